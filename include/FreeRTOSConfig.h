@@ -43,7 +43,7 @@
 /* Scheduler Related */
 #define configUSE_PREEMPTION                    1
 #define configUSE_TICKLESS_IDLE                 0
-#define configUSE_IDLE_HOOK                     0
+#define configUSE_IDLE_HOOK                     1
 #define configUSE_TICK_HOOK                     0
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES                    32
@@ -76,12 +76,12 @@
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
 /* Hook function related definitions. */
-#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            0
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
@@ -108,6 +108,7 @@
 #define configTICK_CORE                         0
 #define configRUN_MULTIPLE_PRIORITIES           1
 #define configUSE_CORE_AFFINITY                 1
+#define configUSE_MINIMAL_IDLE_HOOK             1
 #endif
 
 /* RP2040 specific */
@@ -139,4 +140,24 @@ to exclude the API function. */
 
 /* A header file that defines trace macro can be included here. */
 
+/* The idle hooks, the stack overflow hook and the trace macro below are defined by lib/Health.
+Run time stats count the 1MHz timer, read raw so the kernel sources don't need the SDK timer header. It wraps every
+~71 minutes, the loads are taken over much shorter windows. */
+#include "hardware/regs/addressmap.h"
+#include "hardware/regs/timer.h"
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        ( *( volatile uint32_t * ) ( TIMER_BASE + TIMER_TIMERAWL_OFFSET ) )
+
+#ifndef __ASSEMBLER__
+#ifdef __cplusplus
+extern "C" {
+#endif
+void health_task_switched_in( void );
+#ifdef __cplusplus
+}
+#endif
+/* Load of each core, the time outside of the idle tasks is accumulated on every switch */
+#define traceTASK_SWITCHED_IN()                 health_task_switched_in()
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
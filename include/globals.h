@@ -44,7 +44,10 @@ enum IO
     ENC_B = 3,
     ENC_BTN = 24,
     UART0_TX = 16,
-    UART0_RX = 17
+    UART0_RX = 17,
+
+    THERM_CS_BOTTOM = UART0_RX, // Second thermocouple converter
+    THERM_SDI = UART0_TX        // Only needed by the MAX31856
 };
 
 enum SFTO
@@ -16,6 +16,9 @@
  */
 
 #include "AT24C16.h"
+#include "Log.h"
+
+static AT24C16 *i2c_owner[2]; // Driver waiting on each I2C block, for i2cHandler()
 
 /**
  * @brief Initialize AT24C16 EEPROM
@@ -30,69 +33,269 @@
 bool AT24C16::init(i2c_inst_t *_i2c, uint sda, uint scl, uint32_t speed)
 {
     static uint8_t rxdata = 0;
+    if (mutex == NULL)
+        mutex = xSemaphoreCreateMutex();
+    if (mutex == NULL)
+        return false;
+    // The writer initializes the bus again after a failed write, while the other tasks may be reading
+    xSemaphoreTake(mutex, portMAX_DELAY);
     i2c_inst = _i2c;
     i2c_init(i2c_inst, speed);
     gpio_set_function(sda, GPIO_FUNC_I2C);
     gpio_set_function(scl, GPIO_FUNC_I2C);
     gpio_pull_up(sda);
     gpio_pull_up(scl);
-    return i2c_read_blocking(i2c_inst, AT24C16_i2cAddress, &rxdata, 1, false) > 0;
+    if (!dmaInit())
+        LOG_WARN("AT24C16: no DMA channel left, using blocking transfers\n");
+    detected = i2c_read_blocking(i2c_inst, AT24C16_i2cAddress, &rxdata, 1, false) > 0;
+    xSemaphoreGive(mutex);
+    return detected;
+}
+
+/**
+ * @brief Claim the DMA channels and the I2C interrupt on the first call, then enable the DMA handshake of the I2C
+ * block which is reset by every i2c_init()
+ *
+ * @return false if there's no DMA channel left
+ */
+bool AT24C16::dmaInit()
+{
+    if (dmaTxChannel < 0)
+    {
+        dmaTxChannel = dma_claim_unused_channel(false);
+        dmaRxChannel = dma_claim_unused_channel(false);
+        if (dmaTxChannel < 0 || dmaRxChannel < 0) // Seems we don't have any DMA left, abort
+        {
+            if (dmaTxChannel >= 0)
+                dma_channel_unclaim(dmaTxChannel);
+            if (dmaRxChannel >= 0)
+                dma_channel_unclaim(dmaRxChannel);
+            dmaTxChannel = dmaRxChannel = -1;
+            return false;
+        }
+        // Commands are pushed as 16 bits IC_DATA_CMD words, the data is pulled from its low byte
+        dmaTxConfig = dma_channel_get_default_config(dmaTxChannel);
+        channel_config_set_transfer_data_size(&dmaTxConfig, DMA_SIZE_16);
+        channel_config_set_read_increment(&dmaTxConfig, true);
+        channel_config_set_write_increment(&dmaTxConfig, false);
+        channel_config_set_dreq(&dmaTxConfig, i2c_get_dreq(i2c_inst, true));
+        dmaRxConfig = dma_channel_get_default_config(dmaRxChannel);
+        channel_config_set_transfer_data_size(&dmaRxConfig, DMA_SIZE_8);
+        channel_config_set_read_increment(&dmaRxConfig, false);
+        channel_config_set_write_increment(&dmaRxConfig, true);
+        channel_config_set_dreq(&dmaRxConfig, i2c_get_dreq(i2c_inst, false));
+
+        uint index = i2c_hw_index(i2c_inst);
+        i2c_owner[index] = this;
+        irq_set_exclusive_handler(I2C0_IRQ + index, i2cHandler);
+        irq_set_enabled(I2C0_IRQ + index, true);
+    }
+    i2c_hw_t *hw = i2c_get_hw(i2c_inst);
+    hw->intr_mask = 0;
+    hw->dma_tdlr = 4;
+    hw->dma_rdlr = 0;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    return true;
 }
 
 /**
- * @brief Write memory with specific length to destination address on EEPROM, whole 2048 bytes write takes around ~900ms
+ * @brief STOP detected or transfer aborted, mask the interrupt and wake the waiting task up
+ *
+ */
+void AT24C16::i2cHandler()
+{
+    BaseType_t woken = pdFALSE;
+    for (AT24C16 *self : i2c_owner)
+    {
+        if (self == NULL)
+            continue;
+        i2c_hw_t *hw = i2c_get_hw(self->i2c_inst);
+        if (!hw->intr_stat)
+            continue;
+        hw->intr_mask = 0;
+        if (self->waiter != NULL)
+            vTaskNotifyGiveFromISR(self->waiter, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Push count words of commands to the EEPROM with DMA and sleep until the STOP, the last command must have the
+ * STOP bit. Read bytes are pulled into rx with DMA at the same time. Called with the mutex held, which also covers
+ * filling commands
+ *
+ * @param address EEPROM address, selects the device address of the block
+ * @param count Number of words in commands
+ * @param rx Destination of the read bytes, can be NULL if rxLen is 0
+ * @param rxLen Number of read commands in commands
+ * @return false if the EEPROM didn't acknowledge or the transfer timed out
+ */
+bool AT24C16::transfer(uint16_t address, uint16_t count, uint8_t *rx, uint16_t rxLen)
+{
+    i2c_hw_t *hw = i2c_get_hw(i2c_inst);
+    hw->enable = 0;
+    hw->tar = AT24C16_i2cAddress | ((address >> 8) & 0x07);
+    hw->enable = 1;
+    (void)hw->clr_intr;
+    ulTaskNotifyTake(pdTRUE, 0); // Drop a notification left by a timed out transfer
+    waiter = xTaskGetCurrentTaskHandle();
+
+    if (rxLen)
+        dma_channel_configure(dmaRxChannel, &dmaRxConfig, rx, &hw->data_cmd, rxLen, true);
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    dma_channel_configure(dmaTxChannel, &dmaTxConfig, &hw->data_cmd, commands, count, true);
+
+    bool stopped = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AT24C16_TransferTimeout)) > 0;
+    hw->intr_mask = 0;
+    waiter = NULL;
+    bool ok = stopped && !(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS);
+    if (!ok)
+    {
+        // Stop the DMA before the abort is cleared, otherwise it would start pushing the leftover commands again
+        dma_channel_abort(dmaTxChannel);
+        dma_channel_abort(dmaRxChannel);
+        while (hw->rxflr)
+            (void)hw->data_cmd;
+    }
+    (void)hw->clr_intr;
+    // The last bytes may still be on their way out of the RX FIFO
+    if (ok && rxLen)
+        dma_channel_wait_for_finish_blocking(dmaRxChannel);
+    return ok;
+}
+
+/**
+ * @brief Write memory with specific length to destination address on EEPROM, only the pages whose content differs
+ * from the shadow copy are written. A page is ~7ms, a whole 2048 bytes write takes around ~900ms
  *
  * @param destAddress
  * @param src source memory pointer to write to EEPROM
  * @param len length to be written
+ * @return uint16_t Number of pages actually written
  */
-void AT24C16::memWrite(uint16_t destAddress, const void *src, size_t len)
+uint16_t AT24C16::memWrite(uint16_t destAddress, const void *src, size_t len)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint16_t pagesWritten = write(destAddress, src, len);
+    xSemaphoreGive(mutex);
+    return pagesWritten;
+}
+
+// memWrite() with the mutex held
+uint16_t AT24C16::write(uint16_t destAddress, const void *src, size_t len)
 {
     const uint8_t *p_data = (const uint8_t *)src;
-    // Write first page if not aligned.
-    uint8_t notAlignedLength = 0;
-    uint8_t pageOffset = destAddress % AT24C16_PageSize;
-    if (pageOffset > 0)
-    {
-        notAlignedLength = AT24C16_PageSize - pageOffset;
-        pageWrite(destAddress, p_data, notAlignedLength);
-        len -= notAlignedLength;
-    }
-    if (len > 0)
-    {
-        destAddress += notAlignedLength;
-        p_data += notAlignedLength;
+    uint16_t pagesWritten = 0;
+    writeError = false;
+    if (destAddress >= AT24C16_Size)
+        return 0;
+    if (len > (size_t)(AT24C16_Size - destAddress))
+        len = AT24C16_Size - destAddress;
 
-        // Write complete and aligned pages.
-        uint8_t pageCount = len / AT24C16_PageSize;
-        for (uint8_t i = 0; i < pageCount; i++)
-        {
-            pageWrite(destAddress, p_data, AT24C16_PageSize);
-            destAddress += AT24C16_PageSize;
-            p_data += AT24C16_PageSize;
-            len -= AT24C16_PageSize;
-        }
+    while (len > 0)
+    {
+        // Chunk up to the end of the current page, the first one may not be aligned
+        uint8_t pageOffset = destAddress % AT24C16_PageSize;
+        uint8_t chunk = AT24C16_PageSize - pageOffset;
+        if (chunk > len)
+            chunk = len;
 
-        if (len > 0)
+        // A page that couldn't be read back is written anyway, its shadow copy may be stale
+        uint16_t page = destAddress / AT24C16_PageSize;
+        if (!shadowPage(page) || memcmp(&shadow[destAddress], p_data, chunk) != 0)
         {
-            // Write remaining uncomplete bytes.
-            pageWrite(destAddress, p_data, AT24C16_PageSize);
+            if (!pageWrite(destAddress, p_data, chunk))
+            {
+                // The page content is unknown now, read it back next time
+                shadowValid[page / 8] &= ~(1 << (page % 8));
+                writeError = true;
+                return pagesWritten;
+            }
+            memcpy(&shadow[destAddress], p_data, chunk);
+            pagesWritten++;
         }
+        destAddress += chunk;
+        p_data += chunk;
+        len -= chunk;
     }
+    return pagesWritten;
 }
 
 /**
- * @brief Read memory from EEPROM and save it to passed pointer, whole 2048 bytes read takes around ~52ms
+ * @brief Make sure the shadow copy of a page is known, reads the page back the first time it's needed
+ *
+ * @param page
+ * @return false if the page couldn't be read, its shadow copy is not to be trusted
+ */
+bool AT24C16::shadowPage(uint16_t page)
+{
+    if (shadowValid[page / 8] & (1 << (page % 8)))
+        return true;
+    return read(page * AT24C16_PageSize, &shadow[page * AT24C16_PageSize], AT24C16_PageSize);
+}
+
+/**
+ * @brief Read memory from EEPROM and save it to passed pointer, whole 2048 bytes read takes around ~52ms of bus time
+ * during which the caller sleeps
  *
  * @param srcAddress EEPROM Address to read from
  * @param dest Destination memory pointer to be written from EEPROM
  * @param len Length of memory to be read
+ * @return false if the EEPROM didn't acknowledge or a transfer timed out, dest is then only partly read
  */
-void AT24C16::memRead(uint16_t srcAddress, void *dest, size_t len)
+bool AT24C16::memRead(uint16_t srcAddress, void *dest, size_t len)
 {
-    uint8_t wordAddress = srcAddress & 0xFF;
-    i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((srcAddress >> 8) & 0x07), &wordAddress, 1, false);
-    i2c_read_blocking(i2c_inst, AT24C16_i2cAddress | ((srcAddress >> 8) & 0x07), (uint8_t *)dest, len, false);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool ok = read(srcAddress, dest, len);
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+// memRead() with the mutex held
+bool AT24C16::read(uint16_t srcAddress, void *dest, size_t len)
+{
+    uint8_t *p_dest = (uint8_t *)dest;
+    uint16_t readAddress = srcAddress;
+    size_t left = len;
+    while (left > 0)
+    {
+        // Read block by block, each one has its own device address
+        uint16_t chunk = AT24C16_BlockSize - readAddress % AT24C16_BlockSize;
+        if (chunk > left)
+            chunk = left;
+
+        uint8_t wordAddress = readAddress & 0xFF;
+        if (dmaTxChannel >= 0)
+        {
+            commands[0] = wordAddress;
+            commands[1] = I2C_IC_DATA_CMD_CMD_BITS | I2C_IC_DATA_CMD_RESTART_BITS;
+            for (uint16_t i = 2; i <= chunk; i++)
+                commands[i] = I2C_IC_DATA_CMD_CMD_BITS;
+            commands[chunk] |= I2C_IC_DATA_CMD_STOP_BITS;
+            if (!transfer(readAddress, chunk + 1, p_dest, chunk))
+                return false;
+        }
+        else
+        {
+            i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((readAddress >> 8) & 0x07), &wordAddress, 1, false);
+            if (i2c_read_blocking(i2c_inst, AT24C16_i2cAddress | ((readAddress >> 8) & 0x07), p_dest, chunk, false) !=
+                (int)chunk)
+                return false;
+        }
+        readAddress += chunk;
+        p_dest += chunk;
+        left -= chunk;
+    }
+
+    // Keep what was read in the shadow copy, pages only partially read stay unknown
+    for (size_t i = 0; i < len && srcAddress + i < AT24C16_Size; i++)
+    {
+        uint16_t address = srcAddress + i;
+        shadow[address] = ((uint8_t *)dest)[i];
+        if (address % AT24C16_PageSize == AT24C16_PageSize - 1 && i >= AT24C16_PageSize - 1)
+            shadowValid[address / AT24C16_PageSize / 8] |= 1 << (address / AT24C16_PageSize % 8);
+    }
+    return true;
 }
 
 /**
@@ -103,9 +306,13 @@ void AT24C16::memRead(uint16_t srcAddress, void *dest, size_t len)
  */
 void AT24C16::byteWrite(uint16_t destAddress, uint8_t byte)
 {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    // Keep the shadow copy in sync
+    shadow[destAddress % AT24C16_Size] = byte;
     uint8_t writeBuffer[] = {destAddress & 0xFF, byte};
     i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((destAddress >> 8) & 0x07), writeBuffer, sizeof(writeBuffer),
                        false);
+    xSemaphoreGive(mutex);
 }
 
 /**
@@ -118,40 +325,60 @@ uint8_t AT24C16::byteRead(uint16_t srcAddress)
 {
     uint8_t rx = 0;
     uint8_t address_lnibble = srcAddress & 0xFF;
+    xSemaphoreTake(mutex, portMAX_DELAY);
     i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((srcAddress >> 8) & 0x07), &address_lnibble, 1, false);
     i2c_read_blocking(i2c_inst, AT24C16_i2cAddress | ((srcAddress >> 8) & 0x07), &rx, 1, false);
+    xSemaphoreGive(mutex);
     return rx;
 }
 
 /**
- * @brief Function to write chunk of 16-bytes of data to EEPROM or Page Write operation on EEPROM
+ * @brief Function to write chunk of 16-bytes of data to EEPROM or Page Write operation on EEPROM, returns once the
+ * write cycle is done
  *
  * @param address
  * @param src
  * @param len
+ * @return true if the page was acknowledged and written within AT24C16_WriteTimeout
  */
-void AT24C16::pageWrite(uint16_t address, const uint8_t *src, uint8_t len)
+bool AT24C16::pageWrite(uint16_t address, const uint8_t *src, uint8_t len)
 {
     if (len == 0 || len > 16)
-        return;
-    const uint8_t *src_b = src;
+        return false;
     uint8_t wordAddress = address & 0xFF;
 
-    // Write the address to bus
-    i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((address >> 8) & 0x07), &wordAddress, 1, true);
-    
-    // Write the data to bus
-    for (size_t i = 0; i < len; ++i)
+    if (dmaTxChannel >= 0)
     {
-        while (!i2c_get_write_available(i2c_inst))
-            tight_loop_contents();
-        // Send stop bit if we're on last bit
-        i2c_get_hw(i2c_inst)->data_cmd = (i == len - 1) ? *src_b++ | (1 << 9) : *src_b++;
+        commands[0] = wordAddress;
+        for (uint8_t i = 0; i < len; i++)
+            commands[i + 1] = src[i];
+        commands[len] |= I2C_IC_DATA_CMD_STOP_BITS;
+        if (!transfer(address, len + 1, NULL, 0))
+            return false;
+    }
+    else
+    {
+        uint8_t writeBuffer[1 + AT24C16_PageSize];
+        writeBuffer[0] = wordAddress;
+        memcpy(&writeBuffer[1], src, len);
+        if (i2c_write_blocking(i2c_inst, AT24C16_i2cAddress | ((address >> 8) & 0x07), writeBuffer, len + 1, false) !=
+            len + 1)
+            return false;
     }
     // From Datasheet
     // tWR max 5ms
-    // Note: 1. The write cycle time tWR is the time 
+    // Note: 1. The write cycle time tWR is the time
     // from a valid stop condition of a write sequence to the end of the
     // internal clear/write cycle
-    vTaskDelay(7 / portTICK_PERIOD_MS);
+    // The device doesn't acknowledge its address during the write cycle, so poll it instead of waiting the worst
+    // case. A dummy current address read is harmless
+    absolute_time_t timeout = make_timeout_time_us(AT24C16_WriteTimeout);
+    uint8_t dummy;
+    while (i2c_read_blocking(i2c_inst, AT24C16_i2cAddress, &dummy, 1, false) < 0)
+    {
+        if (time_reached(timeout))
+            return false;
+        vTaskDelay(1);
+    }
+    return true;
 }
\ No newline at end of file
@@ -17,25 +17,60 @@
 #ifndef _AT24Cxx_H_
 #include "pico/stdlib.h"
 #include <hardware/i2c.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
 #include <stdio.h>
 #include <string.h>
 #include "FreeRTOS.h"
+#include "semphr.h"
 #include "task.h"
 #define _AT24Cxx_H_
 
 static constexpr uint8_t AT24C16_PageSize = 16;
+static constexpr uint16_t AT24C16_Size = 2048;
 static constexpr uint8_t AT24C16_i2cAddress = 0x50;
+static constexpr uint32_t AT24C16_WriteTimeout = 10000; // in uS, tWR is 5ms max
+static constexpr uint32_t AT24C16_TransferTimeout = 50;  // in mS, a 256 bytes block is ~6ms at 400kHz
+static constexpr uint16_t AT24C16_BlockSize = 256;       // Bytes addressed by one device address
 
 class AT24C16
 {
   public:
     bool init(i2c_inst_t *i2c, uint sda, uint scl, uint32_t speed);
-    void memWrite(uint16_t destAddress, const void *src, size_t len);
-    void memRead(uint16_t srcAddress, void *dest, size_t len);
+    uint16_t memWrite(uint16_t destAddress, const void *src, size_t len);
+    bool memRead(uint16_t srcAddress, void *dest, size_t len);
     void byteWrite(uint16_t destAddress, uint8_t byte);
     uint8_t byteRead(uint16_t srcAddress);
+    // True if a page of the last memWrite() was not acknowledged or its write cycle never ended
+    __force_inline bool getWriteError() { return writeError; }
+    // Result of the last init()
+    __force_inline bool isDetected() { return detected; }
+    // Forget the shadow copy, needed if anything else than this driver writes the EEPROM
+    __force_inline void invalidate() { memset(shadowValid, 0, sizeof(shadowValid)); }
   private:
     i2c_inst_t *i2c_inst;
-    void pageWrite(uint16_t address, const uint8_t *src, uint8_t len);
+    // Taken by every public access, the writer task and the loads of the other tasks share the bus, the DMA
+    // channels, commands and the shadow copy
+    SemaphoreHandle_t mutex = NULL;
+    uint16_t write(uint16_t destAddress, const void *src, size_t len);
+    bool read(uint16_t srcAddress, void *dest, size_t len);
+    bool pageWrite(uint16_t address, const uint8_t *src, uint8_t len);
+    bool dmaInit();
+    bool transfer(uint16_t address, uint16_t count, uint8_t *rx, uint16_t rxLen);
+    static void i2cHandler();
+    // The transfers are DMA paced and the caller sleeps until the STOP, falls back to blocking if no DMA is left
+    int dmaTxChannel = -1;
+    int dmaRxChannel = -1;
+    dma_channel_config dmaTxConfig;
+    dma_channel_config dmaRxConfig;
+    volatile TaskHandle_t waiter = NULL;
+    // IC_DATA_CMD words of the current transfer, the word address followed by up to a block of data or read commands
+    uint16_t commands[1 + AT24C16_BlockSize];
+    bool writeError = false;
+    bool detected = false;
+    bool shadowPage(uint16_t page);
+    // Copy of the EEPROM content, only pages flagged in shadowValid are known
+    uint8_t shadow[AT24C16_Size];
+    uint8_t shadowValid[AT24C16_Size / AT24C16_PageSize / 8] = {};
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+/**
+ * @file AT24C16Store.cpp
+ * @brief Record store on the AT24C16 EEPROM with CRC, schema version, atomic commit and wear rotation
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "AT24C16Store.h"
+
+uint16_t AT24C16Store::slotAddress(uint8_t group, uint8_t slot)
+{
+    return groups[group].base + (uint16_t)groups[group].slotSize * slot;
+}
+
+// CRC16-CCITT of the id, version and sequence followed by the slot data, the CRC field itself is skipped
+uint16_t AT24C16Store::crc(const uint8_t *slot, uint8_t slotSize)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < slotSize; i++)
+    {
+        if (i == 4 || i == 5)
+            continue;
+        crc ^= (uint16_t)slot[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+bool AT24C16Store::isFree(uint8_t group, uint8_t slot)
+{
+    for (uint8_t id = 0; id < recordCount; id++)
+        if (recordGroup[id] == group && newest[id] == slot)
+            return false;
+    return true;
+}
+
+/**
+ * @brief Read every slot once and index the newest valid copy of every record, call once at boot before load()
+ * and save()
+ *
+ * @param i2c
+ * @param sda
+ * @param scl
+ * @param speed
+ * @return false if the EEPROM didn't answer or couldn't be read, every load() then fails and the defaults are kept
+ */
+bool AT24C16Store::mount(i2c_inst_t *i2c, uint sda, uint scl, uint32_t speed)
+{
+    if (mutex == NULL)
+        mutex = xSemaphoreCreateMutex();
+    memset(newest, AT24C16STORE_NO_SLOT, sizeof(newest));
+    validCount = 0;
+    sequence = 0;
+    readError = false;
+    detected = eeprom->init(i2c, sda, scl, speed);
+    if (!detected)
+        return false;
+
+    // The global sequence goes on from the newest slot of the whole EEPROM, the rotation of each group from the
+    // newest slot of that group
+    uint16_t newestSequence[AT24C16STORE_MAX_RECORD];
+    uint8_t slot[AT24C16STORE_MAX_SLOT];
+    bool first = true;
+    for (uint8_t g = 0; g < groupCount; g++)
+    {
+        uint8_t size = groups[g].slotSize;
+        bool groupFirst = true;
+        uint16_t groupSequence = 0;
+        nextSlot[g] = 0;
+        if (size > AT24C16STORE_MAX_SLOT)
+            continue;
+        for (uint8_t s = 0; s < groups[g].slotCount; s++)
+        {
+            // The slots in use aren't known if a read failed, a save could then overwrite the newest copy of a record
+            if (!eeprom->memRead(slotAddress(g, s), slot, size))
+            {
+                readError = true;
+                memset(newest, AT24C16STORE_NO_SLOT, sizeof(newest));
+                validCount = 0;
+                return false;
+            }
+            uint8_t id = slot[0];
+            uint16_t seq = slot[2] | (uint16_t)slot[3] << 8;
+            if (id >= recordCount || recordGroup[id] != g || slot[1] != version ||
+                crc(slot, size) != (slot[4] | (uint16_t)slot[5] << 8))
+                continue;
+
+            // Sequences wrap around, a copy is newer if it's less than half the range ahead
+            if (newest[id] == AT24C16STORE_NO_SLOT)
+                validCount++;
+            else if ((int16_t)(seq - newestSequence[id]) <= 0)
+                continue;
+            newest[id] = s;
+            newestSequence[id] = seq;
+            if (groupFirst || (int16_t)(seq - groupSequence) > 0)
+            {
+                groupSequence = seq;
+                nextSlot[g] = (s + 1) % groups[g].slotCount;
+            }
+            groupFirst = false;
+            if (first || (int16_t)(seq - sequence) > 0)
+                sequence = seq;
+            first = false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Copy the newest valid copy of a record
+ *
+ * @param id
+ * @param dest
+ * @param len Length of the record, must fit in the slot of its group
+ * @return false if there's no valid copy or it couldn't be read, dest may then be overwritten with what was read
+ */
+bool AT24C16Store::load(uint8_t id, void *dest, size_t len)
+{
+    if (id >= recordCount || newest[id] == AT24C16STORE_NO_SLOT)
+        return false;
+    uint8_t g = recordGroup[id];
+    if (len > (size_t)(groups[g].slotSize - AT24C16STORE_HEADER_SIZE))
+        return false;
+    return writer->read(slotAddress(g, newest[id]) + AT24C16STORE_HEADER_SIZE, dest, len);
+}
+
+/**
+ * @brief Queue a new copy of a record on the next free slot of its group
+ * The old copy becomes free and is only reused once every other free slot of the group was written, so it's still
+ * there to fall back to if this write is torn.
+ *
+ * @param id
+ * @param src
+ * @param len Length of the record, must fit in the slot of its group
+ * @param callback Passed to the writer, called with the slot address
+ * @return false if the record doesn't fit, the writer queue is full or the EEPROM couldn't be read on mount()
+ */
+bool AT24C16Store::save(uint8_t id, const void *src, size_t len, AT24C16WriterCallback callback)
+{
+    if (id >= recordCount || readError)
+        return false;
+    uint8_t g = recordGroup[id];
+    uint8_t size = groups[g].slotSize;
+    if (size > AT24C16STORE_MAX_SLOT || len > (size_t)(size - AT24C16STORE_HEADER_SIZE))
+        return false;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint8_t slot = AT24C16STORE_NO_SLOT;
+    for (uint8_t i = 0; i < groups[g].slotCount && slot == AT24C16STORE_NO_SLOT; i++)
+    {
+        uint8_t s = (nextSlot[g] + i) % groups[g].slotCount;
+        if (isFree(g, s))
+            slot = s;
+    }
+    if (slot == AT24C16STORE_NO_SLOT)
+    {
+        xSemaphoreGive(mutex);
+        return false;
+    }
+
+    uint16_t address = slotAddress(g, slot);
+    uint8_t dest[AT24C16STORE_MAX_SLOT];
+    sequence++;
+    dest[0] = id;
+    dest[1] = version;
+    dest[2] = sequence & 0xFF;
+    dest[3] = sequence >> 8;
+    memcpy(&dest[AT24C16STORE_HEADER_SIZE], src, len);
+    memset(&dest[AT24C16STORE_HEADER_SIZE + len], 0, size - AT24C16STORE_HEADER_SIZE - len);
+    uint16_t sum = crc(dest, size);
+    dest[4] = sum & 0xFF;
+    dest[5] = sum >> 8;
+    bool queued = writer->write(address, dest, size, callback);
+    if (queued)
+    {
+        if (newest[id] == AT24C16STORE_NO_SLOT)
+            validCount++;
+        newest[id] = slot;
+        nextSlot[g] = (slot + 1) % groups[g].slotCount;
+    }
+    xSemaphoreGive(mutex);
+    return queued;
+}
+
+/**
+ * @brief Queue a write outside of the groups, readRaw() reads it back even before it's written
+ *
+ * @param address
+ * @param src
+ * @param len
+ * @param callback Passed to the writer
+ * @return false if the region is out of the EEPROM, the writer queue is full or the EEPROM couldn't be read on
+ * mount()
+ */
+bool AT24C16Store::writeRaw(uint16_t address, const void *src, size_t len, AT24C16WriterCallback callback)
+{
+    if (readError || address >= AT24C16_Size || len > (size_t)(AT24C16_Size - address))
+        return false;
+    return writer->write(address, src, len, callback);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file AT24C16Store.h
+ * @brief Record store on the AT24C16 EEPROM with CRC, schema version, atomic commit and wear rotation
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The EEPROM is split in groups of fixed size slots, each group has more slots than records so there is always a
+ * free slot. Every slot starts with a header:
+ *   [0] record id, [1] schema version, [2..3] sequence, [4..5] CRC16 of the id, version, sequence and slot data
+ * A record is never rewritten in place, save() writes it with the next sequence on the next free slot of its group
+ * and the old copy is left untouched until that slot is reused. A torn write fails the CRC and mount() falls back to
+ * the older copy, while the round-robin choice of the free slot spreads the writes over the whole group. Slots are
+ * laid out on whole pages, so a torn page write only ever hits the slot being written.
+ * save() and writeRaw() may be called from any task, writer callbacks included, save() is serialized by a mutex.
+ * Nothing of the EEPROM is kept in RAM, load() and readRaw() read it through the writer.
+ */
+#ifndef _AT24C16STORE_H_
+#include "AT24C16.h"
+#include "AT24C16Writer.h"
+#define _AT24C16STORE_H_
+
+#define AT24C16STORE_HEADER_SIZE 6
+#define AT24C16STORE_MAX_RECORD 32
+#define AT24C16STORE_MAX_GROUP 4
+#define AT24C16STORE_NO_SLOT 0xFF
+#define AT24C16STORE_MAX_SLOT 128 // Built on the stack of the caller, header included
+
+struct AT24C16StoreGroup
+{
+    uint16_t base;     // EEPROM address of the first slot
+    uint8_t slotSize;  // Header included
+    uint8_t slotCount; // Records of the group plus the free slots
+};
+
+// For a static_assert on the layout, a slot spanning part of a page shares the write cycle of its neighbour and a
+// slot over AT24C16STORE_MAX_SLOT is never mounted nor saved
+static constexpr bool AT24C16Store_isPageAligned(const AT24C16StoreGroup *groups, uint8_t groupCount)
+{
+    for (uint8_t g = 0; g < groupCount; g++)
+        if (groups[g].base % AT24C16_PageSize || groups[g].slotSize % AT24C16_PageSize ||
+            groups[g].slotSize > AT24C16STORE_MAX_SLOT)
+            return false;
+    return true;
+}
+
+class AT24C16Store
+{
+public:
+    AT24C16Store(AT24C16 *_eeprom, AT24C16Writer *_writer, const AT24C16StoreGroup *_groups, uint8_t _groupCount,
+                 const uint8_t *_recordGroup, uint8_t _recordCount, uint8_t _version)
+        : eeprom(_eeprom), writer(_writer), groups(_groups), groupCount(_groupCount), recordGroup(_recordGroup),
+          recordCount(_recordCount), version(_version)
+    {
+    }
+    bool mount(i2c_inst_t *i2c, uint sda, uint scl, uint32_t speed);
+    bool load(uint8_t id, void *dest, size_t len);
+    bool save(uint8_t id, const void *src, size_t len, AT24C16WriterCallback callback = NULL);
+    bool writeRaw(uint16_t address, const void *src, size_t len, AT24C16WriterCallback callback = NULL);
+    // For the areas laid out outside of the groups, the writes still queued are read back too
+    __force_inline bool readRaw(uint16_t address, void *dest, size_t len)
+    {
+        return !readError && writer->read(address, dest, len);
+    }
+    // True if the EEPROM answered on mount()
+    __force_inline bool isDetected() { return detected; }
+    // True if the EEPROM answered on mount() but couldn't be read, nothing is written to it until the next mount()
+    __force_inline bool getReadError() { return readError; }
+    // Records with a valid copy found by mount()
+    __force_inline uint8_t getValidCount() { return validCount; }
+
+protected:
+    uint16_t slotAddress(uint8_t group, uint8_t slot);
+    uint16_t crc(const uint8_t *slot, uint8_t slotSize);
+    bool isFree(uint8_t group, uint8_t slot);
+
+    AT24C16 *eeprom;
+    AT24C16Writer *writer;
+    const AT24C16StoreGroup *groups;
+    uint8_t groupCount;
+    const uint8_t *recordGroup; // Group of each record id
+    uint8_t recordCount;
+    uint8_t version;
+    SemaphoreHandle_t mutex = NULL; // Created by mount(), guards the slot indexes and the sequence
+    bool detected = false;
+    bool readError = false;
+    uint8_t validCount = 0;
+    uint16_t sequence = 0;                           // Sequence of the last written slot
+    uint8_t newest[AT24C16STORE_MAX_RECORD];         // Slot of the newest valid copy in its group, or NO_SLOT
+    uint8_t nextSlot[AT24C16STORE_MAX_GROUP] = {};   // Where the search for a free slot starts
+};
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file AT24C16Writer.cpp
+ * @brief Background writer for the AT24C16 EEPROM, so the caller never waits for the write cycles
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "AT24C16Writer.h"
+#include "Log.h"
+#include <algorithm>
+
+/**
+ * @brief Create the request queue and the writer task, call once before the scheduler starts
+ *
+ * @param priority Priority of the writer task, should be the lowest one
+ * @param stackSize Stack of the writer task in words
+ * @return true if the queue and the task were created
+ */
+bool AT24C16Writer::init(UBaseType_t priority, uint32_t stackSize)
+{
+    pending = 0;
+    queue = xQueueCreate(AT24C16WRITER_QUEUE_LENGTH, sizeof(Request));
+    stagingMutex = xSemaphoreCreateMutex();
+    if (queue == NULL || stagingMutex == NULL)
+        return false;
+    return xTaskCreate(task, "eeprom_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+/**
+ * @brief Queue a region to be written, the data is copied so src can be reused as soon as this returns
+ *
+ * @param address EEPROM address to write to
+ * @param src Data to be written
+ * @param len Length of the data
+ * @param callback Called from the writer task when done, can be NULL
+ * @return false if the region is out of the EEPROM or the queue is full
+ */
+bool AT24C16Writer::write(uint16_t address, const void *src, size_t len, AT24C16WriterCallback callback)
+{
+    if (len == 0 || address >= AT24C16_Size || len > (size_t)(AT24C16_Size - address))
+        return false;
+
+    Request request = {address, (uint16_t)len, callback};
+    xSemaphoreTake(stagingMutex, portMAX_DELAY);
+    memcpy(&staging[address], src, len);
+    markQueued(address, len, 1);
+    taskENTER_CRITICAL();
+    pending++;
+    taskEXIT_CRITICAL();
+    bool sent = xQueueSend(queue, &request, 0) == pdTRUE;
+    if (!sent)
+    {
+        markQueued(address, len, -1);
+        taskENTER_CRITICAL();
+        pending--;
+        taskEXIT_CRITICAL();
+    }
+    xSemaphoreGive(stagingMutex);
+    return sent;
+}
+
+/**
+ * @brief Read the EEPROM, the pages with a queued request are taken from the staging image instead
+ *
+ * @param address EEPROM address to read from
+ * @param dest
+ * @param len
+ * @return false if the region is out of the EEPROM or the read failed
+ */
+bool AT24C16Writer::read(uint16_t address, void *dest, size_t len)
+{
+    if (len == 0 || address >= AT24C16_Size || len > (size_t)(AT24C16_Size - address))
+        return false;
+
+    // Held across the read so the task can't finish a page in between and drop it from the overlay
+    xSemaphoreTake(stagingMutex, portMAX_DELAY);
+    bool ok = eeprom->memRead(address, dest, len);
+    uint16_t end = address + len;
+    for (uint16_t page = address / AT24C16_PageSize; ok && page <= (end - 1) / AT24C16_PageSize; page++)
+    {
+        if (!queued[page])
+            continue;
+        uint16_t from = std::max<uint16_t>(page * AT24C16_PageSize, address);
+        uint16_t to = std::min<uint16_t>((page + 1) * AT24C16_PageSize, end);
+        memcpy((uint8_t *)dest + (from - address), &staging[from], to - from);
+    }
+    xSemaphoreGive(stagingMutex);
+    return ok;
+}
+
+// Count a request in or out of the pages it covers, stagingMutex has to be held
+void AT24C16Writer::markQueued(uint16_t address, uint16_t len, int8_t delta)
+{
+    for (uint16_t page = address / AT24C16_PageSize; page <= (address + len - 1) / AT24C16_PageSize; page++)
+        queued[page] += delta;
+}
+
+void AT24C16Writer::task(void *pvParameter)
+{
+    AT24C16Writer *self = (AT24C16Writer *)pvParameter;
+    Request requests[AT24C16WRITER_QUEUE_LENGTH];
+    for (;;)
+    {
+        // Wait for a request, then take whatever else was queued meanwhile
+        xQueueReceive(self->queue, &requests[0], portMAX_DELAY);
+        uint8_t count = 1;
+        while (count < AT24C16WRITER_QUEUE_LENGTH && xQueueReceive(self->queue, &requests[count], 0) == pdTRUE)
+            count++;
+        self->process(requests, count);
+    }
+}
+
+/**
+ * @brief Merge the overlapping or touching requests and write each merged region once
+ *
+ * @param requests
+ * @param count
+ */
+void AT24C16Writer::process(Request *requests, uint8_t count)
+{
+    uint16_t start[AT24C16WRITER_QUEUE_LENGTH], end[AT24C16WRITER_QUEUE_LENGTH];
+    uint8_t regionOf[AT24C16WRITER_QUEUE_LENGTH];
+    uint8_t regions = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        start[regions] = requests[i].address;
+        end[regions] = requests[i].address + requests[i].len;
+        regionOf[i] = regions++;
+    }
+    // Keep merging until no two regions overlap or touch, a merge can make a region reach another one
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (uint8_t a = 0; a < regions && !merged; a++)
+            for (uint8_t b = a + 1; b < regions && !merged; b++)
+            {
+                if (start[b] > end[a] || start[a] > end[b])
+                    continue;
+                start[a] = start[a] < start[b] ? start[a] : start[b];
+                end[a] = end[a] > end[b] ? end[a] : end[b];
+                // Move the last region into b and point its requests to the new places
+                regions--;
+                start[b] = start[regions];
+                end[b] = end[regions];
+                for (uint8_t i = 0; i < count; i++)
+                {
+                    if (regionOf[i] == b)
+                        regionOf[i] = a;
+                    else if (regionOf[i] == regions)
+                        regionOf[i] = b;
+                }
+                merged = true;
+            }
+    }
+
+    // The bus is brought up once at boot, it's only initialized again if it wasn't there or the last batch failed
+    bool detected = eeprom->isDetected();
+    if (!detected || recover)
+        detected = eeprom->init(i2c, sda, scl, speed);
+    recover = false;
+    uint16_t pages[AT24C16WRITER_QUEUE_LENGTH];
+    bool ok[AT24C16WRITER_QUEUE_LENGTH];
+    for (uint8_t r = 0; r < regions; r++)
+    {
+        pages[r] = 0;
+        ok[r] = false;
+        if (!detected)
+            continue;
+        xSemaphoreTake(stagingMutex, portMAX_DELAY);
+        memcpy(&scratch[start[r]], &staging[start[r]], end[r] - start[r]);
+        xSemaphoreGive(stagingMutex);
+        pages[r] = eeprom->memWrite(start[r], &scratch[start[r]], end[r] - start[r]);
+        ok[r] = !eeprom->getWriteError();
+        if (!ok[r])
+            recover = true;
+    }
+    if (!detected)
+        LOG_ERROR("EEPROM Not detected!\n");
+
+    // Written or failed, read() goes back to the EEPROM for these pages either way
+    xSemaphoreTake(stagingMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++)
+        markQueued(requests[i].address, requests[i].len, -1);
+    xSemaphoreGive(stagingMutex);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (requests[i].callback)
+            requests[i].callback(requests[i].address, pages[regionOf[i]], ok[regionOf[i]]);
+        taskENTER_CRITICAL();
+        pending--;
+        taskEXIT_CRITICAL();
+    }
+}
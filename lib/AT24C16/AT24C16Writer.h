@@ -0,0 +1,63 @@
+/**
+ * @file AT24C16Writer.h
+ * @brief Background writer for the AT24C16 EEPROM, so the caller never waits for the write cycles
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * write() copies the data into a staging image of the EEPROM and queues the region, then a low priority task
+ * writes it. Requests queued while the task is busy are merged when they overlap or touch, so saving the same
+ * region several times in a row only writes it once with the latest data. read() reads the EEPROM with the queued
+ * data laid over it, so a region reads back what was last queued even before the task wrote it.
+ */
+#ifndef _AT24C16WRITER_H_
+#include "AT24C16.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+#define _AT24C16WRITER_H_
+
+#define AT24C16WRITER_QUEUE_LENGTH 16
+
+// Called from the writer task once the region was written, must not call into LVGL
+typedef void (*AT24C16WriterCallback)(uint16_t address, uint16_t pagesWritten, bool ok);
+
+class AT24C16Writer
+{
+public:
+    AT24C16Writer(AT24C16 *_eeprom, i2c_inst_t *_i2c, uint _sda, uint _scl, uint32_t _speed)
+        : eeprom(_eeprom), i2c(_i2c), sda(_sda), scl(_scl), speed(_speed)
+    {
+    }
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    bool write(uint16_t address, const void *src, size_t len, AT24C16WriterCallback callback = NULL);
+    bool read(uint16_t address, void *dest, size_t len);
+    // True while a request is queued or being written
+    __force_inline bool isBusy() { return pending > 0; }
+
+protected:
+    struct Request
+    {
+        uint16_t address;
+        uint16_t len;
+        AT24C16WriterCallback callback;
+    };
+    static void task(void *pvParameter);
+    void process(Request *requests, uint8_t count);
+    void markQueued(uint16_t address, uint16_t len, int8_t delta);
+
+    AT24C16 *eeprom;
+    i2c_inst_t *i2c;
+    uint sda, scl;
+    uint32_t speed;
+    QueueHandle_t queue;
+    SemaphoreHandle_t stagingMutex;
+    volatile uint32_t pending;
+    bool recover = false; // Set after a failed write so the next batch initializes the bus again, task only
+    uint8_t staging[AT24C16_Size]; // Latest data of every queued region, guarded by stagingMutex
+    uint8_t queued[AT24C16_Size / AT24C16_PageSize] = {}; // Requests not written yet on each page, same guard
+    uint8_t scratch[AT24C16_Size]; // Snapshot of a region while it's written, only used by the task
+};
+#endif
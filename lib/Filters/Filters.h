@@ -0,0 +1,181 @@
+/**
+ * @file Filters.h
+ * @brief Header-only fixed-point filters with compile-time capacity and no heap allocation
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every filter takes and returns Q15.16 fixed-point values (see Filters::toFixed()), so the fractional part of an
+ * average is kept instead of being rounded back to whole ADC counts. The 12-bit MAX6675 readout fits with plenty of
+ * headroom.
+ */
+#ifndef _FILTERS_H_
+#include <stddef.h>
+#include <stdint.h>
+#define _FILTERS_H_
+
+namespace Filters
+{
+typedef int32_t fixed_t;
+static constexpr int fracBits = 16;
+
+inline constexpr fixed_t toFixed(int32_t value) { return value * (1 << fracBits); }
+inline constexpr fixed_t toFixed(float value) { return (fixed_t)(value * (1 << fracBits)); }
+inline constexpr float toFloat(fixed_t value) { return value / (float)(1 << fracBits); }
+
+// Simple moving average of the last N samples, the sum is kept so each update is O(1)
+template <size_t N> class SMA
+{
+    static_assert(N > 0, "SMA needs at least one sample");
+
+public:
+    void reset()
+    {
+        sum = 0;
+        count = 0;
+        next = 0;
+    }
+    fixed_t update(fixed_t sample)
+    {
+        if (count < N)
+            count++;
+        else
+            sum -= samples[next];
+        sum += sample;
+        samples[next] = sample;
+        if (++next >= N)
+            next = 0;
+        return value();
+    }
+    fixed_t value() const { return count ? sum / (int64_t)count : 0; }
+    bool ready() const { return count == N; }
+
+private:
+    fixed_t samples[N];
+    int64_t sum = 0;
+    size_t count = 0;
+    size_t next = 0;
+};
+
+// Exponential moving average with alpha = 1 / 2^Shift, the first sample initializes the state
+template <unsigned Shift> class EMA
+{
+    static_assert(Shift > 0 && Shift < fracBits, "EMA shift out of range");
+
+public:
+    void reset() { initialized = false; }
+    fixed_t update(fixed_t sample)
+    {
+        if (!initialized)
+        {
+            state = sample;
+            initialized = true;
+        }
+        else // Arithmetic shift, rounds toward minus infinity like the division it replaces
+            state += (sample - state) >> Shift;
+        return state;
+    }
+    fixed_t value() const { return state; }
+    bool ready() const { return initialized; }
+
+private:
+    fixed_t state = 0;
+    bool initialized = false;
+};
+
+// Median of the last N samples, removes single sample spikes without smearing them like an average
+template <size_t N> class Median
+{
+    static_assert(N % 2 == 1, "Median needs an odd number of samples");
+
+public:
+    void reset()
+    {
+        count = 0;
+        next = 0;
+    }
+    fixed_t update(fixed_t sample)
+    {
+        samples[next] = sample;
+        if (++next >= N)
+            next = 0;
+        if (count < N)
+            count++;
+
+        // Insertion sort of a copy, N is small enough that this beats keeping a sorted structure
+        fixed_t sorted[N];
+        for (size_t i = 0; i < count; i++)
+        {
+            fixed_t key = samples[i];
+            size_t j = i;
+            for (; j > 0 && sorted[j - 1] > key; j--)
+                sorted[j] = sorted[j - 1];
+            sorted[j] = key;
+        }
+        median = sorted[count / 2];
+        return median;
+    }
+    fixed_t value() const { return median; }
+    bool ready() const { return count == N; }
+
+private:
+    fixed_t samples[N];
+    fixed_t median = 0;
+    size_t count = 0;
+    size_t next = 0;
+};
+
+/*
+ * First derivative from a Savitzky-Golay fit over the last N samples (N odd, linear or quadratic fit give the same
+ * coefficients). The result is the slope in units per sample at the center of the window, so it lags by (N - 1) / 2
+ * samples, divide by the sample period to get units per second.
+ */
+template <size_t N> class SavitzkyGolayDerivative
+{
+    static_assert(N % 2 == 1 && N >= 3, "Savitzky-Golay derivative needs an odd window of at least 3 samples");
+    static constexpr int32_t half = N / 2;
+    static constexpr int64_t norm = half * (half + 1) * (2 * half + 1) / 3; // Sum of i^2 for i in -half..half
+
+public:
+    void reset()
+    {
+        count = 0;
+        next = 0;
+        slope = 0;
+    }
+    fixed_t update(fixed_t sample)
+    {
+        samples[next] = sample;
+        if (++next >= N)
+            next = 0;
+        if (count < N)
+        {
+            count++;
+            if (count < N)
+                return slope;
+        }
+
+        // samples[next] is the oldest sample now, weighted by -half
+        int64_t acc = 0;
+        size_t index = next;
+        for (int32_t i = -half; i <= half; i++)
+        {
+            acc += (int64_t)i * samples[index];
+            if (++index >= N)
+                index = 0;
+        }
+        slope = acc / norm;
+        return slope;
+    }
+    fixed_t value() const { return slope; }
+    bool ready() const { return count == N; }
+
+private:
+    fixed_t samples[N];
+    fixed_t slope = 0;
+    size_t count = 0;
+    size_t next = 0;
+};
+} // namespace Filters
+#endif
@@ -0,0 +1,63 @@
+// Host benchmark of the filters, prints the average cost of one update() and the output on a noisy ramp.
+// Build and run from this folder:
+//   g++ -O2 -std=c++17 -I../.. benchmark.cpp -o benchmark && ./benchmark
+// Cycle counts come from the TSC on x86 hosts, other hosts print nanoseconds instead.
+
+#include "Filters.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCHMARK_UNIT "cycles"
+static inline uint64_t now() { return __rdtsc(); }
+#else
+#define BENCHMARK_UNIT "ns"
+static inline uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+static constexpr int sampleCount = 100000;
+static Filters::fixed_t input[sampleCount];
+
+template <typename Filter> static void benchmark(const char *name)
+{
+    Filter filter;
+    filter.reset();
+    volatile Filters::fixed_t sink = 0; // Keep the compiler from optimizing the updates away
+    uint64_t start = now();
+    for (int i = 0; i < sampleCount; i++)
+        sink = filter.update(input[i]);
+    uint64_t elapsed = now() - start;
+    (void)sink;
+    printf("%-28s %8.1f %s/update   last output %10.4f\n", name, (double)elapsed / sampleCount, BENCHMARK_UNIT,
+           Filters::toFloat(filter.value()));
+}
+
+int main()
+{
+    // 0.25 celcius MAX6675 counts: 1 count per sample ramp with +-2 counts of noise and a spike every 100 samples
+    srand(1);
+    for (int i = 0; i < sampleCount; i++)
+    {
+        int32_t counts = 400 + i % 2000 + rand() % 5 - 2;
+        if (i % 100 == 0)
+            counts += 200;
+        input[i] = Filters::toFixed(counts);
+    }
+
+    printf("Input last sample %d counts\n", (int)(input[sampleCount - 1] >> Filters::fracBits));
+    benchmark<Filters::SMA<10>>("SMA<10>");
+    benchmark<Filters::SMA<32>>("SMA<32>");
+    benchmark<Filters::EMA<2>>("EMA<2>");
+    benchmark<Filters::EMA<4>>("EMA<4>");
+    benchmark<Filters::Median<5>>("Median<5>");
+    benchmark<Filters::Median<9>>("Median<9>");
+    benchmark<Filters::SavitzkyGolayDerivative<5>>("SavitzkyGolayDerivative<5>");
+    benchmark<Filters::SavitzkyGolayDerivative<11>>("SavitzkyGolayDerivative<11>");
+    return 0;
+}
@@ -0,0 +1,424 @@
+/**
+ * @file FlashKV.cpp
+ * @brief Log-structured key-value store on a reserved region of the RP2040 QSPI flash
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FlashKV.h"
+
+extern char __flash_binary_end; // From the linker script, the region must not overlap the program
+
+// CRC16-CCITT of the key and length followed by the value, the CRC field itself is skipped
+uint16_t FlashKV::crc(const uint8_t *record, uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < FLASHKV_HEADER_SIZE + len; i++)
+    {
+        if (i == 4 || i == 5)
+            continue;
+        crc ^= (uint16_t)record[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+uint16_t FlashKV::lengthOf(uint32_t record)
+{
+    const uint8_t *header = at(record);
+    return header[2] | (uint16_t)header[3] << 8;
+}
+
+// Live data is kept below two sectors worth of space, so a compaction always has somewhere to move it to
+uint32_t FlashKV::capacity()
+{
+    return (uint32_t)(sectorCount - 2) * (FLASH_SECTOR_SIZE - FLASHKV_SECTOR_HEADER_SIZE) -
+           recordSize(FLASHKV_MAX_VALUE);
+}
+
+uint32_t FlashKV::liveBytes()
+{
+    uint32_t live = 0;
+    for (uint8_t s = 0; s < sectorCount; s++)
+        live += sectorLive[s];
+    return live;
+}
+
+uint8_t FlashKV::erasedCount()
+{
+    uint8_t count = 0;
+    for (uint8_t s = 0; s < sectorCount; s++)
+        if (state[s] == SECTOR_ERASED)
+            count++;
+    return count;
+}
+
+/**
+ * @brief Create the mutexes and the writer task, call once before the scheduler starts
+ *
+ * @param priority Priority of the writer task, should be the lowest one
+ * @param stackSize Stack of the writer task in words
+ * @return true if the mutexes and the task were created
+ */
+bool FlashKV::init(UBaseType_t priority, uint32_t stackSize)
+{
+    first = 0;
+    queued = 0;
+    storeMutex = xSemaphoreCreateMutex();
+    queueMutex = xSemaphoreCreateMutex();
+    if (storeMutex == NULL || queueMutex == NULL)
+        return false;
+    return xTaskCreate(task, "flash_task", stackSize, this, priority, &writer) == pdPASS;
+}
+
+/**
+ * @brief Scan the region and index the newest valid record of every key, only reads through XIP so it can be
+ * called before the scheduler starts
+ *
+ * @return false if the region is misplaced, every get() then fails and put() is refused
+ */
+bool FlashKV::mount()
+{
+    mounted = false;
+    memset(index, 0xFF, sizeof(index));
+    memset(sectorLive, 0, sizeof(sectorLive));
+    head = FLASHKV_NO_SECTOR;
+    headUsed = 0;
+    sequence = 0;
+    if (offset % FLASH_SECTOR_SIZE || sectorCount < 3 || sectorCount > FLASHKV_MAX_SECTOR ||
+        offset + (uint32_t)sectorCount * FLASH_SECTOR_SIZE > PICO_FLASH_SIZE_BYTES ||
+        XIP_BASE + offset < (uintptr_t)&__flash_binary_end)
+        return false;
+
+    uint8_t order[FLASHKV_MAX_SECTOR];
+    uint8_t used = 0;
+    for (uint8_t s = 0; s < sectorCount; s++)
+    {
+        const uint8_t *sector = at((uint32_t)s * FLASH_SECTOR_SIZE);
+        uint32_t magic, seq;
+        memcpy(&magic, sector, sizeof(magic));
+        memcpy(&seq, &sector[4], sizeof(seq));
+        if (magic == FLASHKV_MAGIC)
+        {
+            state[s] = SECTOR_USED;
+            sectorSequence[s] = seq;
+            // Insertion sort by sequence, there are only a few sectors
+            uint8_t i = used++;
+            for (; i > 0 && sectorSequence[order[i - 1]] > seq; i--)
+                order[i] = order[i - 1];
+            order[i] = s;
+            continue;
+        }
+        state[s] = SECTOR_ERASED;
+        for (uint16_t i = 0; i < FLASH_SECTOR_SIZE && state[s] == SECTOR_ERASED; i++)
+            if (sector[i] != 0xFF)
+                state[s] = SECTOR_DIRTY;
+    }
+
+    for (uint8_t o = 0; o < used; o++)
+    {
+        uint8_t s = order[o];
+        uint32_t base = (uint32_t)s * FLASH_SECTOR_SIZE;
+        uint16_t pos = FLASHKV_SECTOR_HEADER_SIZE;
+        while (pos + FLASHKV_HEADER_SIZE <= FLASH_SECTOR_SIZE)
+        {
+            const uint8_t *r = at(base + pos);
+            uint16_t key = r[0] | (uint16_t)r[1] << 8;
+            uint16_t len = r[2] | (uint16_t)r[3] << 8;
+            if (key == 0xFFFF && len == 0xFFFF && r[4] == 0xFF && r[5] == 0xFF)
+                break; // End of the log of this sector
+            if (len == 0 || len > FLASHKV_MAX_VALUE || pos + recordSize(len) > FLASH_SECTOR_SIZE)
+            {
+                pos = FLASH_SECTOR_SIZE; // Torn header, the rest of the sector can't be trusted
+                break;
+            }
+            if (key < FLASHKV_MAX_KEY && crc(r, len) == (r[4] | (uint16_t)r[5] << 8))
+            {
+                if (index[key] != FLASHKV_NO_RECORD)
+                    sectorLive[index[key] / FLASH_SECTOR_SIZE] -= recordSize(lengthOf(index[key]));
+                index[key] = base + pos;
+                sectorLive[s] += recordSize(len);
+            }
+            pos += recordSize(len);
+        }
+        head = s;
+        headUsed = pos;
+        sequence = sectorSequence[s];
+    }
+    mounted = true;
+    return true;
+}
+
+/**
+ * @brief Copy the newest value of a key, a value still queued is returned ahead of the flash
+ *
+ * @param key
+ * @param dest
+ * @param maxLen Size of dest
+ * @return uint16_t Length of the value, 0 if the key was never put or the value doesn't fit dest
+ */
+uint16_t FlashKV::get(uint16_t key, void *dest, uint16_t maxLen)
+{
+    if (!mounted || key >= FLASHKV_MAX_KEY)
+        return 0;
+    // A request leaves the queue only once the index points to its record, so the value is always in one of them
+    if (queueMutex != NULL)
+    {
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        for (uint8_t i = queued; i > 0; i--)
+        {
+            const Request *request = &requests[(first + i - 1) % FLASHKV_QUEUE_LENGTH];
+            if (request->key != key)
+                continue;
+            uint16_t len = request->len > maxLen ? 0 : request->len;
+            memcpy(dest, request->value, len);
+            xSemaphoreGive(queueMutex);
+            return len;
+        }
+        xSemaphoreGive(queueMutex);
+        xSemaphoreTake(storeMutex, portMAX_DELAY);
+    }
+    uint16_t len = 0;
+    if (index[key] != FLASHKV_NO_RECORD && lengthOf(index[key]) <= maxLen)
+    {
+        len = lengthOf(index[key]);
+        memcpy(dest, at(index[key] + FLASHKV_HEADER_SIZE), len);
+    }
+    if (storeMutex != NULL)
+        xSemaphoreGive(storeMutex);
+    return len;
+}
+
+/**
+ * @brief Program data at any offset of the region, the pages are read back so the bytes around data are kept
+ *
+ * @param regionOffset
+ * @param data Must not be in flash
+ * @param len
+ * @return false if the flash doesn't read back what was programmed
+ */
+bool FlashKV::write(uint32_t regionOffset, const uint8_t *data, uint16_t len)
+{
+    uint32_t done = 0;
+    while (done < len)
+    {
+        uint32_t pageStart = (regionOffset + done) & ~(FLASH_PAGE_SIZE - 1);
+        uint32_t inPage = regionOffset + done - pageStart;
+        uint32_t chunk = FLASH_PAGE_SIZE - inPage < len - done ? FLASH_PAGE_SIZE - inPage : len - done;
+        memcpy(page, at(pageStart), FLASH_PAGE_SIZE);
+        memcpy(&page[inPage], &data[done], chunk);
+        if (!lockout->program(offset + pageStart, page, FLASH_PAGE_SIZE))
+            return false;
+        done += chunk;
+    }
+    return memcmp(at(regionOffset), data, len) == 0;
+}
+
+// Start a new head on the next erased sector
+bool FlashKV::open()
+{
+    for (uint8_t i = 0; i < sectorCount; i++)
+    {
+        uint8_t s = head == FLASHKV_NO_SECTOR ? i : (head + 1 + i) % sectorCount;
+        if (state[s] != SECTOR_ERASED)
+            continue;
+        uint8_t header[FLASHKV_SECTOR_HEADER_SIZE];
+        uint32_t magic = FLASHKV_MAGIC;
+        uint32_t seq = sequence + 1;
+        memcpy(header, &magic, sizeof(magic));
+        memcpy(&header[4], &seq, sizeof(seq));
+        // Whatever happens the sector isn't erased anymore
+        state[s] = SECTOR_DIRTY;
+        if (!write((uint32_t)s * FLASH_SECTOR_SIZE, header, sizeof(header)))
+            return false;
+        state[s] = SECTOR_USED;
+        sectorSequence[s] = seq;
+        sequence = seq;
+        head = s;
+        headUsed = FLASHKV_SECTOR_HEADER_SIZE;
+        return true;
+    }
+    return false;
+}
+
+// Append a record on the head, which must have room for it
+bool FlashKV::append(uint16_t key, const uint8_t *value, uint16_t len)
+{
+    uint16_t size = recordSize(len);
+    memset(record, 0xFF, size);
+    record[0] = key & 0xFF;
+    record[1] = key >> 8;
+    record[2] = len & 0xFF;
+    record[3] = len >> 8;
+    memmove(&record[FLASHKV_HEADER_SIZE], value, len);
+    uint16_t sum = crc(record, len);
+    record[4] = sum & 0xFF;
+    record[5] = sum >> 8;
+
+    uint32_t address = (uint32_t)head * FLASH_SECTOR_SIZE + headUsed;
+    // The space is consumed even if the write fails, the torn record is skipped by mount()
+    headUsed += size;
+    if (!write(address, record, size))
+        return false;
+    if (index[key] != FLASHKV_NO_RECORD)
+        sectorLive[index[key] / FLASH_SECTOR_SIZE] -= recordSize(lengthOf(index[key]));
+    index[key] = address;
+    sectorLive[head] += size;
+    return true;
+}
+
+/**
+ * @brief Move the live records of the sector with the least of them to the head and erase it
+ *
+ * @return false if there was nothing to compact or the flash failed
+ */
+bool FlashKV::compact()
+{
+    uint8_t victim = FLASHKV_NO_SECTOR;
+    for (uint8_t s = 0; s < sectorCount; s++)
+    {
+        if (s == head || state[s] == SECTOR_ERASED)
+            continue;
+        // Fewer live bytes first, then the oldest so the erases go around the region
+        if (victim == FLASHKV_NO_SECTOR || sectorLive[s] < sectorLive[victim] ||
+            (sectorLive[s] == sectorLive[victim] && state[victim] == SECTOR_USED &&
+             (state[s] == SECTOR_DIRTY || sectorSequence[s] < sectorSequence[victim])))
+            victim = s;
+    }
+    if (victim == FLASHKV_NO_SECTOR)
+        return false;
+
+    uint8_t value[FLASHKV_MAX_VALUE];
+    for (uint16_t key = 0; key < FLASHKV_MAX_KEY && sectorLive[victim] > 0; key++)
+    {
+        if (index[key] == FLASHKV_NO_RECORD || index[key] / FLASH_SECTOR_SIZE != victim)
+            continue;
+        // Copied to RAM first, the flash can't be read while it's programmed
+        uint16_t len = lengthOf(index[key]);
+        memcpy(value, at(index[key] + FLASHKV_HEADER_SIZE), len);
+        if (headUsed + recordSize(len) > FLASH_SECTOR_SIZE && !open())
+            return false;
+        if (!append(key, value, len))
+            return false;
+    }
+
+    if (!lockout->erase(offset + (uint32_t)victim * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE))
+        return false;
+    state[victim] = SECTOR_ERASED;
+    sectorLive[victim] = 0;
+    return true;
+}
+
+// Make room for a record of size bytes on the head, keeping one erased sector spare for the compaction
+bool FlashKV::reserve(uint16_t size)
+{
+    for (uint8_t tried = 0; tried <= sectorCount; tried++)
+    {
+        if (head != FLASHKV_NO_SECTOR && headUsed + size <= FLASH_SECTOR_SIZE)
+            return true;
+        if (erasedCount() > 1)
+        {
+            if (!open())
+                return false;
+        }
+        else if (!compact())
+            return false;
+    }
+    return false;
+}
+
+// Append a new value of a key, writer task only. The caller blocks and the other core is parked while the flash is
+// programmed, a compaction erases a sector on top of that
+bool FlashKV::store(uint16_t key, const uint8_t *value, uint16_t len)
+{
+    uint16_t size = recordSize(len);
+    uint16_t previous = index[key] == FLASHKV_NO_RECORD ? 0 : recordSize(lengthOf(index[key]));
+    if (liveBytes() - previous + size > capacity())
+        return false;
+    if (!reserve(size))
+        return false;
+    return append(key, value, len);
+}
+
+/**
+ * @brief Queue a new value of a key, the value is copied so src can be reused as soon as this returns
+ *
+ * @param key
+ * @param src
+ * @param len 1 to FLASHKV_MAX_VALUE bytes
+ * @param callback Called from the writer task when done, can be NULL. If the region is full or the flash failed
+ * it's called with ok false and the previous value is kept
+ * @return false if the region isn't mounted, the value is out of range or the queue is full
+ */
+bool FlashKV::put(uint16_t key, const void *src, uint16_t len, FlashKVCallback callback)
+{
+    if (!mounted || writer == NULL || key >= FLASHKV_MAX_KEY || len == 0 || len > FLASHKV_MAX_VALUE)
+        return false;
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    Request *request = NULL;
+    for (uint8_t i = writing ? 1 : 0; i < queued && request == NULL; i++)
+        if (requests[(first + i) % FLASHKV_QUEUE_LENGTH].key == key)
+            request = &requests[(first + i) % FLASHKV_QUEUE_LENGTH];
+    if (request == NULL && queued < FLASHKV_QUEUE_LENGTH)
+    {
+        request = &requests[(first + queued) % FLASHKV_QUEUE_LENGTH];
+        request->callback = NULL;
+        queued++;
+    }
+    if (request != NULL)
+    {
+        request->key = key;
+        request->len = len;
+        memcpy(request->value, src, len);
+        if (callback)
+            request->callback = callback;
+    }
+    xSemaphoreGive(queueMutex);
+    if (request == NULL)
+        return false;
+    xTaskNotifyGive(writer);
+    return true;
+}
+
+void FlashKV::task(void *pvParameter)
+{
+    FlashKV *self = (FlashKV *)pvParameter;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;)
+        {
+            xSemaphoreTake(self->queueMutex, portMAX_DELAY);
+            if (self->queued == 0)
+            {
+                xSemaphoreGive(self->queueMutex);
+                break;
+            }
+            self->writing = true;
+            memcpy(&self->current, &self->requests[self->first], sizeof(self->current));
+            xSemaphoreGive(self->queueMutex);
+
+            xSemaphoreTake(self->storeMutex, portMAX_DELAY);
+            bool ok = self->store(self->current.key, self->current.value, self->current.len);
+            xSemaphoreGive(self->storeMutex);
+
+            xSemaphoreTake(self->queueMutex, portMAX_DELAY);
+            self->first = (self->first + 1) % FLASHKV_QUEUE_LENGTH;
+            self->queued--;
+            self->writing = false;
+            xSemaphoreGive(self->queueMutex);
+            if (self->current.callback)
+                self->current.callback(self->current.key, ok);
+        }
+    }
+}
+
+uint32_t FlashKV::getFree()
+{
+    if (!mounted)
+        return 0;
+    return capacity() - liveBytes();
+}
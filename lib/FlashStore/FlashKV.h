@@ -0,0 +1,110 @@
+/**
+ * @file FlashKV.h
+ * @brief Log-structured key-value store on a reserved region of the RP2040 QSPI flash
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The region is split in 4KB sectors, a used sector starts with [0..3] magic, [4..7] sequence and is followed by
+ * records appended back to back on 4 bytes boundaries:
+ *   [0..1] key, [2..3] value length, [4..5] CRC16 of the key, length and value, then the value
+ * A value is never rewritten in place, put() appends a new record and the index moves to it. mount() replays the
+ * sectors in sequence order so the last valid record of a key wins, a torn record fails the CRC and the previous
+ * one is kept. When the log runs out of erased sectors the sector with the least live data is compacted: its live
+ * records are appended again and only then it's erased, so a power loss at any point leaves a valid copy.
+ * put() only copies the value to a request queue, a low priority task appends it so the caller never waits for the
+ * flash. A value queued again before it was written replaces the queued one, and get() returns the queued values
+ * ahead of the flash so the caller reads back what it put.
+ */
+#ifndef _FLASHKV_H_
+#include "FlashLockout.h"
+#include <string.h>
+#define _FLASHKV_H_
+
+#define FLASHKV_HEADER_SIZE 6
+#define FLASHKV_SECTOR_HEADER_SIZE 8
+#define FLASHKV_MAX_KEY 64
+#define FLASHKV_MAX_VALUE 240
+#define FLASHKV_MAX_SECTOR 32
+#define FLASHKV_MAGIC 0x564B4248 // "HBKV"
+#define FLASHKV_NO_RECORD 0xFFFFFFFF
+#define FLASHKV_NO_SECTOR 0xFF
+#define FLASHKV_QUEUE_LENGTH 8
+
+// Called from the writer task once the value was appended, must not call into LVGL
+typedef void (*FlashKVCallback)(uint16_t key, bool ok);
+
+class FlashKV
+{
+public:
+    FlashKV(FlashLockout *_lockout, uint32_t _offset, uint32_t _size)
+        : lockout(_lockout), offset(_offset), sectorCount(_size / FLASH_SECTOR_SIZE)
+    {
+    }
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    bool mount();
+    uint16_t get(uint16_t key, void *dest, uint16_t maxLen);
+    bool put(uint16_t key, const void *src, uint16_t len, FlashKVCallback callback = NULL);
+    // Bytes left for live records
+    uint32_t getFree();
+    // True if mount() found a usable region
+    __force_inline bool isMounted() { return mounted; }
+    // True while a value is queued or being written
+    __force_inline bool isBusy() { return queued > 0; }
+
+protected:
+    enum SectorState : uint8_t
+    {
+        SECTOR_ERASED,
+        SECTOR_USED,
+        SECTOR_DIRTY, // Neither erased nor a valid sector header, erased on the next compaction
+    };
+    struct Request
+    {
+        uint16_t key;
+        uint16_t len;
+        FlashKVCallback callback;
+        uint8_t value[FLASHKV_MAX_VALUE];
+    };
+    __force_inline const uint8_t *at(uint32_t regionOffset)
+    {
+        return (const uint8_t *)(XIP_BASE + offset + regionOffset);
+    }
+    __force_inline static uint16_t recordSize(uint16_t len) { return (FLASHKV_HEADER_SIZE + len + 3) & ~3; }
+    static uint16_t crc(const uint8_t *record, uint16_t len);
+    uint16_t lengthOf(uint32_t record);
+    uint32_t capacity();
+    uint32_t liveBytes();
+    uint8_t erasedCount();
+    bool write(uint32_t regionOffset, const uint8_t *data, uint16_t len);
+    bool open();
+    bool append(uint16_t key, const uint8_t *value, uint16_t len);
+    bool compact();
+    bool reserve(uint16_t size);
+    bool store(uint16_t key, const uint8_t *value, uint16_t len);
+    static void task(void *pvParameter);
+
+    FlashLockout *lockout;
+    uint32_t offset; // Offset of the region from the start of the flash
+    uint8_t sectorCount;
+    bool mounted = false;
+    uint8_t head = FLASHKV_NO_SECTOR; // Sector records are appended to
+    uint16_t headUsed = 0;
+    uint32_t sequence = 0;                       // Sequence of the head sector
+    uint32_t index[FLASHKV_MAX_KEY];             // Region offset of the newest record of each key, O(1) lookup
+    SectorState state[FLASHKV_MAX_SECTOR];
+    uint32_t sectorSequence[FLASHKV_MAX_SECTOR];
+    uint16_t sectorLive[FLASHKV_MAX_SECTOR]; // Bytes of the records the index points to
+    uint8_t record[FLASHKV_HEADER_SIZE + FLASHKV_MAX_VALUE + 3];
+    uint8_t page[FLASH_PAGE_SIZE]; // Programming has to be done a whole page at a time
+    TaskHandle_t writer = NULL;
+    SemaphoreHandle_t storeMutex = NULL;       // Held by the writer task while the log changes
+    SemaphoreHandle_t queueMutex = NULL;       // Guards the requests, only held to copy them
+    Request requests[FLASHKV_QUEUE_LENGTH];    // Ring of the queued values, oldest at first
+    uint8_t first = 0;
+    volatile uint8_t queued = 0;
+    bool writing = false;                      // The oldest request is being written and can't be replaced
+    Request current;                           // Copy of the request being written, writer task only
+};
+#endif
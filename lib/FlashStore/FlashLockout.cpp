@@ -0,0 +1,127 @@
+/**
+ * @file FlashLockout.cpp
+ * @brief Erase and program the RP2040 QSPI flash while FreeRTOS runs on both cores
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FlashLockout.h"
+
+// Runs on the parked core, nothing here may touch the flash until parked is cleared
+static void __not_in_flash_func(flashLockout_spin)(volatile bool *parked)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    *parked = true;
+    while (*parked)
+        tight_loop_contents();
+    restore_interrupts(interrupts);
+}
+
+static void __not_in_flash_func(flashLockout_erase)(uint32_t offset, size_t count)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(offset, count);
+    restore_interrupts(interrupts);
+}
+
+static void __not_in_flash_func(flashLockout_program)(uint32_t offset, const uint8_t *data, size_t count)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_program(offset, data, count);
+    restore_interrupts(interrupts);
+}
+
+/**
+ * @brief Create the parking task of each core, call once before the scheduler starts
+ *
+ * @return true if the mutex and both tasks were created
+ */
+bool FlashLockout::init()
+{
+    mutex = xSemaphoreCreateMutex();
+    if (mutex == NULL)
+        return false;
+    for (UBaseType_t core = 0; core < 2; core++)
+        if (xTaskCreateAffinitySet(task, core ? "flash_park1" : "flash_park0", configMINIMAL_STACK_SIZE, this,
+                                   configMAX_PRIORITIES - 1, 1 << core, &parkers[core]) != pdPASS)
+            return false;
+    return true;
+}
+
+void FlashLockout::task(void *pvParameter)
+{
+    FlashLockout *self = (FlashLockout *)pvParameter;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        flashLockout_spin(&self->parked);
+    }
+}
+
+/**
+ * @brief Pin the caller to its core and park the other core, the interrupts of this core are disabled by the
+ * flash operation itself
+ *
+ * @return false if the scheduler isn't running, only core 0 runs then and there's nothing to park
+ */
+bool FlashLockout::lock()
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+        return false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    affinity = vTaskCoreAffinityGet(NULL);
+    vTaskCoreAffinitySet(NULL, 1 << get_core_num());
+    // The task is moved if it switched core before the affinity was set, so read the core again
+    uint core = get_core_num();
+    parked = false;
+    xTaskNotifyGive(parkers[core ^ 1]);
+    while (!parked)
+        tight_loop_contents();
+    return true;
+}
+
+void FlashLockout::unlock(bool locked)
+{
+    if (!locked)
+        return;
+    parked = false;
+    vTaskCoreAffinitySet(NULL, affinity);
+    xSemaphoreGive(mutex);
+}
+
+/**
+ * @brief Erase a range of the flash, the caller is blocked for the whole erase (~50ms per sector)
+ *
+ * @param offset Offset from the start of the flash, must be aligned to FLASH_SECTOR_SIZE
+ * @param count Must be a multiple of FLASH_SECTOR_SIZE
+ * @return false if the range is not aligned or out of the flash
+ */
+bool FlashLockout::erase(uint32_t offset, size_t count)
+{
+    if (offset % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || offset + count > PICO_FLASH_SIZE_BYTES)
+        return false;
+    bool locked = lock();
+    flashLockout_erase(offset, count);
+    unlock(locked);
+    return true;
+}
+
+/**
+ * @brief Program a range of the flash, bits can only be cleared so the range should be erased first
+ *
+ * @param offset Offset from the start of the flash, must be aligned to FLASH_PAGE_SIZE
+ * @param data Must not be in flash
+ * @param count Must be a multiple of FLASH_PAGE_SIZE
+ * @return false if the range is not aligned or out of the flash
+ */
+bool FlashLockout::program(uint32_t offset, const uint8_t *data, size_t count)
+{
+    if (offset % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || offset + count > PICO_FLASH_SIZE_BYTES)
+        return false;
+    bool locked = lock();
+    flashLockout_program(offset, data, count);
+    unlock(locked);
+    return true;
+}
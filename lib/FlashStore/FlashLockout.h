@@ -0,0 +1,40 @@
+/**
+ * @file FlashLockout.h
+ * @brief Erase and program the RP2040 QSPI flash while FreeRTOS runs on both cores
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * XIP is off while the flash is erased or programmed, so nothing may run from flash on either core meanwhile. The
+ * SMP port of FreeRTOS owns the inter-core FIFO interrupt that multicore_lockout relies on, so the other core is
+ * locked out the same way by a parking task instead: each core has a task at the highest priority that waits for a
+ * notification, then disables its interrupts and spins in RAM until the operation is done.
+ */
+#ifndef _FLASHLOCKOUT_H_
+#include "pico/stdlib.h"
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#define _FLASHLOCKOUT_H_
+
+class FlashLockout
+{
+public:
+    bool init();
+    bool erase(uint32_t offset, size_t count);
+    bool program(uint32_t offset, const uint8_t *data, size_t count);
+
+protected:
+    static void task(void *pvParameter);
+    bool lock();
+    void unlock(bool locked);
+
+    TaskHandle_t parkers[2] = {};
+    SemaphoreHandle_t mutex = NULL;
+    volatile bool parked = false; // Set by the parking task once it spins in RAM, cleared to release it
+    UBaseType_t affinity;         // Affinity of the caller, restored on unlock()
+};
+#endif
@@ -0,0 +1,263 @@
+/**
+ * @file FlashRecorder.cpp
+ * @brief Circular log of run records on a reserved region of the RP2040 QSPI flash
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FlashRecorder.h"
+
+extern char __flash_binary_end; // From the linker script, the region must not overlap the program
+
+static constexpr uint32_t pagesPerSector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+
+// CRC16-CCITT of the whole page, the CRC field itself is skipped
+uint16_t FlashRecorder::crc(const uint8_t *page)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++)
+    {
+        if (i == 6 || i == 7)
+            continue;
+        crc ^= (uint16_t)page[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/**
+ * @brief Create the page queue and the writer task, call once before the scheduler starts
+ *
+ * @param priority Priority of the writer task, should be the lowest one
+ * @param stackSize Stack of the writer task in words
+ * @return true if the queue and the task were created
+ */
+bool FlashRecorder::init(UBaseType_t priority, uint32_t stackSize)
+{
+    batch.len = 0;
+    pages = xQueueCreate(FLASHRECORDER_QUEUE_LENGTH, sizeof(Page));
+    if (pages == NULL)
+        return false;
+    return xTaskCreate(task, "recorder_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+/**
+ * @brief Find the head of the log, only reads through XIP so it can be called before the scheduler starts
+ *
+ * @return false if the region is misplaced, nothing is recorded then
+ */
+bool FlashRecorder::mount()
+{
+    mounted = false;
+    if (offset % FLASH_SECTOR_SIZE || pageCount < 2 * pagesPerSector || pageCount % pagesPerSector ||
+        offset + pageCount * FLASH_PAGE_SIZE > PICO_FLASH_SIZE_BYTES ||
+        XIP_BASE + offset < (uintptr_t)&__flash_binary_end)
+        return false;
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t p = 0; p < pageCount; p++)
+    {
+        const uint8_t *page = (const uint8_t *)(XIP_BASE + offset + p * FLASH_PAGE_SIZE);
+        uint32_t seq;
+        memcpy(&seq, &page[2], sizeof(seq));
+        if ((page[0] != FLASHRECORDER_RUN && page[0] != FLASHRECORDER_RECORDS) || seq % pageCount != p)
+            continue;
+        if (!found || (int32_t)(seq - newest) > 0)
+            newest = seq;
+        found = true;
+    }
+
+    next = found ? newest + 1 : 0;
+    // A page torn by a power loss can't be programmed again, the log goes on from the next sector
+    const uint8_t *page = at(next);
+    for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++)
+        if (page[i] != 0xFF)
+        {
+            next = (next + pagesPerSector) / pagesPerSector * pagesPerSector;
+            break;
+        }
+    // The sector of the head was erased when the head entered it, the ones erased ahead of it are found again. The
+    // pages of the older lap in the erased sectors are gone
+    erasedUpTo = (next + pagesPerSector - 1) / pagesPerSector * pagesPerSector;
+    while (erasedUpTo - next < aheadLimit() && isErased(erasedUpTo))
+        erasedUpTo += pagesPerSector;
+    oldest = erasedUpTo > pageCount ? erasedUpTo - pageCount : 0;
+    mounted = true;
+    return true;
+}
+
+// Pages kept erased ahead of the head, at least one sector of the older lap is left
+uint32_t FlashRecorder::aheadLimit()
+{
+    uint32_t sectors = pageCount / pagesPerSector - 1;
+    return (sectors < FLASHRECORDER_ERASE_AHEAD ? sectors : FLASHRECORDER_ERASE_AHEAD) * pagesPerSector;
+}
+
+// True if the sector starting at a sequence reads erased
+bool FlashRecorder::isErased(uint32_t sequence)
+{
+    const uint8_t *sector = at(sequence);
+    for (uint16_t i = 0; i < FLASH_SECTOR_SIZE; i++)
+        if (sector[i] != 0xFF)
+            return false;
+    return true;
+}
+
+bool FlashRecorder::queue(const Page *page)
+{
+    if (!mounted || xQueueSend(pages, page, 0) != pdTRUE)
+    {
+        dropped++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Write the records batched so far and start a run with its header page, never blocks
+ *
+ * @param header Run header, e.g. the board id and a snapshot of the profile
+ * @param len Up to FLASHRECORDER_PAYLOAD_SIZE bytes
+ * @return false if the writer task is behind, the page is dropped
+ */
+bool FlashRecorder::begin(const void *header, uint8_t len)
+{
+    if (len > FLASHRECORDER_PAYLOAD_SIZE)
+        return false;
+    flush();
+    batch.type = FLASHRECORDER_RUN;
+    batch.len = len;
+    memcpy(batch.payload, header, len);
+    bool queued = queue(&batch);
+    batch.len = 0;
+    running = true;
+    return queued;
+}
+
+/**
+ * @brief Add a record to the batch, the batch is handed to the writer task once the next record doesn't fit.
+ * Records never span pages. Never blocks
+ *
+ * @param record
+ * @param len Up to FLASHRECORDER_PAYLOAD_SIZE bytes, use the same length for the whole run
+ * @return false if a full batch had to be dropped because the writer task is behind
+ */
+bool FlashRecorder::append(const void *record, uint8_t len)
+{
+    if (len > FLASHRECORDER_PAYLOAD_SIZE)
+        return false;
+    bool queued = true;
+    if (batch.len + len > FLASHRECORDER_PAYLOAD_SIZE)
+        queued = flush();
+    memcpy(&batch.payload[batch.len], record, len);
+    batch.len += len;
+    return queued;
+}
+
+/**
+ * @brief Hand the batch to the writer task even if it's not full, call at the end of a run
+ *
+ * @return false if the writer task is behind, the batch is dropped
+ */
+bool FlashRecorder::flush()
+{
+    if (batch.len == 0)
+        return true;
+    batch.type = FLASHRECORDER_RECORDS;
+    bool queued = queue(&batch);
+    batch.len = 0;
+    return queued;
+}
+
+/**
+ * @brief Flush the batch and end the run, the writer task erases ahead again until the next begin()
+ *
+ */
+void FlashRecorder::end()
+{
+    flush();
+    running = false;
+}
+
+void FlashRecorder::task(void *pvParameter)
+{
+    FlashRecorder *self = (FlashRecorder *)pvParameter;
+    Page page;
+    for (;;)
+    {
+        if (xQueueReceive(self->pages, &page, FLASHRECORDER_IDLE_PERIOD / portTICK_PERIOD_MS) == pdTRUE)
+            self->write(&page);
+        else if (!self->running && self->erasedUpTo - self->next < self->aheadLimit())
+            self->eraseNext(); // One sector per period, the heaters are off between runs
+    }
+}
+
+// Erase the sector past the erased ones, which drops the oldest pages of the region
+bool FlashRecorder::eraseNext()
+{
+    if (!lockout->erase(offset + (erasedUpTo % pageCount) * FLASH_PAGE_SIZE, FLASH_SECTOR_SIZE))
+    {
+        failed++;
+        return false;
+    }
+    erasedUpTo += pagesPerSector;
+    if (erasedUpTo > pageCount)
+        oldest = erasedUpTo - pageCount;
+    return true;
+}
+
+// Program a page at the head, the sector is erased here if the run outgrew the sectors erased ahead
+void FlashRecorder::write(const Page *page)
+{
+    uint32_t seq = next;
+    uint32_t address = offset + (seq % pageCount) * FLASH_PAGE_SIZE;
+    if (seq == erasedUpTo && !eraseNext())
+        return;
+
+    memset(buffer, 0xFF, sizeof(buffer));
+    buffer[0] = page->type;
+    buffer[1] = page->len;
+    memcpy(&buffer[2], &seq, sizeof(seq));
+    memcpy(&buffer[FLASHRECORDER_HEADER_SIZE], page->payload, page->len);
+    uint16_t sum = crc(buffer);
+    buffer[6] = sum & 0xFF;
+    buffer[7] = sum >> 8;
+    if (!lockout->program(address, buffer, FLASH_PAGE_SIZE))
+    {
+        failed++; // Nothing was programmed, the next page takes its place
+        return;
+    }
+    // A page that doesn't read back is torn, read() fails its CRC and the log goes on past it
+    if (memcmp(at(seq), buffer, FLASH_PAGE_SIZE) != 0)
+        failed++;
+    next = seq + 1;
+}
+
+/**
+ * @brief Copy a page of the log
+ *
+ * @param sequence From getOldest() to getNext() - 1
+ * @param type Type of the page
+ * @param dest At least FLASHRECORDER_PAYLOAD_SIZE bytes
+ * @param len Length of the payload
+ * @return false if the page was overwritten, never written or is corrupted
+ */
+bool FlashRecorder::read(uint32_t sequence, uint8_t *type, uint8_t *dest, uint8_t *len)
+{
+    if (!mounted || (int32_t)(sequence - oldest) < 0 || (int32_t)(sequence - next) >= 0)
+        return false;
+    const uint8_t *page = at(sequence);
+    uint32_t seq;
+    memcpy(&seq, &page[2], sizeof(seq));
+    if (seq != sequence || page[1] > FLASHRECORDER_PAYLOAD_SIZE ||
+        crc(page) != (page[6] | (uint16_t)page[7] << 8))
+        return false;
+    *type = page[0];
+    *len = page[1];
+    memcpy(dest, &page[FLASHRECORDER_HEADER_SIZE], page[1]);
+    return true;
+}
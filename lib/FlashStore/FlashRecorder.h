@@ -0,0 +1,94 @@
+/**
+ * @file FlashRecorder.h
+ * @brief Circular log of run records on a reserved region of the RP2040 QSPI flash
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Records are batched in RAM and written a whole page at a time by a low priority task, the caller only copies
+ * them so it never waits for the flash. Every page starts with a header:
+ *   [0] page type, [1] payload length, [2..5] sequence, [6..7] CRC16 of the page without the CRC field
+ * A page always lands at sequence % page count of the region, so the head is found again on mount() without
+ * checking any CRC and a torn header almost never matches its place.
+ * Erasing or programming parks the other core and masks the interrupts of this one, a sector erase takes ~50ms so
+ * it would stall the control loop and the PWM timer. Between runs the writer task keeps FLASHRECORDER_ERASE_AHEAD
+ * sectors ahead of the head erased, which drops the oldest pages early, so a run only programs pages (~1ms each).
+ * A run longer than that erases the next sector when the head enters it and does stall for the erase.
+ * A failed erase or program is counted, the page is dropped and the head stays where it is.
+ */
+#ifndef _FLASHRECORDER_H_
+#include "FlashLockout.h"
+#include "queue.h"
+#include <string.h>
+#define _FLASHRECORDER_H_
+
+#define FLASHRECORDER_HEADER_SIZE 8
+#define FLASHRECORDER_PAYLOAD_SIZE (FLASH_PAGE_SIZE - FLASHRECORDER_HEADER_SIZE)
+#define FLASHRECORDER_QUEUE_LENGTH 4
+#define FLASHRECORDER_ERASE_AHEAD 8    // Sectors, ~30 minutes of run at one 16 byte record per second
+#define FLASHRECORDER_IDLE_PERIOD 1000 // in ms, how often the writer task erases ahead between runs
+
+enum FlashRecorderPageType : uint8_t
+{
+    FLASHRECORDER_RUN = 'R',     // Start of a run, the payload is the run header given to begin()
+    FLASHRECORDER_RECORDS = 'D', // Records appended during the run
+};
+
+class FlashRecorder
+{
+public:
+    FlashRecorder(FlashLockout *_lockout, uint32_t _offset, uint32_t _size)
+        : lockout(_lockout), offset(_offset), pageCount(_size / FLASH_PAGE_SIZE)
+    {
+    }
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    bool mount();
+    bool begin(const void *header, uint8_t len);
+    bool append(const void *record, uint8_t len);
+    bool flush();
+    void end();
+    bool read(uint32_t sequence, uint8_t *type, uint8_t *dest, uint8_t *len);
+    // Sequence of the oldest page still in the region, equals getNext() when it's empty
+    __force_inline uint32_t getOldest() { return oldest; }
+    // Sequence the next page is written with
+    __force_inline uint32_t getNext() { return next; }
+    // Pages lost because the writer task was behind
+    __force_inline uint32_t getDropped() { return dropped; }
+    // Erases and programs that failed, their pages are dropped too
+    __force_inline uint32_t getFailed() { return failed; }
+
+protected:
+    struct Page
+    {
+        uint8_t type;
+        uint8_t len;
+        uint8_t payload[FLASHRECORDER_PAYLOAD_SIZE];
+    };
+    __force_inline const uint8_t *at(uint32_t sequence)
+    {
+        return (const uint8_t *)(XIP_BASE + offset + (sequence % pageCount) * FLASH_PAGE_SIZE);
+    }
+    static uint16_t crc(const uint8_t *page);
+    static void task(void *pvParameter);
+    bool queue(const Page *page);
+    void write(const Page *page);
+    bool eraseNext();
+    bool isErased(uint32_t sequence);
+    uint32_t aheadLimit();
+
+    FlashLockout *lockout;
+    uint32_t offset; // Offset of the region from the start of the flash
+    uint32_t pageCount;
+    bool mounted = false;
+    QueueHandle_t pages = NULL;
+    volatile uint32_t oldest = 0;
+    volatile uint32_t next = 0;
+    volatile uint32_t dropped = 0;
+    volatile uint32_t failed = 0;
+    volatile bool running = false;
+    uint32_t erasedUpTo = 0;        // Sequence of the first page past the erased sectors, on a sector boundary
+    Page batch;                     // Page being filled by append(), caller only
+    uint8_t buffer[FLASH_PAGE_SIZE]; // Page being written, writer task only
+};
+#endif
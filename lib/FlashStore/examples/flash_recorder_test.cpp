@@ -0,0 +1,182 @@
+/**
+ * @file flash_recorder_test.cpp
+ * @brief Host test of FlashRecorder on a flash image in RAM: wrap around, erase ahead, mount, torn and failed pages
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Runs without arguments, the writer task is stood in for by TestRecorder so the test decides when the pages are
+ * written and when the sectors are erased ahead.
+ */
+#include "FlashRecorder.h"
+#include <stdio.h>
+
+static constexpr uint32_t test_offset = 64 * 1024;
+static constexpr uint32_t test_size = 64 * 1024; // 16 sectors of 16 pages
+static constexpr uint8_t test_sampleSize = 16;
+static constexpr uint8_t test_samplesPerPage = FLASHRECORDER_PAYLOAD_SIZE / test_sampleSize;
+
+alignas(FLASH_SECTOR_SIZE) uint8_t flash_image[PICO_FLASH_SIZE_BYTES];
+// Linker script symbol of the firmware, the program ends where the image starts so any region of it is allowed
+asm(".globl __flash_binary_end\n.set __flash_binary_end, flash_image");
+
+static int test_failures = 0;
+
+#define TEST_CHECK(condition)                                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(condition))                                                                                              \
+        {                                                                                                              \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                                       \
+            test_failures++;                                                                                           \
+        }                                                                                                              \
+    } while (0)
+
+// Does the work of the writer task in place
+class TestRecorder : public FlashRecorder
+{
+public:
+    using FlashRecorder::FlashRecorder;
+    void drain()
+    {
+        Page page;
+        while (xQueueReceive(pages, &page, 0) == pdTRUE)
+            write(&page);
+    }
+    // Every sector the task would erase ahead between runs
+    void idle()
+    {
+        while (!running && erasedUpTo - next < aheadLimit())
+            eraseNext();
+    }
+    uint32_t readable()
+    {
+        uint8_t type, len, payload[FLASHRECORDER_PAYLOAD_SIZE];
+        uint32_t count = 0;
+        for (uint32_t sequence = getOldest(); sequence != getNext(); sequence++)
+            count += read(sequence, &type, payload, &len);
+        return count;
+    }
+};
+
+// A run of numbered samples, each sample holds its number so the pages can be checked for gaps
+static void test_run(TestRecorder *recorder, uint8_t run, uint32_t samples, uint32_t *number)
+{
+    uint8_t header[20] = {run};
+    recorder->begin(header, sizeof(header));
+    recorder->drain();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        uint8_t sample[test_sampleSize] = {};
+        memcpy(sample, number, sizeof(*number));
+        (*number)++;
+        recorder->append(sample, sizeof(sample));
+        recorder->drain();
+    }
+    recorder->end();
+    recorder->drain();
+}
+
+// Samples of the records pages follow each other without gaps from the first readable page on
+static bool test_samplesInOrder(TestRecorder *recorder)
+{
+    uint8_t type, len, payload[FLASHRECORDER_PAYLOAD_SIZE];
+    bool first = true;
+    uint32_t expected = 0;
+    for (uint32_t sequence = recorder->getOldest(); sequence != recorder->getNext(); sequence++)
+    {
+        if (!recorder->read(sequence, &type, payload, &len) || type != FLASHRECORDER_RECORDS)
+            continue;
+        for (uint8_t i = 0; i + test_sampleSize <= len; i += test_sampleSize)
+        {
+            uint32_t number;
+            memcpy(&number, &payload[i], sizeof(number));
+            if (!first && number != expected)
+                return false;
+            first = false;
+            expected = number + 1;
+        }
+    }
+    return !first;
+}
+
+int main()
+{
+    // A region that was never used reads as garbage, not erased
+    memset(flash_image, 0x33, sizeof(flash_image));
+    FlashLockout lockout;
+    TestRecorder recorder(&lockout, test_offset, test_size);
+    TEST_CHECK(recorder.init(1, 256));
+    TEST_CHECK(recorder.mount());
+    // The head can't be programmed, the log starts on the next sector and the pages before it never read back
+    uint32_t pagesPerSector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+    uint32_t firstWritten = recorder.getNext();
+    TEST_CHECK(firstWritten == pagesPerSector);
+
+    // Runs short enough for the sectors erased ahead, they only program pages. The log wraps around several times
+    uint32_t number = 0;
+    for (uint8_t run = 0; run < 30; run++)
+    {
+        recorder.idle();
+        uint32_t erases = lockout.erases;
+        test_run(&recorder, run, 10 * test_samplesPerPage, &number);
+        TEST_CHECK(lockout.erases == erases);
+        uint32_t from = recorder.getOldest() > firstWritten ? recorder.getOldest() : firstWritten;
+        TEST_CHECK(recorder.readable() == recorder.getNext() - from);
+    }
+    TEST_CHECK(recorder.getNext() > test_size / FLASH_PAGE_SIZE);
+    TEST_CHECK(test_samplesInOrder(&recorder));
+    TEST_CHECK(recorder.getFailed() == 0 && recorder.getDropped() == 0);
+
+    // Mounted again the log is found where it was
+    recorder.idle();
+    TestRecorder remounted(&lockout, test_offset, test_size);
+    TEST_CHECK(remounted.init(1, 256));
+    TEST_CHECK(remounted.mount());
+    TEST_CHECK(remounted.getOldest() == recorder.getOldest());
+    TEST_CHECK(remounted.getNext() == recorder.getNext());
+    TEST_CHECK(remounted.readable() == remounted.getNext() - remounted.getOldest());
+
+    // A page torn by a power loss is counted and skipped, the log goes on from the next sector once mounted again
+    lockout.tearAfter = 4;
+    uint32_t torn = remounted.getNext();
+    test_run(&remounted, 30, 0, &number);
+    lockout.tearAfter = -1;
+    TEST_CHECK(remounted.getFailed() == 1);
+    uint8_t type, len, payload[FLASHRECORDER_PAYLOAD_SIZE];
+    TEST_CHECK(!remounted.read(torn, &type, payload, &len));
+    TestRecorder afterTorn(&lockout, test_offset, test_size);
+    TEST_CHECK(afterTorn.init(1, 256));
+    TEST_CHECK(afterTorn.mount());
+    uint32_t skipped = (torn + pagesPerSector) / pagesPerSector * pagesPerSector;
+    TEST_CHECK(afterTorn.getNext() == skipped);
+    test_run(&afterTorn, 31, 3 * test_samplesPerPage, &number);
+    TEST_CHECK(afterTorn.readable() == afterTorn.getNext() - afterTorn.getOldest() - (skipped - torn));
+
+    // A run longer than the sectors erased ahead erases each sector as the head enters it, nothing is lost
+    afterTorn.idle();
+    uint32_t erases = lockout.erases;
+    uint32_t start = afterTorn.getNext();
+    test_run(&afterTorn, 32, 300 * test_samplesPerPage, &number);
+    TEST_CHECK(lockout.erases > erases);
+    TEST_CHECK(afterTorn.getNext() - start == 301);
+    TEST_CHECK(afterTorn.getOldest() > skipped);
+    TEST_CHECK(afterTorn.readable() == afterTorn.getNext() - afterTorn.getOldest());
+    TEST_CHECK(test_samplesInOrder(&afterTorn));
+
+    // A failed program drops the page and leaves the head where it is
+    uint32_t head = afterTorn.getNext();
+    uint32_t failed = afterTorn.getFailed();
+    lockout.fail = true;
+    test_run(&afterTorn, 33, test_samplesPerPage, &number);
+    lockout.fail = false;
+    TEST_CHECK(afterTorn.getNext() == head);
+    TEST_CHECK(afterTorn.getFailed() == failed + 2);
+
+    if (test_failures)
+        printf("%d checks failed\n", test_failures);
+    else
+        printf("Every check passed\n");
+    return test_failures ? 1 : 0;
+}
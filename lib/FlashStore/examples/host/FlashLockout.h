@@ -0,0 +1,50 @@
+/**
+ * @file FlashLockout.h
+ * @brief Host stand-in of FlashLockout for flash_recorder_test, the flash is an image in RAM read through XIP_BASE
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Programming only clears bits like on the flash. A program can be made to fail, or to stop after some bytes and
+ * still report success, which is what a power loss in the middle of it leaves on the flash.
+ */
+#ifndef _FLASHLOCKOUT_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#define _FLASHLOCKOUT_H_
+
+#define FLASH_SECTOR_SIZE 4096u
+#define FLASH_PAGE_SIZE 256u
+#define PICO_FLASH_SIZE_BYTES (256u * 1024)
+#define XIP_BASE ((uintptr_t)flash_image)
+#define __force_inline inline
+
+extern uint8_t flash_image[PICO_FLASH_SIZE_BYTES];
+
+class FlashLockout
+{
+public:
+    bool erase(uint32_t offset, size_t count)
+    {
+        if (fail)
+            return false;
+        memset(&flash_image[offset], 0xFF, count);
+        erases++;
+        return true;
+    }
+    bool program(uint32_t offset, const uint8_t *data, size_t count)
+    {
+        if (fail)
+            return false;
+        for (size_t i = 0; i < count && tearAfter != 0; i++, tearAfter--)
+            flash_image[offset + i] &= data[i];
+        return true;
+    }
+
+    bool fail = false;   // Erases and programs fail without touching the flash
+    long tearAfter = -1; // Bytes programmed before the flash stops taking them, -1 for no limit
+    uint32_t erases = 0;
+};
+#endif
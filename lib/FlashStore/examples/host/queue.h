@@ -0,0 +1,53 @@
+/**
+ * @file queue.h
+ * @brief Host stand-in of the FreeRTOS queue and task calls FlashRecorder makes, for flash_recorder_test
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The queue never blocks and no task is started, the test does the work of the writer task itself.
+ */
+#ifndef _QUEUE_H_
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#define _QUEUE_H_
+
+typedef unsigned UBaseType_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdPASS 1
+#define portTICK_PERIOD_MS 1
+
+struct HostQueue
+{
+    size_t itemSize;
+    size_t length;
+    std::deque<std::vector<uint8_t>> items;
+};
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) { return new HostQueue{itemSize, length, {}}; }
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t)
+{
+    if (queue->items.size() == queue->length)
+        return 0;
+    queue->items.emplace_back((const uint8_t *)item, (const uint8_t *)item + queue->itemSize);
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t)
+{
+    if (queue->items.empty())
+        return 0;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+inline BaseType_t xTaskCreate(void (*)(void *), const char *, uint32_t, void *, UBaseType_t, void *) { return pdPASS; }
+#endif
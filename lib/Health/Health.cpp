@@ -0,0 +1,215 @@
+/**
+ * @file Health.cpp
+ * @brief Run time health of the firmware: CPU load of each task and core, ISR load, stack and heap margins
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Health.h"
+#include "Log.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+#include <string.h>
+
+#define HEALTH_OVERFLOW_MAGIC 0x4F564552 // "OVER", a stack overflow was recorded before the reset
+
+Health health;
+
+// Left by vApplicationStackOverflowHook for the next boot, in RAM the startup code doesn't clear
+struct HealthOverflow
+{
+    uint32_t magic;
+    char name[configMAX_TASK_NAME_LEN];
+};
+static HealthOverflow __uninitialized_ram(health_overflow);
+
+// Written by each core for itself on its context switches and in its timed ISRs, read by the health task
+static TaskHandle_t health_idleTasks[HEALTH_CORES]; // Registered by the idle hooks
+static volatile uint32_t health_busy[HEALTH_CORES]; // in us, outside of the idle tasks up to the last switch
+static volatile uint32_t health_switchedAt[HEALTH_CORES];
+static volatile bool health_idle[HEALTH_CORES];
+static volatile uint32_t health_isr[HEALTH_CORES]; // in us
+static uint32_t health_isrStart[HEALTH_CORES];
+static uint8_t health_isrDepth[HEALTH_CORES];
+
+/**
+ * @brief Create the health task, the first report is ready HEALTH_PERIOD after the scheduler starts
+ * Logs the task whose stack overflow caused the last reset, if any
+ *
+ * @param priority Lowest one, the loads are taken over the window whenever the task gets to run
+ * @param stackSize in words
+ * @return true if the mutex and the task were created
+ */
+bool Health::init(UBaseType_t priority, uint32_t stackSize)
+{
+    // The name stays in place after the magic is cleared, the log task prints it later
+    if (health_overflow.magic == HEALTH_OVERFLOW_MAGIC)
+    {
+        health_overflow.name[sizeof(health_overflow.name) - 1] = '\0';
+        LOG_ERROR("Restarted after a stack overflow in %s\n", health_overflow.name);
+    }
+    health_overflow.magic = 0;
+    mutex = xSemaphoreCreateMutex();
+    return mutex != NULL && xTaskCreate(task, "health_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+/**
+ * @brief Copy the last report
+ *
+ * @param dest
+ * @return false if there's no report yet
+ */
+bool Health::read(HealthReport *dest)
+{
+    if (mutex == NULL)
+        return false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memcpy(dest, &report, sizeof(*dest));
+    xSemaphoreGive(mutex);
+    return dest->window != 0;
+}
+
+// Only the outermost ISR of a core is timed, a nested one is already inside its time
+void Health::isrEnter()
+{
+    uint8_t core = get_core_num();
+    if (health_isrDepth[core]++ == 0)
+        health_isrStart[core] = portGET_RUN_TIME_COUNTER_VALUE();
+}
+
+void Health::isrExit()
+{
+    uint8_t core = get_core_num();
+    if (--health_isrDepth[core] == 0)
+        health_isr[core] = health_isr[core] + (portGET_RUN_TIME_COUNTER_VALUE() - health_isrStart[core]);
+}
+
+void Health::task(void *pvParameter)
+{
+    Health *health = (Health *)pvParameter;
+    TickType_t lastWakeTime = xTaskGetTickCount();
+    health->update();
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWakeTime, HEALTH_PERIOD / portTICK_PERIOD_MS);
+        health->update();
+    }
+}
+
+// Take the counters and work out the loads since the last call. The counters are 32 bits of us and wrap every 71
+// minutes, their differences are still right as long as the window is shorter
+void Health::update()
+{
+    // uxTaskGetSystemState() fills nothing, not even the time, if the tasks don't all fit. The tasks aren't listed then
+    // but the loads of the cores and the heap still are, taskTotal tells the tasks are missing
+    uint32_t now = portGET_RUN_TIME_COUNTER_VALUE();
+    UBaseType_t total = uxTaskGetNumberOfTasks();
+    UBaseType_t count = total <= HEALTH_MAX_TASKS ? uxTaskGetSystemState(status, HEALTH_MAX_TASKS, &now) : 0;
+    uint32_t window = now - previousTime;
+
+    // Ordered by creation so the rows don't move around between reports
+    for (UBaseType_t i = 1; i < count; i++)
+    {
+        TaskStatus_t key = status[i];
+        UBaseType_t j = i;
+        for (; j > 0 && status[j - 1].xTaskNumber > key.xTaskNumber; j--)
+            status[j] = status[j - 1];
+        status[j] = key;
+    }
+
+    next.uptime = to_ms_since_boot(get_absolute_time()) / 1000;
+    next.window = window;
+    next.taskCount = count;
+    next.taskTotal = total;
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        HealthTask *t = &next.tasks[i];
+        // A task created within the window ran for its whole counter
+        uint32_t previous = 0;
+        for (uint8_t j = 0; j < previousCount; j++)
+            if (previousNumber[j] == status[i].xTaskNumber)
+                previous = previousRunTime[j];
+        strncpy(t->name, status[i].pcTaskName, sizeof(t->name));
+        t->stackFree = status[i].usStackHighWaterMark;
+        t->load = window ? (uint64_t)(status[i].ulRunTimeCounter - previous) * 1000 / window : 0;
+        t->priority = status[i].uxCurrentPriority;
+        t->state = status[i].eCurrentState;
+        t->affinity = vTaskCoreAffinityGet(status[i].xHandle);
+        previousNumber[i] = status[i].xTaskNumber;
+        previousRunTime[i] = status[i].ulRunTimeCounter;
+    }
+    previousCount = count;
+
+    for (uint8_t core = 0; core < HEALTH_CORES; core++)
+    {
+        // The task running on the core since its last switch is counted up to now
+        uint32_t busy = health_busy[core];
+        if (!health_idle[core])
+            busy += now - health_switchedAt[core];
+        uint32_t isr = health_isr[core];
+        next.coreLoad[core] = window ? (uint64_t)(busy - previousBusy[core]) * 1000 / window : 0;
+        next.isrLoad[core] = window ? (uint64_t)(isr - previousIsr[core]) * 1000 / window : 0;
+        previousBusy[core] = busy;
+        previousIsr[core] = isr;
+    }
+    next.heapFree = xPortGetFreeHeapSize();
+    next.heapMinimum = xPortGetMinimumEverFreeHeapSize();
+    previousTime = now;
+
+    // The first call only starts the first window
+    if (!started)
+    {
+        started = true;
+        return;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memcpy(&report, &next, sizeof(report));
+    xSemaphoreGive(mutex);
+}
+
+// traceTASK_SWITCHED_IN of FreeRTOSConfig.h, called by the kernel with the interrupts of the core masked
+extern "C" void health_task_switched_in(void)
+{
+    uint32_t now = portGET_RUN_TIME_COUNTER_VALUE();
+    uint8_t core = get_core_num();
+    if (!health_idle[core])
+        health_busy[core] = health_busy[core] + (now - health_switchedAt[core]);
+    health_switchedAt[core] = now;
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    health_idle[core] = current == health_idleTasks[0] || current == health_idleTasks[1];
+}
+
+// The idle tasks aren't tied to a core on the SMP kernel, each one registers itself the first time it runs
+static void health_register_idle()
+{
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    if (current == health_idleTasks[0] || current == health_idleTasks[1])
+        return;
+    taskENTER_CRITICAL();
+    health_idleTasks[health_idleTasks[0] == NULL ? 0 : 1] = current;
+    taskEXIT_CRITICAL();
+}
+
+extern "C" void vApplicationIdleHook(void)
+{
+    health_register_idle();
+}
+
+extern "C" void vApplicationMinimalIdleHook(void)
+{
+    health_register_idle();
+}
+
+// Called from the context switch, nothing can be printed there and the default UART pins are the EEPROM bus. The name
+// is kept for Health::init() to report after the reset, which turns the heaters off since the stack of the task can't
+// be trusted anymore
+extern "C" void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
+{
+    strncpy(health_overflow.name, pcTaskName, sizeof(health_overflow.name));
+    health_overflow.magic = HEALTH_OVERFLOW_MAGIC;
+    watchdog_reboot(0, 0, 0);
+    for (;;)
+        tight_loop_contents();
+}
@@ -0,0 +1,86 @@
+/**
+ * @file Health.h
+ * @brief Run time health of the firmware: CPU load of each task and core, ISR load, stack and heap margins
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The kernel counts the run time of every task on the 1MHz timer (configGENERATE_RUN_TIME_STATS), a low priority
+ * task takes the counters once per HEALTH_PERIOD and turns their difference into the load of each task over that
+ * window. The load of each core comes from the context switches instead, the kernel calls
+ * health_task_switched_in() on every switch of a core and the time spent outside of the idle tasks is accumulated
+ * per core. ISRs are only timed where a HealthIsr is put at their start, their time is counted in the load of the
+ * task or idle task they interrupted as well.
+ * The last report is kept under a mutex, read() copies it for the screen and the host link.
+ */
+#ifndef _HEALTH_H_
+#include "FreeRTOS.h"
+#include "pico/stdlib.h"
+#include "semphr.h"
+#include "task.h"
+#define _HEALTH_H_
+
+#define HEALTH_PERIOD 1000  // in ms, window of the loads
+#define HEALTH_MAX_TASKS 24 // No task is listed while there are more than this, only the loads of the cores
+#define HEALTH_CORES 2
+
+struct HealthTask
+{
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stackFree; // in words, lowest since the task started
+    uint16_t load;      // in permille of one core, over the window
+    uint8_t priority;
+    uint8_t state;      // eTaskState
+    uint8_t affinity;   // Bit of each core the task may run on
+};
+
+struct HealthReport
+{
+    uint32_t uptime;                    // in s
+    uint32_t window;                    // in us, the loads are averaged over it
+    uint16_t coreLoad[HEALTH_CORES];    // in permille, time outside of the idle tasks
+    uint16_t isrLoad[HEALTH_CORES];     // in permille, time in the timed ISRs
+    uint32_t heapFree;                  // in bytes, FreeRTOS heap
+    uint32_t heapMinimum;               // in bytes, lowest free heap since boot
+    uint8_t taskCount;                  // Tasks listed, 0 while taskTotal is above HEALTH_MAX_TASKS
+    uint8_t taskTotal;                  // Tasks running
+    HealthTask tasks[HEALTH_MAX_TASKS]; // Ordered by creation
+};
+
+class Health
+{
+public:
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    bool read(HealthReport *dest);
+    static void isrEnter();
+    static void isrExit();
+
+protected:
+    static void task(void *pvParameter);
+    void update();
+
+    SemaphoreHandle_t mutex = NULL;
+    HealthReport report = {};
+    // Health task only
+    HealthReport next;
+    TaskStatus_t status[HEALTH_MAX_TASKS];
+    UBaseType_t previousNumber[HEALTH_MAX_TASKS];
+    uint32_t previousRunTime[HEALTH_MAX_TASKS];
+    uint8_t previousCount = 0;
+    uint32_t previousTime = 0;
+    bool started = false;
+    uint32_t previousBusy[HEALTH_CORES] = {};
+    uint32_t previousIsr[HEALTH_CORES] = {};
+};
+
+// Times the ISR it's declared in, from there to its end
+class HealthIsr
+{
+public:
+    __force_inline HealthIsr() { Health::isrEnter(); }
+    __force_inline ~HealthIsr() { Health::isrExit(); }
+};
+
+extern Health health;
+#endif
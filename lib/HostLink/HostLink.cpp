@@ -0,0 +1,413 @@
+/**
+ * @file HostLink.cpp
+ * @brief USB device with the console on the first CDC interface and the binary host link on the second one
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "HostLink.h"
+#include "pico/bootrom.h"
+#include "pico/stdio/driver.h"
+#include "tusb.h"
+#include <string.h>
+
+// The stdio driver callbacks have no context, there's only one USB device anyway
+static HostLink *instance = NULL;
+static stdio_driver_t console_driver;
+
+/**
+ * @brief Start the USB device, register the console as a stdio driver and create the tasks, call once before the
+ * scheduler starts. Console output written before the scheduler runs only goes to the UART.
+ *
+ * @param usbPriority Priority of the task running the TinyUSB device stack
+ * @param samplerPriority Priority of the sampler task, above the link task so sampling keeps its rate
+ * @param linkPriority Priority of the link task
+ * @param stackSize Stack of each task in words
+ * @return true if the mutex, the queues and the tasks were created
+ */
+bool HostLink::init(UBaseType_t usbPriority, UBaseType_t samplerPriority, UBaseType_t linkPriority,
+                    uint32_t stackSize)
+{
+    usbMutex = xSemaphoreCreateMutex();
+    requests = xQueueCreate(HOSTLINK_QUEUE_LENGTH, sizeof(HostLinkRequest));
+    commands = xQueueCreate(HOSTLINK_COMMAND_QUEUE_LENGTH, sizeof(HostLinkRequest));
+    replies = xQueueCreate(HOSTLINK_REPLY_QUEUE_LENGTH, sizeof(HostLinkRequest));
+    if (usbMutex == NULL || requests == NULL || commands == NULL || replies == NULL)
+        return false;
+    instance = this;
+    tusb_init();
+
+    console_driver.out_chars = consoleWrite;
+    console_driver.in_chars = consoleRead;
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    console_driver.crlf_enabled = PICO_STDIO_DEFAULT_CRLF;
+#endif
+    stdio_set_driver_enabled(&console_driver, true);
+
+    return xTaskCreate(usbTask, "usb_task", stackSize, this, usbPriority, NULL) == pdPASS &&
+           xTaskCreate(linkTask, "link_task", stackSize, this, linkPriority, &linkHandle) == pdPASS &&
+           xTaskCreate(samplerTask, "sampler_task", stackSize, this, samplerPriority, NULL) == pdPASS;
+}
+
+/**
+ * @brief Publish the state of the control loop, called by the control task on every iteration. Never blocks, the
+ * sampler retries its copy if it overlapped this one.
+ *
+ * @param state Timestamp, dropped and raw are filled by the sampler
+ */
+void HostLink::publish(const HostLinkTelemetry *state)
+{
+    snapshotSequence = snapshotSequence + 1;
+    __dmb(); // Readers have to see the odd sequence before the copy starts
+    memcpy(&snapshot, state, sizeof(snapshot));
+    __dmb(); // and the whole copy before the even sequence
+    snapshotSequence = snapshotSequence + 1;
+}
+
+// The sampler can't preempt the control task, an odd sequence means publish() is copying on the other core, which
+// takes a few us. A sample is skipped if it's still not through after HOSTLINK_READ_SPINS
+bool HostLink::tryRead(HostLinkTelemetry *dest)
+{
+    for (uint16_t spin = 0; spin < HOSTLINK_READ_SPINS; spin++)
+    {
+        uint32_t before = snapshotSequence;
+        if (before & 1)
+        {
+            tight_loop_contents();
+            continue;
+        }
+        __dmb();
+        memcpy(dest, &snapshot, sizeof(*dest));
+        __dmb();
+        if (snapshotSequence == before)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Set the telemetry rate
+ *
+ * @param hz 0 stops the stream
+ * @return false if the rate is above HOSTLINK_TELEMETRY_MAX_RATE, the rate is left unchanged
+ */
+bool HostLink::setRate(uint8_t hz)
+{
+    if (hz > HOSTLINK_TELEMETRY_MAX_RATE)
+        return false;
+    rate = hz;
+    return true;
+}
+
+/**
+ * @brief Take the next request of the host, never blocks. Every request taken has to be answered with reply() or
+ * ack(), the host retries the ones that are never answered.
+ *
+ * @param request
+ * @return false if there's no request waiting
+ */
+bool HostLink::takeRequest(HostLinkRequest *request)
+{
+    return requests != NULL && xQueueReceive(requests, request, 0) == pdTRUE;
+}
+
+/**
+ * @brief Take the next run control request of the host, never blocks. Called by the control task, the same rules
+ * as takeRequest() apply.
+ *
+ * @param command
+ * @return false if there's no request waiting
+ */
+bool HostLink::takeCommand(HostLinkRequest *command)
+{
+    return commands != NULL && xQueueReceive(commands, command, 0) == pdTRUE;
+}
+
+/**
+ * @brief Queue the answer to a request for the link task, never blocks
+ *
+ * @param request Request being answered, its sequence is put in front of the payload
+ * @param type
+ * @param payload
+ * @param len Up to HOSTLINK_MAX_PAYLOAD - 1 bytes
+ * @return false if the payload is too long or the reply queue is full, the host then retries the request
+ */
+bool HostLink::reply(const HostLinkRequest *request, uint8_t type, const void *payload, size_t len)
+{
+    HostLinkRequest answer;
+    if (replies == NULL || len + 1 > HOSTLINK_MAX_PAYLOAD)
+        return false;
+    answer.type = type;
+    answer.sequence = request->sequence;
+    answer.len = len + 1;
+    answer.payload[0] = request->sequence;
+    memcpy(&answer.payload[1], payload, len);
+    if (xQueueSend(replies, &answer, 0) != pdTRUE)
+        return false;
+    xTaskNotifyGive(linkHandle);
+    return true;
+}
+
+// Answer a request that only changes something
+bool HostLink::ack(const HostLinkRequest *request, HostLinkResult result)
+{
+    uint8_t payload[2] = {request->type, result};
+    return reply(request, HOSTLINK_ACK, payload, sizeof(payload));
+}
+
+/**
+ * @brief Read what the host sent on another CDC interface, never blocks
+ *
+ * @param itf
+ * @param buf
+ * @param len
+ * @return uint32_t Bytes read
+ */
+uint32_t HostLink::readInterface(uint8_t itf, void *buf, uint32_t len)
+{
+    xSemaphoreTake(usbMutex, portMAX_DELAY);
+    uint32_t n = tud_cdc_n_available(itf) ? tud_cdc_n_read(itf, buf, len) : 0;
+    xSemaphoreGive(usbMutex);
+    return n;
+}
+
+/**
+ * @brief Write to another CDC interface, waiting for room in the FIFO like the frames of the link interface
+ *
+ * @param itf
+ * @param buf
+ * @param len Up to CFG_TUD_CDC_TX_BUFSIZE bytes, written whole
+ * @return false if the host is not connected or didn't make room within HOSTLINK_SEND_TIMEOUT, nothing is written
+ */
+bool HostLink::writeInterface(uint8_t itf, const void *buf, uint32_t len)
+{
+    TickType_t start = xTaskGetTickCount();
+    for (;;)
+    {
+        xSemaphoreTake(usbMutex, portMAX_DELAY);
+        bool connected = tud_cdc_n_connected(itf);
+        bool room = connected && tud_cdc_n_write_available(itf) >= len;
+        if (room)
+        {
+            tud_cdc_n_write(itf, buf, len);
+            tud_cdc_n_write_flush(itf);
+        }
+        xSemaphoreGive(usbMutex);
+        if (!connected)
+            return false;
+        if (room)
+            return true;
+        if (xTaskGetTickCount() - start >= HOSTLINK_SEND_TIMEOUT / portTICK_PERIOD_MS)
+        {
+            sendTimeouts++;
+            return false;
+        }
+        vTaskDelay(1);
+    }
+}
+
+void HostLink::usbTask(void *pvParameter)
+{
+    HostLink *link = (HostLink *)pvParameter;
+    for (;;)
+    {
+        xSemaphoreTake(link->usbMutex, portMAX_DELAY);
+        tud_task();
+        xSemaphoreGive(link->usbMutex);
+        vTaskDelay(1);
+    }
+}
+
+void HostLink::samplerTask(void *pvParameter)
+{
+    HostLink *link = (HostLink *)pvParameter;
+    TickType_t lastWakeTime = xTaskGetTickCount();
+    for (;;)
+    {
+        uint8_t hz = link->rate;
+        if (hz == 0)
+        {
+            vTaskDelay(100 / portTICK_PERIOD_MS);
+            lastWakeTime = xTaskGetTickCount();
+            continue;
+        }
+        vTaskDelayUntil(&lastWakeTime, (1000 / hz) / portTICK_PERIOD_MS);
+
+        // Nobody to send to, the ring would only fill with samples that are stale once the host connects
+        xSemaphoreTake(link->usbMutex, portMAX_DELAY);
+        bool connected = tud_cdc_n_connected(HOSTLINK_LINK_ITF);
+        xSemaphoreGive(link->usbMutex);
+        if (!connected)
+            continue;
+        HostLinkTelemetry sample;
+        if (!link->tryRead(&sample))
+            continue;
+        sample.timestamp = time_us_32();
+        sample.raw[0] = link->raw[0];
+        sample.raw[1] = link->raw[1];
+        sample.dropped = link->ring.getDropped();
+        link->ring.push(sample);
+        xTaskNotifyGive(link->linkHandle);
+    }
+}
+
+void HostLink::linkTask(void *pvParameter)
+{
+    HostLink *link = (HostLink *)pvParameter;
+    for (;;)
+    {
+        // Woken by every sample and reply, the timeout polls the requests of the host
+        ulTaskNotifyTake(pdTRUE, 10 / portTICK_PERIOD_MS);
+        link->receive();
+        HostLinkRequest answer;
+        while (xQueueReceive(link->replies, &answer, 0) == pdTRUE)
+            link->send(answer.type, answer.payload, answer.len);
+        HostLinkTelemetry sample;
+        while (link->ring.pop(&sample))
+            if (!link->send(HOSTLINK_TELEMETRY, &sample, sizeof(sample)))
+                break;
+    }
+}
+
+/**
+ * @brief Frame a message and write it to the link interface, waiting for room in the FIFO
+ *
+ * @param type
+ * @param payload
+ * @param len
+ * @return false if the host disconnected or didn't make room within HOSTLINK_SEND_TIMEOUT, the frame is not sent
+ */
+bool HostLink::send(uint8_t type, const void *payload, size_t len)
+{
+    uint8_t encoded[HOSTLINK_MAX_ENCODED];
+    size_t encodedLen = hostlink_encodeFrame(type, txSequence, payload, len, encoded);
+    if (encodedLen == 0)
+        return false;
+    TickType_t start = xTaskGetTickCount();
+    for (;;)
+    {
+        xSemaphoreTake(usbMutex, portMAX_DELAY);
+        bool connected = tud_cdc_n_connected(HOSTLINK_LINK_ITF);
+        // Frames are written whole so a slow host never gets half of one
+        bool room = connected && tud_cdc_n_write_available(HOSTLINK_LINK_ITF) >= encodedLen;
+        if (room)
+        {
+            tud_cdc_n_write(HOSTLINK_LINK_ITF, encoded, encodedLen);
+            tud_cdc_n_write_flush(HOSTLINK_LINK_ITF);
+        }
+        xSemaphoreGive(usbMutex);
+        if (!connected)
+            return false;
+        if (room)
+            break;
+        if (xTaskGetTickCount() - start >= HOSTLINK_SEND_TIMEOUT / portTICK_PERIOD_MS)
+        {
+            sendTimeouts++;
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    txSequence++;
+    return true;
+}
+
+// Collect the bytes of the host up to each delimiter, an overlong frame is skipped up to the next one
+void HostLink::receive()
+{
+    uint8_t buf[64];
+    for (;;)
+    {
+        xSemaphoreTake(usbMutex, portMAX_DELAY);
+        uint32_t n = tud_cdc_n_available(HOSTLINK_LINK_ITF) ? tud_cdc_n_read(HOSTLINK_LINK_ITF, buf, sizeof(buf)) : 0;
+        xSemaphoreGive(usbMutex);
+        if (n == 0)
+            return;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (buf[i] != 0)
+            {
+                if (rxLen < sizeof(rx))
+                    rx[rxLen++] = buf[i];
+                else
+                    rxOverflow = true;
+                continue;
+            }
+            uint8_t frame[HOSTLINK_MAX_FRAME];
+            size_t len = rxOverflow ? 0 : hostlink_decodeFrame(rx, rxLen, frame);
+            if (len)
+                dispatch(frame, len);
+            rxLen = 0;
+            rxOverflow = false;
+        }
+    }
+}
+
+// The telemetry rate is set right away, the run control requests go to the control task and the others to the
+// application
+void HostLink::dispatch(const uint8_t *frame, size_t len)
+{
+    HostLinkRequest request;
+    request.type = frame[0];
+    request.sequence = frame[1];
+    request.len = len - 2;
+    memcpy(request.payload, &frame[2], request.len);
+    if (request.type == HOSTLINK_SET_TELEMETRY)
+    {
+        bool ok = request.len == 1 && setRate(request.payload[0]);
+        ack(&request, ok ? HOSTLINK_OK : HOSTLINK_INVALID);
+    }
+    else
+    {
+        bool control = request.type == HOSTLINK_START || request.type == HOSTLINK_STOP ||
+                       request.type == HOSTLINK_SET_SV || request.type == HOSTLINK_GET_STATUS;
+        if (xQueueSend(control ? commands : requests, &request, 0) != pdTRUE)
+            ack(&request, HOSTLINK_BUSY);
+    }
+}
+
+int HostLink::consoleRead(char *buf, int len)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || !xSemaphoreTake(instance->usbMutex, 0))
+        return PICO_ERROR_NO_DATA;
+    int n = tud_cdc_n_available(HOSTLINK_CONSOLE_ITF) ? tud_cdc_n_read(HOSTLINK_CONSOLE_ITF, buf, len) : 0;
+    xSemaphoreGive(instance->usbMutex);
+    return n > 0 ? n : PICO_ERROR_NO_DATA;
+}
+
+// Same policy as pico_stdio_usb, what the host doesn't read within the timeout is dropped
+void HostLink::consoleWrite(const char *buf, int len)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+        return;
+    TickType_t start = xTaskGetTickCount();
+    while (len > 0)
+    {
+        if (!xSemaphoreTake(instance->usbMutex, HOSTLINK_CONSOLE_TIMEOUT / portTICK_PERIOD_MS))
+            return;
+        if (!tud_cdc_n_connected(HOSTLINK_CONSOLE_ITF))
+        {
+            xSemaphoreGive(instance->usbMutex);
+            return;
+        }
+        int n = tud_cdc_n_write(HOSTLINK_CONSOLE_ITF, buf, len);
+        tud_cdc_n_write_flush(HOSTLINK_CONSOLE_ITF);
+        xSemaphoreGive(instance->usbMutex);
+        buf += n;
+        len -= n;
+        if (len > 0)
+        {
+            if (xTaskGetTickCount() - start >= HOSTLINK_CONSOLE_TIMEOUT / portTICK_PERIOD_MS)
+                return;
+            vTaskDelay(1);
+        }
+    }
+}
+
+// Touching 1200 baud on the console reboots to the bootloader, like pico_stdio_usb does for picotool and the IDEs
+extern "C" void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *line_coding)
+{
+    if (itf == HOSTLINK_CONSOLE_ITF && line_coding->bit_rate == 1200)
+        reset_usb_boot(0, 0);
+}
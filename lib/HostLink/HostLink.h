@@ -0,0 +1,102 @@
+/**
+ * @file HostLink.h
+ * @brief USB device with the console on the first CDC interface and the binary host link on the second one
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The control task publishes a snapshot of every iteration through a sequence lock and never waits for the link.
+ * A sampler task copies the snapshot at the rate asked by the host into a lock-free ring, and the link task frames
+ * the samples out of the ring to the USB FIFO. When the host or the USB is behind the ring fills and the samples are
+ * dropped and counted, the count is sent with every sample. The control task only publishes once per control period,
+ * so above 1Hz the samples repeat the control fields and only the timestamp and the raw thermocouple readings of the
+ * sensor task move between them. A frame that doesn't fit the FIFO within HOSTLINK_SEND_TIMEOUT is dropped and
+ * counted too, so a host that stops reading without closing the port never stalls the link task. TinyUSB is not
+ * thread safe, every call to it is made while holding the USB mutex like pico_stdio_usb does.
+ * Requests of the host other than the telemetry rate are queued for the application, the run control ones on a
+ * queue of their own for the control task. They're answered with reply() from the task that took them whenever
+ * it's done, the replies are queued back and sent by the link task ahead of the telemetry, so the link task stays
+ * the only writer of the link interface and no task waits on the USB while holding a lock.
+ * The interfaces after the link one are left to other tasks, which go through readInterface() and writeInterface()
+ * so they take the USB mutex too.
+ */
+#ifndef _HOSTLINK_H_
+#include "FreeRTOS.h"
+#include "HostLinkProtocol.h"
+#include "SpscRing.h"
+#include "pico/stdlib.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+#define _HOSTLINK_H_
+
+#define HOSTLINK_CONSOLE_ITF 0
+#define HOSTLINK_LINK_ITF 1
+#define HOSTLINK_MODBUS_ITF 2
+#define HOSTLINK_RING_SIZE 32        // 320ms of samples at the highest rate
+#define HOSTLINK_CONSOLE_TIMEOUT 10  // in ms, console output is dropped if the host doesn't read it
+#define HOSTLINK_SEND_TIMEOUT 50     // in ms, a frame or interface write is dropped if the host doesn't read it
+#define HOSTLINK_READ_SPINS 256      // Reads of the sequence before a sample overlapping publish() is skipped
+#define HOSTLINK_QUEUE_LENGTH 2
+#define HOSTLINK_COMMAND_QUEUE_LENGTH 4 // Run control requests, taken once per control period
+#define HOSTLINK_REPLY_QUEUE_LENGTH (HOSTLINK_QUEUE_LENGTH + HOSTLINK_COMMAND_QUEUE_LENGTH)
+
+// Request of the host, or reply of the application
+struct HostLinkRequest
+{
+    uint8_t type;
+    uint8_t sequence;
+    uint8_t len;
+    uint8_t payload[HOSTLINK_MAX_PAYLOAD];
+};
+
+class HostLink
+{
+public:
+    bool init(UBaseType_t usbPriority, UBaseType_t samplerPriority, UBaseType_t linkPriority, uint32_t stackSize);
+    void publish(const HostLinkTelemetry *state);
+    bool setRate(uint8_t hz);
+    bool takeRequest(HostLinkRequest *request);
+    bool takeCommand(HostLinkRequest *command);
+    bool reply(const HostLinkRequest *request, uint8_t type, const void *payload, size_t len);
+    bool ack(const HostLinkRequest *request, HostLinkResult result);
+    uint32_t readInterface(uint8_t itf, void *buf, uint32_t len);
+    bool writeInterface(uint8_t itf, const void *buf, uint32_t len);
+    // Last thermocouple reading of a zone, bottom 0 and top 1, single writer
+    __force_inline void setRaw(uint8_t zone, float celcius) { raw[zone] = celcius; }
+    __force_inline uint8_t getRate() { return rate; }
+    // Samples dropped because the link was behind
+    __force_inline uint32_t getDropped() { return ring.getDropped(); }
+    // Frames and interface writes dropped because the host didn't read them within HOSTLINK_SEND_TIMEOUT
+    __force_inline uint32_t getSendTimeouts() { return sendTimeouts; }
+
+protected:
+    static void usbTask(void *pvParameter);
+    static void samplerTask(void *pvParameter);
+    static void linkTask(void *pvParameter);
+    static int consoleRead(char *buf, int len);
+    static void consoleWrite(const char *buf, int len);
+    bool tryRead(HostLinkTelemetry *snapshot);
+    void receive();
+    void dispatch(const uint8_t *frame, size_t len);
+    bool send(uint8_t type, const void *payload, size_t len);
+
+    SemaphoreHandle_t usbMutex = NULL;
+    QueueHandle_t requests = NULL;
+    QueueHandle_t commands = NULL;
+    QueueHandle_t replies = NULL;
+    TaskHandle_t linkHandle = NULL;
+    volatile uint32_t snapshotSequence = 0; // Odd while publish() is copying
+    HostLinkTelemetry snapshot = {};
+    volatile float raw[2] = {};
+    volatile uint8_t rate = HOSTLINK_DEFAULT_RATE;
+    volatile uint32_t sendTimeouts = 0;
+    SpscRing<HostLinkTelemetry, HOSTLINK_RING_SIZE> ring;
+    // Link task only
+    uint8_t txSequence = 0;
+    uint8_t rx[HOSTLINK_MAX_ENCODED];
+    uint16_t rxLen = 0;
+    bool rxOverflow = false;
+};
+#endif
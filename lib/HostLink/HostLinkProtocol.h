@@ -0,0 +1,313 @@
+/**
+ * @file HostLinkProtocol.h
+ * @brief Framing and messages of the binary link to the host on the second USB CDC interface, shared by the
+ * firmware and the host tools so it only includes the standard headers
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * A frame is [type][sequence][payload][CRC16 LE] encoded with COBS and ended by a 0x00 delimiter, so a receiver
+ * that joins in the middle of the stream or loses a byte resynchronizes on the next delimiter. The CRC16-CCITT
+ * covers the type, the sequence and the payload. Each direction numbers its frames with its own sequence, a gap
+ * tells the host how many frames were lost on the way. Multibyte fields are little endian, floats are IEEE 754.
+ */
+#ifndef _HOSTLINKPROTOCOL_H_
+#include <stddef.h>
+#include <stdint.h>
+#define _HOSTLINKPROTOCOL_H_
+
+#define HOSTLINK_MAX_PAYLOAD 240
+#define HOSTLINK_MAX_FRAME (2 + HOSTLINK_MAX_PAYLOAD + 2)
+// COBS adds a byte every 254 bytes, plus the delimiter
+#define HOSTLINK_MAX_ENCODED (HOSTLINK_MAX_FRAME + HOSTLINK_MAX_FRAME / 254 + 2)
+#define HOSTLINK_TELEMETRY_MAX_RATE 100 // in Hz, the control fields still only change once per control period
+#define HOSTLINK_DEFAULT_RATE 10         // in Hz, until the host sets another one
+#define HOSTLINK_MAXIMUM_SV 999          // in celcius, same range as the SV input of the manual operation screen
+
+/*
+ * Requests of the host are answered with a frame whose payload starts with the sequence of the request, which is
+ * the request id: the answers come asynchronously, once the task owning what the request touches got to it, and
+ * not necessarily in the order of the requests. A request that only changes something is answered with
+ * HOSTLINK_ACK. The run control requests are idempotent so a host may repeat one it got no answer to. Profiles
+ * travel encoded by profile_encode().
+ */
+enum HostLinkMessage : uint8_t
+{
+    HOSTLINK_TELEMETRY = 0x01,     // Device to host, HostLinkTelemetry
+    HOSTLINK_SET_TELEMETRY = 0x02, // Host to device, rate in Hz as uint8_t, 0 stops the stream
+    HOSTLINK_GET_PROFILE = 0x03,   // Host to device, profile index as uint8_t
+    HOSTLINK_PROFILE = 0x04,       // Device to host, [request sequence][index][encoded profile]
+    HOSTLINK_SET_PROFILE = 0x05,   // Host to device, [index][encoded profile]
+    HOSTLINK_GET_TUNING = 0x06,    // Host to device, zone as uint8_t
+    HOSTLINK_TUNING = 0x07,        // Device to host, [request sequence][HostLinkTuning]
+    HOSTLINK_SET_TUNING = 0x08,    // Host to device, HostLinkTuning
+    HOSTLINK_ACK = 0x09,           // Device to host, [request sequence][request type][HostLinkResult]
+    // Run control, applied by the control task at the start of its next iteration
+    HOSTLINK_START = 0x0A,          // Host to device, HostLinkMode as uint8_t, OK if that operation already runs
+    HOSTLINK_STOP = 0x0B,           // Host to device, no payload, stops either operation
+    HOSTLINK_SET_SV = 0x0C,         // Host to device, SV of the manual operation in celcius, uint16_t bottom then top
+    HOSTLINK_GET_STATUS = 0x0D,     // Host to device, no payload
+    HOSTLINK_STATUS = 0x0E,         // Device to host, [request sequence][HostLinkStatus]
+    HOSTLINK_SELECT_PROFILE = 0x0F, // Host to device, profile index of the auto operation as uint8_t
+    // Diagnostics, the task list comes in pages of up to HOSTLINK_HEALTH_TASKS
+    HOSTLINK_GET_HEALTH = 0x10, // Host to device, index of the first task as uint8_t
+    HOSTLINK_HEALTH = 0x11,     // Device to host, [request sequence][HostLinkHealth][HostLinkTaskHealth * count]
+    // Run log kept in the flash, a page comes in chunks of up to HOSTLINK_RUN_CHUNK bytes
+    HOSTLINK_GET_RUN_PAGE = 0x12, // Host to device, sequence of the page as uint32_t then offset in it as uint8_t
+    HOSTLINK_RUN_PAGE = 0x13,     // Device to host, [request sequence][HostLinkRunPage][chunk of the payload]
+};
+
+enum HostLinkMode : uint8_t
+{
+    HOSTLINK_MODE_MANUAL = 0,
+    HOSTLINK_MODE_AUTO = 1,
+};
+
+enum HostLinkResult : uint8_t
+{
+    HOSTLINK_OK = 0,
+    HOSTLINK_INVALID = 1, // Unknown request, wrong length or a value out of range
+    HOSTLINK_BUSY = 2,    // The request queue is full or the screen editing the same thing is open, try again
+    HOSTLINK_STORAGE = 3, // Applied but not saved, there's no room left or the storage failed
+    HOSTLINK_REFUSED = 4, // Not allowed while the station is in this state, like a start while the other runs
+};
+
+// Bits of HostLinkTelemetry::flags
+#define HOSTLINK_FLAG_MANUAL 0x01   // Manual operation is running
+#define HOSTLINK_FLAG_AUTO 0x02     // Auto operation is running
+#define HOSTLINK_FLAG_LEARNING 0x04 // The learned feed-forward is added to the PID output
+
+// Zones are ordered bottom then top, like the SSRs
+struct __attribute__((packed)) HostLinkTelemetry
+{
+    uint32_t timestamp;   // in us, when the sample was taken, wraps around every ~71 minutes
+    uint32_t dropped;     // Samples dropped so far because the link was behind
+    uint32_t loopPeriod;  // in us, between the last two control iterations
+    uint16_t loopTime;    // in us, how long the last control iteration took
+    uint16_t runSecond;   // Seconds since the operation started
+    uint8_t flags;
+    uint8_t status[2];    // ThermocoupleStatus of each zone
+    float raw[2];         // in celcius, last thermocouple reading of each zone
+    float pv[2];          // in celcius, filtered or estimated temperature the PID acts on
+    float sv[2];          // in celcius
+    float proportional[2];
+    float integral[2];
+    float derivative[2];
+    float duty[2]; // 0 to 1, applied to the SSR
+};
+
+#define HOSTLINK_TUNING_MAX_BREAKPOINT 5
+
+// PID constants and gain schedule of one zone, a schedule without breakpoints uses the fixed constants
+struct __attribute__((packed)) HostLinkTuning
+{
+    uint8_t zone; // 0 bottom, 1 top
+    float kp;
+    float ki;
+    float kd;
+    float tau;
+    uint8_t breakpointCount;
+    struct __attribute__((packed))
+    {
+        uint16_t temperature; // in celcius, sorted ascending
+        float kp;
+        float ki;
+        float kd;
+    } breakpoints[HOSTLINK_TUNING_MAX_BREAKPOINT];
+};
+
+// State of the station, zones are ordered bottom then top
+struct __attribute__((packed)) HostLinkStatus
+{
+    uint8_t flags; // HOSTLINK_FLAG_*
+    uint8_t selectedProfile;
+    uint16_t runSecond;
+    uint16_t manualSV[2]; // in celcius, SV of the manual operation
+    uint8_t status[2];    // ThermocoupleStatus of each zone
+    float pv[2];          // in celcius
+    float sv[2];          // in celcius, applied on the last control iteration, 0 when idle
+    float duty[2];        // 0 to 1, applied on the last control iteration
+};
+
+#define HOSTLINK_HEALTH_TASKS 8      // Tasks in one HOSTLINK_HEALTH answer
+#define HOSTLINK_TASK_NAME_LENGTH 16 // Not terminated when the name fills it
+
+// Load and memory margins of the firmware, loads are in permille over the last window
+struct __attribute__((packed)) HostLinkHealth
+{
+    uint32_t uptime;           // in s
+    uint32_t window;           // in us, 0 until the first window is over
+    uint16_t coreLoad[2];      // Time outside of the idle tasks
+    uint16_t isrLoad[2];       // Time in the timed ISRs
+    uint32_t heapFree;         // in bytes, FreeRTOS heap
+    uint32_t heapMinimum;      // in bytes, lowest free heap since boot
+    uint32_t lvglSize;         // in bytes, LVGL memory pool
+    uint32_t lvglFree;         // in bytes
+    uint32_t lvglBiggest;      // in bytes, biggest free block
+    uint8_t lvglFragmentation; // in percent
+    uint8_t taskCount;         // Tasks in every page
+    uint8_t first;             // Index of the first task of this page
+    uint8_t count;             // Tasks in this page
+};
+
+struct __attribute__((packed)) HostLinkTaskHealth
+{
+    char name[HOSTLINK_TASK_NAME_LENGTH];
+    uint16_t load;      // in permille of one core
+    uint16_t stackFree; // in words, lowest since the task started
+    uint8_t priority;
+    uint8_t state;      // 0 running, 1 ready, 2 blocked, 3 suspended, 4 deleted
+    uint8_t affinity;   // Bit of each core the task may run on
+};
+
+#define HOSTLINK_RUN_CHUNK 128        // Payload bytes in one HOSTLINK_RUN_PAGE answer
+#define HOSTLINK_RUN_PAGE_SIZE 248    // Largest payload of a page of the run log
+#define HOSTLINK_RUN_BOARD_ID_SIZE 8  // Board id at the start of a run header
+#define HOSTLINK_RUN_RECORD_SIZE 16   // Sample of one control period
+
+/*
+ * Pages of the run log. A run starts with a header page, then the samples of its control periods fill records
+ * pages, each sample is little endian:
+ *   [0..1] second, [2..5] SV bottom and top in celcius, [6..9] PV bottom and top in 0.1 celcius (signed),
+ *   [10..13] duty bottom and top in permille, [14] thermocouple status bottom (bits 0-2) and top (bits 3-5),
+ *   auto operation (bit 6), learned feed-forward applied (bit 7), [15] reserved
+ */
+enum HostLinkRunPageType : uint8_t
+{
+    HOSTLINK_RUN_NONE = 0,      // Overwritten, never written or corrupted
+    HOSTLINK_RUN_HEADER = 'R',  // Board id, auto operation as uint8_t, profile index as uint16_t, then the profile
+                                // encoded by profile_encode() if it's the auto operation
+    HOSTLINK_RUN_RECORDS = 'D', // HOSTLINK_RUN_RECORD_SIZE bytes per sample
+};
+
+// Pages go from oldest to next - 1, the oldest ones are overwritten while the station records
+struct __attribute__((packed)) HostLinkRunPage
+{
+    uint32_t oldest;   // Sequence of the oldest page still in the log
+    uint32_t next;     // Sequence the next page is written with
+    uint32_t sequence; // Of this page
+    uint8_t type;      // HostLinkRunPageType
+    uint8_t len;       // Payload of the whole page
+    uint8_t offset;    // Of this chunk in the payload
+    uint8_t count;     // Bytes in this chunk
+};
+
+static inline uint16_t hostlink_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS encode a frame and append the delimiter
+ *
+ * @param src
+ * @param len
+ * @param dest At least len + len / 254 + 2 bytes
+ * @return size_t Encoded length, delimiter included
+ */
+static inline size_t hostlink_cobsEncode(const uint8_t *src, size_t len, uint8_t *dest)
+{
+    size_t code = 0, out = 1; // Where the code of the current block goes, and the next data byte
+    uint8_t run = 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (src[i] != 0)
+            dest[out++] = src[i];
+        if (src[i] == 0 || ++run == 0xFF)
+        {
+            dest[code] = run;
+            code = out++;
+            run = 1;
+        }
+    }
+    dest[code] = run;
+    dest[out++] = 0;
+    return out;
+}
+
+/**
+ * @brief COBS decode a frame received without its delimiter
+ *
+ * @param src
+ * @param len
+ * @param dest At least len bytes
+ * @return size_t Decoded length, 0 if the encoding is not valid
+ */
+static inline size_t hostlink_cobsDecode(const uint8_t *src, size_t len, uint8_t *dest)
+{
+    size_t in = 0, out = 0;
+    while (in < len)
+    {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len)
+            return 0;
+        for (uint8_t i = 1; i < code; i++)
+        {
+            if (src[in] == 0)
+                return 0;
+            dest[out++] = src[in++];
+        }
+        if (code != 0xFF && in < len)
+            dest[out++] = 0;
+    }
+    return out;
+}
+
+/**
+ * @brief Build and encode a frame
+ *
+ * @param type
+ * @param sequence
+ * @param payload
+ * @param len Up to HOSTLINK_MAX_PAYLOAD bytes
+ * @param dest HOSTLINK_MAX_ENCODED bytes
+ * @return size_t Encoded length, 0 if the payload is too long
+ */
+static inline size_t hostlink_encodeFrame(uint8_t type, uint8_t sequence, const void *payload, size_t len,
+                                          uint8_t *dest)
+{
+    uint8_t frame[HOSTLINK_MAX_FRAME];
+    if (len > HOSTLINK_MAX_PAYLOAD)
+        return 0;
+    frame[0] = type;
+    frame[1] = sequence;
+    for (size_t i = 0; i < len; i++)
+        frame[2 + i] = ((const uint8_t *)payload)[i];
+    uint16_t crc = hostlink_crc16(frame, 2 + len);
+    frame[2 + len] = crc & 0xFF;
+    frame[3 + len] = crc >> 8;
+    return hostlink_cobsEncode(frame, 4 + len, dest);
+}
+
+/**
+ * @brief Decode a frame received without its delimiter and check its CRC
+ *
+ * @param src
+ * @param len
+ * @param frame HOSTLINK_MAX_FRAME bytes, receives [type][sequence][payload]
+ * @return size_t Payload length + 2, 0 if the frame is not valid
+ */
+static inline size_t hostlink_decodeFrame(const uint8_t *src, size_t len, uint8_t *frame)
+{
+    if (len == 0 || len > HOSTLINK_MAX_ENCODED)
+        return 0;
+    uint8_t decoded[HOSTLINK_MAX_ENCODED];
+    size_t n = hostlink_cobsDecode(src, len, decoded);
+    if (n < 4 || n > HOSTLINK_MAX_FRAME)
+        return 0;
+    uint16_t crc = decoded[n - 2] | (uint16_t)decoded[n - 1] << 8;
+    if (hostlink_crc16(decoded, n - 2) != crc)
+        return 0;
+    for (size_t i = 0; i < n - 2; i++)
+        frame[i] = decoded[i];
+    return n - 2;
+}
+#endif
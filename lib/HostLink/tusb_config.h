@@ -0,0 +1,27 @@
+/**
+ * @file tusb_config.h
+ * @brief TinyUSB device configuration, the console, the host link and Modbus are three CDC interfaces of one device
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Replaces the configuration of pico_stdio_usb, which only has one CDC interface. tud_task() is run by the USB task
+ * of HostLink instead of the SDK's low priority IRQ.
+ */
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
+
+#define CFG_TUSB_RHPORT0_MODE OPT_MODE_DEVICE
+#define CFG_TUD_ENDPOINT0_SIZE 64
+
+#define CFG_TUD_CDC 3 // Console, host link, Modbus
+#define CFG_TUD_MSC 0
+#define CFG_TUD_HID 0
+#define CFG_TUD_MIDI 0
+#define CFG_TUD_VENDOR 0
+
+#define CFG_TUD_CDC_RX_BUFSIZE 256
+#define CFG_TUD_CDC_TX_BUFSIZE 1024 // About 10 telemetry frames, the USB task empties it every ms
+#define CFG_TUD_CDC_EP_BUFSIZE 64
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file usb_descriptors.c
+ * @brief USB descriptors of the console, host link and Modbus CDC interfaces
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "pico/unique_id.h"
+#include "tusb.h"
+
+// The station has no product id of its own, it keeps the one of pico_stdio_usb so the udev rules and drivers set up
+// for the Pico still match. The interfaces differ from pico_stdio_usb, bcdDevice tells them apart so a host that
+// cached the single CDC layout enumerates again. The three ports are told apart by their interface strings and the
+// serial number, /dev/serial/by-id shows both.
+#define USBD_VID 0x2E8A // Raspberry Pi
+#define USBD_PID 0x000A // Raspberry Pi Pico SDK CDC
+#define USBD_MAX_POWER_MA 250
+
+enum
+{
+    ITF_NUM_CDC_CONSOLE = 0,
+    ITF_NUM_CDC_CONSOLE_DATA,
+    ITF_NUM_CDC_LINK,
+    ITF_NUM_CDC_LINK_DATA,
+    ITF_NUM_CDC_MODBUS,
+    ITF_NUM_CDC_MODBUS_DATA,
+    ITF_NUM_TOTAL
+};
+
+#define EPNUM_CDC_CONSOLE_NOTIF 0x81
+#define EPNUM_CDC_CONSOLE_OUT 0x02
+#define EPNUM_CDC_CONSOLE_IN 0x82
+#define EPNUM_CDC_LINK_NOTIF 0x83
+#define EPNUM_CDC_LINK_OUT 0x04
+#define EPNUM_CDC_LINK_IN 0x84
+#define EPNUM_CDC_MODBUS_NOTIF 0x85
+#define EPNUM_CDC_MODBUS_OUT 0x06
+#define EPNUM_CDC_MODBUS_IN 0x86
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_CDC * TUD_CDC_DESC_LEN)
+
+enum
+{
+    STRID_LANGID = 0,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_CONSOLE,
+    STRID_LINK,
+    STRID_MODBUS,
+};
+
+static const tusb_desc_device_t usbd_desc_device = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    // Interface association descriptors group the two interfaces of each CDC
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USBD_VID,
+    .idProduct = USBD_PID,
+    .bcdDevice = 0x0300, // Three CDC interfaces, pico_stdio_usb has one
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t usbd_desc_cfg[CONFIG_TOTAL_LEN] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, USBD_MAX_POWER_MA),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_CONSOLE, STRID_CONSOLE, EPNUM_CDC_CONSOLE_NOTIF, 8, EPNUM_CDC_CONSOLE_OUT,
+                       EPNUM_CDC_CONSOLE_IN, CFG_TUD_CDC_EP_BUFSIZE),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_LINK, STRID_LINK, EPNUM_CDC_LINK_NOTIF, 8, EPNUM_CDC_LINK_OUT, EPNUM_CDC_LINK_IN,
+                       CFG_TUD_CDC_EP_BUFSIZE),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_MODBUS, STRID_MODBUS, EPNUM_CDC_MODBUS_NOTIF, 8, EPNUM_CDC_MODBUS_OUT,
+                       EPNUM_CDC_MODBUS_IN, CFG_TUD_CDC_EP_BUFSIZE),
+};
+
+#define USBD_PRODUCT "HotBerry Rework Station" // Longest string
+#define USBD_DESC_STR_MAX 32                    // in characters
+_Static_assert(sizeof(USBD_PRODUCT) - 1 <= USBD_DESC_STR_MAX, "Product string doesn't fit the descriptor buffer");
+_Static_assert(2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES <= USBD_DESC_STR_MAX, "Serial doesn't fit the descriptor buffer");
+
+static const char *const usbd_desc_str[] = {
+    [STRID_MANUFACTURER] = "HotBerry",
+    [STRID_PRODUCT] = USBD_PRODUCT,
+    [STRID_SERIAL] = NULL, // Board id, so every station keeps its own name on the host
+    [STRID_CONSOLE] = "HotBerry Console",
+    [STRID_LINK] = "HotBerry Link",
+    [STRID_MODBUS] = "HotBerry Modbus",
+};
+
+const uint8_t *tud_descriptor_device_cb(void)
+{
+    return (const uint8_t *)&usbd_desc_device;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index)
+{
+    (void)index;
+    return usbd_desc_cfg;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+    static uint16_t desc_str[USBD_DESC_STR_MAX + 1];
+    (void)langid;
+    uint8_t len;
+    if (index == STRID_LANGID)
+    {
+        desc_str[1] = 0x0409; // English
+        len = 1;
+    }
+    else
+    {
+        char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+        const char *str;
+        if (index == STRID_SERIAL)
+        {
+            pico_get_unique_board_id_string(serial, sizeof(serial));
+            str = serial;
+        }
+        else if (index < sizeof(usbd_desc_str) / sizeof(usbd_desc_str[0]) && usbd_desc_str[index])
+            str = usbd_desc_str[index];
+        else
+            return NULL;
+        for (len = 0; str[len] && len < sizeof(desc_str) / sizeof(desc_str[0]) - 1; len++)
+            desc_str[1 + len] = str[len];
+    }
+    desc_str[0] = (TUSB_DESC_STRING << 8) | (2 * len + 2);
+    return desc_str;
+}
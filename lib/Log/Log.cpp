@@ -0,0 +1,167 @@
+/**
+ * @file Log.cpp
+ * @brief Deferred console log, the callers only copy the format pointer and the arguments to a per-core ring
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Log.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+Log logger;
+
+/**
+ * @brief Create the drain task, records written before the scheduler starts are printed once it runs
+ *
+ * @param priority Lowest priority that still gets to run, the output is only late when it's starved
+ * @param stackSize in words, the formatting of floats takes most of it
+ * @return true if the task was created
+ */
+bool Log::init(UBaseType_t priority, uint32_t stackSize)
+{
+    return xTaskCreate(drainTask, "log_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+// Masking the interrupts keeps the task on this core and the other producers of the core out until the copy is done
+void Log::push(const LogRecord *record)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    rings[get_core_num()].push(*record);
+    restore_interrupts(interrupts);
+}
+
+/**
+ * @brief Format a record like printf would have, every conversion is handed its own argument with the type it
+ * expects
+ *
+ * @param dest
+ * @param size
+ * @param record
+ * @return size_t Length of the line, cut to size - 1
+ */
+size_t Log::format(char *dest, size_t size, const LogRecord *record)
+{
+    size_t len = 0;
+    uint8_t arg = 0;
+    const char *p = record->format;
+    while (*p && len < size - 1)
+    {
+        if (*p != '%')
+        {
+            dest[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            dest[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Copy the conversion with its flags, width, precision and length, a * width or precision is not supported
+        char spec[16];
+        size_t specLen = 0;
+        uint8_t longs = 0;
+        spec[specLen++] = *p++;
+        while (*p && strchr("-+ #0123456789.hlzjt", *p) && specLen < sizeof(spec) - 2)
+        {
+            if (*p == 'l')
+                longs++;
+            spec[specLen++] = *p++;
+        }
+        char conversion = *p;
+        if (conversion == '\0')
+            break;
+        spec[specLen++] = *p++;
+        spec[specLen] = '\0';
+
+        LogArg value = arg < record->argc ? record->args[arg] : LogArg{};
+        arg++;
+        int n;
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+        case 'c':
+            n = longs >= 2 ? snprintf(&dest[len], size - len, spec, (long long)value.i)
+                           : (longs ? snprintf(&dest[len], size - len, spec, (long)value.i)
+                                    : snprintf(&dest[len], size - len, spec, (int)value.i));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            n = longs >= 2 ? snprintf(&dest[len], size - len, spec, (unsigned long long)value.u)
+                           : (longs ? snprintf(&dest[len], size - len, spec, (unsigned long)value.u)
+                                    : snprintf(&dest[len], size - len, spec, (unsigned)value.u));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            n = snprintf(&dest[len], size - len, spec, value.d);
+            break;
+        case 's':
+            n = snprintf(&dest[len], size - len, spec, value.p ? (const char *)value.p : "(null)");
+            break;
+        case 'p':
+            n = snprintf(&dest[len], size - len, spec, value.p);
+            break;
+        default: // Unknown conversion, printed as it was written
+            n = snprintf(&dest[len], size - len, "%s", spec);
+            break;
+        }
+        if (n > 0)
+            len += (size_t)n < size - len ? n : size - len - 1;
+    }
+    dest[len] = '\0';
+    return len;
+}
+
+void Log::drainTask(void *pvParameter)
+{
+    Log *log = (Log *)pvParameter;
+    static const char levelName[] = {'E', 'W', 'I', 'D'};
+    for (;;)
+    {
+        // Both rings are merged by timestamp so the lines keep the order they were written in
+        bool any = false;
+        for (;;)
+        {
+            const LogRecord *heads[2] = {log->rings[0].peek(), log->rings[1].peek()};
+            if (heads[0] == NULL && heads[1] == NULL)
+                break;
+            uint8_t core =
+                heads[0] == NULL || (heads[1] && (int32_t)(heads[1]->timestamp - heads[0]->timestamp) < 0) ? 1 : 0;
+            LogRecord record;
+            log->rings[core].pop(&record);
+            any = true;
+
+            char line[LOG_LINE_SIZE];
+            int prefix = snprintf(line, sizeof(line), "[%6lu.%03lu] %c ", (unsigned long)(record.timestamp / 1000),
+                                  (unsigned long)(record.timestamp % 1000),
+                                  record.level < sizeof(levelName) ? levelName[record.level] : '?');
+            size_t len = prefix + format(&line[prefix], sizeof(line) - prefix, &record);
+            if (len == sizeof(line) - 1 && line[len - 1] != '\n') // Cut, the next line still starts on its own
+                line[len - 1] = '\n';
+            printf("%s", line);
+        }
+
+        for (uint8_t core = 0; core < 2; core++)
+        {
+            uint32_t dropped = log->rings[core].getDropped();
+            if (dropped != log->reported[core])
+            {
+                printf("%lu log records of core %u dropped\n", (unsigned long)(dropped - log->reported[core]), core);
+                log->reported[core] = dropped;
+            }
+        }
+        if (!any)
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file Log.h
+ * @brief Deferred console log, the callers only copy the format pointer and the arguments to a per-core ring
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Formatting and the console output happen on a low priority drain task, so the control and render paths never
+ * wait on the UART or the USB. Each core has its own single-producer ring, the record is pushed with the interrupts
+ * of that core masked so the tasks and ISRs sharing a core can't interleave, and nothing is shared with the other
+ * core but the ring indexes. A full ring drops the record, the drain task reports how many were lost.
+ * The format is kept as a pointer and formatted later, so it has to be a string literal and so do the %s arguments.
+ * Levels above LOG_LEVEL are compiled out, arguments included. Without PICO_BOARD the macros are plain printf.
+ */
+#ifndef _LOG_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <type_traits>
+#define _LOG_H_
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#ifdef PICO_BOARD
+#include "FreeRTOS.h"
+#include "SpscRing.h"
+#include "pico/stdlib.h"
+#include "task.h"
+
+#define LOG_MAX_ARGS 6
+#define LOG_RING_SIZE 32  // Records per core
+#define LOG_LINE_SIZE 160 // Longer lines are cut
+
+#define LOG_AT(level, format, ...)                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr ((level) <= LOG_LEVEL)                                                                            \
+            logger.write((level), (format), ##__VA_ARGS__);                                                            \
+    } while (0)
+
+// Argument as it was passed, the conversion of the format tells the drain task which member to use
+union LogArg
+{
+    int64_t i;
+    uint64_t u;
+    double d;
+    const void *p;
+};
+
+struct LogRecord
+{
+    const char *format;
+    uint32_t timestamp; // in ms
+    uint8_t level;
+    uint8_t argc;
+    LogArg args[LOG_MAX_ARGS];
+};
+
+template <typename T> inline LogArg log_arg(T value)
+{
+    LogArg arg;
+    if constexpr (std::is_floating_point<T>::value)
+        arg.d = value;
+    else if constexpr (std::is_pointer<T>::value)
+        arg.p = (const void *)value;
+    else if constexpr (std::is_enum<T>::value)
+        arg.i = (int64_t)value;
+    else if constexpr (std::is_signed<T>::value)
+        arg.i = value;
+    else
+        arg.u = value;
+    return arg;
+}
+
+class Log
+{
+public:
+    bool init(UBaseType_t priority, uint32_t stackSize);
+
+    // Never blocks, callable from any task or ISR of either core
+    template <typename... Args> void write(uint8_t level, const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for a log record");
+        LogRecord record;
+        record.format = format;
+        record.timestamp = to_ms_since_boot(get_absolute_time());
+        record.level = level;
+        record.argc = sizeof...(Args);
+        LogArg captured[] = {log_arg(args)..., LogArg{}};
+        for (uint8_t i = 0; i < record.argc; i++)
+            record.args[i] = captured[i];
+        push(&record);
+    }
+
+protected:
+    static void drainTask(void *pvParameter);
+    void push(const LogRecord *record);
+    static size_t format(char *dest, size_t size, const LogRecord *record);
+
+    SpscRing<LogRecord, LOG_RING_SIZE> rings[2];
+    uint32_t reported[2] = {}; // Drops already reported, drain task only
+};
+
+extern Log logger;
+#else
+#define LOG_AT(level, ...)                                                                                             \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr ((level) <= LOG_LEVEL)                                                                            \
+            printf(__VA_ARGS__);                                                                                       \
+    } while (0)
+#endif
+#endif
@@ -0,0 +1,43 @@
+/**
+ * @file MAX31855.cpp
+ * @brief Simple library to interface to MAX31855K Thermocouple Type-K on RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "MAX31855.h"
+
+/**
+ * @brief Need to be called before sampling the sensor
+ *
+ */
+void MAX31855::init()
+{
+    initPins();
+    frame = 0;
+    coldJunction = 0.0f;
+}
+
+/**
+ * @brief Read the last conversion, the chip converts continuously every 100ms while CS is high
+ *
+ * @param celcius Cold junction compensated temperature, left untouched unless the readout is valid
+ * @return ThermocoupleStatus of the readout
+ */
+ThermocoupleStatus MAX31855::convert(float *celcius)
+{
+    gpio_put(cs, 0);
+    frame = transfer(32, 0, true);
+    gpio_put(cs, 1);
+
+    ThermocoupleStatus status = statusOf(frame);
+    if (status == THERMOCOUPLE_NOT_READY)
+        return status;
+    // 12-bit signed cold junction temperature from D15..D4
+    coldJunction = ((int32_t)(frame << 16) >> 20) * 0.0625f;
+    if (status == THERMOCOUPLE_VALID)
+        *celcius = toCelcius(frame);
+    return status;
+}
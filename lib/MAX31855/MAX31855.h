@@ -0,0 +1,48 @@
+/**
+ * @file MAX31855.h
+ * @brief Simple library to interface to MAX31855K Thermocouple Type-K on RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _MAX31855_H_
+#include "Thermocouple.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#define _MAX31855_H_
+
+// Read-only, pin compatible with the MAX6675 wiring
+class MAX31855 : public Thermocouple<MAX31855>
+{
+public:
+    using Thermocouple::Thermocouple;
+    static constexpr uint32_t conversionTime = 100000UL; // in uS
+    static constexpr float resolution = 0.25f;           // in celcius
+
+    void init();
+    ThermocoupleStatus convert(float *celcius);
+    // Cold junction (die) temperature measured along the last readout
+    __force_inline float getColdJunction() { return coldJunction; }
+    __force_inline uint32_t getLastFrame() { return frame; }
+
+    // Status of a raw 32-bit frame, D17 and D3 always read 0
+    __force_inline static ThermocoupleStatus statusOf(uint32_t raw)
+    {
+        if (raw & 0x00020008)
+            return THERMOCOUPLE_NOT_READY;
+        if (raw & 0x01)
+            return THERMOCOUPLE_OPEN;
+        if (raw & 0x00010006) // Fault, short to VCC or short to GND
+            return THERMOCOUPLE_SHORT;
+        return THERMOCOUPLE_VALID;
+    }
+    // 14-bit signed thermocouple temperature from D31..D18
+    __force_inline static float toCelcius(uint32_t raw) { return ((int32_t)raw >> 18) * 0.25f; }
+
+protected:
+    uint32_t frame;
+    float coldJunction;
+};
+#endif
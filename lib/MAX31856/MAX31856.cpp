@@ -0,0 +1,71 @@
+/**
+ * @file MAX31856.cpp
+ * @brief Simple library to interface to MAX31856 Thermocouple to digital converter on RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "MAX31856.h"
+
+/**
+ * @brief Configure the chip for a type K thermocouple with continuous conversion
+ *
+ * @return true if the configuration reads back, false without SDI or with no chip answering
+ */
+bool MAX31856::init()
+{
+    fault = 0;
+    if (sdi == THERMOCOUPLE_NO_PIN)
+        return false;
+    initPins();
+    writeRegister(MAX31856_CR1, MAX31856_CR1_TYPE_K);
+    writeRegister(MAX31856_CR0, MAX31856_CR0_AUTO | MAX31856_CR0_OCFAULT | MAX31856_CR0_50HZ);
+    return readRegister(MAX31856_CR1) == MAX31856_CR1_TYPE_K;
+}
+
+void MAX31856::setColdJunctionOffset(float celcius)
+{
+    float steps = celcius / 0.0625f;
+    steps = steps < -128.0f ? -128.0f : (steps > 127.0f ? 127.0f : steps);
+    writeRegister(MAX31856_CJTO, (uint8_t)(int8_t)steps);
+}
+
+void MAX31856::writeRegister(uint8_t reg, uint8_t value)
+{
+    gpio_put(cs, 0);
+    transfer(16, (uint32_t)(reg | MAX31856_WRITE) << 8 | value, false);
+    gpio_put(cs, 1);
+}
+
+uint8_t MAX31856::readRegister(uint8_t reg)
+{
+    gpio_put(cs, 0);
+    uint8_t value = transfer(16, (uint32_t)reg << 8, false);
+    gpio_put(cs, 1);
+    return value;
+}
+
+/**
+ * @brief Read the last conversion, the three temperature bytes and the fault status in one burst
+ *
+ * @param celcius Cold junction compensated temperature, left untouched unless the readout is valid
+ * @return ThermocoupleStatus of the readout
+ */
+ThermocoupleStatus MAX31856::convert(float *celcius)
+{
+    gpio_put(cs, 0);
+    transfer(8, MAX31856_LTCBH, false);
+    uint32_t ltc = transfer(24, 0, false);
+    fault = transfer(8, 0, false);
+    gpio_put(cs, 1);
+
+    if (fault & MAX31856_SR_OPEN)
+        return THERMOCOUPLE_OPEN;
+    if (fault & (MAX31856_SR_OVUV | MAX31856_SR_RANGE))
+        return THERMOCOUPLE_SHORT;
+    // 19-bit signed temperature, left aligned in the 24 bits read
+    *celcius = ((int32_t)(ltc << 8) >> 13) * resolution;
+    return THERMOCOUPLE_VALID;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file MAX31856.h
+ * @brief Simple library to interface to MAX31856 Thermocouple to digital converter on RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _MAX31856_H_
+#include "Thermocouple.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#define _MAX31856_H_
+
+// Registers, OR with MAX31856_WRITE to write
+#define MAX31856_CR0 0x00
+#define MAX31856_CR1 0x01
+#define MAX31856_MASK 0x02
+#define MAX31856_CJTO 0x09
+#define MAX31856_LTCBH 0x0C
+#define MAX31856_SR 0x0F
+#define MAX31856_WRITE 0x80
+
+#define MAX31856_CR0_AUTO 0x80     // Automatic conversion mode
+#define MAX31856_CR0_OCFAULT 0x10  // Open circuit detection, for thermocouple resistance under 5k
+#define MAX31856_CR0_50HZ 0x01     // Reject 50Hz mains instead of 60Hz
+#define MAX31856_CR1_TYPE_K 0x03
+#define MAX31856_SR_OPEN 0x01
+#define MAX31856_SR_OVUV 0x02      // Input over or under voltage, usually shorted to a supply
+#define MAX31856_SR_RANGE 0xFC     // Thermocouple or cold junction out of range or over a threshold
+
+// Needs SDI for the configuration, unlike the MAX6675 and MAX31855
+class MAX31856 : public Thermocouple<MAX31856>
+{
+public:
+    using Thermocouple::Thermocouple;
+    static constexpr uint32_t conversionTime = 100000UL; // in uS, automatic mode with 50Hz rejection
+    static constexpr float resolution = 0.0078125f;      // in celcius
+
+    bool init();
+    ThermocoupleStatus convert(float *celcius);
+    // Trim the cold junction for a sensor that doesn't sit at the terminal block temperature, 0.0625 celcius steps
+    void setColdJunctionOffset(float celcius);
+    __force_inline uint8_t getFault() { return fault; }
+
+protected:
+    void writeRegister(uint8_t reg, uint8_t value);
+    uint8_t readRegister(uint8_t reg);
+    uint8_t fault;
+};
+#endif
@@ -16,10 +16,13 @@
  */
 void MAX6675::init()
 {
+    status = THERMOCOUPLE_NOT_READY;
+    lastSample = nil_time;
     gpio_init(sdo);
     gpio_init(sck);
     gpio_init(cs);
     gpio_set_dir(sdo, GPIO_IN);
+    gpio_pull_up(sdo); // A missing chip reads all ones, rejected by statusOf()
     gpio_set_dir(sck, GPIO_OUT);
     gpio_set_dir(cs, GPIO_OUT);
 
@@ -30,7 +33,8 @@ void MAX6675::init()
 /**
  * @brief Sample sensor, only need to be called once every 0.17s because sensor conversion time is 0.17s
  * 
- * @return uint16_t Sampled 12-bit ADC ranging from 0 to 700C
+ * @return uint16_t Sampled 12-bit ADC ranging from 0 to 700C, 0xFFFE if the conversion is not done yet or 0xFFFF
+ * if the thermocouple is open. getStatus() tells why
  */
 uint16_t MAX6675::sample()
 {
@@ -39,8 +43,11 @@ uint16_t MAX6675::sample()
     // The sensor typically needs 0.17s to convert next value
     // so if last sampling time is less than conversion time we halt the sampling and return 0xFFFE instead
     uint64_t diff = absolute_time_diff_us(lastSample, get_absolute_time());
-    // if (diff < CONVERSION_TIME)
-        // return 0xFFFE;
+    if (diff < CONVERSION_TIME)
+    {
+        status = THERMOCOUPLE_NOT_READY;
+        return 0xFFFE;
+    }
     
     uint16_t resp = 0;
     /*
@@ -80,8 +87,23 @@ uint16_t MAX6675::sample()
     result = (resp & 0x7FF8) >> 3;
     open = resp & 0x04;
     exist = resp & 0x02;
-    // if (open)
-        // return 0xFFFF;
+    status = statusOf(resp);
     lastSample = get_absolute_time();
+    if (status != THERMOCOUPLE_VALID)
+        return status == THERMOCOUPLE_OPEN ? 0xFFFF : 0xFFFE;
     return result;
+}
+
+/**
+ * @brief Sample the sensor through the common thermocouple interface
+ *
+ * @param celcius Left untouched unless the readout is valid
+ * @return ThermocoupleStatus of the readout
+ */
+ThermocoupleStatus MAX6675::convert(float *celcius)
+{
+    uint16_t adc = sample();
+    if (status == THERMOCOUPLE_VALID)
+        *celcius = toCelcius(adc);
+    return status;
 }
\ No newline at end of file
@@ -9,28 +9,44 @@
  * 
  */
 #ifndef _MAX6675_H_
+#include "Thermocouple.h"
 #include "pico/stdlib.h"
 #include <stdio.h>
 #define _MAX6675_H_
 
 #define CONVERSION_TIME 230000UL // in uS
-class MAX6675
+class MAX6675 : public Thermocouple<MAX6675>
 {
 public:
-    MAX6675(uint8_t _sdo, uint8_t _sck, uint8_t _cs) : sdo(_sdo), sck(_sck), cs(_cs) {}
+    using Thermocouple::Thermocouple;
+    static constexpr uint32_t conversionTime = CONVERSION_TIME;
+    static constexpr float resolution = 0.25f; // in celcius
+
     void init();
     uint16_t sample();
+    ThermocoupleStatus convert(float *celcius);
     __force_inline bool isOpen() { return open; }
     __force_inline bool isExist() { return exist; }
+    __force_inline ThermocoupleStatus getStatus() { return status; }
+    // Status of a raw 16-bit frame, D15 and D1 always read 0 on a MAX6675. SO is pulled up, a missing chip reads
+    // 0xFFFF, and an all zero frame is what a dead or unpowered chip pulling SO low gives, never a reading of the oven
+    __force_inline static ThermocoupleStatus statusOf(uint16_t raw)
+    {
+        if (raw & 0x8002 || raw == 0)
+            return THERMOCOUPLE_NOT_READY;
+        return raw & 0x04 ? THERMOCOUPLE_OPEN : THERMOCOUPLE_VALID;
+    }
     // Get last sampled result without sampling the sensor
     __force_inline uint16_t getLastResult() { return result; }
     // Convert passed 12-bit adc to actual celcius
     __force_inline static float toCelcius(uint16_t sample) { return sample * 0.25; }
+    // Same as above for a filtered adc readout that kept its fractional part
+    __force_inline static float toCelcius(float sample) { return sample * 0.25f; }
 
 protected:
-    uint8_t sdo, sck, cs;
     uint16_t result;
     bool open, exist;
+    ThermocoupleStatus status;
     absolute_time_t lastSample;
 };
 #endif
\ No newline at end of file
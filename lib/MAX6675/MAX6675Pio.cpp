@@ -0,0 +1,126 @@
+/**
+ * @file MAX6675Pio.cpp
+ * @brief Background acquisition of two MAX6675 sharing SO and SCK using a PIO state machine and DMA
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "MAX6675Pio.h"
+#include "hardware/clocks.h"
+#include "max6675.pio.h"
+
+static constexpr float pio_clock_hz = 10000000.0f;         // One PIO cycle is 100ns
+static constexpr uint32_t dma_transfer_count = 0xFFFFFFFF; // Practically never ending, the ring wraps the writes
+
+/**
+ * @brief Claim a state machine and a DMA channel, then start reading both chips every periodMs
+ *
+ * @param periodMs Time between two readouts of the same chip, must be longer than the 220ms max conversion time
+ * @return true if the pins fit the required layout and the resources were claimed
+ */
+bool MAX6675Pio::init(uint32_t periodMs)
+{
+    uint8_t csBase = sdo - 1;
+    if (!((cs[0] == csBase && cs[1] == sdo + 1) || (cs[1] == csBase && cs[0] == sdo + 1)))
+        return false;
+
+    sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0)
+        return false;
+    dmaChannel = dma_claim_unused_channel(false);
+    if (dmaChannel < 0)
+    {
+        pio_sm_unclaim(pio, sm);
+        return false;
+    }
+    // Both CS high on the OUT pins, only the CS of the chip being read goes low
+    for (int i = 0; i < 2; i++)
+        csWord[i] = 0b101 & ~(1u << (cs[i] - csBase));
+
+    uint offset = pio_add_program(pio, &max6675_program);
+    pio_gpio_init(pio, cs[0]);
+    pio_gpio_init(pio, cs[1]);
+    pio_gpio_init(pio, sck);
+    pio_gpio_init(pio, sdo);
+    gpio_pull_up(sdo); // A missing chip reads all ones, rejected by MAX6675::statusOf()
+    pio_sm_set_pins_with_mask(pio, sm, (1u << cs[0]) | (1u << cs[1]), (1u << cs[0]) | (1u << cs[1]) | (1u << sck));
+    pio_sm_set_consecutive_pindirs(pio, sm, cs[0], 1, true);
+    pio_sm_set_consecutive_pindirs(pio, sm, cs[1], 1, true);
+    pio_sm_set_consecutive_pindirs(pio, sm, sck, 1, true);
+    pio_sm_set_consecutive_pindirs(pio, sm, sdo, 1, false);
+
+    pio_sm_config c = max6675_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, csBase, 3);
+    sm_config_set_set_pins(&c, csBase, 3);
+    sm_config_set_sideset_pins(&c, sck);
+    sm_config_set_in_pins(&c, sdo);
+    // CS level is taken from the LSBs, frames are shifted in MSB first and pushed every 16 bits
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_in_shift(&c, false, true, 16);
+    sm_config_set_clkdiv(&c, clock_get_hz(clk_sys) / pio_clock_hz);
+    pio_sm_init(pio, sm, offset, &c);
+
+    // Move every pushed frame to the ring buffer
+    dma_channel_config dc = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&dc, DMA_SIZE_16);
+    channel_config_set_read_increment(&dc, false);
+    channel_config_set_write_increment(&dc, true);
+    channel_config_set_ring(&dc, true, __builtin_ctz(sizeof(frames)));
+    channel_config_set_dreq(&dc, pio_get_dreq(pio, sm, false));
+    dma_channel_configure(dmaChannel, &dc, frames, &pio->rxf[sm], dma_transfer_count, true);
+
+    rounds = 0;
+    consumed = 0;
+    overrun = 0;
+    pio_sm_set_enabled(pio, sm, true);
+    // Negative period so the timer keeps a fixed rate regardless of the callback duration
+    return add_repeating_timer_ms(-(int32_t)periodMs, timer_cb, this, &timer);
+}
+
+/**
+ * @brief Start one transaction for each chip, called from the timer interrupt
+ *
+ */
+bool MAX6675Pio::timer_cb(repeating_timer_t *rt)
+{
+    MAX6675Pio *self = (MAX6675Pio *)rt->user_data;
+    // The timestamp has to be there before the DMA writes the frames of this round
+    self->timestamps[self->rounds % (MAX6675PIO_RING_SIZE / 2)] = time_us_64();
+    self->rounds++;
+    pio_sm_put(self->pio, self->sm, self->csWord[0]);
+    pio_sm_put(self->pio, self->sm, self->csWord[1]);
+    // must return true, otherwise the timer is not repeated
+    return true;
+}
+
+uint32_t MAX6675Pio::framesDone()
+{
+    return dma_transfer_count - dma_channel_hw_addr(dmaChannel)->transfer_count;
+}
+
+/**
+ * @brief Get the oldest frame that was not read yet, never blocks
+ *
+ * @param frame Filled with the frame, its status, CS pin and timestamp
+ * @return true if a frame was available
+ */
+bool MAX6675Pio::read(MAX6675Frame *frame)
+{
+    uint32_t done = framesDone();
+    if (done - consumed > MAX6675PIO_RING_SIZE) // The DMA went around the ring, skip to the oldest frame still there
+    {
+        overrun += done - consumed - MAX6675PIO_RING_SIZE;
+        consumed = done - MAX6675PIO_RING_SIZE;
+    }
+    if (consumed == done)
+        return false;
+
+    frame->raw = frames[consumed % MAX6675PIO_RING_SIZE];
+    frame->status = MAX6675::statusOf(frame->raw);
+    frame->cs = cs[consumed % 2];
+    frame->timestamp = timestamps[(consumed / 2) % (MAX6675PIO_RING_SIZE / 2)];
+    consumed++;
+    return true;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file MAX6675Pio.h
+ * @brief Background acquisition of two MAX6675 sharing SO and SCK using a PIO state machine and DMA
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _MAX6675PIO_H_
+#include "MAX6675.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#define _MAX6675PIO_H_
+
+#define MAX6675PIO_RING_SIZE 16 // Frames kept in the DMA ring buffer, must be a power of 2
+
+struct MAX6675Frame
+{
+    uint16_t raw;              // Raw 16-bit frame as shifted out by the chip
+    ThermocoupleStatus status; // Decoded from raw, the adc readout is only meaningful when THERMOCOUPLE_VALID
+    uint8_t cs;                // CS pin of the chip the frame was read from
+    uint64_t timestamp;        // time_us_64() when the frame was read
+};
+
+class MAX6675Pio
+{
+public:
+    // The CS pins must be right below and right above SO, so the state machine can drive both with one OUT
+    MAX6675Pio(uint8_t _sdo, uint8_t _sck, uint8_t _cs0, uint8_t _cs1, PIO _pio = pio1)
+        : sdo(_sdo), sck(_sck), cs{_cs0, _cs1}, pio(_pio)
+    {
+    }
+    bool init(uint32_t periodMs);
+    bool read(MAX6675Frame *frame);
+    // Number of frames dropped because read() was not called often enough
+    __force_inline uint32_t getOverrun() { return overrun; }
+    // Extract the 12-bit adc readout from a raw frame, same scale as MAX6675::sample()
+    __force_inline static uint16_t toAdc(uint16_t raw) { return (raw & 0x7FF8) >> 3; }
+    __force_inline static bool isOpen(uint16_t raw) { return raw & 0x04; }
+
+protected:
+    static bool timer_cb(repeating_timer_t *rt);
+    uint32_t framesDone();
+
+    uint8_t sdo, sck, cs[2];
+    PIO pio;
+    int sm;
+    int dmaChannel;
+    struct repeating_timer timer;
+    uint32_t csWord[2];       // OUT value selecting each chip
+    volatile uint32_t rounds; // Transactions started by the timer, both chips are read on each round
+    uint32_t consumed;        // Frames already returned by read()
+    uint32_t overrun;
+    uint64_t timestamps[MAX6675PIO_RING_SIZE / 2];
+    uint16_t frames[MAX6675PIO_RING_SIZE] __attribute__((aligned(MAX6675PIO_RING_SIZE * sizeof(uint16_t))));
+};
+#endif
@@ -0,0 +1,44 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------- //
+// max6675 //
+// ------- //
+
+#define max6675_wrap_target 0
+#define max6675_wrap 6
+
+static const uint16_t max6675_program_instructions[] = {
+            //     .wrap_target
+    0x80a0, //  0: pull   block           side 0     
+    0x6103, //  1: out    pins, 3         side 0 [1] 
+    0xe02f, //  2: set    x, 15           side 0     
+    0xb142, //  3: nop                    side 1 [1] 
+    0x5001, //  4: in     pins, 1         side 1     
+    0x0143, //  5: jmp    x--, 3          side 0 [1] 
+    0xe005, //  6: set    pins, 5         side 0     
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program max6675_program = {
+    .instructions = max6675_program_instructions,
+    .length = 7,
+    .origin = -1,
+};
+
+static inline pio_sm_config max6675_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + max6675_wrap_target, offset + max6675_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+#endif
+
@@ -0,0 +1,97 @@
+/**
+ * @file ModbusLink.cpp
+ * @brief Modbus slave on the third USB CDC interface, for the PLCs of the line
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "ModbusLink.h"
+#include <string.h>
+
+/**
+ * @brief Create the Modbus task, call once before the scheduler starts and after HostLink::init()
+ *
+ * @param priority
+ * @param stackSize in words
+ * @return true if the task was created
+ */
+bool ModbusLink::init(UBaseType_t priority, uint32_t stackSize)
+{
+    return xTaskCreate(modbusTask, "modbus_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+/**
+ * @brief Publish the register map, called by the control task on every iteration. Never blocks, a read overlapping
+ * the copy is retried by the Modbus task.
+ *
+ * @param registers MODBUS_REG_COUNT registers
+ */
+void ModbusLink::publish(const uint16_t *registers)
+{
+    snapshotSequence = snapshotSequence + 1;
+    __dmb(); // Readers have to see the odd sequence before the copy starts
+    memcpy(snapshot, registers, sizeof(snapshot));
+    __dmb(); // and the whole copy before the even sequence
+    snapshotSequence = snapshotSequence + 1;
+}
+
+// publish() runs on the control task, which the Modbus task can't preempt, so an odd sequence means it's copying on
+// the other core and is done within a few us. The master gets a device failure if it's still not through after
+// MODBUSLINK_READ_SPINS
+bool ModbusLink::readSnapshot(uint16_t address, uint16_t count, uint16_t *dest, void *context)
+{
+    ModbusLink *link = (ModbusLink *)context;
+    for (uint16_t spin = 0; spin < MODBUSLINK_READ_SPINS; spin++)
+    {
+        uint32_t before = link->snapshotSequence;
+        if (before & 1)
+        {
+            tight_loop_contents();
+            continue;
+        }
+        __dmb();
+        memcpy(dest, &link->snapshot[address], count * sizeof(uint16_t));
+        __dmb();
+        if (link->snapshotSequence == before)
+            return true;
+    }
+    return false;
+}
+
+void ModbusLink::modbusTask(void *pvParameter)
+{
+    ModbusLink *link = (ModbusLink *)pvParameter;
+    TickType_t lastReceive = xTaskGetTickCount();
+    for (;;)
+    {
+        vTaskDelay(MODBUSLINK_POLL / portTICK_PERIOD_MS);
+        uint32_t n = link->usb->readInterface(HOSTLINK_MODBUS_ITF, &link->rx[link->rxLen],
+                                              sizeof(link->rx) - link->rxLen);
+        if (n)
+            lastReceive = xTaskGetTickCount();
+        link->rxLen += n;
+        if (link->rxLen == 0)
+            continue;
+
+        // Answer every complete frame, the rest stays at the start of the buffer until more comes
+        bool idle = xTaskGetTickCount() - lastReceive >= MODBUSLINK_IDLE / portTICK_PERIOD_MS;
+        size_t start = 0;
+        for (;;)
+        {
+            size_t txLen;
+            size_t consumed =
+                link->slave.process(&link->rx[start], link->rxLen - start, idle, link->tx, &txLen);
+            if (consumed == 0)
+                break;
+            if (txLen)
+                link->usb->writeInterface(HOSTLINK_MODBUS_ITF, link->tx, txLen);
+            start += consumed;
+        }
+        if (start == 0 && link->rxLen == sizeof(link->rx)) // Longer than any frame
+            start = link->rxLen;
+        memmove(link->rx, &link->rx[start], link->rxLen - start);
+        link->rxLen -= start;
+    }
+}
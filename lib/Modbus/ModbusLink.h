@@ -0,0 +1,49 @@
+/**
+ * @file ModbusLink.h
+ * @brief Modbus slave on the third USB CDC interface, for the PLCs of the line
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The control task publishes the register map of ModbusMap.h once per iteration through a sequence lock, the
+ * Modbus task answers every read from that snapshot so polling never waits on the control task nor its mutex, and
+ * the control task never waits on the master.
+ */
+#ifndef _MODBUSLINK_H_
+#include "FreeRTOS.h"
+#include "HostLink.h"
+#include "ModbusMap.h"
+#include "ModbusSlave.h"
+#include "task.h"
+#define _MODBUSLINK_H_
+
+#define MODBUSLINK_IDLE 20        // in ms, the unfinished frame is dropped when nothing more comes for this long
+#define MODBUSLINK_POLL 2         // in ms
+#define MODBUSLINK_READ_SPINS 256 // Reads of the sequence before a read overlapping publish() gives up
+
+class ModbusLink
+{
+public:
+    ModbusLink(HostLink *_usb, ModbusFraming framing, uint8_t address)
+        : usb(_usb), slave(framing, address, MODBUS_REG_COUNT, readSnapshot, this)
+    {
+    }
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    void publish(const uint16_t *registers);
+    __force_inline uint32_t getBadFrames() { return slave.getBadFrames(); }
+
+protected:
+    static void modbusTask(void *pvParameter);
+    static bool readSnapshot(uint16_t address, uint16_t count, uint16_t *dest, void *context);
+
+    HostLink *usb;
+    ModbusSlave slave;
+    volatile uint32_t snapshotSequence = 0; // Odd while publish() is copying
+    uint16_t snapshot[MODBUS_REG_COUNT] = {};
+    // Modbus task only
+    uint8_t rx[MODBUS_MAX_ADU];
+    size_t rxLen = 0;
+    uint8_t tx[MODBUS_MAX_ADU];
+};
+#endif
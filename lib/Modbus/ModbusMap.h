@@ -0,0 +1,57 @@
+/**
+ * @file ModbusMap.h
+ * @brief Register map of the Modbus interface, shared by the firmware and the simulator of the host tool
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every register is read only and can be read as a holding register (0x03) or an input register (0x04), both read
+ * the same map. Zones are ordered bottom then top. Temperatures are signed in 0.1 celcius, the duty goes from 0 to
+ * 1000 like the SSR PWM. The PID gains are the ones applied on the last control iteration, gain schedule included,
+ * as IEEE 754 floats on two registers with the high word first.
+ */
+#ifndef _MODBUSMAP_H_
+#include <stdint.h>
+#define _MODBUSMAP_H_
+
+enum ModbusRegister : uint16_t
+{
+    MODBUS_REG_STATE = 0,             // ModbusState
+    MODBUS_REG_RUN_SECOND = 1,        // Seconds of the running operation, kept after it stops
+    MODBUS_REG_SELECTED_PROFILE = 2,  // Profile of the auto operation
+    MODBUS_REG_ALARMS = 3,            // MODBUS_ALARM_* bits
+    MODBUS_REG_STATUS = 4,            // ThermocoupleStatus, 2 registers
+    MODBUS_REG_PV = 6,                // in 0.1 celcius, 2 registers
+    MODBUS_REG_SV = 8,                // in 0.1 celcius, applied on the last control iteration, 0 when idle, 2 registers
+    MODBUS_REG_MANUAL_SV = 10,        // in celcius, SV of the manual operation, 2 registers
+    MODBUS_REG_DUTY = 12,             // 0 to 1000, 2 registers
+    MODBUS_REG_GAINS = 16,            // Kp, Ki and Kd of the bottom zone then the top zone, 12 registers
+    MODBUS_REG_COUNT = 28,
+};
+
+enum ModbusState : uint16_t
+{
+    MODBUS_STATE_IDLE = 0,
+    MODBUS_STATE_MANUAL = 1,
+    MODBUS_STATE_AUTO = 2,
+};
+
+// Bits of MODBUS_REG_ALARMS, set while the condition lasts
+#define MODBUS_ALARM_BOTTOM_SENSOR 0x0001 // The last sample of the bottom thermocouple is not valid
+#define MODBUS_ALARM_TOP_SENSOR 0x0002
+#define MODBUS_ALARM_BOTTOM_STALE 0x0004 // No valid sample of the bottom thermocouple for a while, its SSR is off
+#define MODBUS_ALARM_TOP_STALE 0x0008
+
+// Float on two registers, high word first
+static inline void modbus_putFloat(uint16_t *registers, float value)
+{
+    union
+    {
+        float f;
+        uint32_t u;
+    } bits = {value};
+    registers[0] = bits.u >> 16;
+    registers[1] = bits.u & 0xFFFF;
+}
+#endif
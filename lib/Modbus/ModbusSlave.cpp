@@ -0,0 +1,167 @@
+/**
+ * @file ModbusSlave.cpp
+ * @brief Modbus slave answering register reads, with RTU or TCP (MBAP) framing over a byte stream
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "ModbusSlave.h"
+
+#define MODBUS_MBAP_SIZE 7
+
+// CRC16 of Modbus RTU, reflected 0x8005 polynomial, it's not the CRC16-CCITT of the other links
+uint16_t ModbusSlave::crc(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x0001 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+/**
+ * @brief Parse the frame at the start of the received bytes and build its answer
+ *
+ * @param rx Received bytes not consumed yet
+ * @param len
+ * @param idle True if nothing was received for a while, the bytes of an unfinished frame are then dropped
+ * @param tx At least MODBUS_MAX_ADU bytes
+ * @param txLen Length of the answer to send, 0 if there's none
+ * @return size_t Bytes consumed from rx, 0 if the frame is not complete yet
+ */
+size_t ModbusSlave::process(const uint8_t *rx, size_t len, bool idle, uint8_t *tx, size_t *txLen)
+{
+    *txLen = 0;
+    if (len == 0)
+        return 0;
+    size_t consumed = framing == MODBUS_TCP ? processTcp(rx, len, tx, txLen) : processRtu(rx, len, idle, tx, txLen);
+    if (consumed == 0 && idle)
+    {
+        badFrames++;
+        return len;
+    }
+    return consumed;
+}
+
+// Length of an RTU request told by its function code, 0 for the functions this slave doesn't know or when the
+// length is not received yet
+static size_t rtuLength(const uint8_t *rx, size_t len)
+{
+    uint8_t function = rx[1];
+    if (function >= 0x01 && function <= 0x06)
+        return 8;
+    if ((function == 0x0F || function == 0x10) && len >= 7)
+        return 9 + rx[6];
+    return 0;
+}
+
+size_t ModbusSlave::processRtu(const uint8_t *rx, size_t len, bool idle, uint8_t *tx, size_t *txLen)
+{
+    if (len < 4)
+        return 0;
+    size_t expected = rtuLength(rx, len);
+    bool known = expected != 0;
+    if (!known || len < expected)
+    {
+        if (!idle)
+        {
+            // Either the frame is not complete or it lost its start, a complete frame further on tells which
+            for (size_t i = 1; i + 4 <= len; i++)
+            {
+                size_t next = rtuLength(&rx[i], len - i);
+                if (next && next <= len - i && crc(&rx[i], next) == 0)
+                {
+                    badFrames++;
+                    return i;
+                }
+            }
+            return 0;
+        }
+        if (known)
+            return 0; // Dropped by process()
+        expected = len; // A function this slave doesn't know, the whole burst is taken as its frame
+    }
+
+    size_t pduLen = expected - 3;
+    if (crc(rx, expected) != 0) // The CRC of a frame followed by its CRC is 0
+    {
+        badFrames++;
+        return known ? 1 : expected;
+    }
+    if (rx[0] != address)
+        return expected; // For another slave, or a broadcast which is never answered
+    tx[0] = address;
+    size_t responseLen = 1 + answer(&rx[1], pduLen, &tx[1]);
+    uint16_t sum = crc(tx, responseLen);
+    tx[responseLen++] = sum & 0xFF;
+    tx[responseLen++] = sum >> 8;
+    *txLen = responseLen;
+    return expected;
+}
+
+// The unit id is not checked, the bridge on the host is the only way to this slave
+size_t ModbusSlave::processTcp(const uint8_t *rx, size_t len, uint8_t *tx, size_t *txLen)
+{
+    if (len < MODBUS_MBAP_SIZE)
+        return 0;
+    uint16_t protocol = rx[2] << 8 | rx[3];
+    uint16_t length = rx[4] << 8 | rx[5];
+    if (protocol != 0 || length < 2 || length > MODBUS_MAX_ADU - MODBUS_MBAP_SIZE + 1)
+    {
+        badFrames++;
+        return 1;
+    }
+    size_t expected = 6 + length;
+    if (len < expected)
+        return 0;
+
+    for (uint8_t i = 0; i < MODBUS_MBAP_SIZE; i++)
+        tx[i] = rx[i]; // Same transaction, protocol and unit
+    size_t pduLen = answer(&rx[MODBUS_MBAP_SIZE], expected - MODBUS_MBAP_SIZE, &tx[MODBUS_MBAP_SIZE]);
+    tx[4] = (pduLen + 1) >> 8;
+    tx[5] = (pduLen + 1) & 0xFF;
+    *txLen = MODBUS_MBAP_SIZE + pduLen;
+    return expected;
+}
+
+// Answer a PDU, returns the length of the response PDU
+size_t ModbusSlave::answer(const uint8_t *pdu, size_t len, uint8_t *response)
+{
+    uint8_t function = pdu[0];
+    uint8_t exception;
+    if (function != MODBUS_READ_HOLDING && function != MODBUS_READ_INPUT)
+        exception = MODBUS_ILLEGAL_FUNCTION;
+    else if (len != 5)
+        exception = MODBUS_ILLEGAL_VALUE;
+    else
+    {
+        uint16_t start = pdu[1] << 8 | pdu[2];
+        uint16_t count = pdu[3] << 8 | pdu[4];
+        uint16_t registers[MODBUS_MAX_READ];
+        if (count == 0 || count > MODBUS_MAX_READ)
+            exception = MODBUS_ILLEGAL_VALUE;
+        else if ((uint32_t)start + count > registerCount)
+            exception = MODBUS_ILLEGAL_ADDRESS;
+        else if (!read(start, count, registers, context))
+            exception = MODBUS_DEVICE_FAILURE;
+        else
+        {
+            response[0] = function;
+            response[1] = count * 2;
+            for (uint16_t i = 0; i < count; i++)
+            {
+                response[2 + 2 * i] = registers[i] >> 8;
+                response[3 + 2 * i] = registers[i] & 0xFF;
+            }
+            return 2 + count * 2;
+        }
+    }
+    response[0] = function | 0x80;
+    response[1] = exception;
+    return 2;
+}
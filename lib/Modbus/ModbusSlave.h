@@ -0,0 +1,72 @@
+/**
+ * @file ModbusSlave.h
+ * @brief Modbus slave answering register reads, with RTU or TCP (MBAP) framing over a byte stream
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Frames are parsed where they lie in the receive buffer and the answer is built in the transmit buffer of the
+ * caller, nothing is copied in between. Over a USB CDC interface the inter-character timing of RTU doesn't survive,
+ * so the length of a request is told by its function code and checked with the CRC, a bad CRC drops one byte to
+ * find the next frame. A request of an unknown function code can't be measured, it's only answered once the line
+ * went idle. Only standard headers are used so the simulator of the host tool builds it too.
+ */
+#ifndef _MODBUSSLAVE_H_
+#include <stddef.h>
+#include <stdint.h>
+#define _MODBUSSLAVE_H_
+
+#define MODBUS_MAX_ADU 260      // MBAP header and the largest PDU, RTU frames are shorter
+#define MODBUS_MAX_READ 125     // Registers in one read
+#define MODBUS_BROADCAST 0
+
+enum ModbusFraming : uint8_t
+{
+    MODBUS_RTU = 0, // [address][PDU][CRC16 low byte first]
+    MODBUS_TCP = 1, // [transaction][protocol 0][length][unit][PDU], all big endian, for a TCP bridge on the host
+};
+
+enum ModbusFunction : uint8_t
+{
+    MODBUS_READ_HOLDING = 0x03,
+    MODBUS_READ_INPUT = 0x04,
+};
+
+enum ModbusException : uint8_t
+{
+    MODBUS_ILLEGAL_FUNCTION = 0x01,
+    MODBUS_ILLEGAL_ADDRESS = 0x02,
+    MODBUS_ILLEGAL_VALUE = 0x03,
+    MODBUS_DEVICE_FAILURE = 0x04,
+};
+
+// Copy count registers from address, returns false if the snapshot couldn't be read
+typedef bool (*ModbusReadCallback)(uint16_t address, uint16_t count, uint16_t *dest, void *context);
+
+class ModbusSlave
+{
+public:
+    ModbusSlave(ModbusFraming _framing, uint8_t _address, uint16_t _registerCount, ModbusReadCallback _read,
+                void *_context)
+        : framing(_framing), address(_address), registerCount(_registerCount), read(_read), context(_context)
+    {
+    }
+    size_t process(const uint8_t *rx, size_t len, bool idle, uint8_t *tx, size_t *txLen);
+    static uint16_t crc(const uint8_t *data, size_t len);
+    // Frames dropped for a bad CRC, a bad header or a line going idle in the middle of them
+    inline uint32_t getBadFrames() { return badFrames; }
+
+protected:
+    size_t processRtu(const uint8_t *rx, size_t len, bool idle, uint8_t *tx, size_t *txLen);
+    size_t processTcp(const uint8_t *rx, size_t len, uint8_t *tx, size_t *txLen);
+    size_t answer(const uint8_t *pdu, size_t len, uint8_t *response);
+
+    ModbusFraming framing;
+    uint8_t address;
+    uint16_t registerCount;
+    ModbusReadCallback read;
+    void *context;
+    uint32_t badFrames = 0;
+};
+#endif
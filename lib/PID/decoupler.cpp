@@ -0,0 +1,206 @@
+#include "decoupler.h"
+#include <math.h>
+#include <string.h>
+
+void Decoupler_Init(Decoupler *d)
+{
+    d->enabled = false;
+    d->G[0][0] = 1.0f;
+    d->G[0][1] = 0.0f;
+    d->G[1][0] = 0.0f;
+    d->G[1][1] = 1.0f;
+}
+
+/*
+ * Static decoupler u = D * v with D = inverse(G) * diag(G), so the plant seen by each PID becomes G * D = diag(G)
+ * and each loop keeps its own direct gain. The result is clamped to the SSR duty range, v is passed through when
+ * the decoupler is disabled or G can't be inverted.
+ */
+void Decoupler_Apply(const Decoupler *d, const float v[2], float u[2])
+{
+    if (!d->enabled || !Decoupler_IsValid(d))
+    {
+        u[0] = v[0];
+        u[1] = v[1];
+        return;
+    }
+
+    float det = d->G[0][0] * d->G[1][1] - d->G[0][1] * d->G[1][0];
+    float direct = d->G[0][0] * d->G[1][1] / det;
+    float u0 = direct * v[0] - d->G[0][1] * d->G[1][1] / det * v[1];
+    float u1 = direct * v[1] - d->G[1][0] * d->G[0][0] / det * v[0];
+
+    u[0] = u0 < 0.0f ? 0.0f : (u0 > 1.0f ? 1.0f : u0);
+    u[1] = u1 < 0.0f ? 0.0f : (u1 > 1.0f ? 1.0f : u1);
+}
+
+void Decoupler_Pack(const Decoupler *d, uint8_t *dest)
+{
+    *dest++ = d->enabled;
+    memcpy(dest, d->G, sizeof(d->G));
+}
+
+/* Blank (0xFF) or corrupted EEPROM content leaves the decoupler disabled */
+void Decoupler_Unpack(Decoupler *d, const uint8_t *src)
+{
+    Decoupler_Init(d);
+    uint8_t enabled = *src++;
+    float G[2][2];
+    memcpy(G, src, sizeof(G));
+    if (enabled > 1 || !isfinite(G[0][0]) || !isfinite(G[0][1]) || !isfinite(G[1][0]) || !isfinite(G[1][1]))
+        return;
+    memcpy(d->G, G, sizeof(G));
+    d->enabled = enabled;
+}
+
+void CouplingStepTest_Init(CouplingStepTest *test, float stepDuty, uint32_t stepDuration)
+{
+    memset(test, 0, sizeof(CouplingStepTest));
+    test->stepDuty = stepDuty;
+    test->stepDuration = stepDuration;
+    test->baselineTime = 10;
+    test->cooldownLimit = 1800;
+    test->cooldownBand = 3.0f;
+    test->maxTemperature = 200.0f;
+    test->riseThreshold = 1.0f;
+    test->phase = STEP_TEST_IDLE;
+    test->request = STEP_TEST_REQUEST_NONE;
+}
+
+void CouplingStepTest_Abort(CouplingStepTest *test)
+{
+    if (CouplingStepTest_IsRunning(test))
+        test->phase = STEP_TEST_FAILED;
+}
+
+/*
+ * Fit a first order plus dead time model on the step response of one zone. The step is usually too short to
+ * reach steady state, so the gain and time constant are solved from two points of the rise: midRise at t_a and
+ * the final rise at t_b = 2 * t_a, where y(t) = K * d * (1 - exp(-t / tau)) counted from the dead time.
+ * Then y_b / y_a = 1 + exp(-t_a / tau), which gives tau and K back.
+ */
+static void CouplingStepTest_Fit(CouplingStepTest *test, uint8_t zone, float finalRise)
+{
+    test->modelGain[zone] = 0.0f;
+    test->timeConstant[zone] = 0.0f;
+    test->deadTime[zone] = 0.0f;
+    if (!test->riseTime || test->midRise <= 0.0f || finalRise <= 0.0f)
+        return;
+
+    float ta = (test->stepDuration - test->riseTime) / 2.0f;
+    if (ta < 1.0f)
+        return;
+    // Keep the ratio away from 1 (already settled) and 2 (still a straight line) where the fit blows up
+    float ratio = finalRise / test->midRise;
+    ratio = ratio < 1.01f ? 1.01f : (ratio > 1.99f ? 1.99f : ratio);
+    float decay = ratio - 1.0f;
+
+    test->timeConstant[zone] = -ta / logf(decay);
+    test->modelGain[zone] = test->midRise / (test->stepDuty * (1.0f - decay));
+    test->deadTime[zone] = (float)test->riseTime;
+}
+
+// Track the dead time and the halfway rise of the stepped zone
+static void CouplingStepTest_TrackRise(CouplingStepTest *test, uint8_t zone, const float pv[2])
+{
+    float rise = pv[zone] - test->baseline[zone];
+    if (!test->riseTime)
+    {
+        if (rise >= test->riseThreshold)
+            test->riseTime = test->elapsed;
+    }
+    else if (test->elapsed == test->riseTime + (test->stepDuration - test->riseTime) / 2)
+        test->midRise = rise;
+}
+
+/*
+ * Step test state machine, must be called once per second with the current PVs.
+ * Both SSRs are kept off to take a baseline, then the bottom SSR is stepped while the top one stays off,
+ * the zones are left to cool down and the top SSR is stepped the same way. The PV rise of both zones at the
+ * end of each step divided by the step duty gives one column of G. The stepped zone response is also fitted to a
+ * first order plus dead time model.
+ *
+ * Returns true while the test owns the SSRs, duty is then filled with the duty to apply.
+ */
+bool CouplingStepTest_Update(CouplingStepTest *test, const float pv[2], float duty[2])
+{
+    StepTestRequest request = test->request;
+    test->request = STEP_TEST_REQUEST_NONE;
+    if (request == STEP_TEST_REQUEST_START)
+    {
+        test->phase = STEP_TEST_BASELINE;
+        test->elapsed = 0;
+        test->baseline[0] = test->baseline[1] = 0.0f;
+        test->riseTime = 0;
+        test->midRise = 0.0f;
+    }
+    else if (request == STEP_TEST_REQUEST_ABORT)
+        CouplingStepTest_Abort(test);
+
+    duty[0] = duty[1] = 0.0f;
+    if (!CouplingStepTest_IsRunning(test))
+        return false;
+
+    if (pv[0] > test->maxTemperature || pv[1] > test->maxTemperature)
+    {
+        test->phase = STEP_TEST_FAILED;
+        return false;
+    }
+
+    test->elapsed++;
+    switch (test->phase)
+    {
+    case STEP_TEST_BASELINE:
+        test->baseline[0] += pv[0] / test->baselineTime;
+        test->baseline[1] += pv[1] / test->baselineTime;
+        if (test->elapsed >= test->baselineTime)
+        {
+            test->phase = STEP_TEST_STEP_BOTTOM;
+            test->elapsed = 0;
+        }
+        break;
+    case STEP_TEST_STEP_BOTTOM:
+        duty[DECOUPLER_BOTTOM] = test->stepDuty;
+        CouplingStepTest_TrackRise(test, DECOUPLER_BOTTOM, pv);
+        if (test->elapsed >= test->stepDuration)
+        {
+            CouplingStepTest_Fit(test, DECOUPLER_BOTTOM, pv[DECOUPLER_BOTTOM] - test->baseline[DECOUPLER_BOTTOM]);
+            test->G[0][DECOUPLER_BOTTOM] = (pv[0] - test->baseline[0]) / test->stepDuty;
+            test->G[1][DECOUPLER_BOTTOM] = (pv[1] - test->baseline[1]) / test->stepDuty;
+            test->phase = STEP_TEST_COOLDOWN;
+            test->elapsed = 0;
+        }
+        break;
+    case STEP_TEST_COOLDOWN:
+        if ((fabsf(pv[0] - test->baseline[0]) < test->cooldownBand &&
+             fabsf(pv[1] - test->baseline[1]) < test->cooldownBand) ||
+            test->elapsed >= test->cooldownLimit)
+        {
+            // Take the residual heat as the new baseline for the second step
+            test->baseline[0] = pv[0];
+            test->baseline[1] = pv[1];
+            test->phase = STEP_TEST_STEP_TOP;
+            test->elapsed = 0;
+            test->riseTime = 0;
+            test->midRise = 0.0f;
+        }
+        break;
+    case STEP_TEST_STEP_TOP:
+        duty[DECOUPLER_TOP] = test->stepDuty;
+        CouplingStepTest_TrackRise(test, DECOUPLER_TOP, pv);
+        if (test->elapsed >= test->stepDuration)
+        {
+            CouplingStepTest_Fit(test, DECOUPLER_TOP, pv[DECOUPLER_TOP] - test->baseline[DECOUPLER_TOP]);
+            test->G[0][DECOUPLER_TOP] = (pv[0] - test->baseline[0]) / test->stepDuty;
+            test->G[1][DECOUPLER_TOP] = (pv[1] - test->baseline[1]) / test->stepDuty;
+            test->phase = STEP_TEST_DONE;
+            test->elapsed = 0;
+            duty[DECOUPLER_TOP] = 0.0f;
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef _DECOUPLER_H_
+#include <stdint.h>
+#define _DECOUPLER_H_
+
+/* Zone index used on every 2x2 matrix below, the same order as SSR0 and SSR1 */
+#define DECOUPLER_BOTTOM 0
+#define DECOUPLER_TOP 1
+
+/* Size of the decoupler once packed by Decoupler_Pack(), used to lay out EEPROM */
+#define DECOUPLER_PACKED_SIZE (1 + 4 * sizeof(float))
+
+typedef struct
+{
+    /* Apply the decoupler in front of the PIDs when both zones are heating */
+    bool enabled;
+
+    /* Process gain matrix, G[pv][ssr] is the rise of zone pv (in celcius) per unit duty of ssr */
+    float G[2][2];
+} Decoupler;
+
+/* Decoupling needs positive direct gains and a direct coupling stronger than the cross coupling */
+static inline bool Decoupler_IsValid(const Decoupler *d)
+{
+    float det = d->G[0][0] * d->G[1][1] - d->G[0][1] * d->G[1][0];
+    return d->G[0][0] > 0.0f && d->G[1][1] > 0.0f && det > 0.0f;
+}
+
+void Decoupler_Init(Decoupler *d);
+void Decoupler_Apply(const Decoupler *d, const float v[2], float u[2]);
+void Decoupler_Pack(const Decoupler *d, uint8_t *dest);
+void Decoupler_Unpack(Decoupler *d, const uint8_t *src);
+
+typedef enum
+{
+    STEP_TEST_IDLE,
+    STEP_TEST_BASELINE,
+    STEP_TEST_STEP_BOTTOM,
+    STEP_TEST_COOLDOWN,
+    STEP_TEST_STEP_TOP,
+    STEP_TEST_DONE,
+    STEP_TEST_FAILED
+} StepTestPhase;
+
+typedef enum
+{
+    STEP_TEST_REQUEST_NONE,
+    STEP_TEST_REQUEST_START,
+    STEP_TEST_REQUEST_ABORT
+} StepTestRequest;
+
+typedef struct
+{
+    /* Test parameters */
+    float stepDuty;          /* Duty applied to the stepped SSR, 0 to 1 */
+    uint32_t stepDuration;   /* Duration of each step (in seconds) */
+    uint32_t baselineTime;   /* Time both SSRs are kept off to average the starting PV (in seconds) */
+    uint32_t cooldownLimit;  /* Longest cooldown between the two steps (in seconds) */
+    float cooldownBand;      /* Cooldown ends once both PVs are this close to the baseline (in celcius) */
+    float maxTemperature;    /* The test is aborted if any PV goes above this (in celcius) */
+    float riseThreshold;     /* PV rise marking the end of the dead time (in celcius) */
+
+    /* Set by the user interface, consumed by CouplingStepTest_Update() */
+    volatile StepTestRequest request;
+
+    /* Test state */
+    StepTestPhase phase;
+    uint32_t elapsed;
+    float baseline[2];
+    uint32_t riseTime; /* Elapsed seconds when the stepped zone crossed riseThreshold, 0 until then */
+    float midRise;     /* Stepped zone rise halfway between riseTime and the end of the step */
+
+    /* Identified process gain matrix, valid once phase is STEP_TEST_DONE */
+    float G[2][2];
+
+    /*
+     * First order plus dead time model of each zone fitted on its own step, valid once phase is STEP_TEST_DONE
+     * and modelGain is positive. Used to fill the Smith predictor parameters.
+     */
+    float modelGain[2];
+    float timeConstant[2];
+    float deadTime[2];
+} CouplingStepTest;
+
+static inline bool CouplingStepTest_IsRunning(const CouplingStepTest *test)
+{
+    return test->phase != STEP_TEST_IDLE && test->phase != STEP_TEST_DONE && test->phase != STEP_TEST_FAILED;
+}
+
+void CouplingStepTest_Init(CouplingStepTest *test, float stepDuty, uint32_t stepDuration);
+void CouplingStepTest_Abort(CouplingStepTest *test);
+bool CouplingStepTest_Update(CouplingStepTest *test, const float pv[2], float duty[2]);
+#endif
@@ -0,0 +1,115 @@
+#include "gain_schedule.h"
+#include <math.h>
+#include <string.h>
+
+void GainSchedule_Init(GainSchedule *schedule)
+{
+    schedule->count = 0;
+    memset(schedule->breakpoints, 0, sizeof(schedule->breakpoints));
+}
+
+bool GainSchedule_IsEnabled(const GainSchedule *schedule)
+{
+    return schedule->count > 0 && schedule->count <= GAIN_SCHEDULE_MAX_BREAKPOINT;
+}
+
+/* Insertion sort by temperature, the table is tiny and mostly sorted already when edited from the UI */
+void GainSchedule_Sort(GainSchedule *schedule)
+{
+    for (uint8_t i = 1; i < schedule->count; i++)
+    {
+        GainBreakpoint key = schedule->breakpoints[i];
+        int8_t j = i - 1;
+        while (j >= 0 && schedule->breakpoints[j].temperature > key.temperature)
+        {
+            schedule->breakpoints[j + 1] = schedule->breakpoints[j];
+            j--;
+        }
+        schedule->breakpoints[j + 1] = key;
+    }
+}
+
+/*
+ * Linearly interpolate the gains between the two breakpoints surrounding temperature,
+ * the outermost breakpoints are held constant outside of the scheduled range.
+ */
+void GainSchedule_Lookup(const GainSchedule *schedule, float temperature, float *kp, float *ki, float *kd)
+{
+    const GainBreakpoint *bp = schedule->breakpoints;
+    uint8_t last = schedule->count - 1;
+
+    if (temperature <= bp[0].temperature)
+    {
+        *kp = bp[0].Kp;
+        *ki = bp[0].Ki;
+        *kd = bp[0].Kd;
+        return;
+    }
+    if (temperature >= bp[last].temperature)
+    {
+        *kp = bp[last].Kp;
+        *ki = bp[last].Ki;
+        *kd = bp[last].Kd;
+        return;
+    }
+
+    uint8_t i = 0;
+    while (i < last - 1 && temperature >= bp[i + 1].temperature)
+        i++;
+
+    float span = bp[i + 1].temperature - bp[i].temperature;
+    float frac = span > 0 ? (temperature - bp[i].temperature) / span : 0.0f;
+    *kp = bp[i].Kp + frac * (bp[i + 1].Kp - bp[i].Kp);
+    *ki = bp[i].Ki + frac * (bp[i + 1].Ki - bp[i].Ki);
+    *kd = bp[i].Kd + frac * (bp[i + 1].Kd - bp[i].Kd);
+}
+
+/*
+ * Serialize the schedule without struct padding, only GAIN_SCHEDULE_PACKED_SIZE bytes are written to dest.
+ * Unused breakpoints are still written so the EEPROM layout stays fixed.
+ */
+void GainSchedule_Pack(const GainSchedule *schedule, uint8_t *dest)
+{
+    *dest++ = schedule->count;
+    for (uint8_t i = 0; i < GAIN_SCHEDULE_MAX_BREAKPOINT; i++)
+    {
+        const GainBreakpoint *bp = &schedule->breakpoints[i];
+        memcpy(dest, &bp->temperature, sizeof(bp->temperature));
+        dest += sizeof(bp->temperature);
+        memcpy(dest, &bp->Kp, sizeof(float));
+        dest += sizeof(float);
+        memcpy(dest, &bp->Ki, sizeof(float));
+        dest += sizeof(float);
+        memcpy(dest, &bp->Kd, sizeof(float));
+        dest += sizeof(float);
+    }
+}
+
+/* Deserialize a packed schedule, blank (0xFF) or corrupted EEPROM content disables the schedule */
+void GainSchedule_Unpack(GainSchedule *schedule, const uint8_t *src)
+{
+    GainSchedule_Init(schedule);
+    uint8_t count = *src++;
+    if (count > GAIN_SCHEDULE_MAX_BREAKPOINT)
+        return;
+
+    for (uint8_t i = 0; i < GAIN_SCHEDULE_MAX_BREAKPOINT; i++)
+    {
+        GainBreakpoint *bp = &schedule->breakpoints[i];
+        memcpy(&bp->temperature, src, sizeof(bp->temperature));
+        src += sizeof(bp->temperature);
+        memcpy(&bp->Kp, src, sizeof(float));
+        src += sizeof(float);
+        memcpy(&bp->Ki, src, sizeof(float));
+        src += sizeof(float);
+        memcpy(&bp->Kd, src, sizeof(float));
+        src += sizeof(float);
+        if (i < count && (!isfinite(bp->Kp) || !isfinite(bp->Ki) || !isfinite(bp->Kd)))
+        {
+            GainSchedule_Init(schedule);
+            return;
+        }
+    }
+    schedule->count = count;
+    GainSchedule_Sort(schedule);
+}
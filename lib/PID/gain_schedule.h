@@ -0,0 +1,37 @@
+#ifndef _GAIN_SCHEDULE_H_
+#include <stdint.h>
+#define _GAIN_SCHEDULE_H_
+
+/* Maximum number of temperature breakpoints per heater zone */
+#define GAIN_SCHEDULE_MAX_BREAKPOINT 5
+
+/* Size of one schedule once packed by GainSchedule_Pack(), used to lay out EEPROM */
+#define GAIN_SCHEDULE_PACKED_SIZE (1 + GAIN_SCHEDULE_MAX_BREAKPOINT * (sizeof(uint16_t) + 3 * sizeof(float)))
+
+typedef struct
+{
+    /* Process value (in celcius) at which the gains below are fully applied */
+    uint16_t temperature;
+
+    /* Controller gains at this breakpoint */
+    float Kp;
+    float Ki;
+    float Kd;
+} GainBreakpoint;
+
+typedef struct
+{
+    /* Number of valid breakpoints, 0 means scheduling is disabled and the fixed PID gains are used */
+    uint8_t count;
+
+    /* Breakpoints sorted by ascending temperature */
+    GainBreakpoint breakpoints[GAIN_SCHEDULE_MAX_BREAKPOINT];
+} GainSchedule;
+
+void GainSchedule_Init(GainSchedule *schedule);
+bool GainSchedule_IsEnabled(const GainSchedule *schedule);
+void GainSchedule_Sort(GainSchedule *schedule);
+void GainSchedule_Lookup(const GainSchedule *schedule, float temperature, float *kp, float *ki, float *kd);
+void GainSchedule_Pack(const GainSchedule *schedule, uint8_t *dest);
+void GainSchedule_Unpack(GainSchedule *schedule, const uint8_t *src);
+#endif
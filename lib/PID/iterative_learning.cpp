@@ -0,0 +1,128 @@
+#include "iterative_learning.h"
+#include <math.h>
+#include <string.h>
+
+void LearningTable_Init(LearningTable *table)
+{
+    table->enabled = false;
+    LearningTable_Reset(table);
+}
+
+void LearningTable_Pack(const LearningTable *table, uint8_t *dest)
+{
+    *dest++ = table->enabled;
+    *dest++ = table->runs;
+    memcpy(dest, table->correction, sizeof(table->correction));
+}
+
+/* Blank (0xFF) or corrupted EEPROM content leaves the table disabled and empty */
+void LearningTable_Unpack(LearningTable *table, const uint8_t *src)
+{
+    LearningTable_Init(table);
+    uint8_t enabled = *src++;
+    uint8_t runs = *src++;
+    if (enabled > 1)
+        return;
+    int8_t correction[2][ITERATIVE_LEARNING_BINS];
+    memcpy(correction, src, sizeof(correction));
+    for (uint8_t zone = 0; zone < 2; zone++)
+        for (uint8_t bin = 0; bin < ITERATIVE_LEARNING_BINS; bin++)
+            if (correction[zone][bin] > ITERATIVE_LEARNING_LIMIT || correction[zone][bin] < -ITERATIVE_LEARNING_LIMIT)
+                return;
+    table->enabled = enabled;
+    table->runs = runs;
+    memcpy(table->correction, correction, sizeof(correction));
+}
+
+void IterativeLearning_Init(IterativeLearning *ilc, float gain, uint16_t lead)
+{
+    memset(ilc, 0, sizeof(IterativeLearning));
+    ilc->gain = gain;
+    ilc->lead = lead;
+}
+
+/* Clear the recorded errors, duration is the profile length in seconds */
+void IterativeLearning_Start(IterativeLearning *ilc, uint32_t duration)
+{
+    ilc->duration = duration;
+    memset(ilc->errorSum, 0, sizeof(ilc->errorSum));
+    memset(ilc->samples, 0, sizeof(ilc->samples));
+}
+
+// Position of second on the bin axis, bin centers are at integer positions
+static float IterativeLearning_Position(const IterativeLearning *ilc, uint32_t second)
+{
+    if (!ilc->duration)
+        return 0.0f;
+    return (float)second * ITERATIVE_LEARNING_BINS / ilc->duration - 0.5f;
+}
+
+/* Feed-forward duty for the zone at second, linearly interpolated between bin centers to avoid steps */
+float IterativeLearning_FeedForward(const IterativeLearning *ilc, const LearningTable *table, uint8_t zone,
+                                    uint32_t second)
+{
+    if (!table->enabled || !ilc->duration || second > ilc->duration)
+        return 0.0f;
+    float position = IterativeLearning_Position(ilc, second);
+    if (position <= 0.0f)
+        return table->correction[zone][0] * ITERATIVE_LEARNING_RESOLUTION;
+    if (position >= ITERATIVE_LEARNING_BINS - 1)
+        return table->correction[zone][ITERATIVE_LEARNING_BINS - 1] * ITERATIVE_LEARNING_RESOLUTION;
+    uint8_t bin = (uint8_t)position;
+    float frac = position - bin;
+    const int8_t *correction = &table->correction[zone][bin];
+    return (correction[0] + frac * (correction[1] - correction[0])) * ITERATIVE_LEARNING_RESOLUTION;
+}
+
+/* Record the tracking error (setpoint - measurement) of the zone, call it once per second while the zone is heating */
+void IterativeLearning_Record(IterativeLearning *ilc, uint8_t zone, uint32_t second, float error)
+{
+    if (!ilc->duration || second > ilc->duration || !isfinite(error))
+        return;
+    // The correction applied at second - lead is the one that shows up in this error
+    uint32_t applied = second > ilc->lead ? second - ilc->lead : 0;
+    uint32_t bin = applied * ITERATIVE_LEARNING_BINS / ilc->duration;
+    if (bin >= ITERATIVE_LEARNING_BINS)
+        bin = ITERATIVE_LEARNING_BINS - 1;
+    ilc->errorSum[zone][bin] += error;
+    ilc->samples[zone][bin]++;
+}
+
+/*
+ * Update the table from a completed run: each bin moves by gain times its average error, then the update is
+ * smoothed over the neighbouring bins so noise in a single bin can't build up from run to run. The correction is
+ * kept within +-ITERATIVE_LEARNING_LIMIT steps.
+ *
+ * Returns true if the table was updated and should be saved.
+ */
+bool IterativeLearning_Finish(IterativeLearning *ilc, LearningTable *table)
+{
+    bool learn = table->enabled && ilc->duration;
+    ilc->duration = 0;
+    if (!learn)
+        return false;
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        float update[ITERATIVE_LEARNING_BINS];
+        for (uint8_t bin = 0; bin < ITERATIVE_LEARNING_BINS; bin++)
+        {
+            uint16_t samples = ilc->samples[zone][bin];
+            update[bin] =
+                samples ? ilc->gain * ilc->errorSum[zone][bin] / samples / ITERATIVE_LEARNING_RESOLUTION : 0.0f;
+        }
+        for (uint8_t bin = 0; bin < ITERATIVE_LEARNING_BINS; bin++)
+        {
+            float prev = update[bin > 0 ? bin - 1 : bin];
+            float next = update[bin < ITERATIVE_LEARNING_BINS - 1 ? bin + 1 : bin];
+            float correction = table->correction[zone][bin] + roundf(0.25f * prev + 0.5f * update[bin] + 0.25f * next);
+            if (correction > ITERATIVE_LEARNING_LIMIT)
+                correction = ITERATIVE_LEARNING_LIMIT;
+            else if (correction < -ITERATIVE_LEARNING_LIMIT)
+                correction = -ITERATIVE_LEARNING_LIMIT;
+            table->correction[zone][bin] = (int8_t)correction;
+        }
+    }
+    if (table->runs < UINT8_MAX)
+        table->runs++;
+    return true;
+}
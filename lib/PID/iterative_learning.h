@@ -0,0 +1,57 @@
+#ifndef _ITERATIVE_LEARNING_H_
+#include <stdint.h>
+#include <string.h>
+#define _ITERATIVE_LEARNING_H_
+
+/* Number of time bins a profile run is split into, per heater zone */
+#define ITERATIVE_LEARNING_BINS 16
+
+/* Duty represented by one step of the stored correction and the bound of the correction (in steps) */
+#define ITERATIVE_LEARNING_RESOLUTION 0.002f
+#define ITERATIVE_LEARNING_LIMIT 125
+
+/* Size of one learning table once packed by LearningTable_Pack(), used to lay out EEPROM */
+#define LEARNING_TABLE_PACKED_SIZE (2 + 2 * ITERATIVE_LEARNING_BINS)
+
+typedef struct
+{
+    /* Learning is enabled for this profile slot */
+    bool enabled;
+
+    /* Number of completed runs the table learned from */
+    uint8_t runs;
+
+    /* Feed-forward duty added to the PID output, correction[zone][bin] * ITERATIVE_LEARNING_RESOLUTION */
+    int8_t correction[2][ITERATIVE_LEARNING_BINS];
+} LearningTable;
+
+typedef struct
+{
+    /* Learning parameters */
+    float gain; /* Correction added per celcius of average tracking error (in duty) */
+    uint16_t lead; /* The error at t + lead is blamed on the correction at t, covers the zone dead time (in seconds) */
+
+    /* Run state */
+    uint32_t duration;
+    float errorSum[2][ITERATIVE_LEARNING_BINS];
+    uint16_t samples[2][ITERATIVE_LEARNING_BINS];
+} IterativeLearning;
+
+/* Forget everything learned, the enabled flag is kept */
+static inline void LearningTable_Reset(LearningTable *table)
+{
+    table->runs = 0;
+    memset(table->correction, 0, sizeof(table->correction));
+}
+
+void LearningTable_Init(LearningTable *table);
+void LearningTable_Pack(const LearningTable *table, uint8_t *dest);
+void LearningTable_Unpack(LearningTable *table, const uint8_t *src);
+
+void IterativeLearning_Init(IterativeLearning *ilc, float gain, uint16_t lead);
+void IterativeLearning_Start(IterativeLearning *ilc, uint32_t duration);
+float IterativeLearning_FeedForward(const IterativeLearning *ilc, const LearningTable *table, uint8_t zone,
+                                    uint32_t second);
+void IterativeLearning_Record(IterativeLearning *ilc, uint8_t zone, uint32_t second, float error);
+bool IterativeLearning_Finish(IterativeLearning *ilc, LearningTable *table);
+#endif
@@ -22,6 +22,25 @@ void PIDController_SetTuning(PIDController *pid, pid_variable_t kp, pid_variable
     pid->tau = 0.00;
 }
 
+/*
+ * Change the gains of a running controller without a step on the output.
+ * The integrator already holds the Ki-weighted error sum so a new Ki does not bump the output,
+ * only the proportional change on the last error needs to be absorbed by the integrator.
+ */
+void PIDController_SetGainsBumpless(PIDController *pid, pid_variable_t kp, pid_variable_t ki, pid_variable_t kd)
+{
+    pid->integrator -= (kp - pid->Kp) * pid->prevError;
+
+    if (pid->integrator > pid->limMaxInt)
+        pid->integrator = pid->limMaxInt;
+    else if (pid->integrator < pid->limMinInt)
+        pid->integrator = pid->limMinInt;
+
+    pid->Kp = kp;
+    pid->Ki = ki;
+    pid->Kd = kd;
+}
+
 void PIDController_Init(PIDController *pid)
 {
 
@@ -43,6 +43,7 @@ void PIDController_SetOutputLimit(PIDController *pid, pid_variable_t limMin, pid
 void PIDController_SetIntegralLimit(PIDController *pid, pid_variable_t limMin, pid_variable_t limMax);
 void PIDController_SetTuning(PIDController *pid, pid_variable_t kp, pid_variable_t ki, pid_variable_t kd,
                              pid_variable_t sampleTime, pid_variable_t tau);
+void PIDController_SetGainsBumpless(PIDController *pid, pid_variable_t kp, pid_variable_t ki, pid_variable_t kd);
 void PIDController_Init(PIDController *pid);
 pid_variable_t PIDController_Compute(PIDController *pid, pid_variable_t setpoint, pid_variable_t measurement);
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "smith_predictor.h"
+#include <math.h>
+#include <string.h>
+
+void SmithPredictor_Init(SmithPredictor *sp)
+{
+    memset(sp, 0, sizeof(SmithPredictor));
+    sp->enabled = false;
+    sp->K = 0.0f;
+    sp->tau = 1.0f;
+    sp->deadTime = 0.0f;
+}
+
+/* Discretize the model for the controller sample time and clear the model memory, call it when a run starts */
+void SmithPredictor_Reset(SmithPredictor *sp, float sampleTime)
+{
+    sp->a = sp->tau > 0.0f ? expf(-sampleTime / sp->tau) : 0.0f;
+    sp->b = sp->K * (1.0f - sp->a);
+
+    float delay = roundf(sp->deadTime / sampleTime);
+    if (delay < 0.0f)
+        delay = 0.0f;
+    else if (delay > SMITH_PREDICTOR_MAX_DELAY)
+        delay = SMITH_PREDICTOR_MAX_DELAY;
+    sp->delay = (uint8_t)delay;
+
+    sp->model = 0.0f;
+    sp->head = 0;
+    memset(sp->history, 0, sizeof(sp->history));
+}
+
+/*
+ * Predicted temperature the controller should act on: the measurement with the delayed model output replaced by
+ * the undelayed one. A perfect model cancels the dead time out of the loop, a model error still shows up as the
+ * measurement so the integrator keeps removing the offset.
+ */
+float SmithPredictor_Predict(const SmithPredictor *sp, float measurement)
+{
+    if (!sp->enabled)
+        return measurement;
+    float delayed = sp->delay ? sp->history[sp->head] : sp->model;
+    return measurement + sp->model - delayed;
+}
+
+/* Advance the model by one sample with the controller output that was just applied */
+void SmithPredictor_Update(SmithPredictor *sp, float output)
+{
+    if (!sp->enabled)
+        return;
+    // history[head] holds the model output from delay samples ago, replace it with the current one
+    if (sp->delay)
+    {
+        sp->history[sp->head] = sp->model;
+        sp->head = (sp->head + 1) % sp->delay;
+    }
+    sp->model = sp->a * sp->model + sp->b * output;
+}
+
+void SmithPredictor_Pack(const SmithPredictor *sp, uint8_t *dest)
+{
+    *dest++ = sp->enabled;
+    memcpy(dest, &sp->K, sizeof(float));
+    dest += sizeof(float);
+    memcpy(dest, &sp->tau, sizeof(float));
+    dest += sizeof(float);
+    memcpy(dest, &sp->deadTime, sizeof(float));
+}
+
+/* Blank (0xFF) or corrupted EEPROM content leaves the predictor disabled */
+void SmithPredictor_Unpack(SmithPredictor *sp, const uint8_t *src)
+{
+    SmithPredictor_Init(sp);
+    uint8_t enabled = *src++;
+    float K, tau, deadTime;
+    memcpy(&K, src, sizeof(float));
+    src += sizeof(float);
+    memcpy(&tau, src, sizeof(float));
+    src += sizeof(float);
+    memcpy(&deadTime, src, sizeof(float));
+    if (enabled > 1 || !isfinite(K) || !isfinite(tau) || !isfinite(deadTime) || tau <= 0.0f || deadTime < 0.0f)
+        return;
+    sp->enabled = enabled;
+    sp->K = K;
+    sp->tau = tau;
+    sp->deadTime = deadTime;
+}
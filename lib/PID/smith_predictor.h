@@ -0,0 +1,36 @@
+#ifndef _SMITH_PREDICTOR_H_
+#include <stdint.h>
+#define _SMITH_PREDICTOR_H_
+
+/* Longest dead time the predictor can model, in samples */
+#define SMITH_PREDICTOR_MAX_DELAY 60
+
+/* Size of one predictor parameters once packed by SmithPredictor_Pack(), used to lay out EEPROM */
+#define SMITH_PREDICTOR_PACKED_SIZE (1 + 3 * sizeof(float))
+
+typedef struct
+{
+    /* First order plus dead time model of the zone, edited by hand or taken from the coupling step test */
+    bool enabled;
+    float K;        /* Process gain, celcius per unit duty */
+    float tau;      /* Time constant (in seconds) */
+    float deadTime; /* Dead time including the sensor filter delay (in seconds) */
+
+    /* Discretized model, computed by SmithPredictor_Reset() */
+    float a;
+    float b;
+    uint8_t delay;
+
+    /* Model "memory" */
+    float model;                              /* Model output without dead time */
+    float history[SMITH_PREDICTOR_MAX_DELAY]; /* Past model outputs used for the dead time */
+    uint8_t head;
+} SmithPredictor;
+
+void SmithPredictor_Init(SmithPredictor *sp);
+void SmithPredictor_Reset(SmithPredictor *sp, float sampleTime);
+float SmithPredictor_Predict(const SmithPredictor *sp, float measurement);
+void SmithPredictor_Update(SmithPredictor *sp, float output);
+void SmithPredictor_Pack(const SmithPredictor *sp, uint8_t *dest);
+void SmithPredictor_Unpack(SmithPredictor *sp, const uint8_t *src);
+#endif
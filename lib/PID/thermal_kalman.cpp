@@ -0,0 +1,99 @@
+#include "thermal_kalman.h"
+#include <string.h>
+
+void ThermalKalman_Init(ThermalKalman *kf, float measurementNoise, float temperatureNoise, float rateNoise)
+{
+    memset(kf, 0, sizeof(ThermalKalman));
+    kf->tau = 1.0f;
+    kf->rateTau = 1.0f;
+    kf->q[0] = temperatureNoise;
+    kf->q[1] = rateNoise;
+    kf->r = measurementNoise;
+    kf->initialized = false;
+}
+
+/*
+ * Take the heater model, usually the one fitted by the coupling step test. The dead time is used as the lag of
+ * the rate behind the duty, which is how the dead time looks like from a 2-state model.
+ */
+void ThermalKalman_SetModel(ThermalKalman *kf, float K, float tau, float deadTime, float ambient)
+{
+    if (K <= 0.0f || tau <= 0.0f)
+    {
+        kf->K = 0.0f;
+        return;
+    }
+    kf->K = K;
+    kf->tau = tau;
+    kf->rateTau = deadTime > 1.0f ? deadTime : 1.0f;
+    kf->ambient = ambient;
+}
+
+/*
+ * Time update with the duty applied since the last sample, dt in seconds.
+ * x = F * x + u, P = F * P * F' + Q with
+ *   F = | 1     dt  |   u = | 0                               |
+ *       | -a/tau 1-a |       | a * (K * duty + ambient) / tau |   a = dt / rateTau
+ */
+void ThermalKalman_Predict(ThermalKalman *kf, float duty, float dt)
+{
+    if (!kf->initialized || dt <= 0.0f)
+        return;
+
+    float f10 = 0.0f, f11 = 1.0f, u1 = 0.0f;
+    if (kf->K > 0.0f)
+    {
+        float a = dt / kf->rateTau;
+        if (a > 1.0f)
+            a = 1.0f;
+        f10 = -a / kf->tau;
+        f11 = 1.0f - a;
+        u1 = a * (kf->K * duty + kf->ambient) / kf->tau;
+    }
+
+    float x0 = kf->x[0] + dt * kf->x[1];
+    float x1 = f10 * kf->x[0] + f11 * kf->x[1] + u1;
+    kf->x[0] = x0;
+    kf->x[1] = x1;
+
+    // F * P
+    float fp00 = kf->P[0][0] + dt * kf->P[1][0];
+    float fp01 = kf->P[0][1] + dt * kf->P[1][1];
+    float fp10 = f10 * kf->P[0][0] + f11 * kf->P[1][0];
+    float fp11 = f10 * kf->P[0][1] + f11 * kf->P[1][1];
+    // (F * P) * F' + Q
+    kf->P[0][0] = fp00 + dt * fp01 + kf->q[0] * dt;
+    kf->P[0][1] = fp00 * f10 + fp01 * f11;
+    kf->P[1][0] = kf->P[0][1];
+    kf->P[1][1] = fp10 * f10 + fp11 * f11 + kf->q[1] * dt;
+}
+
+/* Measurement update with a thermocouple reading in celcius, the first reading initializes the state */
+void ThermalKalman_Correct(ThermalKalman *kf, float measurement)
+{
+    if (!kf->initialized)
+    {
+        kf->x[0] = measurement;
+        kf->x[1] = 0.0f;
+        kf->P[0][0] = kf->r;
+        kf->P[0][1] = kf->P[1][0] = 0.0f;
+        kf->P[1][1] = 1.0f;
+        kf->initialized = true;
+        return;
+    }
+
+    // Only the temperature is measured, H = | 1 0 |
+    float s = kf->P[0][0] + kf->r;
+    float k0 = kf->P[0][0] / s;
+    float k1 = kf->P[1][0] / s;
+    float innovation = measurement - kf->x[0];
+    kf->x[0] += k0 * innovation;
+    kf->x[1] += k1 * innovation;
+
+    // P = (I - K * H) * P, kept symmetric
+    float p00 = kf->P[0][0], p01 = kf->P[0][1];
+    kf->P[0][0] = (1.0f - k0) * p00;
+    kf->P[0][1] = (1.0f - k0) * p01;
+    kf->P[1][0] = kf->P[0][1];
+    kf->P[1][1] -= k1 * p01;
+}
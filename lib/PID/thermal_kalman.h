@@ -0,0 +1,41 @@
+#ifndef _THERMAL_KALMAN_H_
+#include <stdint.h>
+#define _THERMAL_KALMAN_H_
+
+typedef struct
+{
+    /*
+     * Heater model of the zone, the same first order model as the Smith predictor. The rate follows
+     * (K * duty - (T - ambient)) / tau with a lag of rateTau, K = 0 falls back to a constant rate model.
+     */
+    float K;       /* Process gain, celcius per unit duty */
+    float tau;     /* Time constant (in seconds) */
+    float rateTau; /* Lag of the rate behind the heater input (in seconds) */
+    float ambient; /* Temperature the zone cools down to (in celcius) */
+
+    /* Noise */
+    float q[2]; /* Process noise density of the temperature (celcius^2/s) and the rate ((celcius/s)^2/s) */
+    float r;    /* Measurement noise variance (celcius^2) */
+
+    /* State estimate, x[0] is the temperature (in celcius) and x[1] the rate (in celcius/s) */
+    bool initialized;
+    float x[2];
+    float P[2][2];
+} ThermalKalman;
+
+/* Estimated temperature and slope of the zone */
+static inline float ThermalKalman_Temperature(const ThermalKalman *kf)
+{
+    return kf->x[0];
+}
+
+static inline float ThermalKalman_Rate(const ThermalKalman *kf)
+{
+    return kf->x[1];
+}
+
+void ThermalKalman_Init(ThermalKalman *kf, float measurementNoise, float temperatureNoise, float rateNoise);
+void ThermalKalman_SetModel(ThermalKalman *kf, float K, float tau, float deadTime, float ambient);
+void ThermalKalman_Predict(ThermalKalman *kf, float duty, float dt);
+void ThermalKalman_Correct(ThermalKalman *kf, float measurement);
+#endif
@@ -0,0 +1,58 @@
+#include "RunClock.h"
+
+void RunClock::init()
+{
+    critical_section_init(&lock);
+}
+
+void RunClock::start()
+{
+    critical_section_enter_blocking(&lock);
+    accumulatedUs = 0;
+    startUs = time_us_64();
+    running = true;
+    paused = false;
+    critical_section_exit(&lock);
+}
+
+void RunClock::stop()
+{
+    critical_section_enter_blocking(&lock);
+    if (running && !paused)
+        accumulatedUs += time_us_64() - startUs;
+    running = false;
+    paused = false;
+    critical_section_exit(&lock);
+}
+
+void RunClock::pause()
+{
+    critical_section_enter_blocking(&lock);
+    if (running && !paused)
+    {
+        accumulatedUs += time_us_64() - startUs;
+        paused = true;
+    }
+    critical_section_exit(&lock);
+}
+
+void RunClock::resume()
+{
+    critical_section_enter_blocking(&lock);
+    if (running && paused)
+    {
+        startUs = time_us_64();
+        paused = false;
+    }
+    critical_section_exit(&lock);
+}
+
+uint64_t RunClock::elapsedUs()
+{
+    critical_section_enter_blocking(&lock);
+    uint64_t elapsed = accumulatedUs;
+    if (running && !paused)
+        elapsed += time_us_64() - startUs;
+    critical_section_exit(&lock);
+    return elapsed;
+}
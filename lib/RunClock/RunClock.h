@@ -0,0 +1,41 @@
+/**
+ * @file RunClock.h
+ * @brief Monotonic run clock based on the 64-bit microsecond timer, shared by every task that needs the run time
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _RUNCLOCK_H_
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#define _RUNCLOCK_H_
+
+class RunClock
+{
+public:
+    void init();
+    // Reset the elapsed time to zero and start counting
+    void start();
+    // Stop counting, the elapsed time is kept until the next start()
+    void stop();
+    // Hold the elapsed time without ending the run, resume() continues from where it was paused
+    void pause();
+    void resume();
+
+    uint64_t elapsedUs();
+    __force_inline uint32_t elapsedMs() { return elapsedUs() / 1000ULL; }
+    __force_inline uint32_t seconds() { return elapsedUs() / 1000000ULL; }
+    __force_inline float secondsf() { return elapsedUs() / 1000000.0f; }
+    __force_inline bool isRunning() { return running; }
+    __force_inline bool isPaused() { return running && paused; }
+
+protected:
+    critical_section_t lock; // Both cores read the clock, so every access to the state below is locked
+    uint64_t startUs = 0;    // time_us_64() when the clock was last started or resumed
+    uint64_t accumulatedUs = 0; // Elapsed time before the last start or resume
+    volatile bool running = false;
+    volatile bool paused = false;
+};
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file BlockDevice.h
+ * @brief 512 bytes block storage used by Fat32, the SD card on the board or a disk image on Linux
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _BLOCKDEVICE_H_
+#include <stdint.h>
+#include <stddef.h>
+#define _BLOCKDEVICE_H_
+
+#define BLOCKDEVICE_BLOCK_SIZE 512
+
+class BlockDevice
+{
+public:
+    virtual bool readBlocks(uint32_t block, uint8_t *dest, uint32_t count) = 0;
+    virtual bool writeBlocks(uint32_t block, const uint8_t *src, uint32_t count) = 0;
+};
+#endif
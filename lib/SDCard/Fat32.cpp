@@ -0,0 +1,532 @@
+/**
+ * @file Fat32.cpp
+ * @brief Minimal FAT32 for the SD card: 8.3 files in the root directory, sequential read, write and append
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Fat32.h"
+
+static uint16_t fat32_get16(const uint8_t *p) { return p[0] | (uint16_t)p[1] << 8; }
+static uint32_t fat32_get32(const uint8_t *p) { return fat32_get16(p) | (uint32_t)fat32_get16(&p[2]) << 16; }
+static void fat32_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+static void fat32_put32(uint8_t *p, uint32_t v)
+{
+    fat32_put16(p, v & 0xFFFF);
+    fat32_put16(&p[2], v >> 16);
+}
+
+/**
+ * @brief Get a block through the cache, the previous block is written back first if it was modified
+ *
+ * @param block
+ * @param overwrite The whole block is going to be overwritten, so it's not read
+ * @return uint8_t* The cache, NULL if the device failed
+ */
+uint8_t *Fat32::load(uint32_t block, bool overwrite)
+{
+    if (block == cacheBlock)
+        return cache;
+    if (!sync())
+        return NULL;
+    cacheBlock = FAT32_NO_BLOCK;
+    if (!overwrite && !device->readBlocks(block, cache, 1))
+        return NULL;
+    cacheBlock = block;
+    return cache;
+}
+
+/**
+ * @brief Write the cached block back if it was modified, FAT blocks go to every FAT copy
+ *
+ * @return false if the device failed
+ */
+bool Fat32::sync()
+{
+    if (!dirty || cacheBlock == FAT32_NO_BLOCK)
+        return true;
+    if (!device->writeBlocks(cacheBlock, cache, 1))
+        return false;
+    if (cacheBlock >= fatStart && cacheBlock < fatStart + fatSize)
+        for (uint8_t i = 1; i < fatCount; i++)
+            if (!device->writeBlocks(cacheBlock + i * fatSize, cache, 1))
+                return false;
+    dirty = false;
+    return true;
+}
+
+/**
+ * @brief Find the FAT32 volume and read its layout
+ *
+ * @param _device
+ * @return false if there's no FAT32 volume or the device failed
+ */
+bool Fat32::mount(BlockDevice *_device)
+{
+    device = _device;
+    cacheBlock = FAT32_NO_BLOCK;
+    dirty = false;
+    uint8_t *b = load(0);
+    if (!b || b[510] != 0x55 || b[511] != 0xAA)
+    {
+        device = NULL;
+        return false;
+    }
+
+    // A boot sector starts with a jump, otherwise look for a FAT32 partition in the MBR
+    uint32_t volumeStart = 0;
+    if (!(b[0] == 0xEB || b[0] == 0xE9) || fat32_get16(&b[11]) != BLOCKDEVICE_BLOCK_SIZE)
+    {
+        volumeStart = FAT32_NO_BLOCK;
+        for (uint8_t i = 0; i < 4 && volumeStart == FAT32_NO_BLOCK; i++)
+        {
+            const uint8_t *partition = &b[446 + 16 * i];
+            if (partition[4] == 0x0B || partition[4] == 0x0C)
+                volumeStart = fat32_get32(&partition[8]);
+        }
+        if (volumeStart == FAT32_NO_BLOCK || !(b = load(volumeStart)))
+        {
+            device = NULL;
+            return false;
+        }
+    }
+
+    uint32_t totalSectors = fat32_get16(&b[19]) ? fat32_get16(&b[19]) : fat32_get32(&b[32]);
+    sectorsPerCluster = b[13];
+    fatCount = b[16];
+    fatSize = fat32_get32(&b[36]);
+    rootCluster = fat32_get32(&b[44]);
+    uint16_t reserved = fat32_get16(&b[14]);
+    // FAT32 has no fixed root directory and its FAT size lives in the extended BPB only
+    if (fat32_get16(&b[11]) != BLOCKDEVICE_BLOCK_SIZE || sectorsPerCluster == 0 || fatCount == 0 ||
+        fat32_get16(&b[17]) != 0 || fat32_get16(&b[22]) != 0 || fatSize == 0 || rootCluster < 2)
+    {
+        device = NULL;
+        return false;
+    }
+    fatStart = volumeStart + reserved;
+    dataStart = fatStart + fatCount * fatSize;
+    clusterCount = (totalSectors - (dataStart - volumeStart)) / sectorsPerCluster;
+    // The FAT may be too small for the data area, never go past its last entry
+    if (clusterCount + 2 > fatSize * (BLOCKDEVICE_BLOCK_SIZE / 4))
+        clusterCount = fatSize * (BLOCKDEVICE_BLOCK_SIZE / 4) - 2;
+    uint16_t fsInfoSector = fat32_get16(&b[48]);
+    fsInfo = fsInfoSector && fsInfoSector < reserved ? volumeStart + fsInfoSector : FAT32_NO_BLOCK;
+    fsInfoStale = false;
+    nextFree = 2;
+    return true;
+}
+
+uint32_t Fat32::fatGet(uint32_t cluster)
+{
+    uint8_t *b = load(fatStart + cluster / (BLOCKDEVICE_BLOCK_SIZE / 4));
+    if (!b)
+        return FAT32_EOC;
+    return fat32_get32(&b[(cluster % (BLOCKDEVICE_BLOCK_SIZE / 4)) * 4]) & 0x0FFFFFFF;
+}
+
+bool Fat32::fatSet(uint32_t cluster, uint32_t value)
+{
+    uint8_t *b = load(fatStart + cluster / (BLOCKDEVICE_BLOCK_SIZE / 4));
+    if (!b)
+        return false;
+    uint8_t *entry = &b[(cluster % (BLOCKDEVICE_BLOCK_SIZE / 4)) * 4];
+    // The upper 4 bits are reserved and must be kept
+    fat32_put32(entry, (fat32_get32(entry) & 0xF0000000) | (value & 0x0FFFFFFF));
+    markDirty();
+    return true;
+}
+
+/**
+ * @brief Allocate a free cluster as the end of a chain
+ *
+ * @param previous Last cluster of the chain to link the new one to, 0 to start a new chain
+ * @return uint32_t The new cluster, 0 if the volume is full or the device failed
+ */
+uint32_t Fat32::allocate(uint32_t previous)
+{
+    // The free count of FSInfo is only a hint, mark it unknown instead of keeping it up to date
+    if (!fsInfoStale && fsInfo != FAT32_NO_BLOCK)
+    {
+        uint8_t *b = load(fsInfo);
+        if (b && fat32_get32(b) == 0x41615252 && fat32_get32(&b[484]) == 0x61417272)
+        {
+            fat32_put32(&b[488], 0xFFFFFFFF);
+            markDirty();
+        }
+        fsInfoStale = true;
+    }
+
+    for (uint32_t tried = 0; tried < clusterCount; tried++)
+    {
+        uint32_t cluster = 2 + (nextFree - 2 + tried) % clusterCount;
+        if (fatGet(cluster) != 0)
+            continue;
+        if (!fatSet(cluster, 0x0FFFFFFF) || (previous && !fatSet(previous, cluster)))
+            return 0;
+        nextFree = cluster + 1 < clusterCount + 2 ? cluster + 1 : 2;
+        return cluster;
+    }
+    return 0;
+}
+
+bool Fat32::freeChain(uint32_t cluster)
+{
+    while (cluster >= 2 && cluster < FAT32_EOC)
+    {
+        uint32_t next = fatGet(cluster);
+        if (!fatSet(cluster, 0))
+            return false;
+        cluster = next;
+    }
+    return true;
+}
+
+// Upper case 8.3 name padded with spaces, false if the name doesn't fit
+bool Fat32::toShortName(const char *name, uint8_t *shortName)
+{
+    memset(shortName, ' ', 11);
+    uint8_t i = 0, limit = 8;
+    for (; *name; name++)
+    {
+        char c = *name;
+        if (c == '.' && limit == 8)
+        {
+            i = 8;
+            limit = 11;
+            continue;
+        }
+        if (i >= limit || c == '.' || c == '/' || c == '\\' || c <= ' ')
+            return false;
+        shortName[i++] = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+    }
+    return shortName[0] != ' ';
+}
+
+/**
+ * @brief Find the directory entry of a file in the root directory
+ *
+ * @param shortName
+ * @param block Block of the entry
+ * @param offset Offset of the entry in the block
+ * @param create Take the first free entry if the file is missing, the directory grows by a cluster if it's full
+ * @return false if the file is missing (and couldn't be created)
+ */
+bool Fat32::findEntry(const uint8_t *shortName, uint32_t *block, uint16_t *offset, bool create)
+{
+    uint32_t freeBlock = FAT32_NO_BLOCK;
+    uint16_t freeOffset = 0;
+    uint32_t cluster = rootCluster;
+    uint32_t last = cluster;
+    bool end = false;
+    while (!end && cluster >= 2 && cluster < FAT32_EOC)
+    {
+        for (uint8_t s = 0; s < sectorsPerCluster && !end; s++)
+        {
+            uint8_t *b = load(clusterBlock(cluster) + s);
+            if (!b)
+                return false;
+            for (uint16_t o = 0; o < BLOCKDEVICE_BLOCK_SIZE; o += 32)
+            {
+                uint8_t *entry = &b[o];
+                if (entry[0] == 0x00 || entry[0] == 0xE5)
+                {
+                    if (freeBlock == FAT32_NO_BLOCK)
+                    {
+                        freeBlock = clusterBlock(cluster) + s;
+                        freeOffset = o;
+                    }
+                    if (entry[0] == 0x00) // No entry after this one is used
+                    {
+                        end = true;
+                        break;
+                    }
+                    continue;
+                }
+                // Skip long name parts and the volume label
+                if ((entry[11] & 0x0F) == 0x0F || entry[11] & 0x08)
+                    continue;
+                if (memcmp(entry, shortName, 11) == 0)
+                {
+                    *block = clusterBlock(cluster) + s;
+                    *offset = o;
+                    return true;
+                }
+            }
+        }
+        last = cluster;
+        if (!end)
+            cluster = fatGet(cluster);
+    }
+    if (!create)
+        return false;
+
+    if (freeBlock == FAT32_NO_BLOCK)
+    {
+        // The directory is full, a new cluster is zeroed so it ends the directory
+        uint32_t added = allocate(last);
+        if (!added)
+            return false;
+        for (uint8_t s = 0; s < sectorsPerCluster; s++)
+        {
+            uint8_t *b = load(clusterBlock(added) + s, true);
+            if (!b)
+                return false;
+            memset(b, 0, BLOCKDEVICE_BLOCK_SIZE);
+            markDirty();
+        }
+        freeBlock = clusterBlock(added);
+        freeOffset = 0;
+    }
+
+    uint8_t *b = load(freeBlock);
+    if (!b)
+        return false;
+    uint8_t *entry = &b[freeOffset];
+    memset(entry, 0, 32);
+    memcpy(entry, shortName, 11);
+    entry[11] = 0x20;                         // Archive
+    fat32_put16(&entry[16], date); // Created, accessed and modified, the times are left at 0
+    fat32_put16(&entry[18], date);
+    fat32_put16(&entry[24], date);
+    markDirty();
+    *block = freeBlock;
+    *offset = freeOffset;
+    return true;
+}
+
+/**
+ * @brief Get the next file of the root directory
+ *
+ * @param position Start with 0, it's moved past the returned entry
+ * @param entry
+ * @return false if there are no more files or the device failed
+ */
+bool Fat32::readDir(uint32_t *position, Fat32Entry *entry)
+{
+    if (!device)
+        return false;
+    uint32_t entriesPerCluster = (uint32_t)sectorsPerCluster * BLOCKDEVICE_BLOCK_SIZE / 32;
+    uint32_t cluster = rootCluster;
+    for (uint32_t i = *position / entriesPerCluster; i > 0 && cluster >= 2 && cluster < FAT32_EOC; i--)
+        cluster = fatGet(cluster);
+    while (cluster >= 2 && cluster < FAT32_EOC)
+    {
+        uint32_t inCluster = *position % entriesPerCluster;
+        uint8_t *b = load(clusterBlock(cluster) + inCluster / (BLOCKDEVICE_BLOCK_SIZE / 32));
+        if (!b)
+            return false;
+        // Copied since moving to the next cluster loads a FAT block in the cache
+        uint8_t e[32];
+        memcpy(e, &b[(inCluster % (BLOCKDEVICE_BLOCK_SIZE / 32)) * 32], sizeof(e));
+        if (e[0] == 0x00)
+            return false;
+        (*position)++;
+        if (*position % entriesPerCluster == 0)
+            cluster = fatGet(cluster);
+        // Skip deleted entries, long name parts, the volume label and the directories
+        if (e[0] == 0xE5 || (e[11] & 0x0F) == 0x0F || e[11] & 0x18)
+            continue;
+        uint8_t len = 0;
+        for (uint8_t i = 0; i < 8 && e[i] != ' '; i++)
+            entry->name[len++] = e[i];
+        if (e[8] != ' ')
+        {
+            entry->name[len++] = '.';
+            for (uint8_t i = 8; i < 11 && e[i] != ' '; i++)
+                entry->name[len++] = e[i];
+        }
+        entry->name[len] = '\0';
+        entry->size = fat32_get32(&e[28]);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Open a file of the root directory
+ *
+ * @param file
+ * @param name 8.3 name, case insensitive
+ * @param mode
+ * @return false if the file is missing on FAT32_READ, or the name is not valid, or the device failed
+ */
+bool Fat32::open(Fat32File *file, const char *name, Fat32Mode mode)
+{
+    file->isOpen = false;
+    uint8_t shortName[11];
+    if (!device || !toShortName(name, shortName))
+        return false;
+    if (!findEntry(shortName, &file->entryBlock, &file->entryOffset, mode != FAT32_READ))
+        return false;
+    uint8_t *b = load(file->entryBlock);
+    if (!b)
+        return false;
+    uint8_t *entry = &b[file->entryOffset];
+    if (entry[11] & 0x10) // Directory
+        return false;
+    file->firstCluster = (uint32_t)fat32_get16(&entry[20]) << 16 | fat32_get16(&entry[26]);
+    file->size = fat32_get32(&entry[28]);
+    file->writable = mode != FAT32_READ;
+    if (mode == FAT32_WRITE && file->firstCluster)
+    {
+        uint32_t first = file->firstCluster;
+        fat32_put16(&entry[20], 0);
+        fat32_put16(&entry[26], 0);
+        fat32_put32(&entry[28], 0);
+        markDirty();
+        if (!freeChain(first))
+            return false;
+        file->firstCluster = 0;
+        file->size = 0;
+    }
+    file->cluster = file->firstCluster;
+    file->clusterIndex = 0;
+    file->position = mode == FAT32_APPEND ? file->size : 0;
+    file->isOpen = true;
+    return true;
+}
+
+/**
+ * @brief Walk the chain to the cluster holding the position of a file
+ *
+ * @param file
+ * @param extend Allocate the missing clusters, for writing
+ * @return false if the chain ends before the position (and couldn't be extended)
+ */
+bool Fat32::seek(Fat32File *file, bool extend)
+{
+    uint32_t clusterBytes = (uint32_t)sectorsPerCluster * BLOCKDEVICE_BLOCK_SIZE;
+    if (file->firstCluster == 0)
+    {
+        if (!extend || !(file->firstCluster = allocate(0)))
+            return false;
+        file->cluster = file->firstCluster;
+        file->clusterIndex = 0;
+    }
+    uint32_t index = file->position / clusterBytes;
+    if (index < file->clusterIndex)
+    {
+        file->cluster = file->firstCluster;
+        file->clusterIndex = 0;
+    }
+    while (file->clusterIndex < index)
+    {
+        uint32_t next = fatGet(file->cluster);
+        if (next < 2 || next >= FAT32_EOC)
+        {
+            if (!extend || !(next = allocate(file->cluster)))
+                return false;
+        }
+        file->cluster = next;
+        file->clusterIndex++;
+    }
+    return true;
+}
+
+/**
+ * @brief Read from the position of a file
+ *
+ * @param file
+ * @param dest
+ * @param len
+ * @return uint32_t Bytes read, less than len at the end of the file or if the device failed
+ */
+uint32_t Fat32::read(Fat32File *file, void *dest, uint32_t len)
+{
+    uint32_t done = 0;
+    if (!file->isOpen)
+        return 0;
+    while (done < len && file->position < file->size)
+    {
+        if (!seek(file, false))
+            break;
+        uint32_t inCluster = file->position % ((uint32_t)sectorsPerCluster * BLOCKDEVICE_BLOCK_SIZE);
+        uint16_t inBlock = file->position % BLOCKDEVICE_BLOCK_SIZE;
+        uint32_t chunk = BLOCKDEVICE_BLOCK_SIZE - inBlock;
+        if (chunk > len - done)
+            chunk = len - done;
+        if (chunk > file->size - file->position)
+            chunk = file->size - file->position;
+        uint8_t *b = load(clusterBlock(file->cluster) + inCluster / BLOCKDEVICE_BLOCK_SIZE);
+        if (!b)
+            break;
+        memcpy((uint8_t *)dest + done, &b[inBlock], chunk);
+        done += chunk;
+        file->position += chunk;
+    }
+    return done;
+}
+
+/**
+ * @brief Write at the position of a file, the directory entry is only updated by close() or sync()
+ *
+ * @param file
+ * @param src
+ * @param len
+ * @return uint32_t Bytes written, less than len if the volume is full or the device failed
+ */
+uint32_t Fat32::write(Fat32File *file, const void *src, uint32_t len)
+{
+    uint32_t done = 0;
+    if (!file->isOpen || !file->writable)
+        return 0;
+    while (done < len)
+    {
+        if (!seek(file, true))
+            break;
+        uint32_t inCluster = file->position % ((uint32_t)sectorsPerCluster * BLOCKDEVICE_BLOCK_SIZE);
+        uint16_t inBlock = file->position % BLOCKDEVICE_BLOCK_SIZE;
+        uint32_t chunk = BLOCKDEVICE_BLOCK_SIZE - inBlock;
+        if (chunk > len - done)
+            chunk = len - done;
+        // A block past the end of the file holds nothing worth reading
+        bool overwrite = inBlock == 0 && (chunk == BLOCKDEVICE_BLOCK_SIZE || file->position >= file->size);
+        uint8_t *b = load(clusterBlock(file->cluster) + inCluster / BLOCKDEVICE_BLOCK_SIZE, overwrite);
+        if (!b)
+            break;
+        if (overwrite)
+            memset(b, 0, BLOCKDEVICE_BLOCK_SIZE);
+        memcpy(&b[inBlock], (const uint8_t *)src + done, chunk);
+        markDirty();
+        done += chunk;
+        file->position += chunk;
+        if (file->position > file->size)
+            file->size = file->position;
+    }
+    return done;
+}
+
+/**
+ * @brief Update the directory entry of a written file and write every cached change back, the file stays open
+ *
+ * @param file
+ * @return false if the device failed
+ */
+bool Fat32::flush(Fat32File *file)
+{
+    if (!file->isOpen || !file->writable)
+        return true;
+    uint8_t *b = load(file->entryBlock);
+    if (!b)
+        return false;
+    uint8_t *entry = &b[file->entryOffset];
+    fat32_put16(&entry[20], file->firstCluster >> 16);
+    fat32_put16(&entry[26], file->firstCluster & 0xFFFF);
+    fat32_put32(&entry[28], file->size);
+    markDirty();
+    return sync();
+}
+
+bool Fat32::close(Fat32File *file)
+{
+    bool ok = flush(file);
+    file->isOpen = false;
+    return ok;
+}
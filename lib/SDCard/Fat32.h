@@ -0,0 +1,95 @@
+/**
+ * @file Fat32.h
+ * @brief Minimal FAT32 for the SD card: 8.3 files in the root directory, sequential read, write and append
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The volume is either the first FAT32 partition of the MBR or a whole device formatted without a partition table.
+ * Long file names, subdirectories and FAT12/16 are not supported. Every FAT, directory and data access goes through
+ * a single sector cache, FAT sectors are mirrored to every FAT copy when they're written back. Not thread safe, the
+ * callers share the volume under their own lock.
+ */
+#ifndef _FAT32_H_
+#include "BlockDevice.h"
+#include <string.h>
+#define _FAT32_H_
+
+#define FAT32_NO_BLOCK 0xFFFFFFFF
+#define FAT32_EOC 0x0FFFFFF8 // Cluster values from this one mark the end of a chain
+
+enum Fat32Mode : uint8_t
+{
+    FAT32_READ,
+    FAT32_WRITE,  // Created if missing, truncated otherwise
+    FAT32_APPEND, // Created if missing
+};
+
+struct Fat32Entry
+{
+    char name[13]; // 8.3 name and the terminator
+    uint32_t size;
+};
+
+struct Fat32File
+{
+    bool isOpen = false;
+    bool writable;
+    uint32_t size;
+    uint32_t position;
+    uint32_t firstCluster;
+    uint32_t cluster;      // Cluster holding position, valid once firstCluster is set
+    uint32_t clusterIndex; // Index of cluster in the chain
+    uint32_t entryBlock;   // Directory entry of the file
+    uint16_t entryOffset;
+};
+
+class Fat32
+{
+public:
+    bool mount(BlockDevice *_device);
+    void unmount() { device = NULL; }
+    bool isMounted() { return device != NULL; }
+    bool open(Fat32File *file, const char *name, Fat32Mode mode);
+    uint32_t read(Fat32File *file, void *dest, uint32_t len);
+    uint32_t write(Fat32File *file, const void *src, uint32_t len);
+    bool flush(Fat32File *file);
+    bool close(Fat32File *file);
+    bool sync();
+    bool readDir(uint32_t *position, Fat32Entry *entry);
+    // Date of the files created from now on, they're left undated (0) until it's set since the board has no RTC
+    void setDate(uint16_t year, uint8_t month, uint8_t day)
+    {
+        date = year < 1980 || year > 2107 ? 0 : (year - 1980) << 9 | (month & 0x0F) << 5 | (day & 0x1F);
+    }
+
+protected:
+    uint8_t *load(uint32_t block, bool overwrite = false);
+    void markDirty() { dirty = true; }
+    uint32_t clusterBlock(uint32_t cluster) { return dataStart + (cluster - 2) * sectorsPerCluster; }
+    uint32_t fatGet(uint32_t cluster);
+    bool fatSet(uint32_t cluster, uint32_t value);
+    uint32_t allocate(uint32_t previous);
+    bool freeChain(uint32_t cluster);
+    bool seek(Fat32File *file, bool extend);
+    static bool toShortName(const char *name, uint8_t *shortName);
+    bool findEntry(const uint8_t *shortName, uint32_t *block, uint16_t *offset, bool create);
+
+    BlockDevice *device = NULL;
+    uint32_t fatStart;       // First block of the first FAT
+    uint32_t fatSize;        // In blocks
+    uint8_t fatCount;
+    uint32_t dataStart;      // First block of cluster 2
+    uint8_t sectorsPerCluster;
+    uint32_t clusterCount;
+    uint32_t rootCluster;
+    uint32_t fsInfo;         // Block of the FSInfo sector, FAT32_NO_BLOCK if there is none
+    bool fsInfoStale;        // The free cluster count of FSInfo was already invalidated
+    uint32_t nextFree;       // Where the search for a free cluster starts
+    uint16_t date = 0;       // FAT date of the new directory entries
+    uint32_t cacheBlock = FAT32_NO_BLOCK;
+    bool dirty = false;
+    uint8_t cache[BLOCKDEVICE_BLOCK_SIZE];
+};
+#endif
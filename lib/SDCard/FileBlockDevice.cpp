@@ -0,0 +1,38 @@
+/**
+ * @file FileBlockDevice.cpp
+ * @brief Disk image standing in for the SD card, so Fat32 can be run on Linux
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FileBlockDevice.h"
+
+bool FileBlockDevice::open(const char *path)
+{
+    close();
+    image = fopen(path, "r+b");
+    return image != NULL;
+}
+
+void FileBlockDevice::close()
+{
+    if (image)
+        fclose(image);
+    image = NULL;
+}
+
+bool FileBlockDevice::readBlocks(uint32_t block, uint8_t *dest, uint32_t count)
+{
+    if (!image || fseek(image, (long)block * BLOCKDEVICE_BLOCK_SIZE, SEEK_SET))
+        return false;
+    return fread(dest, BLOCKDEVICE_BLOCK_SIZE, count, image) == count;
+}
+
+bool FileBlockDevice::writeBlocks(uint32_t block, const uint8_t *src, uint32_t count)
+{
+    if (!image || fseek(image, (long)block * BLOCKDEVICE_BLOCK_SIZE, SEEK_SET))
+        return false;
+    return fwrite(src, BLOCKDEVICE_BLOCK_SIZE, count, image) == count && fflush(image) == 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file FileBlockDevice.h
+ * @brief Disk image standing in for the SD card, so Fat32 can be run on Linux
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * An image made with e.g. "mkfs.fat -C -F 32 sdcard.img 65536" can be mounted by Fat32 as is, and the files written
+ * to it checked with mtools or fsck.fat.
+ */
+#ifndef _FILEBLOCKDEVICE_H_
+#include "BlockDevice.h"
+#include <stdio.h>
+#define _FILEBLOCKDEVICE_H_
+
+class FileBlockDevice : public BlockDevice
+{
+public:
+    ~FileBlockDevice() { close(); }
+    bool open(const char *path);
+    void close();
+    bool readBlocks(uint32_t block, uint8_t *dest, uint32_t count) override;
+    bool writeBlocks(uint32_t block, const uint8_t *src, uint32_t count) override;
+
+protected:
+    FILE *image = NULL;
+};
+#endif
@@ -0,0 +1,222 @@
+/**
+ * @file SDCard.cpp
+ * @brief microSD card in SPI mode on the reserved SD pins of the RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "SDCard.h"
+
+/**
+ * @brief Create the pin mutex and set up the SPI, the pins shared with the touchscreen are left alone. Call once
+ * before the scheduler starts
+ *
+ * @return false if the mutex couldn't be created
+ */
+bool SDCard::init()
+{
+    pins = xSemaphoreCreateMutex();
+    if (pins == NULL)
+        return false;
+    spi_init(spi, SDCARD_INIT_SPEED);
+    spi_set_format(spi, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(sck, GPIO_FUNC_SPI);
+    gpio_set_function(rx, GPIO_FUNC_SPI);
+    gpio_pull_up(rx); // The card leaves DO floating while it's not selected
+    return true;
+}
+
+// Take TX over and select the card, the pin mutex must be held
+bool SDCard::select()
+{
+    gpio_set_function(tx, GPIO_FUNC_SPI);
+    gpio_set_dir(cs, GPIO_OUT);
+    gpio_put(cs, 1);
+    transfer(0xFF); // The card only sees the CS edge with a clock
+    gpio_put(cs, 0);
+    if (waitReady(SDCARD_READY_TIMEOUT))
+        return true;
+    deselect();
+    return false;
+}
+
+// Release the card and give TX back to the touchscreen
+void SDCard::deselect()
+{
+    gpio_put(cs, 1);
+    transfer(0xFF); // Let the card release DO
+    gpio_set_function(tx, GPIO_FUNC_SIO);
+}
+
+/**
+ * @brief Wait while the card holds DO low, it's still busy with the previous write
+ * Blocks the touchscreen for the time the card is busy, usually a couple of ms.
+ *
+ * @param timeout in ms
+ * @return false if the card is still busy
+ */
+bool SDCard::waitReady(uint32_t timeout)
+{
+    absolute_time_t deadline = make_timeout_time_ms(timeout);
+    for (uint16_t polls = 0; transfer(0xFF) != 0xFF; polls++)
+    {
+        if (time_reached(deadline))
+            return false;
+        if (polls > 100)
+            vTaskDelay(1);
+    }
+    return true;
+}
+
+/**
+ * @brief Send a command and get its R1 response, the card must be selected
+ *
+ * @param cmd Command index, SDCARD_ACMD41 is preceded by CMD55
+ * @param arg
+ * @return uint8_t R1 response, 0xFF if the card didn't answer
+ */
+uint8_t SDCard::command(uint8_t cmd, uint32_t arg)
+{
+    if (cmd & 0x80)
+    {
+        cmd &= 0x7F;
+        uint8_t r1 = command(SDCARD_CMD55, 0);
+        if (r1 > SDCARD_R1_IDLE)
+            return r1;
+    }
+    // Only CMD0 and CMD8 are checked against their CRC, the card ignores it afterwards
+    uint8_t frame[6] = {(uint8_t)(0x40 | cmd), (uint8_t)(arg >> 24), (uint8_t)(arg >> 16), (uint8_t)(arg >> 8),
+                        (uint8_t)arg, (uint8_t)(cmd == SDCARD_CMD0 ? 0x95 : (cmd == SDCARD_CMD8 ? 0x87 : 0x01))};
+    spi_write_blocking(spi, frame, sizeof(frame));
+    uint8_t r1 = 0xFF;
+    for (uint8_t i = 0; i < 10 && (r1 & 0x80); i++)
+        r1 = transfer(0xFF);
+    return r1;
+}
+
+/**
+ * @brief Detect and initialize the card, may be called again after a card change or a failed access
+ *
+ * @return false if there's no card or it's not supported
+ */
+bool SDCard::begin()
+{
+    ready = false;
+    if (!takePins(portMAX_DELAY))
+        return false;
+    spi_set_baudrate(spi, SDCARD_INIT_SPEED);
+    gpio_set_function(tx, GPIO_FUNC_SPI);
+    gpio_set_dir(cs, GPIO_OUT);
+    gpio_put(cs, 1);
+    // At least 74 clocks with CS high to enter the native mode, CMD0 with CS low then switches to SPI mode
+    for (uint8_t i = 0; i < 10; i++)
+        transfer(0xFF);
+    gpio_put(cs, 0);
+
+    uint8_t r1 = 0xFF;
+    for (uint8_t i = 0; i < 10 && r1 != SDCARD_R1_IDLE; i++)
+        r1 = command(SDCARD_CMD0, 0);
+    bool ok = r1 == SDCARD_R1_IDLE;
+
+    // Version 2 cards echo the check pattern of CMD8, version 1 cards reject it
+    bool version2 = false;
+    if (ok)
+    {
+        r1 = command(SDCARD_CMD8, 0x1AA);
+        if (!(r1 & SDCARD_R1_ILLEGAL))
+        {
+            uint8_t r7[4];
+            spi_read_blocking(spi, 0xFF, r7, sizeof(r7));
+            ok = (r7[2] & 0x0F) == 0x01 && r7[3] == 0xAA;
+            version2 = true;
+        }
+    }
+
+    // ACMD41 starts the initialization, HCS tells the card high capacity is supported
+    if (ok)
+    {
+        absolute_time_t deadline = make_timeout_time_ms(SDCARD_INIT_TIMEOUT);
+        while ((r1 = command(SDCARD_ACMD41, version2 ? 1UL << 30 : 0)) == SDCARD_R1_IDLE && !time_reached(deadline))
+            vTaskDelay(1);
+        ok = r1 == 0;
+    }
+
+    highCapacity = false;
+    if (ok && version2)
+    {
+        uint8_t ocr[4];
+        ok = command(SDCARD_CMD58, 0) == 0;
+        spi_read_blocking(spi, 0xFF, ocr, sizeof(ocr));
+        highCapacity = ok && (ocr[0] & 0x40);
+    }
+    if (ok && !highCapacity)
+        ok = command(SDCARD_CMD16, BLOCKDEVICE_BLOCK_SIZE) == 0;
+
+    deselect();
+    if (ok)
+        spi_set_baudrate(spi, SDCARD_SPEED);
+    givePins();
+    ready = ok;
+    return ok;
+}
+
+bool SDCard::readBlocks(uint32_t block, uint8_t *dest, uint32_t count)
+{
+    if (!ready || !takePins(portMAX_DELAY))
+        return false;
+    bool selected = select();
+    bool ok = selected;
+    for (uint32_t i = 0; i < count && ok; i++)
+    {
+        uint32_t address = highCapacity ? block + i : (block + i) * BLOCKDEVICE_BLOCK_SIZE;
+        ok = command(SDCARD_CMD17, address) == 0;
+        absolute_time_t deadline = make_timeout_time_ms(SDCARD_TOKEN_TIMEOUT);
+        uint8_t token = 0xFF;
+        while (ok && (token = transfer(0xFF)) == 0xFF && !time_reached(deadline))
+            ;
+        ok = ok && token == SDCARD_TOKEN_START;
+        if (ok)
+        {
+            spi_read_blocking(spi, 0xFF, &dest[i * BLOCKDEVICE_BLOCK_SIZE], BLOCKDEVICE_BLOCK_SIZE);
+            transfer(0xFF); // CRC, not checked
+            transfer(0xFF);
+        }
+    }
+    if (selected)
+        deselect();
+    givePins();
+    ready = ok;
+    return ok;
+}
+
+bool SDCard::writeBlocks(uint32_t block, const uint8_t *src, uint32_t count)
+{
+    if (!ready || !takePins(portMAX_DELAY))
+        return false;
+    bool selected = select();
+    bool ok = selected;
+    for (uint32_t i = 0; i < count && ok; i++)
+    {
+        uint32_t address = highCapacity ? block + i : (block + i) * BLOCKDEVICE_BLOCK_SIZE;
+        ok = command(SDCARD_CMD24, address) == 0;
+        if (ok)
+        {
+            transfer(0xFF);
+            transfer(SDCARD_TOKEN_START);
+            spi_write_blocking(spi, &src[i * BLOCKDEVICE_BLOCK_SIZE], BLOCKDEVICE_BLOCK_SIZE);
+            transfer(0xFF); // CRC, not checked by the card in SPI mode
+            transfer(0xFF);
+            ok = (transfer(0xFF) & 0x1F) == SDCARD_DATA_ACCEPTED;
+        }
+        // The card is busy programming the block, the next access waits for it
+        if (ok && i + 1 < count)
+            ok = waitReady(SDCARD_READY_TIMEOUT);
+    }
+    if (selected)
+        deselect();
+    givePins();
+    ready = ok;
+    return ok;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file SDCard.h
+ * @brief microSD card in SPI mode on the reserved SD pins of the RP2040
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * TX and CS of the card are also the Y+ and X- pins of the resistive touchscreen. Only TX is switched to the SPI
+ * function, and only while the card is accessed. Every access holds the pin mutex, so the touch sampling takes it too
+ * (with takePins(0)) and skips the sample while the card is busy. The touch sampling leaves CS anywhere, but that
+ * doesn't matter to the card as long as SCK stays idle.
+ */
+#ifndef _SDCARD_H_
+#include "BlockDevice.h"
+#include "FreeRTOS.h"
+#include "hardware/spi.h"
+#include "pico/stdlib.h"
+#include "semphr.h"
+#include "task.h"
+#define _SDCARD_H_
+
+#define SDCARD_INIT_SPEED 400000  // in Hz, the card only has to answer at 400kHz until it's initialized
+#define SDCARD_SPEED 12500000     // in Hz, the wires to the card slot are not short enough for 25MHz
+#define SDCARD_INIT_TIMEOUT 1000  // in ms, ACMD41 until the card leaves the idle state
+#define SDCARD_READY_TIMEOUT 500  // in ms, busy time of a block write
+#define SDCARD_TOKEN_TIMEOUT 100  // in ms, read access time
+
+#define SDCARD_CMD0 0   // GO_IDLE_STATE
+#define SDCARD_CMD8 8   // SEND_IF_COND
+#define SDCARD_CMD16 16 // SET_BLOCKLEN
+#define SDCARD_CMD17 17 // READ_SINGLE_BLOCK
+#define SDCARD_CMD24 24 // WRITE_BLOCK
+#define SDCARD_CMD55 55 // APP_CMD
+#define SDCARD_CMD58 58 // READ_OCR
+#define SDCARD_ACMD41 (0x80 | 41) // SD_SEND_OP_COND, sent after CMD55
+#define SDCARD_R1_IDLE 0x01
+#define SDCARD_R1_ILLEGAL 0x04
+#define SDCARD_TOKEN_START 0xFE
+#define SDCARD_DATA_ACCEPTED 0x05
+
+class SDCard : public BlockDevice
+{
+public:
+    SDCard(spi_inst_t *_spi, uint _sck, uint _tx, uint _rx, uint _cs) : spi(_spi), sck(_sck), tx(_tx), rx(_rx), cs(_cs)
+    {
+    }
+    bool init();
+    bool begin();
+    bool readBlocks(uint32_t block, uint8_t *dest, uint32_t count) override;
+    bool writeBlocks(uint32_t block, const uint8_t *src, uint32_t count) override;
+    // Take the pins shared with the touchscreen, the touch sampling gives them back with givePins()
+    __force_inline bool takePins(TickType_t timeout) { return pins && xSemaphoreTake(pins, timeout) == pdTRUE; }
+    __force_inline void givePins() { xSemaphoreGive(pins); }
+    // True once begin() found a card, false again after a failed access until begin() succeeds
+    __force_inline bool isReady() { return ready; }
+
+protected:
+    __force_inline uint8_t transfer(uint8_t out)
+    {
+        uint8_t in;
+        spi_write_read_blocking(spi, &out, &in, 1);
+        return in;
+    }
+    bool select();
+    void deselect();
+    bool waitReady(uint32_t timeout);
+    uint8_t command(uint8_t cmd, uint32_t arg);
+
+    spi_inst_t *spi;
+    uint sck, tx, rx, cs;
+    SemaphoreHandle_t pins = NULL;
+    bool ready = false;
+    bool highCapacity; // SDHC and SDXC are addressed by block, SDSC by byte
+};
+#endif
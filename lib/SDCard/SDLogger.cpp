@@ -0,0 +1,221 @@
+/**
+ * @file SDLogger.cpp
+ * @brief Run logs streamed to files of the SD card by a low priority task through two alternating buffers
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "SDLogger.h"
+#include "Log.h"
+
+/**
+ * @brief Create the command queue, the volume mutex and the writer task, call once before the scheduler starts
+ *
+ * @param priority Priority of the writer task, should be the lowest one
+ * @param stackSize Stack of the writer task in words
+ * @return true if the queue, the mutex and the task were created
+ */
+bool SDLogger::init(UBaseType_t priority, uint32_t stackSize)
+{
+    commands = xQueueCreate(SDLOGGER_QUEUE_LENGTH, sizeof(Command));
+    volumeMutex = xSemaphoreCreateMutex();
+    if (commands == NULL || volumeMutex == NULL)
+        return false;
+    return xTaskCreate(task, "sd_task", stackSize, this, priority, NULL) == pdPASS;
+}
+
+bool SDLogger::queue(const Command *command)
+{
+    if (commands == NULL || xQueueSend(commands, command, 0) != pdTRUE)
+    {
+        dropped += command->len;
+        return false;
+    }
+    return true;
+}
+
+// Hand the filled buffer to the writer task and go on with the other one
+bool SDLogger::handOver()
+{
+    if (fill == 0)
+        return true;
+    Command command = {SDLOGGER_DATA, active, fill};
+    busy[active] = true;
+    bool queued = queue(&command);
+    if (!queued)
+        busy[active] = false;
+    else
+        active ^= 1;
+    fill = 0;
+    return queued;
+}
+
+/**
+ * @brief Write what's buffered to the current file and start a new one, never blocks
+ *
+ * @param pattern Upper case 8.3 name without the number, "RUN.CSV" gives RUN00001.CSV, RUN00002.CSV and so on
+ * @return false if the writer task is behind, the file is not created
+ */
+bool SDLogger::begin(const char *pattern)
+{
+    Command command = {SDLOGGER_BEGIN, 0, 0};
+    strncpy(command.name, pattern, sizeof(command.name) - 1);
+    command.name[sizeof(command.name) - 1] = '\0';
+    handOver();
+    return queue(&command);
+}
+
+/**
+ * @brief Buffer a record for the current file, never blocks
+ *
+ * @param src
+ * @param len Up to SDLOGGER_BUFFER_SIZE bytes
+ * @return false if the record is dropped
+ */
+bool SDLogger::write(const void *src, uint16_t len)
+{
+    if (commands == NULL || len > SDLOGGER_BUFFER_SIZE)
+        return false;
+    // Records are never split across the buffers
+    if (fill + len > SDLOGGER_BUFFER_SIZE)
+        handOver();
+    if (busy[active])
+    {
+        dropped += len;
+        return false;
+    }
+    memcpy(&buffers[active][fill], src, len);
+    fill += len;
+    return true;
+}
+
+/**
+ * @brief Write what's buffered and close the current file, never blocks
+ *
+ * @return false if the writer task is behind, the file is still closed by the next begin()
+ */
+bool SDLogger::end()
+{
+    Command command = {SDLOGGER_END, 0, 0};
+    handOver();
+    return queue(&command);
+}
+
+/**
+ * @brief Take the volume, hold it while using the volume outside of the logger
+ *
+ * @param timeout
+ * @return false if the volume is still used, or before init()
+ */
+bool SDLogger::lock(TickType_t timeout)
+{
+    return volumeMutex && xSemaphoreTake(volumeMutex, timeout) == pdTRUE;
+}
+
+/**
+ * @brief Initialize the card and mount its volume if it's not mounted yet, the volume must be locked
+ *
+ * @return false if there's no card or no FAT32 volume on it
+ */
+bool SDLogger::mount()
+{
+    if (volume->isMounted())
+        return true;
+    return card->begin() && volume->mount(card);
+}
+
+/**
+ * @brief Give the volume back, it's unmounted unless a log file is still open so the card may be swapped
+ *
+ */
+void SDLogger::unlock()
+{
+    if (!file.isOpen)
+        volume->unmount();
+    xSemaphoreGive(volumeMutex);
+}
+
+// A failed access usually means the card was pulled, the file is given up and the volume mounted again next time
+void SDLogger::fail()
+{
+    LOG_WARN("SD card access failed, the log file is given up\n");
+    file.isOpen = false;
+    volume->unmount();
+}
+
+/**
+ * @brief Number a pattern after the highest number of the root directory, the volume must be mounted
+ *
+ * @param pattern e.g. "RUN.CSV", the prefix is padded with digits to 8 characters
+ * @param name Numbered name, SDLOGGER_NAME_SIZE bytes
+ * @param value Number given to the name
+ * @return false if the prefix leaves no room for the number
+ */
+bool SDLogger::number(const char *pattern, char *name, uint32_t *value)
+{
+    const char *extension = strchr(pattern, '.');
+    if (extension == NULL)
+        extension = pattern + strlen(pattern);
+    int prefixLen = extension - pattern;
+    if (prefixLen > 7)
+        return false;
+
+    uint32_t highest = 0, position = 0;
+    Fat32Entry entry;
+    while (volume->readDir(&position, &entry))
+    {
+        char *end;
+        if (strncmp(entry.name, pattern, prefixLen))
+            continue;
+        uint32_t n = strtoul(&entry.name[prefixLen], &end, 10);
+        if (end != &entry.name[prefixLen] && strcmp(end, extension) == 0 && n > highest)
+            highest = n;
+    }
+    *value = highest + 1;
+    int len = snprintf(name, SDLOGGER_NAME_SIZE, "%.*s%0*lu%s", prefixLen, pattern, 8 - prefixLen,
+                       (unsigned long)*value, extension);
+    return len < SDLOGGER_NAME_SIZE;
+}
+
+void SDLogger::run(const Command *command)
+{
+    char name[SDLOGGER_NAME_SIZE];
+    uint32_t value;
+    lock(portMAX_DELAY);
+    switch (command->type)
+    {
+    case SDLOGGER_BEGIN:
+        if (file.isOpen && !volume->close(&file))
+            fail();
+        if (!mount())
+            LOG_WARN("No SD card, the run is not logged\n");
+        else if (!number(command->name, name, &value) || !volume->open(&file, name, FAT32_WRITE))
+            fail();
+        else
+            LOG_INFO("Logging the run to file number %lu\n", (unsigned long)value); // The name is on the stack
+        break;
+    case SDLOGGER_DATA:
+        // The directory entry is updated with every buffer, a power loss only loses the buffered records
+        if (file.isOpen && (volume->write(&file, buffers[command->buffer], command->len) != command->len ||
+                            !volume->flush(&file)))
+            fail();
+        busy[command->buffer] = false;
+        break;
+    case SDLOGGER_END:
+        if (file.isOpen && !volume->close(&file))
+            fail();
+        break;
+    }
+    unlock();
+}
+
+void SDLogger::task(void *pvParameter)
+{
+    SDLogger *logger = (SDLogger *)pvParameter;
+    Command command;
+    for (;;)
+        if (xQueueReceive(logger->commands, &command, portMAX_DELAY) == pdTRUE)
+            logger->run(&command);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file SDLogger.h
+ * @brief Run logs streamed to files of the SD card by a low priority task through two alternating buffers
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The caller fills one buffer while the writer task writes the other one, a full buffer is handed over through the
+ * command queue together with the begin and end of the files so they stay in order. The caller only copies, it never
+ * waits for the card. If both buffers are taken the record is dropped and counted instead.
+ * Files are numbered after the highest number already on the card, as there's no clock to name them after.
+ * The volume is mounted again for every file, so the card may be swapped between runs. Other users of the volume,
+ * like the profile import, hold lock() while they use it.
+ */
+#ifndef _SDLOGGER_H_
+#include "Fat32.h"
+#include "SDCard.h"
+#include "queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#define _SDLOGGER_H_
+
+#define SDLOGGER_BUFFER_SIZE 2048 // A run logged as CSV at 1Hz fills a buffer every ~50 seconds
+#define SDLOGGER_QUEUE_LENGTH 8
+#define SDLOGGER_NAME_SIZE 13 // 8.3 name and the terminator
+
+class SDLogger
+{
+public:
+    SDLogger(SDCard *_card, Fat32 *_volume) : card(_card), volume(_volume) {}
+    bool init(UBaseType_t priority, uint32_t stackSize);
+    bool begin(const char *pattern);
+    bool write(const void *src, uint16_t len);
+    bool end();
+    bool lock(TickType_t timeout);
+    bool mount();
+    void unlock();
+    // Bytes lost because the writer task was behind
+    __force_inline uint32_t getDropped() { return dropped; }
+
+protected:
+    enum CommandType : uint8_t
+    {
+        SDLOGGER_BEGIN, // Create the next numbered file of the pattern given by the command
+        SDLOGGER_DATA,  // Append the buffer of the command
+        SDLOGGER_END,   // Close the file
+    };
+    struct Command
+    {
+        CommandType type;
+        uint8_t buffer;
+        uint16_t len;
+        char name[SDLOGGER_NAME_SIZE];
+    };
+    static void task(void *pvParameter);
+    void run(const Command *command);
+    bool queue(const Command *command);
+    bool handOver();
+    bool number(const char *pattern, char *name, uint32_t *value);
+    void fail();
+
+    SDCard *card;
+    Fat32 *volume;
+    QueueHandle_t commands = NULL;
+    SemaphoreHandle_t volumeMutex = NULL;
+    volatile uint32_t dropped = 0;
+    volatile bool busy[2] = {}; // Buffer handed over and not written yet
+    uint8_t active = 0;         // Buffer being filled, caller only
+    uint16_t fill = 0;
+    uint8_t buffers[2][SDLOGGER_BUFFER_SIZE];
+    Fat32File file; // Writer task only
+};
+#endif
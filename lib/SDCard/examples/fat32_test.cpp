@@ -0,0 +1,244 @@
+/**
+ * @file fat32_test.cpp
+ * @brief Host test of Fat32 through FileBlockDevice: create, append, read back, truncate and directory lookup
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * "fat32-test image.img" formats a small FAT32 volume on the image and runs the checks on it, "fat32-test -o
+ * image.img" runs them on an existing image instead, e.g. one made with "mkfs.fat -C -F 32 image.img 65536". The
+ * files written are left on the image so they can be checked with mtools or fsck.fat afterwards.
+ */
+#include "Fat32.h"
+#include "FileBlockDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr uint32_t test_imageBlocks = 8192; // 4MB, one block per cluster
+static constexpr uint16_t test_reserved = 32;
+static constexpr uint8_t test_fatCount = 2;
+
+static int test_failures = 0;
+
+#define TEST_CHECK(condition)                                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(condition))                                                                                              \
+        {                                                                                                              \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                                       \
+            test_failures++;                                                                                           \
+        }                                                                                                              \
+    } while (0)
+
+static void test_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void test_put32(uint8_t *p, uint32_t v)
+{
+    test_put16(p, v & 0xFFFF);
+    test_put16(&p[2], v >> 16);
+}
+
+// Whole device FAT32 volume without a partition table, the root directory takes cluster 2
+static bool test_format(const char *path)
+{
+    uint32_t fatSize = 1;
+    for (;;)
+    {
+        uint32_t clusters = test_imageBlocks - test_reserved - test_fatCount * fatSize;
+        uint32_t needed = ((clusters + 2) * 4 + BLOCKDEVICE_BLOCK_SIZE - 1) / BLOCKDEVICE_BLOCK_SIZE;
+        if (needed <= fatSize)
+            break;
+        fatSize = needed;
+    }
+    uint8_t *image = (uint8_t *)calloc(test_imageBlocks, BLOCKDEVICE_BLOCK_SIZE);
+    if (!image)
+        return false;
+
+    uint8_t *boot = image;
+    boot[0] = 0xEB;
+    boot[1] = 0x58;
+    boot[2] = 0x90;
+    memcpy(&boot[3], "HOTBERRY", 8);
+    test_put16(&boot[11], BLOCKDEVICE_BLOCK_SIZE);
+    boot[13] = 1; // Blocks per cluster
+    test_put16(&boot[14], test_reserved);
+    boot[16] = test_fatCount;
+    boot[21] = 0xF8;
+    test_put32(&boot[32], test_imageBlocks);
+    test_put32(&boot[36], fatSize);
+    test_put32(&boot[44], 2); // Root cluster
+    test_put16(&boot[48], 1); // FSInfo
+    boot[510] = 0x55;
+    boot[511] = 0xAA;
+
+    uint8_t *fsInfo = &image[BLOCKDEVICE_BLOCK_SIZE];
+    test_put32(fsInfo, 0x41615252);
+    test_put32(&fsInfo[484], 0x61417272);
+    test_put32(&fsInfo[488], 0xFFFFFFFF);
+    test_put32(&fsInfo[492], 0xFFFFFFFF);
+    test_put32(&fsInfo[508], 0xAA550000);
+
+    for (uint8_t f = 0; f < test_fatCount; f++)
+    {
+        uint8_t *fat = &image[(test_reserved + f * fatSize) * BLOCKDEVICE_BLOCK_SIZE];
+        test_put32(fat, 0x0FFFFFF8);
+        test_put32(&fat[4], 0x0FFFFFFF);
+        test_put32(&fat[8], 0x0FFFFFFF); // End of the root directory chain
+    }
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file && fwrite(image, BLOCKDEVICE_BLOCK_SIZE, test_imageBlocks, file) == test_imageBlocks;
+    if (file)
+        ok = fclose(file) == 0 && ok;
+    free(image);
+    return ok;
+}
+
+static uint8_t test_pattern(uint32_t i) { return (i * 7 + i / 251) & 0xFF; }
+
+// Reads the whole file and compares it to the pattern from offset 0
+static bool test_readBack(Fat32 *volume, const char *name, uint32_t size)
+{
+    Fat32File file;
+    if (!volume->open(&file, name, FAT32_READ) || file.size != size)
+        return false;
+    bool same = true;
+    uint8_t buf[333]; // Not a divisor of the block size, so the reads straddle blocks and clusters
+    uint32_t done = 0;
+    while (uint32_t n = volume->read(&file, buf, sizeof(buf)))
+    {
+        for (uint32_t i = 0; i < n; i++)
+            same = same && buf[i] == test_pattern(done + i);
+        done += n;
+    }
+    return volume->close(&file) && same && done == size;
+}
+
+static bool test_writePattern(Fat32 *volume, const char *name, Fat32Mode mode, uint32_t from, uint32_t len)
+{
+    Fat32File file;
+    if (!volume->open(&file, name, mode) || file.position != from)
+        return false;
+    uint8_t buf[700];
+    uint32_t done = 0;
+    while (done < len)
+    {
+        uint32_t chunk = len - done < sizeof(buf) ? len - done : sizeof(buf);
+        for (uint32_t i = 0; i < chunk; i++)
+            buf[i] = test_pattern(from + done + i);
+        if (volume->write(&file, buf, chunk) != chunk)
+            return false;
+        done += chunk;
+    }
+    return volume->close(&file);
+}
+
+// Size of a file as listed by readDir(), -1 if it's not listed
+static long test_listedSize(Fat32 *volume, const char *name)
+{
+    uint32_t position = 0;
+    Fat32Entry entry;
+    while (volume->readDir(&position, &entry))
+        if (strcmp(entry.name, name) == 0)
+            return entry.size;
+    return -1;
+}
+
+// Date of the directory entry of a file, straight from the image, -1 if the entry is not found
+static long test_entryDate(const char *path, const char *shortName)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return -1;
+    uint8_t entry[32];
+    long date = -1;
+    while (date < 0 && fread(entry, sizeof(entry), 1, file) == 1)
+        if (memcmp(entry, shortName, 11) == 0)
+            date = entry[16] | entry[17] << 8;
+    fclose(file);
+    return date;
+}
+
+int main(int argc, char **argv)
+{
+    bool format = !(argc == 3 && strcmp(argv[1], "-o") == 0);
+    if (argc != (format ? 2 : 3))
+    {
+        printf("Usage: %s image.img    format the image and test it\n"
+               "       %s -o image.img existing FAT32 image\n",
+               argv[0], argv[0]);
+        return 2;
+    }
+    const char *path = argv[argc - 1];
+    if (format && !test_format(path))
+    {
+        printf("Can't format %s\n", path);
+        return 1;
+    }
+
+    FileBlockDevice device;
+    Fat32 volume;
+    if (!device.open(path) || !volume.mount(&device))
+    {
+        printf("Can't mount %s\n", path);
+        return 1;
+    }
+
+    // Create, append across cluster boundaries and read back
+    TEST_CHECK(test_writePattern(&volume, "RUN.CSV", FAT32_WRITE, 0, 3000));
+    TEST_CHECK(test_writePattern(&volume, "run.csv", FAT32_APPEND, 3000, 1000));
+    TEST_CHECK(test_listedSize(&volume, "RUN.CSV") == 4000);
+    TEST_CHECK(test_readBack(&volume, "RUN.CSV", 4000));
+
+    // Enough files for the root directory to grow past its first cluster
+    char name[13];
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        sprintf(name, "F%u.BIN", (unsigned)i);
+        TEST_CHECK(test_writePattern(&volume, name, FAT32_WRITE, 0, i * 97));
+    }
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        sprintf(name, "F%u.BIN", (unsigned)i);
+        TEST_CHECK(test_listedSize(&volume, name) == (long)(i * 97));
+    }
+
+    // Lookups that have to fail
+    Fat32File file;
+    TEST_CHECK(!volume.open(&file, "MISSING.TXT", FAT32_READ));
+    TEST_CHECK(!volume.open(&file, "TOOLONGNAME.TXT", FAT32_WRITE));
+    TEST_CHECK(!volume.open(&file, "A.B.C", FAT32_WRITE));
+
+    // Truncate, the freed clusters are taken again by the next file
+    TEST_CHECK(test_writePattern(&volume, "F39.BIN", FAT32_WRITE, 0, 10));
+    TEST_CHECK(test_writePattern(&volume, "BIG.BIN", FAT32_WRITE, 0, 20000));
+    TEST_CHECK(test_readBack(&volume, "F39.BIN", 10));
+
+    // New entries are undated until a date is set
+    volume.setDate(2026, 10, 19);
+    TEST_CHECK(test_writePattern(&volume, "DATED.TXT", FAT32_WRITE, 0, 1));
+    TEST_CHECK(volume.sync());
+
+    // Everything is still there once mounted again from the image
+    FileBlockDevice again;
+    Fat32 remounted;
+    TEST_CHECK(again.open(path) && remounted.mount(&again));
+    TEST_CHECK(test_readBack(&remounted, "RUN.CSV", 4000));
+    TEST_CHECK(test_readBack(&remounted, "F38.BIN", 38 * 97));
+    TEST_CHECK(test_readBack(&remounted, "BIG.BIN", 20000));
+    TEST_CHECK(test_listedSize(&remounted, "F39.BIN") == 10);
+    TEST_CHECK(test_entryDate(path, "RUN     CSV") == 0);
+    TEST_CHECK(test_entryDate(path, "DATED   TXT") == ((2026 - 1980) << 9 | 10 << 5 | 19));
+
+    if (test_failures)
+        printf("%d checks failed\n", test_failures);
+    else
+        printf("All checks passed\n");
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file SpscRing.h
+ * @brief Header-only lock-free single-producer/single-consumer ring buffer, safe across both RP2040 cores
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * head is only written by the producer and tail only by the consumer. Both are free running, so the ring is full
+ * when head - tail == N and no slot has to be sacrificed. The data memory barrier orders the record copy against
+ * the index update, so the other core never sees an index before the record it covers.
+ */
+#ifndef _SPSCRING_H_
+#include "hardware/sync.h"
+#include <stddef.h>
+#include <stdint.h>
+#define _SPSCRING_H_
+
+template <typename T, size_t N> class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of 2");
+
+public:
+    // Producer side, returns false and drops the record if the ring is full
+    bool push(const T &item)
+    {
+        uint32_t h = head;
+        if (h - tail == N)
+        {
+            dropped++;
+            return false;
+        }
+        buffer[h % N] = item;
+        __dmb(); // The record has to be visible before the new head
+        head = h + 1;
+        return true;
+    }
+
+    // Consumer side, returns false if the ring is empty
+    bool pop(T *item)
+    {
+        uint32_t t = tail;
+        if (t == head)
+            return false;
+        __dmb(); // Don't read the record before the head that published it
+        *item = buffer[t % N];
+        __dmb(); // The record has to be read before the slot is handed back
+        tail = t + 1;
+        return true;
+    }
+
+    // Consumer side, the oldest record stays in the ring until pop(), returns NULL if the ring is empty
+    const T *peek()
+    {
+        uint32_t t = tail;
+        if (t == head)
+            return NULL;
+        __dmb(); // Don't read the record before the head that published it
+        return &buffer[t % N];
+    }
+
+    // Approximate from either side, exact from the consumer
+    __force_inline size_t size() const { return head - tail; }
+    __force_inline bool empty() const { return head == tail; }
+    // Records dropped because the consumer was too slow, only written by the producer
+    __force_inline uint32_t getDropped() const { return dropped; }
+
+protected:
+    volatile uint32_t head = 0;
+    volatile uint32_t tail = 0;
+    volatile uint32_t dropped = 0;
+    T buffer[N];
+};
+#endif
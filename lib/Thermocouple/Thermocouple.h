@@ -0,0 +1,119 @@
+/**
+ * @file Thermocouple.h
+ * @brief Compile-time interface shared by the thermocouple converters (MAX6675, MAX31855, MAX31856)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each converter derives from Thermocouple<Chip> (CRTP) and provides:
+ *   static constexpr uint32_t conversionTime; // in uS, time between two readouts
+ *   static constexpr float resolution;        // in celcius
+ *   void init();
+ *   ThermocoupleStatus convert(float *celcius);
+ * so poll() calls straight into the chip without any virtual call.
+ */
+#ifndef _THERMOCOUPLE_H_
+#include "pico/stdlib.h"
+#include <stdio.h>
+#define _THERMOCOUPLE_H_
+
+#define THERMOCOUPLE_NO_PIN 0xFF // For converters that don't use SDI
+
+// Status of a readout, anything but THERMOCOUPLE_VALID must not be used as a temperature
+enum ThermocoupleStatus : uint8_t
+{
+    THERMOCOUPLE_VALID,
+    THERMOCOUPLE_OPEN,      // Thermocouple input is open
+    THERMOCOUPLE_SHORT,     // Thermocouple shorted to GND or VCC, or out of range
+    THERMOCOUPLE_NOT_READY, // Read before the conversion was done, or the frame doesn't look like a valid frame
+    THERMOCOUPLE_STALE      // No valid readout for too long, set by whoever holds the last good value
+};
+
+struct ThermocoupleSample
+{
+    float celcius;             // Cold junction compensated temperature, only meaningful when THERMOCOUPLE_VALID
+    ThermocoupleStatus status;
+    uint8_t zone;              // Set by the owner of the converter
+    uint64_t timestamp;        // time_us_64() when the readout started
+};
+
+template <typename Chip> class Thermocouple
+{
+public:
+    Thermocouple(uint8_t _sdo, uint8_t _sck, uint8_t _cs, uint8_t _sdi = THERMOCOUPLE_NO_PIN)
+        : sdo(_sdo), sck(_sck), cs(_cs), sdi(_sdi), lastPoll(0)
+    {
+    }
+
+    /**
+     * @brief Read the chip once its next conversion is due, never blocks longer than one SPI frame
+     *
+     * @param sample Filled with the temperature, status and timestamp, zone is left untouched
+     * @return true if a new readout was taken
+     */
+    bool poll(ThermocoupleSample *sample)
+    {
+        uint64_t now = time_us_64();
+        if (lastPoll && now - lastPoll < Chip::conversionTime)
+            return false;
+        sample->timestamp = now;
+        sample->status = static_cast<Chip *>(this)->convert(&sample->celcius);
+        // Counted from the end of the frame, so the chip had a full conversion time on the next poll
+        lastPoll = time_us_64();
+        return true;
+    }
+
+protected:
+    // Bit-banged SPI helpers for the converters without a PIO reader, SCK idles low
+    void initPins()
+    {
+        gpio_init(sdo);
+        gpio_init(sck);
+        gpio_init(cs);
+        gpio_set_dir(sdo, GPIO_IN);
+        gpio_set_dir(sck, GPIO_OUT);
+        gpio_set_dir(cs, GPIO_OUT);
+        gpio_put(cs, 1);
+        gpio_put(sck, 0);
+        if (sdi != THERMOCOUPLE_NO_PIN)
+        {
+            gpio_init(sdi);
+            gpio_set_dir(sdi, GPIO_OUT);
+            gpio_put(sdi, 0);
+        }
+    }
+
+    /**
+     * @brief Shift bits in and out MSB first, CS has to be asserted by the caller. SCK runs at about 500kHz, well
+     * under the limit of every supported chip. The chip shifts SDO out on the rising edge and reads SDI on the
+     * falling edge (SPI mode 1), for the read-only chips the first bit is already on SDO when CS falls
+     *
+     * @param bits Up to 32
+     * @param out Bits sent on SDI, ignored without SDI
+     * @param leading true when SDO is valid before the first rising edge (MAX6675, MAX31855)
+     */
+    uint32_t transfer(uint8_t bits, uint32_t out, bool leading)
+    {
+        uint32_t in = 0;
+        busy_wait_us_32(1); // CS fall to SCK rise
+        while (bits--)
+        {
+            if (sdi != THERMOCOUPLE_NO_PIN)
+                gpio_put(sdi, (out >> bits) & 1);
+            if (leading)
+                in |= (uint32_t)gpio_get(sdo) << bits;
+            gpio_put(sck, 1);
+            busy_wait_us_32(1);
+            if (!leading)
+                in |= (uint32_t)gpio_get(sdo) << bits;
+            gpio_put(sck, 0);
+            busy_wait_us_32(1);
+        }
+        return in;
+    }
+
+    uint8_t sdo, sck, cs, sdi;
+    uint64_t lastPoll;
+};
+#endif
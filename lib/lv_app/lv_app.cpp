@@ -1,15 +1,65 @@
 #include "lv_app.h"
 #include "keyboard.h"
+#include <math.h>
 #ifdef PICO_BOARD
 AT24C16 EEPROM;
+AT24C16Writer EEPROMWriter(&EEPROM, EEPROM_I2CBUS, EEPROM_SDA, EEPROM_SCL, EEPROM_BusSpeed);
+// The profile directory and the gain schedules go to the large slots, everything else to the small ones. Slots are
+// whole pages so a slot write never shares a page write cycle with its neighbours
+static constexpr AT24C16StoreGroup app_storeGroups[] = {
+    {0, 80, 5},    // 3 records and 2 free slots
+    {400, 48, 17}, // 15 records and 2 free slots
+};
+static_assert(AT24C16Store_isPageAligned(app_storeGroups, 2), "Slots have to be whole EEPROM pages");
+static constexpr uint8_t app_recordGroup[APP_RECORD_COUNT] = {
+    0,                            // Profile directory
+    0, 0,                         // Gain schedules
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Learning tables
+    1, 1, 1, 1, 1,                // PIDs, decoupler and Smith predictors
+};
+// Encoded profiles take the rest of the EEPROM
+static constexpr uint16_t app_profileHeapBase = 400 + 48 * 17;
+static_assert(app_profileHeapBase % AT24C16_PageSize == 0, "Profile heap has to start on a page");
+static_assert(profile_count + AT24C16STORE_HEADER_SIZE <= 80 &&
+                  GAIN_SCHEDULE_PACKED_SIZE + AT24C16STORE_HEADER_SIZE <= 80,
+              "Record doesn't fit the large slots");
+static_assert(LEARNING_TABLE_PACKED_SIZE + AT24C16STORE_HEADER_SIZE <= 48 &&
+                  sizeof(double[4]) + AT24C16STORE_HEADER_SIZE <= 48,
+              "Record doesn't fit the small slots");
+static_assert((AT24C16_Size - app_profileHeapBase) / PROFILE_STORE_UNIT < PROFILE_STORE_EMPTY,
+              "Profile heap is too large for the directory");
+AT24C16Store EEPROMStore(&EEPROM, &EEPROMWriter, app_storeGroups, 2, app_recordGroup, APP_RECORD_COUNT,
+                         EEPROM_SchemaVersion);
+ProfileStore EEPROMProfiles(&EEPROMStore, APP_RECORD_PROFILE_DIRECTORY, app_profileHeapBase,
+                            AT24C16_Size - app_profileHeapBase);
+FlashLockout flashLockout;
+FlashKV FlashSettings(&flashLockout, FLASH_SettingsOffset, FLASH_SettingsSize);
+SDCard sdCard(spi0, SD_SCK, SD_TX, SD_RX, SD_CS);
+Fat32 sdVolume;
+SDLogger sdLogger(&sdCard, &sdVolume);
+HostLink hostLink;
+static constexpr TickType_t app_sdLockTimeout = 500 / portTICK_PERIOD_MS; // The logger holds it for a buffer write
+static const char *app_export_profiles();
+static const char *app_import_profiles();
+static bool app_replace_profile(uint16_t index, const Profile *profile);
+static void app_host_requests();
+static void app_storage_done(uint16_t address, uint16_t pagesWritten, bool ok);
+static void app_mirror_done(uint16_t address, uint16_t pagesWritten, bool ok);
+static void app_flash_done(uint16_t key, bool ok);
+static bool app_flash_put(uint16_t key, const void *src, size_t len);
+static size_t app_flash_get(uint16_t key, void *dest, size_t maxLen);
+static bool app_save_record(uint8_t id, const void *src, size_t len);
+static volatile bool storageFailed = false; // Set by the completion callbacks of the EEPROM and flash writes
+static volatile bool app_flashFailed = false; // Set by app_flash_done() once a flash write failed
+static volatile bool app_mirrorFailed = false; // Set once an EEPROM copy of a value the flash took was lost
+static HealthReport app_healthReport;         // Read for the host and the diagnostics, too big for a timer stack
 SemaphoreHandle_t lv_app_mutex;
 #endif
 
 static constexpr uint32_t animTime = 500;
 static constexpr uint32_t animTranslationY = 150;
 static constexpr uint32_t manual_max_run_seconds = 300;
-static constexpr const char *profile_roller_list = "Profile 0\nProfile 1\nProfile 2\nProfile 3\nProfile 4\nProfile "
-                                                   "5\nProfile 6\nProfile 7\nProfile 8\nProfile 9";
+static char profile_roller_list[profile_count * sizeof("Profile 00\n")]; // Filled by lv_app_entry()
 
 namespace lv_app_pointers
 {
@@ -28,7 +78,15 @@ bool *pStartedManual;
 double (*pTopHeaterPID)[4];
 uint16_t *pSelectedProfile;
 double (*pBottomHeaterPID)[4];
-Profile (*pProfileLists)[10];
+GainSchedule *pTopHeaterSchedule;
+GainSchedule *pBottomHeaterSchedule;
+Decoupler *pDecoupler;
+CouplingStepTest *pCouplingTest;
+SmithPredictor *pTopHeaterPredictor;
+SmithPredictor *pBottomHeaterPredictor;
+LearningTable (*pProfileLearning)[profile_learningCount];
+int16_t *pLearnedProfile;
+Profile *pActiveProfile;
 } // namespace lv_app_pointers
 using namespace lv_app_pointers;
 
@@ -111,14 +169,12 @@ lv_obj_t *app_create_chart(lv_obj_t *_parent, bool _profileGraph, uint8_t _selec
     if (profileGraph)
     {
         selectedProfile = _selectedProfile;
-        LV_APP_MUTEX_ENTER;
-        dataPoint = (*pProfileLists)[selectedProfile].dataPoint;
-        memcpy(targetTemperatures, (*pProfileLists)[selectedProfile].targetTemperature,
-               sizeof((*pProfileLists)[selectedProfile].targetTemperature));
-        memcpy(targetSeconds, (*pProfileLists)[selectedProfile].targetSecond,
-               sizeof((*pProfileLists)[selectedProfile].targetSecond));
-        startTopHeaterAt = (*pProfileLists)[selectedProfile].startTopHeaterAt;
-        LV_APP_MUTEX_EXIT;
+        Profile profile;
+        app_load_profile(selectedProfile, &profile);
+        dataPoint = profile.dataPoint;
+        memcpy(targetTemperatures, profile.targetTemperature, sizeof(profile.targetTemperature));
+        memcpy(targetSeconds, profile.targetSecond, sizeof(profile.targetSecond));
+        startTopHeaterAt = profile.startTopHeaterAt;
         coord_counter = 0;
         if (coords == NULL && dataPoint)
             coords = (lv_point_t *)malloc(sizeof(lv_point_t) * (dataPoint));
@@ -188,12 +244,12 @@ lv_obj_t *app_create_chart(lv_obj_t *_parent, bool _profileGraph, uint8_t _selec
         profileSeries = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
         cursor = lv_chart_add_cursor(chart, md_grad_red, LV_DIR_LEFT | LV_DIR_BOTTOM);
         // Add data points from profile
-        printf("totalSecond %d\n", totalSecond);
+        LOG_DEBUG("totalSecond %d\n", totalSecond);
         for (int i = 0; i < dataPoint; i++)
         {
             lv_chart_set_value_by_id(chart, profileSeries, targetSeconds[i], targetTemperatures[i]);
-            printf("lvc %d sec %d deg\n", targetSeconds[i],
-                   lv_chart_get_y_array(chart, profileSeries)[targetSeconds[i]]);
+            LOG_DEBUG("lvc %d sec %d deg\n", targetSeconds[i],
+                      lv_chart_get_y_array(chart, profileSeries)[targetSeconds[i]]);
         } // Draw profile graph
         lv_obj_add_event_cb(
             chart,
@@ -206,7 +262,7 @@ lv_obj_t *app_create_chart(lv_obj_t *_parent, bool _profileGraph, uint8_t _selec
                     dsc->draw_area->x2 < 480 && dsc->draw_area->y1 > 0 &&
                     dsc->draw_area->y2 < 320) // Store coordinate only on valid points
                 {
-                    printf("cnt %d x %d y %d\n", coord_counter, coords[coord_counter].x, coords[coord_counter].y);
+                    LOG_DEBUG("cnt %d x %d y %d\n", coord_counter, coords[coord_counter].x, coords[coord_counter].y);
                     coords[coord_counter].x = dsc->draw_area->x1;
                     coords[coord_counter].y = dsc->draw_area->y1;
                     // It seems that this is last coordinate, let's draw the profile graph then
@@ -238,7 +294,7 @@ lv_obj_t *app_create_chart(lv_obj_t *_parent, bool _profileGraph, uint8_t _selec
                 lv_event_code_t code = lv_event_get_code(e);
                 lv_obj_t *obj = lv_event_get_target(e);
                 LV_APP_MUTEX_ENTER;
-                Profile selectedProfileList = (*pProfileLists)[*pSelectedProfile];
+                Profile selectedProfileList = *pActiveProfile;
                 LV_APP_MUTEX_EXIT;
                 if (code == LV_EVENT_VALUE_CHANGED)
                 {
@@ -333,6 +389,565 @@ lv_obj_t *app_create_chart(lv_obj_t *_parent, bool _profileGraph, uint8_t _selec
     return chart;
 }
 
+#ifndef PICO_BOARD
+static Profile app_simulatorProfiles[profile_count]; // There's no EEPROM to decode from on the simulator
+#endif
+
+/**
+ * @brief Decode a profile from storage, profiles are only decoded when they're needed
+ *
+ * @param index
+ * @param profile Left with the default profile if it was never saved
+ * @return false if the profile was never saved
+ */
+bool app_load_profile(uint16_t index, Profile *profile)
+{
+    *profile = Profile();
+#ifdef PICO_BOARD
+    uint8_t encoded[PROFILE_ENCODED_MAX];
+    size_t len = app_flash_get(APP_KEY_PROFILE + index, encoded, sizeof(encoded));
+    if (len && profile_decode(profile, encoded, len))
+        return true;
+    return EEPROMProfiles.load(index, profile);
+#else
+    *profile = app_simulatorProfiles[index];
+    return true;
+#endif
+}
+
+/**
+ * @brief Encode a profile to storage
+ *
+ * @param index
+ * @param profile
+ * @return false if there's no room left for the profile
+ */
+bool app_save_profile(uint16_t index, const Profile *profile)
+{
+#ifdef PICO_BOARD
+    uint8_t encoded[PROFILE_ENCODED_MAX];
+    uint8_t len = profile_encode(profile, encoded);
+    bool saved = len && app_flash_put(APP_KEY_PROFILE + index, encoded, len);
+    // The EEPROM mirror may run out of space before the flash, that's only an error if the flash failed too
+    bool mirrored = EEPROMProfiles.save(index, profile, saved ? app_mirror_done : app_storage_done);
+    if (saved && !mirrored)
+        app_mirrorFailed = true;
+    return mirrored || saved;
+#else
+    app_simulatorProfiles[index] = *profile;
+    return true;
+#endif
+}
+
+/**
+ * @brief Select a profile and decode it for the main application
+ *
+ * @param index
+ */
+void app_select_profile(uint16_t index)
+{
+    Profile profile;
+    app_load_profile(index, &profile);
+    LV_APP_MUTEX_ENTER;
+    *pSelectedProfile = index;
+    *pActiveProfile = profile;
+    LV_APP_MUTEX_EXIT;
+}
+
+/**
+ * @brief Save the learning table of a profile slot to EEPROM
+ *
+ * @param profile Profile slot of the table
+ */
+void app_save_learning(uint16_t profile)
+{
+#ifdef PICO_BOARD
+    if (profile >= profile_learningCount)
+        return;
+    uint8_t learningBuffer[LEARNING_TABLE_PACKED_SIZE];
+    LV_APP_MUTEX_ENTER;
+    LearningTable_Pack(&(*pProfileLearning)[profile], learningBuffer);
+    LV_APP_MUTEX_EXIT;
+    if (!app_save_record(APP_RECORD_LEARNING + profile, learningBuffer, sizeof(learningBuffer)))
+        storageFailed = true;
+#endif
+}
+
+#ifdef PICO_BOARD
+// Flash values start with EEPROM_SchemaVersion, so a layout change drops the flash copies like the EEPROM ones. The
+// value is only queued, the flash task writes it
+static bool app_flash_put(uint16_t key, const void *src, size_t len)
+{
+    uint8_t value[FLASHKV_MAX_VALUE];
+    if (len + 1 > sizeof(value))
+        return false;
+    value[0] = EEPROM_SchemaVersion;
+    memcpy(&value[1], src, len);
+    return FlashSettings.put(key, value, len + 1, app_flash_done);
+}
+
+// Returns the length copied to dest, 0 if there's no flash copy of the current schema
+static size_t app_flash_get(uint16_t key, void *dest, size_t maxLen)
+{
+    uint8_t value[FLASHKV_MAX_VALUE];
+    uint16_t len = FlashSettings.get(key, value, sizeof(value));
+    if (len < 2 || value[0] != EEPROM_SchemaVersion || (size_t)(len - 1) > maxLen)
+        return 0;
+    memcpy(dest, &value[1], len - 1);
+    return len - 1;
+}
+
+/**
+ * @brief Save a record to the flash and mirror it to the EEPROM, the EEPROM failure is only reported when the flash
+ * failed too
+ *
+ * @param id
+ * @param src
+ * @param len
+ * @return false if neither the flash nor the EEPROM writer took the record, like app_save_profile()
+ */
+static bool app_save_record(uint8_t id, const void *src, size_t len)
+{
+    bool saved = app_flash_put(id, src, len);
+    if (!saved)
+        LOG_WARN("Flash record %u not queued, the EEPROM copy is used\n", id);
+    bool mirrored = EEPROMStore.save(id, src, len, saved ? app_mirror_done : app_storage_done);
+    if (saved && !mirrored)
+        app_mirrorFailed = true;
+    return mirrored || saved;
+}
+
+// Load a record from the flash, or from the EEPROM mirror if the flash has none
+static bool app_load_record(uint8_t id, void *dest, size_t len)
+{
+    return app_flash_get(id, dest, len) == len || EEPROMStore.load(id, dest, len);
+}
+
+/**
+ * @brief Completion callback of every EEPROM write, runs on the writer task so the failure is only flagged here
+ * and shown by the lv_app timer
+ *
+ */
+static void app_storage_done(uint16_t address, uint16_t pagesWritten, bool ok)
+{
+    LOG_INFO("EEPROM 0x%03x saved, %u pages written%s\n", address, pagesWritten, ok ? "" : " (failed)");
+    if (!ok)
+        storageFailed = true;
+}
+
+// Completion callback of the EEPROM copy of a value the flash took, its failure only matters once the flash failed,
+// which app_flash_done() may only learn after this ran
+static void app_mirror_done(uint16_t address, uint16_t pagesWritten, bool ok)
+{
+    if (ok)
+        return;
+    app_mirrorFailed = true;
+    if (app_flashFailed)
+        app_storage_done(address, pagesWritten, ok);
+}
+
+// Completion callback of every flash write, runs on the flash task
+static void app_flash_done(uint16_t key, bool ok)
+{
+    if (ok)
+        return;
+    LOG_WARN("Flash key %u not saved, the EEPROM copy is used\n", key);
+    app_flashFailed = true;
+    if (!EEPROMStore.isDetected() || app_mirrorFailed)
+        storageFailed = true;
+}
+
+/**
+ * @brief Write every profile to SD_ProfilesFile on the SD card, one line per profile:
+ *   profile,startTopHeaterAt,second:celcius,second:celcius,...
+ *
+ * @return const char* Result to show on an alert
+ */
+static const char *app_export_profiles()
+{
+    if (!sdLogger.lock(app_sdLockTimeout))
+        return "The SD card is busy, try again later!";
+    const char *message = "Every profile was exported to PROFILES.CSV";
+    Fat32File file;
+    if (!sdLogger.mount() || !sdVolume.open(&file, SD_ProfilesFile, FAT32_WRITE))
+        message = "No SD card, or it's not formatted as FAT32!";
+    else
+    {
+        static constexpr char header[] = "# profile,startTopHeaterAt,second:celcius,...\n";
+        bool ok = sdVolume.write(&file, header, sizeof(header) - 1) == sizeof(header) - 1;
+        for (uint16_t i = 0; i < profile_count && ok; i++)
+        {
+            char line[16 + profile_maximumDataPoint * sizeof(",65535:-2147483648")];
+            Profile profile;
+            app_load_profile(i, &profile);
+            int len = sprintf(line, "%u,%u", i, profile.startTopHeaterAt);
+            for (uint8_t d = 0; d < profile.dataPoint; d++)
+                len += sprintf(&line[len], ",%u:%d", profile.targetSecond[d], profile.targetTemperature[d]);
+            line[len++] = '\n';
+            ok = sdVolume.write(&file, line, len) == (uint32_t)len;
+        }
+        if (!sdVolume.close(&file) || !ok)
+            message = "Writing to the SD card failed!";
+    }
+    sdLogger.unlock();
+    return message;
+}
+
+// Parse a line written by app_export_profiles(), false if anything is out of range
+static bool app_parse_profile(const char *line, uint16_t *index, Profile *profile)
+{
+    char *end;
+    long value = strtol(line, &end, 10);
+    if (end == line || *end != ',' || value < 0 || value >= profile_count)
+        return false;
+    *index = value;
+    line = end + 1;
+    value = strtol(line, &end, 10);
+    if (end == line || value < 0 || value > UINT16_MAX)
+        return false;
+    profile->startTopHeaterAt = value;
+    profile->dataPoint = 0;
+    while (*end == ',')
+    {
+        if (profile->dataPoint == profile_maximumDataPoint)
+            return false;
+        line = end + 1;
+        value = strtol(line, &end, 10);
+        if (end == line || *end != ':' || value < 0 || value > UINT16_MAX)
+            return false;
+        profile->targetSecond[profile->dataPoint] = value;
+        line = end + 1;
+        value = strtol(line, &end, 10);
+        if (end == line || value < INT16_MIN || value > INT16_MAX)
+            return false;
+        profile->targetTemperature[profile->dataPoint++] = value;
+    }
+    return *end == '\0' && profile->dataPoint > 0;
+}
+
+/**
+ * @brief Save a profile that comes from outside of the profile editor, the learning table of a profile whose shape
+ * changed starts over like it does on the editor and the selected profile is decoded again
+ *
+ * @param index
+ * @param profile
+ * @return false if there's no room left for the profile
+ */
+static bool app_replace_profile(uint16_t index, const Profile *profile)
+{
+    Profile saved;
+    app_load_profile(index, &saved);
+    if (!app_save_profile(index, profile))
+        return false;
+    uint8_t encoded[PROFILE_ENCODED_MAX], savedEncoded[PROFILE_ENCODED_MAX];
+    uint8_t encodedLen = profile_encode(profile, encoded);
+    bool reshaped = profile_encode(&saved, savedEncoded) != encodedLen || memcmp(encoded, savedEncoded, encodedLen);
+    LV_APP_MUTEX_ENTER;
+    if (*pSelectedProfile == index)
+        *pActiveProfile = *profile;
+    if (reshaped && index < profile_learningCount)
+        LearningTable_Reset(&(*pProfileLearning)[index]);
+    LV_APP_MUTEX_EXIT;
+    if (reshaped)
+        app_save_learning(index);
+    return true;
+}
+
+/**
+ * @brief Save every valid line of SD_ProfilesFile to its profile slot
+ *
+ * @return const char* Result to show on an alert
+ */
+static const char *app_import_profiles()
+{
+    static char message[64];
+    if (!sdLogger.lock(app_sdLockTimeout))
+        return "The SD card is busy, try again later!";
+    Fat32File file;
+    if (!sdLogger.mount() || !sdVolume.open(&file, SD_ProfilesFile, FAT32_READ))
+    {
+        sdLogger.unlock();
+        return "There's no PROFILES.CSV on the SD card!";
+    }
+
+    uint16_t imported = 0, skipped = 0;
+    char line[16 + profile_maximumDataPoint * sizeof(",65535:-32768")];
+    uint16_t len = 0;
+    bool tooLong = false;
+    uint8_t chunk[64];
+    uint32_t got;
+    do
+    {
+        got = sdVolume.read(&file, chunk, sizeof(chunk));
+        for (uint32_t i = 0; i <= got; i++)
+        {
+            // The end of the file also ends the last line
+            bool endOfFile = i == got;
+            if (endOfFile && (got == sizeof(chunk) || len == 0))
+                break;
+            char c = endOfFile ? '\n' : chunk[i];
+            if (c == '\r')
+                continue;
+            if (c != '\n')
+            {
+                if (len + 1 < sizeof(line))
+                    line[len++] = c;
+                else
+                    tooLong = true;
+                continue;
+            }
+            line[len] = '\0';
+            bool comment = len == 0 || line[0] == '#';
+            bool truncated = tooLong;
+            len = 0;
+            tooLong = false;
+            if (comment)
+                continue;
+
+            uint16_t index;
+            Profile profile;
+            if (!truncated && app_parse_profile(line, &index, &profile) && app_replace_profile(index, &profile))
+                imported++;
+            else
+                skipped++;
+        }
+    } while (got == sizeof(chunk));
+    sdVolume.close(&file);
+    sdLogger.unlock();
+    sprintf(message, "%u profiles imported, %u lines skipped", imported, skipped);
+    return message;
+}
+
+/**
+ * @brief Answer the requests of the host tools, runs on lv_app so the profiles and the tuning are only ever saved
+ * from here. Changes to something that is open on the screen are refused, leaving the screen would overwrite them.
+ *
+ */
+static void app_host_requests()
+{
+    static_assert(HOSTLINK_TUNING_MAX_BREAKPOINT == GAIN_SCHEDULE_MAX_BREAKPOINT, "Host link schedule size differs");
+    HostLinkRequest request;
+    while (hostLink.takeRequest(&request))
+    {
+        const uint8_t *payload = request.payload;
+        switch (request.type)
+        {
+        case HOSTLINK_GET_PROFILE:
+        {
+            if (request.len != 1 || payload[0] >= profile_count)
+            {
+                hostLink.ack(&request, HOSTLINK_INVALID);
+                break;
+            }
+            uint8_t answer[1 + PROFILE_ENCODED_MAX];
+            Profile profile;
+            app_load_profile(payload[0], &profile);
+            answer[0] = payload[0];
+            hostLink.reply(&request, HOSTLINK_PROFILE, answer, 1 + profile_encode(&profile, &answer[1]));
+            break;
+        }
+        case HOSTLINK_SET_PROFILE:
+        {
+            Profile profile;
+            if (request.len < 2 || payload[0] >= profile_count ||
+                profile_decode(&profile, &payload[1], request.len - 1) != request.len - 1)
+                hostLink.ack(&request, HOSTLINK_INVALID);
+            else if (lv_scr_act() == scr_profiles)
+                hostLink.ack(&request, HOSTLINK_BUSY);
+            else
+                hostLink.ack(&request, app_replace_profile(payload[0], &profile) ? HOSTLINK_OK : HOSTLINK_STORAGE);
+            break;
+        }
+        case HOSTLINK_SELECT_PROFILE:
+        {
+            LV_APP_MUTEX_ENTER;
+            bool started = *pStartedAuto;
+            LV_APP_MUTEX_EXIT;
+            if (request.len != 1 || payload[0] >= profile_count)
+                hostLink.ack(&request, HOSTLINK_INVALID);
+            else if (started) // Like the profile button of the auto operation screen
+                hostLink.ack(&request, HOSTLINK_REFUSED);
+            else
+            {
+                LV_APP_MUTEX_ENTER;
+                *pSelectedProfile = payload[0];
+                LV_APP_MUTEX_EXIT;
+                // The auto operation screen decodes the profile again and redraws its chart on refresh
+                if (lv_scr_act() == scr_auto)
+                    lv_event_send(AppAutoVar::profile_btn, LV_EVENT_REFRESH, NULL);
+                else
+                    app_select_profile(payload[0]);
+                hostLink.ack(&request, HOSTLINK_OK);
+            }
+            break;
+        }
+        case HOSTLINK_GET_TUNING:
+        {
+            if (request.len != 1 || payload[0] > 1)
+            {
+                hostLink.ack(&request, HOSTLINK_INVALID);
+                break;
+            }
+            HostLinkTuning tuning = {};
+            tuning.zone = payload[0];
+            LV_APP_MUTEX_ENTER;
+            const double *pid = tuning.zone ? *pTopHeaterPID : *pBottomHeaterPID;
+            GainSchedule schedule = tuning.zone ? *pTopHeaterSchedule : *pBottomHeaterSchedule;
+            tuning.kp = pid[0];
+            tuning.ki = pid[1];
+            tuning.kd = pid[2];
+            tuning.tau = pid[3];
+            LV_APP_MUTEX_EXIT;
+            tuning.breakpointCount = schedule.count;
+            for (uint8_t i = 0; i < schedule.count; i++)
+            {
+                tuning.breakpoints[i].temperature = schedule.breakpoints[i].temperature;
+                tuning.breakpoints[i].kp = schedule.breakpoints[i].Kp;
+                tuning.breakpoints[i].ki = schedule.breakpoints[i].Ki;
+                tuning.breakpoints[i].kd = schedule.breakpoints[i].Kd;
+            }
+            hostLink.reply(&request, HOSTLINK_TUNING, &tuning, sizeof(tuning));
+            break;
+        }
+        case HOSTLINK_SET_TUNING:
+        {
+            HostLinkTuning tuning;
+            memcpy(&tuning, payload, sizeof(tuning));
+            bool valid = request.len == sizeof(tuning) && tuning.zone <= 1 &&
+                         tuning.breakpointCount <= GAIN_SCHEDULE_MAX_BREAKPOINT && isfinite(tuning.kp) &&
+                         isfinite(tuning.ki) && isfinite(tuning.kd) && isfinite(tuning.tau);
+            GainSchedule schedule;
+            GainSchedule_Init(&schedule);
+            schedule.count = valid ? tuning.breakpointCount : 0;
+            for (uint8_t i = 0; i < schedule.count; i++)
+            {
+                schedule.breakpoints[i].temperature = tuning.breakpoints[i].temperature;
+                schedule.breakpoints[i].Kp = tuning.breakpoints[i].kp;
+                schedule.breakpoints[i].Ki = tuning.breakpoints[i].ki;
+                schedule.breakpoints[i].Kd = tuning.breakpoints[i].kd;
+                valid = valid && isfinite(tuning.breakpoints[i].kp) && isfinite(tuning.breakpoints[i].ki) &&
+                        isfinite(tuning.breakpoints[i].kd);
+            }
+            if (!valid)
+            {
+                hostLink.ack(&request, HOSTLINK_INVALID);
+                break;
+            }
+            if (lv_scr_act() == scr_settings)
+            {
+                hostLink.ack(&request, HOSTLINK_BUSY);
+                break;
+            }
+            GainSchedule_Sort(&schedule);
+            double pid[4] = {tuning.kp, tuning.ki, tuning.kd, tuning.tau};
+            LV_APP_MUTEX_ENTER;
+            memcpy(tuning.zone ? *pTopHeaterPID : *pBottomHeaterPID, pid, sizeof(pid));
+            *(tuning.zone ? pTopHeaterSchedule : pBottomHeaterSchedule) = schedule;
+            LV_APP_MUTEX_EXIT;
+            uint8_t scheduleBuffer[GAIN_SCHEDULE_PACKED_SIZE];
+            GainSchedule_Pack(&schedule, scheduleBuffer);
+            bool saved = app_save_record(tuning.zone ? APP_RECORD_TOP_PID : APP_RECORD_BOTTOM_PID, pid, sizeof(pid));
+            saved = app_save_record(tuning.zone ? APP_RECORD_TOP_SCHEDULE : APP_RECORD_BOTTOM_SCHEDULE,
+                                    scheduleBuffer, sizeof(scheduleBuffer)) &&
+                    saved;
+            // The tuning is in use either way, a write failing later on the EEPROM shows up on the screen like it
+            // does for the settings screen
+            hostLink.ack(&request, saved ? HOSTLINK_OK : HOSTLINK_STORAGE);
+            break;
+        }
+        case HOSTLINK_GET_RUN_PAGE:
+        {
+            static_assert(FLASHRECORDER_PAYLOAD_SIZE == HOSTLINK_RUN_PAGE_SIZE &&
+                              FLASHRECORDER_RUN == HOSTLINK_RUN_HEADER && FLASHRECORDER_RECORDS == HOSTLINK_RUN_RECORDS,
+                          "Host link run pages differ from the recorder ones");
+            static_assert(1 + sizeof(HostLinkRunPage) + HOSTLINK_RUN_CHUNK <= HOSTLINK_MAX_PAYLOAD,
+                          "Run page chunk doesn't fit a frame");
+            if (request.len != sizeof(uint32_t) + 1)
+            {
+                hostLink.ack(&request, HOSTLINK_INVALID);
+                break;
+            }
+            // A page that was overwritten or doesn't read back comes with no type, the host skips it
+            HostLinkRunPage page = {};
+            uint8_t data[FLASHRECORDER_PAYLOAD_SIZE];
+            memcpy(&page.sequence, payload, sizeof(page.sequence));
+            page.offset = payload[sizeof(page.sequence)];
+            page.oldest = runRecorder.getOldest();
+            page.next = runRecorder.getNext();
+            if (!runRecorder.read(page.sequence, &page.type, data, &page.len))
+            {
+                page.type = HOSTLINK_RUN_NONE;
+                page.len = 0;
+            }
+            page.count = page.offset < page.len ? std::min(page.len - page.offset, HOSTLINK_RUN_CHUNK) : 0;
+            uint8_t answer[sizeof(HostLinkRunPage) + HOSTLINK_RUN_CHUNK];
+            memcpy(answer, &page, sizeof(page));
+            memcpy(&answer[sizeof(page)], &data[page.offset], page.count);
+            hostLink.reply(&request, HOSTLINK_RUN_PAGE, answer, sizeof(page) + page.count);
+            break;
+        }
+        case HOSTLINK_GET_HEALTH:
+        {
+            static_assert(1 + sizeof(HostLinkHealth) + HOSTLINK_HEALTH_TASKS * sizeof(HostLinkTaskHealth) <=
+                              HOSTLINK_MAX_PAYLOAD,
+                          "Health page doesn't fit a frame");
+            if (request.len != 1)
+            {
+                hostLink.ack(&request, HOSTLINK_INVALID);
+                break;
+            }
+            // Sent even before the first window is over, the host sees the window is 0
+            if (!health.read(&app_healthReport))
+                app_healthReport.taskCount = 0;
+            lv_mem_monitor_t mem;
+            lv_mem_monitor(&mem);
+            const HealthReport *report = &app_healthReport;
+            HostLinkHealth summary = {};
+            summary.uptime = report->uptime;
+            summary.window = report->window;
+            for (uint8_t core = 0; core < 2; core++)
+            {
+                summary.coreLoad[core] = report->coreLoad[core];
+                summary.isrLoad[core] = report->isrLoad[core];
+            }
+            summary.heapFree = report->heapFree;
+            summary.heapMinimum = report->heapMinimum;
+            summary.lvglSize = mem.total_size;
+            summary.lvglFree = mem.free_size;
+            summary.lvglBiggest = mem.free_biggest_size;
+            summary.lvglFragmentation = mem.frag_pct;
+            summary.taskCount = report->taskCount;
+            summary.first = payload[0];
+            summary.count = payload[0] < report->taskCount ? report->taskCount - payload[0] : 0;
+            if (summary.count > HOSTLINK_HEALTH_TASKS)
+                summary.count = HOSTLINK_HEALTH_TASKS;
+
+            uint8_t answer[sizeof(HostLinkHealth) + HOSTLINK_HEALTH_TASKS * sizeof(HostLinkTaskHealth)];
+            memcpy(answer, &summary, sizeof(summary));
+            for (uint8_t i = 0; i < summary.count; i++)
+            {
+                const HealthTask *task = &report->tasks[summary.first + i];
+                HostLinkTaskHealth entry = {};
+                strncpy(entry.name, task->name, sizeof(entry.name));
+                entry.load = task->load;
+                entry.stackFree = task->stackFree > UINT16_MAX ? UINT16_MAX : task->stackFree;
+                entry.priority = task->priority;
+                entry.state = task->state;
+                entry.affinity = task->affinity;
+                memcpy(&answer[sizeof(summary) + i * sizeof(entry)], &entry, sizeof(entry));
+            }
+            hostLink.reply(&request, HOSTLINK_HEALTH, answer,
+                           sizeof(summary) + summary.count * sizeof(HostLinkTaskHealth));
+            break;
+        }
+        default:
+            hostLink.ack(&request, HOSTLINK_INVALID);
+            break;
+        }
+    }
+}
+#endif
+
 /**
  * @brief Entry to the display application, call once on main to run display application
  *
@@ -374,29 +989,80 @@ void lv_app_entry()
     app_home(hotberry_fadein_dur + hotberry_stay_dur + hotberry_fadeout_dur);
 
 #ifdef PICO_BOARD
-    LV_APP_MUTEX_ENTER;
-    if (EEPROM.init(EEPROM_I2CBUS, EEPROM_SDA, EEPROM_SCL, EEPROM_BusSpeed))
-        printf("EEPROM detected!\n");
+    // One bulk read at boot, every record is then checked and a missing or corrupted one keeps its defaults
+    if (EEPROMStore.mount(EEPROM_I2CBUS, EEPROM_SDA, EEPROM_SCL, EEPROM_BusSpeed))
+        LOG_INFO("EEPROM detected, %u of %u records valid\n", EEPROMStore.getValidCount(), APP_RECORD_COUNT);
+    else if (EEPROMStore.getReadError())
+        LOG_ERROR("EEPROM read failed, it's left untouched until the next boot!\n");
+    else
+        LOG_ERROR("EEPROM Not detected!\n");
+
+    EEPROMProfiles.mount();
+    LOG_INFO("%u bytes free for profiles\n", EEPROMProfiles.getFree());
+    if (FlashSettings.mount())
+        LOG_INFO("Flash settings mounted, %lu bytes free\n", FlashSettings.getFree());
     else
-        printf("EEPROM Not detected!\n");
+        LOG_ERROR("Flash settings region is not usable, only the EEPROM is used!\n");
 
-    EEPROM.memRead(sizeof(*pProfileLists), *pTopHeaterPID, sizeof(*pTopHeaterPID));
-    EEPROM.memRead(sizeof(*pProfileLists) + sizeof(*pTopHeaterPID), *pBottomHeaterPID, sizeof(*pBottomHeaterPID));
-    EEPROM.memRead(0, *pProfileLists, sizeof(*pProfileLists));
+    LV_APP_MUTEX_ENTER;
+    uint8_t buffer[GAIN_SCHEDULE_PACKED_SIZE];
+    for (int i = 0; i < profile_learningCount; i++)
+        if (app_load_record(APP_RECORD_LEARNING + i, buffer, LEARNING_TABLE_PACKED_SIZE))
+            LearningTable_Unpack(&(*pProfileLearning)[i], buffer);
+    double pid[4];
+    auto finite = [](const double *v) { return isfinite(v[0]) && isfinite(v[1]) && isfinite(v[2]) && isfinite(v[3]); };
+    if (app_load_record(APP_RECORD_TOP_PID, pid, sizeof(pid)) && finite(pid))
+        memcpy(*pTopHeaterPID, pid, sizeof(pid));
+    if (app_load_record(APP_RECORD_BOTTOM_PID, pid, sizeof(pid)) && finite(pid))
+        memcpy(*pBottomHeaterPID, pid, sizeof(pid));
+    static_assert(LEARNING_TABLE_PACKED_SIZE <= sizeof(buffer) && DECOUPLER_PACKED_SIZE <= sizeof(buffer) &&
+                      SMITH_PREDICTOR_PACKED_SIZE <= sizeof(buffer),
+                  "Record doesn't fit the buffer");
+    if (app_load_record(APP_RECORD_TOP_SCHEDULE, buffer, GAIN_SCHEDULE_PACKED_SIZE))
+        GainSchedule_Unpack(pTopHeaterSchedule, buffer);
+    if (app_load_record(APP_RECORD_BOTTOM_SCHEDULE, buffer, GAIN_SCHEDULE_PACKED_SIZE))
+        GainSchedule_Unpack(pBottomHeaterSchedule, buffer);
+    if (app_load_record(APP_RECORD_DECOUPLER, buffer, DECOUPLER_PACKED_SIZE))
+        Decoupler_Unpack(pDecoupler, buffer);
+    if (app_load_record(APP_RECORD_TOP_PREDICTOR, buffer, SMITH_PREDICTOR_PACKED_SIZE))
+        SmithPredictor_Unpack(pTopHeaterPredictor, buffer);
+    if (app_load_record(APP_RECORD_BOTTOM_PREDICTOR, buffer, SMITH_PREDICTOR_PACKED_SIZE))
+        SmithPredictor_Unpack(pBottomHeaterPredictor, buffer);
     LV_APP_MUTEX_EXIT;
 #endif
+    char *option = profile_roller_list;
+    for (uint16_t i = 0; i < profile_count; i++)
+        option += sprintf(option, i + 1 < profile_count ? "Profile %u\n" : "Profile %u", i);
+    LV_APP_MUTEX_ENTER;
+    uint16_t selectedProfile = *pSelectedProfile;
+    LV_APP_MUTEX_EXIT;
+    app_select_profile(selectedProfile);
     lv_timer_create(
         [](_lv_timer_t *e) {
             static uint32_t lastSecond = 0;
+            static uint32_t lastTopSV = 0, lastBottomSV = 0;
             LV_APP_MUTEX_ENTER;
             cTopHeaterPV = *pTopHeaterPV;
             cBottomHeaterPV = *pBottomHeaterPV;
             cSecondsRunning = *pSecondsRunning;
             bool startedAuto = *pStartedAuto;
             bool startedManual = *pStartedManual;
-            uint16_t totalSecond =
-                (*pProfileLists)[*pSelectedProfile].targetSecond[(*pProfileLists)[*pSelectedProfile].dataPoint - 1];
+            uint32_t topSV = *pTopHeaterSV;
+            uint32_t bottomSV = *pBottomHeaterSV;
+            uint16_t totalSecond = pActiveProfile->targetSecond[pActiveProfile->dataPoint - 1];
+            int16_t learnedProfile = *pLearnedProfile;
+            *pLearnedProfile = -1;
             LV_APP_MUTEX_EXIT;
+            if (learnedProfile >= 0) // Save the learning table updated at the end of the auto operation
+                app_save_learning(learnedProfile);
+#ifdef PICO_BOARD
+            if (storageFailed)
+            {
+                storageFailed = false;
+                modal_create_alert("Saving the settings failed, they are lost on the next restart!");
+            }
+            app_host_requests();
+#endif
             if (lv_scr_act() == scr_auto)
             {
                 using namespace AppAutoVar;
@@ -405,10 +1071,26 @@ void lv_app_entry()
                     lv_obj_t *heater_temp = lv_obj_get_child(heater[i], 1);
                     lv_label_set_text_fmt(heater_temp, "%d°C", i == 0 ? cTopHeaterPV : cBottomHeaterPV);
                 }
+                // The host may start and stop runs too, a run it started gets an empty chart like one started here
+                if (app_show_run_btn(run_btn, startedAuto))
+                {
+                    lv_chart_set_all_value(ChartData::chart, ChartData::topSeries, LV_CHART_POINT_NONE);
+                    lv_chart_set_all_value(ChartData::chart, ChartData::bottomSeries, LV_CHART_POINT_NONE);
+                }
             }
             else if (lv_scr_act() == scr_manual)
             {
                 using namespace AppManualVar;
+                if (app_show_run_btn(run_btn, startedManual))
+                {
+                    lv_chart_set_all_value(ChartData::chart, ChartData::topSeries, LV_CHART_POINT_NONE);
+                    lv_chart_set_all_value(ChartData::chart, ChartData::bottomSeries, LV_CHART_POINT_NONE);
+                }
+                if (topSV != lastTopSV || bottomSV != lastBottomSV)
+                {
+                    lv_event_send(heater[0], LV_EVENT_REFRESH, NULL);
+                    lv_event_send(heater[1], LV_EVENT_REFRESH, NULL);
+                }
                 for (int i = 0; i < 2; i++)
                 {
                     lv_obj_t *heater_temp = lv_obj_get_child(heater[i], 1);
@@ -439,6 +1121,8 @@ void lv_app_entry()
                 // lv_chart_set_next_value(ChartData::chart, ChartData::bottomSeries, cBottomHeaterPV);
             }
             lastSecond = cSecondsRunning;
+            lastTopSV = topSV;
+            lastBottomSV = bottomSV;
         },
         200, NULL);
 }
@@ -532,7 +1216,6 @@ void app_auto(uint32_t delay)
     lv_obj_add_event_cb(
         run_btn,
         [](lv_event_t *e) {
-            lv_obj_t *run_btn_label = lv_obj_get_child(run_btn, 0);
             LV_APP_MUTEX_ENTER;
             *pStartedAuto = !*pStartedAuto;
             bool started = *pStartedAuto;
@@ -543,12 +1226,11 @@ void app_auto(uint32_t delay)
                 lv_chart_set_all_value(ChartData::chart, ChartData::topSeries, LV_CHART_POINT_NONE);
                 lv_chart_set_all_value(ChartData::chart, ChartData::bottomSeries, LV_CHART_POINT_NONE);
             }
-            lv_label_set_text(run_btn_label, started ? LV_SYMBOL_STOP " STOP" : LV_SYMBOL_PLAY " START");
-            lv_obj_set_style_bg_color(run_btn, started ? md_teal : md_red, 0);
+            app_show_run_btn(run_btn, started);
         },
         LV_EVENT_CLICKED, NULL);
 
-    lv_obj_t *profile_btn = lv_btn_create(scr_auto);
+    profile_btn = lv_btn_create(scr_auto);
     lv_obj_set_size(profile_btn, 100, 30);
     lv_obj_set_style_radius(profile_btn, 2, 0);
     lv_obj_t *profile_btn_label = lvc_btn_init(profile_btn, "", LV_ALIGN_TOP_RIGHT, -3,
@@ -588,6 +1270,7 @@ void app_auto(uint32_t delay)
             LV_APP_MUTEX_ENTER;
             uint8_t dSelectedProfile = *pSelectedProfile;
             LV_APP_MUTEX_EXIT;
+            app_select_profile(dSelectedProfile);
             lv_label_set_text_fmt(profile_btn_label, "PROFILE %d", dSelectedProfile);
             ChartData::deleteChart();
             chart = app_create_chart(scr_auto, true, dSelectedProfile, true, chartWidth, chartHeight);
@@ -705,7 +1388,6 @@ void app_manual(uint32_t delay)
     lv_obj_add_event_cb(
         run_btn,
         [](lv_event_t *e) {
-            lv_obj_t *run_btn_label = lv_obj_get_child(run_btn, 0);
             LV_APP_MUTEX_ENTER;
             *pStartedManual = !*pStartedManual;
             bool started = *pStartedManual;
@@ -716,8 +1398,7 @@ void app_manual(uint32_t delay)
                 lv_chart_set_all_value(ChartData::chart, ChartData::topSeries, LV_CHART_POINT_NONE);
                 lv_chart_set_all_value(ChartData::chart, ChartData::bottomSeries, LV_CHART_POINT_NONE);
             }
-            lv_label_set_text(run_btn_label, started ? LV_SYMBOL_STOP " STOP" : LV_SYMBOL_PLAY " START");
-            lv_obj_set_style_bg_color(run_btn, started ? md_teal : md_red, 0);
+            app_show_run_btn(run_btn, started);
         },
         LV_EVENT_CLICKED, NULL);
     app_anim_y(run_btn, delay, elem_y_offset[lv_obj_get_index(run_btn)], false);
@@ -820,6 +1501,7 @@ WidgetParameterData confirm_wpd; // Used for modal confirm
 lv_obj_t *header, *back, *logo, *profile_btn;
 lv_obj_t *box, *label, *saveBtn, *drawBtn, *dataPointTA, *startTopHeaterAtTA, *grid_box;
 lv_obj_t **targetSecondTA = NULL, **targetTemperatureTA = NULL;
+lv_obj_t *learningSwitch, *learningLabel; // Run-to-run learning state of the selected profile
 bool modified;
 auto ta_is_modified_cb = [](lv_event_t *e) { modified = true; };
 } // namespace AppProfilesVar
@@ -845,7 +1527,7 @@ void app_profiles(uint32_t delay)
     modified = false;
 
     LV_APP_MUTEX_ENTER;
-    memcpy(&tempProfile, &(*pProfileLists)[*pSelectedProfile], sizeof(Profile));
+    tempProfile = *pActiveProfile;
     LV_APP_MUTEX_EXIT;
 
     scr_profiles = lv_obj_create(NULL);
@@ -955,9 +1637,12 @@ void app_profiles(uint32_t delay)
             lv_obj_t *profile_btn_label = lv_obj_get_child(profile_btn, 0);
 
             LV_APP_MUTEX_ENTER;
-            memcpy(&tempProfile, &(*pProfileLists)[*pSelectedProfile], sizeof(Profile));
             dSelectedProfile = *pSelectedProfile;
             LV_APP_MUTEX_EXIT;
+            app_select_profile(dSelectedProfile);
+            LV_APP_MUTEX_ENTER;
+            tempProfile = *pActiveProfile;
+            LV_APP_MUTEX_EXIT;
 
             lv_label_set_text_fmt(profile_btn_label, "PROFILE %d", dSelectedProfile);
             char buf[16];
@@ -971,6 +1656,7 @@ void app_profiles(uint32_t delay)
             lv_textarea_set_text(startTopHeaterAtTA, buf);
 
             lv_event_send(dataPointTA, LV_EVENT_READY, NULL); // Redraw grid_box for profile parameters
+            lv_event_send(learningSwitch, LV_EVENT_REFRESH, NULL);
             modified = false;
         },
         LV_EVENT_REFRESH, NULL);
@@ -1038,17 +1724,30 @@ void app_profiles(uint32_t delay)
                     targetTemperature_txt[0] == '\0' ? 0 : std::stol(targetTemperature_txt);
             }
 
+            if (tempProfile.dataPoint == 0 || tempProfile.dataPoint > profile_maximumDataPoint)
+            {
+                modal_create_alert("Data point must be between 1 and 20!");
+                modified = true;
+                return;
+            }
+
+            // The learned correction belongs to the old profile shape, start learning over when it's changed
+            uint8_t encoded[PROFILE_ENCODED_MAX], savedEncoded[PROFILE_ENCODED_MAX];
+            uint8_t len = profile_encode(&tempProfile, encoded);
             LV_APP_MUTEX_ENTER;
-            memcpy(&(*pProfileLists)[*pSelectedProfile], &tempProfile, sizeof(Profile));
+            uint16_t dSelectedProfile = *pSelectedProfile;
+            bool reshaped = profile_encode(pActiveProfile, savedEncoded) != len || memcmp(encoded, savedEncoded, len);
+            if (reshaped && dSelectedProfile < profile_learningCount)
+                LearningTable_Reset(&(*pProfileLearning)[dSelectedProfile]);
+            *pActiveProfile = tempProfile;
             LV_APP_MUTEX_EXIT;
-#ifdef PICO_BOARD
-            if (EEPROM.init(
-                    EEPROM_I2CBUS, EEPROM_SDA, EEPROM_SCL,
-                    EEPROM_BusSpeed)) // For some reason, we need to always init before doing anything with I2C BUS
-                EEPROM.memWrite(0, *pProfileLists, sizeof(*pProfileLists));
-            else
-                printf("EEPROM Not detected!\n");
-#endif
+            if (!app_save_profile(dSelectedProfile, &tempProfile))
+                modal_create_alert("Not enough space left for this profile!");
+            if (reshaped)
+            {
+                app_save_learning(dSelectedProfile);
+                lv_event_send(learningSwitch, LV_EVENT_REFRESH, NULL);
+            }
         },
         LV_EVENT_CLICKED, NULL);
 
@@ -1178,6 +1877,70 @@ void app_profiles(uint32_t delay)
     lv_obj_add_event_cb(startTopHeaterAtTA, ta_is_modified_cb, LV_EVENT_VALUE_CHANGED, NULL);
     lv_obj_add_event_cb(startTopHeaterAtTA, ta_event_cb, LV_EVENT_ALL, scr_cont);
 
+    // Run-to-run learning of the profile, applied immediately instead of waiting for the Save button
+    learningSwitch = lv_switch_create(box);
+    lv_obj_align(learningSwitch, LV_ALIGN_TOP_RIGHT, 0, 55);
+    lv_obj_t *learning_switch_label = lv_label_create(box);
+    lvc_label_init(learning_switch_label);
+    lv_obj_align_to(learning_switch_label, learningSwitch, LV_ALIGN_OUT_LEFT_MID, -10, 0);
+    lv_label_set_text_static(learning_switch_label, "Learn From Runs");
+    lv_obj_add_event_cb(
+        learningSwitch,
+        [](lv_event_t *e) {
+            bool enabled = lv_obj_has_state(learningSwitch, LV_STATE_CHECKED);
+            LV_APP_MUTEX_ENTER;
+            uint16_t dSelectedProfile = *pSelectedProfile;
+            if (dSelectedProfile < profile_learningCount)
+                (*pProfileLearning)[dSelectedProfile].enabled = enabled;
+            LV_APP_MUTEX_EXIT;
+            app_save_learning(dSelectedProfile);
+        },
+        LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_event_cb( // Show the learning state of the selected profile
+        learningSwitch,
+        [](lv_event_t *e) {
+            LV_APP_MUTEX_ENTER;
+            uint16_t dSelectedProfile = *pSelectedProfile;
+            LearningTable table = {};
+            if (dSelectedProfile < profile_learningCount)
+                table = (*pProfileLearning)[dSelectedProfile];
+            LV_APP_MUTEX_EXIT;
+            if (dSelectedProfile >= profile_learningCount)
+            {
+                lv_obj_clear_state(learningSwitch, LV_STATE_CHECKED);
+                lv_obj_add_state(learningSwitch, LV_STATE_DISABLED);
+                lv_label_set_text_fmt(learningLabel, "Only profile 0 to %d can learn", profile_learningCount - 1);
+                return;
+            }
+            lv_obj_clear_state(learningSwitch, LV_STATE_DISABLED);
+            if (table.enabled)
+                lv_obj_add_state(learningSwitch, LV_STATE_CHECKED);
+            else
+                lv_obj_clear_state(learningSwitch, LV_STATE_CHECKED);
+            lv_label_set_text_fmt(learningLabel, "Learned from %d runs", table.runs);
+        },
+        LV_EVENT_REFRESH, NULL);
+
+    lv_obj_t *reset_btn = lv_btn_create(box);
+    lvc_btn_init(reset_btn, "Reset", LV_ALIGN_TOP_RIGHT, 0, 100);
+    lv_obj_add_event_cb(
+        reset_btn,
+        [](lv_event_t *e) {
+            LV_APP_MUTEX_ENTER;
+            uint16_t dSelectedProfile = *pSelectedProfile;
+            if (dSelectedProfile < profile_learningCount)
+                LearningTable_Reset(&(*pProfileLearning)[dSelectedProfile]);
+            LV_APP_MUTEX_EXIT;
+            app_save_learning(dSelectedProfile);
+            lv_event_send(learningSwitch, LV_EVENT_REFRESH, NULL);
+        },
+        LV_EVENT_CLICKED, NULL);
+    learningLabel = lv_label_create(box);
+    lvc_label_init(learningLabel, &lv_font_montserrat_14, LV_ALIGN_DEFAULT, 0, 0, bs_white, LV_TEXT_ALIGN_RIGHT,
+                   LV_LABEL_LONG_WRAP, 160);
+    lv_obj_align_to(learningLabel, reset_btn, LV_ALIGN_OUT_LEFT_MID, -10, 0);
+    lv_event_send(learningSwitch, LV_EVENT_REFRESH, NULL);
+
     lv_event_send(dataPointTA, LV_EVENT_READY, NULL);
 
     modified = false;
@@ -1187,6 +1950,15 @@ namespace AppVarSettings
 {
 lv_obj_t *header, *topHeater_cont, *bottomHeater_cont;
 lv_coord_t elem_y_offset[] = {0, 70, 70};
+lv_obj_t *scheduleTA[GAIN_SCHEDULE_MAX_BREAKPOINT][4]; // Temperature, P, I and D text area of each breakpoint row
+GainSchedule *editedSchedule;                          // Schedule currently opened on the gain schedule editor
+lv_obj_t *decouplerTA[2][2], *decouplerSwitch, *stepTestLabel, *stepTestBtn;
+lv_timer_t *stepTestTimer; // Refresh the step test status while the decoupling editor is opened
+StepTestPhase stepTestLastPhase; // Phase seen by the last refresh, reset when the editor is opened
+lv_obj_t *predictorTA[3], *predictorSwitch; // Gain, time constant and dead time text area
+SmithPredictor *editedPredictor;             // Predictor currently opened on the predictor editor
+lv_obj_t *diagnosticsLabel, *diagnosticsTable;
+lv_timer_t *diagnosticsTimer; // Refresh the diagnostics while they're shown
 } // namespace AppVarSettings
 void app_settings(uint32_t delay)
 {
@@ -1251,17 +2023,15 @@ void app_settings(uint32_t delay)
                 LV_APP_MUTEX_EXIT;
             }
 #ifdef PICO_BOARD
-
-            if (EEPROM.init(
-                    EEPROM_I2CBUS, EEPROM_SDA, EEPROM_SCL,
-                    EEPROM_BusSpeed)) // For some reason, we need to always init before doing anything with I2C BUS
-            {
-                EEPROM.memWrite(sizeof(*pProfileLists), *pTopHeaterPID, sizeof(*pTopHeaterPID));
-                EEPROM.memWrite(sizeof(*pProfileLists) + sizeof(*pTopHeaterPID), *pBottomHeaterPID,
-                                sizeof(*pBottomHeaterPID));
-            }
-            else
-                printf("EEPROM Not detected!\n");
+            double topPID[4], bottomPID[4];
+            LV_APP_MUTEX_ENTER;
+            memcpy(topPID, *pTopHeaterPID, sizeof(topPID));
+            memcpy(bottomPID, *pBottomHeaterPID, sizeof(bottomPID));
+            LV_APP_MUTEX_EXIT;
+            if (!app_save_record(APP_RECORD_TOP_PID, topPID, sizeof(topPID)))
+                storageFailed = true;
+            if (!app_save_record(APP_RECORD_BOTTOM_PID, bottomPID, sizeof(bottomPID)))
+                storageFailed = true;
 #endif
             for (uint32_t i = 0; i < lv_obj_get_child_cnt(scr_settings); i++)
             {
@@ -1276,11 +2046,339 @@ void app_settings(uint32_t delay)
     lv_img_set_src(logo, &hotberry_logo);
     lv_obj_align_to(logo, back, LV_ALIGN_OUT_RIGHT_MID, -20, 0);
     lv_img_set_zoom(logo, 190);
+#ifdef PICO_BOARD
+    // Hidden diagnostics for sizing the stacks and heaps, a long press on the logo shows them until closed
+    lv_obj_add_flag(logo, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(
+        logo,
+        [](lv_event_t *e) {
+            static constexpr lv_coord_t column_width[] = {140, 60, 50, 80, 90};
+            static constexpr const char *column_text[] = {"Task", "Core", "Prio", "CPU", "Stack free"};
+            lv_obj_t *modal = modal_create_alert("", "Diagnostics", &lv_font_montserrat_20, &lv_font_montserrat_12,
+                                                 bs_white, bs_white, bs_indigo_700, "Close", app_display_width - 20,
+                                                 app_display_height - 20);
+            diagnosticsLabel = lv_obj_get_child(modal, 1);
+            lvc_label_init(diagnosticsLabel, &lv_font_montserrat_12, LV_ALIGN_TOP_LEFT, 10, 50, bs_white,
+                           LV_TEXT_ALIGN_LEFT, LV_LABEL_LONG_WRAP, lv_pct(95));
+
+            diagnosticsTable = lv_table_create(modal);
+            lv_obj_set_style_text_font(diagnosticsTable, &lv_font_montserrat_12, 0);
+            lv_obj_set_style_pad_all(diagnosticsTable, 3, LV_PART_ITEMS);
+            lv_obj_set_size(diagnosticsTable, lv_pct(95), 150);
+            lv_obj_align(diagnosticsTable, LV_ALIGN_TOP_MID, 0, 100);
+            lv_table_set_col_cnt(diagnosticsTable, 5);
+            for (uint16_t col = 0; col < 5; col++)
+            {
+                lv_table_set_col_width(diagnosticsTable, col, column_width[col]);
+                lv_table_set_cell_value(diagnosticsTable, 0, col, column_text[col]);
+            }
+
+            diagnosticsTimer = lv_timer_create(
+                [](lv_timer_t *t) {
+                    const HealthReport *report = &app_healthReport;
+                    if (!health.read(&app_healthReport))
+                    {
+                        lv_label_set_text_static(diagnosticsLabel, "Waiting for the first window...");
+                        return;
+                    }
+                    lv_mem_monitor_t mem;
+                    lv_mem_monitor(&mem);
+                    lv_label_set_text_fmt(diagnosticsLabel,
+                                          "Core 0 %d.%d%% (ISR %d.%d%%)   Core 1 %d.%d%% (ISR %d.%d%%)   Up %lus\n"
+                                          "Heap %lu B free, %lu B lowest\n"
+                                          "LVGL %lu of %lu B free, biggest block %lu B, %d%% fragmented",
+                                          report->coreLoad[0] / 10, report->coreLoad[0] % 10,
+                                          report->isrLoad[0] / 10, report->isrLoad[0] % 10, report->coreLoad[1] / 10,
+                                          report->coreLoad[1] % 10, report->isrLoad[1] / 10,
+                                          report->isrLoad[1] % 10, report->uptime, report->heapFree,
+                                          report->heapMinimum, mem.free_size, mem.total_size,
+                                          mem.free_biggest_size, mem.frag_pct);
+                    if (report->taskCount < report->taskTotal)
+                    {
+                        lv_table_set_row_cnt(diagnosticsTable, 2);
+                        lv_table_set_cell_value_fmt(diagnosticsTable, 1, 0, "%d tasks, too many to list",
+                                                    report->taskTotal);
+                        for (uint8_t col = 1; col < 5; col++)
+                            lv_table_set_cell_value(diagnosticsTable, 1, col, "");
+                        return;
+                    }
+                    lv_table_set_row_cnt(diagnosticsTable, report->taskCount + 1);
+                    for (uint8_t i = 0; i < report->taskCount; i++)
+                    {
+                        const HealthTask *task = &report->tasks[i];
+                        uint16_t row = i + 1;
+                        lv_table_set_cell_value(diagnosticsTable, row, 0, task->name);
+                        if (task->affinity == 0x1 || task->affinity == 0x2)
+                            lv_table_set_cell_value_fmt(diagnosticsTable, row, 1, "%d", task->affinity == 0x2);
+                        else
+                            lv_table_set_cell_value(diagnosticsTable, row, 1, "any");
+                        lv_table_set_cell_value_fmt(diagnosticsTable, row, 2, "%d", task->priority);
+                        lv_table_set_cell_value_fmt(diagnosticsTable, row, 3, "%d.%d%%", task->load / 10,
+                                                    task->load % 10);
+                        lv_table_set_cell_value_fmt(diagnosticsTable, row, 4, "%lu", task->stackFree);
+                    }
+                },
+                HEALTH_PERIOD, NULL);
+            lv_timer_ready(diagnosticsTimer);
+
+            lv_obj_add_event_cb( // Stop refreshing once closed
+                modal,
+                [](lv_event_t *e) {
+                    lv_timer_del(diagnosticsTimer);
+                    diagnosticsTimer = NULL;
+                },
+                LV_EVENT_DELETE, NULL);
+        },
+        LV_EVENT_LONG_PRESSED, NULL);
+#endif
 
     lv_obj_t *settings_label = lv_label_create(header);
     lvc_label_init(settings_label, &lv_font_montserrat_24, LV_ALIGN_RIGHT_MID, 0, 0, bs_white);
     lv_label_set_text_static(settings_label, "SETTINGS");
 
+    lv_obj_t *decoupling_btn = lv_btn_create(header);
+    lvc_btn_init(decoupling_btn, "Decoupling");
+    lv_obj_align_to(decoupling_btn, settings_label, LV_ALIGN_OUT_LEFT_MID, -15, 0);
+    lv_obj_add_event_cb( // Open the zone decoupling editor and the coupling step test status
+        decoupling_btn,
+        [](lv_event_t *e) {
+            static constexpr lv_coord_t column_dsc[] = {90, LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_TEMPLATE_LAST};
+            static constexpr lv_coord_t row_dsc[] = {30, 35, 35, LV_GRID_TEMPLATE_LAST};
+            static constexpr const char *column_text[] = {"Bottom SSR", "Top SSR"};
+            static constexpr const char *row_text[] = {"Bottom PV", "Top PV"};
+
+            LV_APP_MUTEX_ENTER;
+            Decoupler decoupler = *pDecoupler;
+            LV_APP_MUTEX_EXIT;
+
+            lv_obj_t *overlay = lvc_create_overlay();
+            lv_obj_set_style_pad_all(overlay, 5, 0);
+            lv_obj_t *modal = lv_obj_create(overlay);
+            lv_obj_set_size(modal, lv_pct(100), LV_SIZE_CONTENT);
+            lv_obj_center(modal);
+
+            lv_obj_t *label = lv_label_create(modal);
+            lvc_label_init(label, &lv_font_montserrat_20, LV_ALIGN_TOP_LEFT);
+            lv_label_set_text_static(label, "Zone Decoupling");
+
+            lv_obj_t *cancel_btn = lv_btn_create(modal);
+            lvc_btn_init(cancel_btn, "Cancel", LV_ALIGN_TOP_RIGHT);
+            lv_obj_add_event_cb(
+                cancel_btn, [](lv_event_t *e) { lv_obj_del((lv_obj_t *)lv_event_get_user_data(e)); },
+                LV_EVENT_CLICKED, overlay);
+
+            lv_obj_t *save_btn = lv_btn_create(modal);
+            lvc_btn_init(save_btn, "Save");
+            lv_obj_align_to(save_btn, cancel_btn, LV_ALIGN_OUT_LEFT_MID, -15, 0);
+            lv_obj_add_event_cb(
+                save_btn,
+                [](lv_event_t *e) {
+                    Decoupler decoupler;
+                    decoupler.enabled = lv_obj_has_state(decouplerSwitch, LV_STATE_CHECKED);
+                    for (int pv = 0; pv < 2; pv++)
+                    {
+                        for (int ssr = 0; ssr < 2; ssr++)
+                        {
+                            const char *txt = lv_textarea_get_text(decouplerTA[pv][ssr]);
+                            decoupler.G[pv][ssr] = (txt[0] == '\0' || strcmp(txt, ".") == 0) ? 0.0f : std::stof(txt);
+                        }
+                    }
+                    if (decoupler.enabled && !Decoupler_IsValid(&decoupler))
+                    {
+                        modal_create_alert("Direct gains must be positive and larger than the cross coupling!");
+                        return;
+                    }
+
+                    LV_APP_MUTEX_ENTER;
+                    *pDecoupler = decoupler;
+                    LV_APP_MUTEX_EXIT;
+#ifdef PICO_BOARD
+                    uint8_t decouplerBuffer[DECOUPLER_PACKED_SIZE];
+                    Decoupler_Pack(&decoupler, decouplerBuffer);
+                    if (!app_save_record(APP_RECORD_DECOUPLER, decouplerBuffer, sizeof(decouplerBuffer)))
+                        storageFailed = true;
+#endif
+                    lv_obj_del((lv_obj_t *)lv_event_get_user_data(e));
+                },
+                LV_EVENT_CLICKED, overlay);
+
+            decouplerSwitch = lv_switch_create(modal);
+            lv_obj_align(decouplerSwitch, LV_ALIGN_TOP_LEFT, 0, 40);
+            if (decoupler.enabled)
+                lv_obj_add_state(decouplerSwitch, LV_STATE_CHECKED);
+            lv_obj_t *switch_label = lv_label_create(modal);
+            lvc_label_init(switch_label);
+            lv_obj_align_to(switch_label, decouplerSwitch, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+            lv_label_set_text_static(switch_label, "Decouple zones while both heaters run");
+
+            lv_obj_t *grid_box = lv_obj_create(modal);
+            lv_obj_set_size(grid_box, lv_pct(100), LV_SIZE_CONTENT);
+            lv_obj_align(grid_box, LV_ALIGN_TOP_MID, 0, 75);
+            lv_obj_set_layout(grid_box, LV_LAYOUT_GRID);
+            lv_obj_set_style_pad_top(grid_box, 0, 0);
+            lv_obj_set_grid_dsc_array(grid_box, column_dsc, row_dsc);
+            for (int i = 0; i < 2; i++)
+            {
+                lv_obj_t *grid_label = lv_label_create(grid_box);
+                lvc_label_init(grid_label);
+                lv_label_set_text_static(grid_label, column_text[i]);
+                lv_obj_set_grid_cell(grid_label, LV_GRID_ALIGN_CENTER, i + 1, 1, LV_GRID_ALIGN_CENTER, 0, 1);
+                grid_label = lv_label_create(grid_box);
+                lvc_label_init(grid_label);
+                lv_label_set_text_static(grid_label, row_text[i]);
+                lv_obj_set_grid_cell(grid_label, LV_GRID_ALIGN_START, 0, 1, LV_GRID_ALIGN_CENTER, i + 1, 1);
+            }
+            for (int pv = 0; pv < 2; pv++)
+            {
+                for (int ssr = 0; ssr < 2; ssr++)
+                {
+                    char buf[16];
+                    decouplerTA[pv][ssr] = createTextArea(grid_box, 10, 120, true, LV_ALIGN_CENTER, 0, 0);
+                    sprintf(buf, "%f", decoupler.G[pv][ssr]);
+                    lv_textarea_set_text(decouplerTA[pv][ssr], buf);
+                    lv_obj_set_grid_cell(decouplerTA[pv][ssr], LV_GRID_ALIGN_CENTER, ssr + 1, 1, LV_GRID_ALIGN_CENTER,
+                                         pv + 1, 1);
+                    lv_obj_add_event_cb(decouplerTA[pv][ssr], ta_event_cb, LV_EVENT_ALL, overlay);
+                }
+            }
+
+            stepTestBtn = lv_btn_create(modal);
+            lvc_btn_init(stepTestBtn, "Run Step Test");
+            lv_obj_align_to(stepTestBtn, grid_box, LV_ALIGN_OUT_BOTTOM_LEFT, 0, 10);
+            lv_obj_add_event_cb( // Start or abort the coupling step test, it runs on pid_task even after leaving here
+                stepTestBtn,
+                [](lv_event_t *e) {
+                    LV_APP_MUTEX_ENTER;
+                    bool started = *pStartedAuto || *pStartedManual;
+                    bool running = CouplingStepTest_IsRunning(pCouplingTest);
+                    if (running)
+                        pCouplingTest->request = STEP_TEST_REQUEST_ABORT;
+                    else if (!started)
+                        pCouplingTest->request = STEP_TEST_REQUEST_START;
+                    LV_APP_MUTEX_EXIT;
+                    if (!running && started)
+                        modal_create_alert("Can't run the step test while an operation is still running!");
+                },
+                LV_EVENT_CLICKED, NULL);
+
+            stepTestLabel = lv_label_create(modal);
+            lvc_label_init(stepTestLabel, &lv_font_montserrat_14, LV_ALIGN_DEFAULT, 0, 0, bs_white, LV_TEXT_ALIGN_LEFT);
+            lv_obj_align_to(stepTestLabel, stepTestBtn, LV_ALIGN_OUT_RIGHT_MID, 15, 0);
+            lv_label_set_text_static(stepTestLabel, "");
+
+            // A test that is done is offered again every time the editor is opened
+            stepTestLastPhase = STEP_TEST_IDLE;
+            stepTestTimer = lv_timer_create(
+                [](lv_timer_t *t) {
+                    static constexpr const char *phase_text[] = {
+                        "Idle", "Measuring baseline", "Stepping bottom heater", "Cooling down",
+                        "Stepping top heater", "Done, review and save", "Aborted"};
+                    LV_APP_MUTEX_ENTER;
+                    StepTestPhase phase = pCouplingTest->phase;
+                    uint32_t elapsed = pCouplingTest->elapsed;
+                    bool running = CouplingStepTest_IsRunning(pCouplingTest);
+                    float G[2][2];
+                    memcpy(G, pCouplingTest->G, sizeof(G));
+                    LV_APP_MUTEX_EXIT;
+
+                    lv_label_set_text_fmt(stepTestLabel, running ? "%s (%lus)" : "%s", phase_text[phase],
+                                          (unsigned long)elapsed);
+                    lv_label_set_text_static(lv_obj_get_child(stepTestBtn, 0), running ? "Abort Test" : "Run Step Test");
+                    // Fill in the identified gains once the test has just finished
+                    if (phase == STEP_TEST_DONE && stepTestLastPhase != STEP_TEST_DONE)
+                    {
+                        for (int pv = 0; pv < 2; pv++)
+                        {
+                            for (int ssr = 0; ssr < 2; ssr++)
+                            {
+                                char buf[16];
+                                sprintf(buf, "%f", G[pv][ssr]);
+                                lv_textarea_set_text(decouplerTA[pv][ssr], buf);
+                            }
+                        }
+                    }
+                    stepTestLastPhase = phase;
+                },
+                500, NULL);
+            lv_timer_ready(stepTestTimer);
+
+            lv_obj_add_event_cb( // Stop refreshing and hide the keyboard if it is still attached to a deleted text area
+                modal,
+                [](lv_event_t *e) {
+                    lv_timer_del(stepTestTimer);
+                    stepTestTimer = NULL;
+                    for (int pv = 0; pv < 2; pv++)
+                        for (int ssr = 0; ssr < 2; ssr++)
+                            if (lv_obj_has_state(decouplerTA[pv][ssr], LV_STATE_FOCUSED))
+                                lv_event_send(decouplerTA[pv][ssr], LV_EVENT_DEFOCUSED, NULL);
+                },
+                LV_EVENT_DELETE, NULL);
+        },
+        LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *sd_btn = lv_btn_create(header);
+    lvc_btn_init(sd_btn, LV_SYMBOL_SD_CARD);
+    lv_obj_align_to(sd_btn, decoupling_btn, LV_ALIGN_OUT_LEFT_MID, -15, 0);
+    lv_obj_add_event_cb( // Export the profiles to the SD card or import them back
+        sd_btn,
+        [](lv_event_t *e) {
+            lv_obj_t *overlay = lvc_create_overlay();
+            lv_obj_set_style_pad_all(overlay, 5, 0);
+            lv_obj_t *modal = lv_obj_create(overlay);
+            lv_obj_set_size(modal, lv_pct(100), LV_SIZE_CONTENT);
+            lv_obj_center(modal);
+
+            lv_obj_t *label = lv_label_create(modal);
+            lvc_label_init(label, &lv_font_montserrat_20, LV_ALIGN_TOP_LEFT);
+            lv_label_set_text_static(label, "SD Card");
+
+            lv_obj_t *cancel_btn = lv_btn_create(modal);
+            lvc_btn_init(cancel_btn, "Cancel", LV_ALIGN_TOP_RIGHT);
+            lv_obj_add_event_cb(
+                cancel_btn, [](lv_event_t *e) { lv_obj_del((lv_obj_t *)lv_event_get_user_data(e)); },
+                LV_EVENT_CLICKED, overlay);
+
+            lv_obj_t *info_label = lv_label_create(modal);
+            lvc_label_init(info_label, &lv_font_montserrat_14, LV_ALIGN_TOP_LEFT, 0, 45, bs_white, LV_TEXT_ALIGN_LEFT,
+                           LV_LABEL_LONG_WRAP, lv_pct(100));
+            lv_label_set_text_static(info_label, "Profiles are kept in PROFILES.CSV on a FAT32 card, one line per "
+                                                 "profile: profile,startTopHeaterAt,second:celcius,... Importing "
+                                                 "overwrites the profiles found in the file. Run logs are written "
+                                                 "as RUNxxxxx.CSV.");
+
+            // The alert is created after the modal is deleted, it's on top of the settings screen
+            lv_obj_t *export_btn = lv_btn_create(modal);
+            lvc_btn_init(export_btn, "Export Profiles");
+            lv_obj_align_to(export_btn, info_label, LV_ALIGN_OUT_BOTTOM_LEFT, 0, 15);
+            lv_obj_add_event_cb(
+                export_btn,
+                [](lv_event_t *e) {
+                    lv_obj_del((lv_obj_t *)lv_event_get_user_data(e));
+#ifdef PICO_BOARD
+                    modal_create_alert(app_export_profiles(), "SD Card");
+#else
+                    modal_create_alert("There's no SD card on the simulator!", "SD Card");
+#endif
+                },
+                LV_EVENT_CLICKED, overlay);
+
+            lv_obj_t *import_btn = lv_btn_create(modal);
+            lvc_btn_init(import_btn, "Import Profiles");
+            lv_obj_align_to(import_btn, export_btn, LV_ALIGN_OUT_RIGHT_MID, 15, 0);
+            lv_obj_add_event_cb(
+                import_btn,
+                [](lv_event_t *e) {
+                    lv_obj_del((lv_obj_t *)lv_event_get_user_data(e));
+#ifdef PICO_BOARD
+                    modal_create_alert(app_import_profiles(), "SD Card");
+#else
+                    modal_create_alert("There's no SD card on the simulator!", "SD Card");
+#endif
+                },
+                LV_EVENT_CLICKED, overlay);
+        },
+        LV_EVENT_CLICKED, NULL);
+
     for (int i = 0; i < 2; i++)
     {
         lv_obj_t *cont = lv_obj_create(scr_cont);
@@ -1309,10 +2407,299 @@ void app_settings(uint32_t delay)
             lv_label_set_text(pid_label, msg[y]);
             lv_obj_add_event_cb(pid_ta, ta_event_cb, LV_EVENT_ALL, scr_cont);
         }
+
+        lv_obj_t *schedule_btn = lv_btn_create(cont);
+        lvc_btn_init(schedule_btn, "Schedule", LV_ALIGN_TOP_LEFT, 0, 140);
+        lv_obj_set_style_pad_hor(schedule_btn, 10, 0);
+        lv_obj_add_event_cb( // Open the gain schedule editor of the corresponding heater
+            schedule_btn,
+            [](lv_event_t *e) {
+                static constexpr lv_coord_t column_dsc[] = {LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1),
+                                                            LV_GRID_TEMPLATE_LAST};
+                static constexpr const char *grid_label_text[] = {"Temp (°C)", "P", "I", "D"};
+                static lv_coord_t row_dsc[GAIN_SCHEDULE_MAX_BREAKPOINT + 2];
+                std::fill(row_dsc, &row_dsc[0] + GAIN_SCHEDULE_MAX_BREAKPOINT + 1, 35);
+                row_dsc[GAIN_SCHEDULE_MAX_BREAKPOINT + 1] = LV_GRID_TEMPLATE_LAST;
+
+                bool topHeater = lv_event_get_user_data(e) == topHeater_cont;
+                LV_APP_MUTEX_ENTER;
+                editedSchedule = topHeater ? pTopHeaterSchedule : pBottomHeaterSchedule;
+                GainSchedule schedule = *editedSchedule;
+                LV_APP_MUTEX_EXIT;
+
+                lv_obj_t *overlay = lvc_create_overlay();
+                lv_obj_set_style_pad_all(overlay, 5, 0);
+                lv_obj_t *modal = lv_obj_create(overlay);
+                lv_obj_set_size(modal, lv_pct(100), LV_SIZE_CONTENT);
+                lv_obj_center(modal);
+
+                lv_obj_t *label = lv_label_create(modal);
+                lvc_label_init(label, &lv_font_montserrat_20, LV_ALIGN_TOP_LEFT);
+                lv_label_set_text_static(label, topHeater ? "Top Heater Schedule" : "Bottom Heater Schedule");
+                lv_obj_t *hint = lv_label_create(modal);
+                lvc_label_init(hint, &lv_font_montserrat_12, LV_ALIGN_TOP_LEFT, 0, 25, bs_gray_500);
+                lv_label_set_text_static(hint, "Empty temperature disables the row");
+
+                lv_obj_t *cancel_btn = lv_btn_create(modal);
+                lvc_btn_init(cancel_btn, "Cancel", LV_ALIGN_TOP_RIGHT);
+                lv_obj_add_event_cb(
+                    cancel_btn, [](lv_event_t *e) { lv_obj_del((lv_obj_t *)lv_event_get_user_data(e)); },
+                    LV_EVENT_CLICKED, overlay);
+
+                lv_obj_t *save_btn = lv_btn_create(modal);
+                lvc_btn_init(save_btn, "Save");
+                lv_obj_align_to(save_btn, cancel_btn, LV_ALIGN_OUT_LEFT_MID, -15, 0);
+                lv_obj_add_event_cb(
+                    save_btn,
+                    [](lv_event_t *e) {
+                        static auto toFloat = [](const char *txt) -> float {
+                            return (txt[0] == '\0' || strcmp(txt, ".") == 0) ? 0.0f : std::stof(txt);
+                        };
+                        GainSchedule schedule = {};
+                        for (int r = 0; r < GAIN_SCHEDULE_MAX_BREAKPOINT; r++)
+                        {
+                            const char *temperature_txt = lv_textarea_get_text(scheduleTA[r][0]);
+                            if (temperature_txt[0] == '\0') // Skip unused rows
+                                continue;
+                            GainBreakpoint *bp = &schedule.breakpoints[schedule.count];
+                            bp->temperature = std::stol(temperature_txt);
+                            bp->Kp = toFloat(lv_textarea_get_text(scheduleTA[r][1]));
+                            bp->Ki = toFloat(lv_textarea_get_text(scheduleTA[r][2]));
+                            bp->Kd = toFloat(lv_textarea_get_text(scheduleTA[r][3]));
+                            if (schedule.count > 0 &&
+                                bp->temperature <= schedule.breakpoints[schedule.count - 1].temperature)
+                            {
+                                modal_create_alert("Breakpoint temperatures must be in ascending order!");
+                                return;
+                            }
+                            schedule.count++;
+                        }
+
+                        LV_APP_MUTEX_ENTER;
+                        *editedSchedule = schedule;
+                        LV_APP_MUTEX_EXIT;
+#ifdef PICO_BOARD
+                        uint8_t scheduleBuffer[GAIN_SCHEDULE_PACKED_SIZE];
+                        uint8_t record = editedSchedule == pTopHeaterSchedule ? APP_RECORD_TOP_SCHEDULE
+                                                                               : APP_RECORD_BOTTOM_SCHEDULE;
+                        GainSchedule_Pack(&schedule, scheduleBuffer);
+                        if (!app_save_record(record, scheduleBuffer, sizeof(scheduleBuffer)))
+                            storageFailed = true;
+#endif
+                        lv_obj_del((lv_obj_t *)lv_event_get_user_data(e));
+                    },
+                    LV_EVENT_CLICKED, overlay);
+
+                lv_obj_t *grid_box = lv_obj_create(modal);
+                lv_obj_set_size(grid_box, lv_pct(100), LV_SIZE_CONTENT);
+                lv_obj_align(grid_box, LV_ALIGN_TOP_MID, 0, 45);
+                lv_obj_set_layout(grid_box, LV_LAYOUT_GRID);
+                lv_obj_set_style_pad_top(grid_box, 0, 0);
+                lv_obj_set_grid_dsc_array(grid_box, column_dsc, row_dsc);
+                for (int c = 0; c < 4; c++)
+                {
+                    lv_obj_t *grid_label = lv_label_create(grid_box);
+                    lvc_label_init(grid_label);
+                    lv_label_set_text_static(grid_label, grid_label_text[c]);
+                    lv_obj_set_grid_cell(grid_label, LV_GRID_ALIGN_CENTER, c, 1, LV_GRID_ALIGN_CENTER, 0, 1);
+                }
+                for (int r = 0; r < GAIN_SCHEDULE_MAX_BREAKPOINT; r++)
+                {
+                    for (int c = 0; c < 4; c++)
+                    {
+                        char buf[16] = "";
+                        scheduleTA[r][c] = createTextArea(grid_box, c == 0 ? 3 : 10, 90, c != 0, LV_ALIGN_CENTER, 0, 0);
+                        if (r < schedule.count)
+                        {
+                            const GainBreakpoint *bp = &schedule.breakpoints[r];
+                            if (c == 0)
+                                sprintf(buf, "%d", bp->temperature);
+                            else
+                                sprintf(buf, "%f", c == 1 ? bp->Kp : (c == 2 ? bp->Ki : bp->Kd));
+                        }
+                        lv_textarea_set_text(scheduleTA[r][c], buf);
+                        lv_obj_set_grid_cell(scheduleTA[r][c], LV_GRID_ALIGN_CENTER, c, 1, LV_GRID_ALIGN_CENTER, r + 1,
+                                             1);
+                        lv_obj_add_event_cb(scheduleTA[r][c], ta_event_cb, LV_EVENT_ALL, overlay);
+                    }
+                }
+                lv_obj_add_event_cb( // Hide the keyboard if it is still attached to one of the deleted text areas
+                    modal,
+                    [](lv_event_t *e) {
+                        for (int r = 0; r < GAIN_SCHEDULE_MAX_BREAKPOINT; r++)
+                            for (int c = 0; c < 4; c++)
+                                if (lv_obj_has_state(scheduleTA[r][c], LV_STATE_FOCUSED))
+                                    lv_event_send(scheduleTA[r][c], LV_EVENT_DEFOCUSED, NULL);
+                    },
+                    LV_EVENT_DELETE, NULL);
+            },
+            LV_EVENT_CLICKED, cont);
+
+        lv_obj_t *predictor_btn = lv_btn_create(cont);
+        lvc_btn_init(predictor_btn, "Predictor");
+        lv_obj_set_style_pad_hor(predictor_btn, 10, 0);
+        lv_obj_align_to(predictor_btn, schedule_btn, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+        lv_obj_add_event_cb( // Open the Smith predictor model editor of the corresponding heater
+            predictor_btn,
+            [](lv_event_t *e) {
+                static constexpr const char *row_text[] = {"Gain (°C/duty)", "Time constant (s)", "Dead time (s)"};
+
+                bool topHeater = lv_event_get_user_data(e) == topHeater_cont;
+                LV_APP_MUTEX_ENTER;
+                editedPredictor = topHeater ? pTopHeaterPredictor : pBottomHeaterPredictor;
+                float model[3] = {editedPredictor->K, editedPredictor->tau, editedPredictor->deadTime};
+                bool enabled = editedPredictor->enabled;
+                LV_APP_MUTEX_EXIT;
+
+                lv_obj_t *overlay = lvc_create_overlay();
+                lv_obj_set_style_pad_all(overlay, 5, 0);
+                lv_obj_t *modal = lv_obj_create(overlay);
+                lv_obj_set_size(modal, lv_pct(100), LV_SIZE_CONTENT);
+                lv_obj_center(modal);
+
+                lv_obj_t *label = lv_label_create(modal);
+                lvc_label_init(label, &lv_font_montserrat_20, LV_ALIGN_TOP_LEFT);
+                lv_label_set_text_static(label, topHeater ? "Top Heater Predictor" : "Bottom Heater Predictor");
+                lv_obj_t *hint = lv_label_create(modal);
+                lvc_label_init(hint, &lv_font_montserrat_12, LV_ALIGN_TOP_LEFT, 0, 25, bs_gray_500);
+                lv_label_set_text_static(hint, "Changes are applied on the next start");
+
+                lv_obj_t *cancel_btn = lv_btn_create(modal);
+                lvc_btn_init(cancel_btn, "Cancel", LV_ALIGN_TOP_RIGHT);
+                lv_obj_add_event_cb(
+                    cancel_btn, [](lv_event_t *e) { lv_obj_del((lv_obj_t *)lv_event_get_user_data(e)); },
+                    LV_EVENT_CLICKED, overlay);
+
+                lv_obj_t *save_btn = lv_btn_create(modal);
+                lvc_btn_init(save_btn, "Save");
+                lv_obj_align_to(save_btn, cancel_btn, LV_ALIGN_OUT_LEFT_MID, -15, 0);
+                lv_obj_add_event_cb(
+                    save_btn,
+                    [](lv_event_t *e) {
+                        float model[3];
+                        for (int r = 0; r < 3; r++)
+                        {
+                            const char *txt = lv_textarea_get_text(predictorTA[r]);
+                            model[r] = (txt[0] == ' ' || strcmp(txt, ".") == 0) ? 0.0f : std::stof(txt);
+                        }
+                        bool enabled = lv_obj_has_state(predictorSwitch, LV_STATE_CHECKED);
+                        if (enabled && (model[0] <= 0.0f || model[1] <= 0.0f))
+                        {
+                            modal_create_alert("Gain and time constant must be positive!");
+                            return;
+                        }
+                        if (model[2] > SMITH_PREDICTOR_MAX_DELAY)
+                        {
+                            modal_create_alert("Dead time is too long!");
+                            return;
+                        }
+
+                        LV_APP_MUTEX_ENTER;
+                        editedPredictor->enabled = enabled;
+                        editedPredictor->K = model[0];
+                        editedPredictor->tau = model[1] > 0.0f ? model[1] : 1.0f;
+                        editedPredictor->deadTime = model[2];
+#ifdef PICO_BOARD
+                        uint8_t predictorBuffer[SMITH_PREDICTOR_PACKED_SIZE];
+                        uint8_t record = editedPredictor == pTopHeaterPredictor ? APP_RECORD_TOP_PREDICTOR
+                                                                                 : APP_RECORD_BOTTOM_PREDICTOR;
+                        SmithPredictor_Pack(editedPredictor, predictorBuffer);
+#endif
+                        LV_APP_MUTEX_EXIT;
+#ifdef PICO_BOARD
+                        if (!app_save_record(record, predictorBuffer, sizeof(predictorBuffer)))
+                            storageFailed = true;
+#endif
+                        lv_obj_del((lv_obj_t *)lv_event_get_user_data(e));
+                    },
+                    LV_EVENT_CLICKED, overlay);
+
+                predictorSwitch = lv_switch_create(modal);
+                lv_obj_align(predictorSwitch, LV_ALIGN_TOP_LEFT, 0, 50);
+                if (enabled)
+                    lv_obj_add_state(predictorSwitch, LV_STATE_CHECKED);
+                lv_obj_t *switch_label = lv_label_create(modal);
+                lvc_label_init(switch_label);
+                lv_obj_align_to(switch_label, predictorSwitch, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+                lv_label_set_text_static(switch_label, "Act on the predicted temperature");
+
+                lv_obj_t *prev = predictorSwitch;
+                for (int r = 0; r < 3; r++)
+                {
+                    char buf[16];
+                    lv_obj_t *row_label = lv_label_create(modal);
+                    lvc_label_init(row_label, &lv_font_montserrat_14, LV_ALIGN_DEFAULT, 0, 0, bs_white,
+                                   LV_TEXT_ALIGN_LEFT);
+                    lv_label_set_text_static(row_label, row_text[r]);
+                    lv_obj_align_to(row_label, prev, LV_ALIGN_OUT_BOTTOM_LEFT, 0, r == 0 ? 20 : 15);
+                    predictorTA[r] = createTextArea(modal, 10, 120, true, LV_ALIGN_DEFAULT, 0, 0);
+                    lv_obj_align_to(predictorTA[r], row_label, LV_ALIGN_OUT_RIGHT_MID, 160 - lv_obj_get_width(row_label),
+                                    0);
+                    sprintf(buf, "%f", model[r]);
+                    lv_textarea_set_text(predictorTA[r], buf);
+                    lv_obj_add_event_cb(predictorTA[r], ta_event_cb, LV_EVENT_ALL, overlay);
+                    prev = row_label;
+                }
+
+                lv_obj_t *fill_btn = lv_btn_create(modal);
+                lvc_btn_init(fill_btn, "From Step Test");
+                lv_obj_align_to(fill_btn, predictorTA[1], LV_ALIGN_OUT_RIGHT_MID, 15, 0);
+                lv_obj_add_event_cb( // Take the model fitted by the last coupling step test (see the decoupling editor)
+                    fill_btn,
+                    [](lv_event_t *e) {
+                        uint8_t zone = editedPredictor == pTopHeaterPredictor ? DECOUPLER_TOP : DECOUPLER_BOTTOM;
+                        LV_APP_MUTEX_ENTER;
+                        bool done = pCouplingTest->phase == STEP_TEST_DONE;
+                        float model[3] = {pCouplingTest->modelGain[zone], pCouplingTest->timeConstant[zone],
+                                          pCouplingTest->deadTime[zone]};
+                        LV_APP_MUTEX_EXIT;
+                        if (!done || model[0] <= 0.0f)
+                        {
+                            modal_create_alert("Run the step test from the decoupling settings first!");
+                            return;
+                        }
+                        for (int r = 0; r < 3; r++)
+                        {
+                            char buf[16];
+                            sprintf(buf, "%f", model[r]);
+                            lv_textarea_set_text(predictorTA[r], buf);
+                        }
+                    },
+                    LV_EVENT_CLICKED, NULL);
+
+                lv_obj_add_event_cb( // Hide the keyboard if it is still attached to one of the deleted text areas
+                    modal,
+                    [](lv_event_t *e) {
+                        for (int r = 0; r < 3; r++)
+                            if (lv_obj_has_state(predictorTA[r], LV_STATE_FOCUSED))
+                                lv_event_send(predictorTA[r], LV_EVENT_DEFOCUSED, NULL);
+                    },
+                    LV_EVENT_DELETE, NULL);
+            },
+            LV_EVENT_CLICKED, cont);
         app_anim_y(cont, delay, 0, false);
     }
 }
 
+/**
+ * @brief Show the state of an operation on its run button, only touched when it differs so the timer may call it
+ * on every period to follow the runs started or stopped by the host
+ *
+ * @param run_btn
+ * @param started
+ * @return true if the button was showing a stopped operation and now shows a started one
+ */
+bool app_show_run_btn(lv_obj_t *run_btn, bool started)
+{
+    lv_obj_t *run_btn_label = lv_obj_get_child(run_btn, 0);
+    const char *text = started ? LV_SYMBOL_STOP " STOP" : LV_SYMBOL_PLAY " START";
+    if (strcmp(lv_label_get_text(run_btn_label), text) == 0)
+        return false;
+    lv_label_set_text(run_btn_label, text);
+    lv_obj_set_style_bg_color(run_btn, started ? md_teal : md_red, 0);
+    return started;
+}
+
 void app_anim_y(lv_obj_t *obj, uint32_t delay, lv_coord_t offs, bool reverse, bool out)
 {
     lv_anim_t a;
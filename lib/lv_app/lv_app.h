@@ -3,6 +3,12 @@
 #ifndef _LV_APP_H
 #define _LV_APP_H
 #include "colors.h"
+#include "decoupler.h"
+#include "gain_schedule.h"
+#include "iterative_learning.h"
+#include "Log.h"
+#include "profile_store.h"
+#include "smith_predictor.h"
 #include "lvgl.h"
 #include <stdio.h>
 #include <string>
@@ -11,11 +17,19 @@
 #include "globals.h"
 #include "pico/stdlib.h"
 #include <AT24C16.h>
+#include <AT24C16Writer.h>
+#include <AT24C16Store.h>
+#include <FlashKV.h>
+#include <FlashRecorder.h>
+#include <SDLogger.h>
+#include <HostLink.h>
+#include <Health.h>
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "task.h"
 extern SemaphoreHandle_t lv_app_mutex;
 extern AT24C16 EEPROM;
+extern AT24C16Writer EEPROMWriter;
 static constexpr uint32_t EEPROM_SDA = 0;
 static constexpr uint32_t EEPROM_SCL = 1;
 static constexpr uint32_t EEPROM_BusSpeed = 400000;
@@ -38,21 +52,46 @@ LV_IMG_DECLARE(finger_icon);
 LV_IMG_DECLARE(documents_icon);
 LV_IMG_DECLARE(temperature_icon);
 
-static constexpr uint8_t profile_maximumDataPoint = 20;
-struct Profile
+#ifdef PICO_BOARD
+// Records of the EEPROM store, the ids are part of the stored data so bump EEPROM_SchemaVersion when they change
+enum AppRecord : uint8_t
 {
-    uint8_t dataPoint = 1;
-    int targetTemperature[profile_maximumDataPoint];
-    uint16_t targetSecond[profile_maximumDataPoint];
-    uint16_t startTopHeaterAt = 0;
-    Profile()
-    {
-        std::fill(targetTemperature, &targetTemperature[0] + profile_maximumDataPoint, 0);
-        std::fill(targetSecond, &targetSecond[0] + profile_maximumDataPoint, 0);
-        targetTemperature[0] = 30;
-        targetSecond[0] = 0;
-    }
+    APP_RECORD_PROFILE_DIRECTORY = 0,
+    APP_RECORD_TOP_SCHEDULE,
+    APP_RECORD_BOTTOM_SCHEDULE,
+    APP_RECORD_LEARNING, // One record per profile with a learning table
+    APP_RECORD_TOP_PID = APP_RECORD_LEARNING + profile_learningCount,
+    APP_RECORD_BOTTOM_PID,
+    APP_RECORD_DECOUPLER,
+    APP_RECORD_TOP_PREDICTOR,
+    APP_RECORD_BOTTOM_PREDICTOR,
+    APP_RECORD_COUNT
 };
+// Bump when the packed layout of any record changes, older records are then ignored and the defaults are used
+static constexpr uint8_t EEPROM_SchemaVersion = 2;
+extern AT24C16Store EEPROMStore;
+extern ProfileStore EEPROMProfiles;
+
+// Settings are kept in a log on the last sectors of the flash, the EEPROM keeps a mirror to fall back to. Tuning
+// records use the ids above as keys and the encoded profiles follow them
+static constexpr uint32_t FLASH_SettingsSize = 64 * 1024;
+static constexpr uint32_t FLASH_SettingsOffset = PICO_FLASH_SIZE_BYTES - FLASH_SettingsSize;
+static constexpr uint16_t APP_KEY_PROFILE = APP_RECORD_COUNT;
+static_assert(APP_KEY_PROFILE + profile_count <= FLASHKV_MAX_KEY, "Not enough flash keys for the profiles");
+extern FlashLockout flashLockout;
+extern FlashKV FlashSettings;
+// Runs are recorded by main to a circular log below the settings, lv_app serves its pages to the host tools
+extern FlashRecorder runRecorder;
+
+// Run logs are written to the SD card by main, lv_app imports and exports the profiles under sdLogger.lock()
+static constexpr const char *SD_ProfilesFile = "PROFILES.CSV";
+extern SDCard sdCard;
+extern Fat32 sdVolume;
+extern SDLogger sdLogger;
+
+// USB console and host link, lv_app answers the profile and tuning requests of the host tools
+extern HostLink hostLink;
+#endif
 
 static constexpr uint32_t app_display_width = 480;
 static constexpr uint32_t app_display_height = 320;
@@ -66,12 +105,20 @@ extern uint32_t *pTopHeaterPV;
 extern uint32_t *pSecondsRunning;
 
 // Read and write pointers
-extern Profile (*pProfileLists)[10];
+extern Profile *pActiveProfile; // The selected profile, decoded by app_select_profile()
 extern uint16_t *pSelectedProfile;
 extern uint32_t *pBottomHeaterSV;
 extern uint32_t *pTopHeaterSV;
 extern double (*pTopHeaterPID)[4];
 extern double (*pBottomHeaterPID)[4];
+extern GainSchedule *pTopHeaterSchedule;
+extern GainSchedule *pBottomHeaterSchedule;
+extern Decoupler *pDecoupler;
+extern CouplingStepTest *pCouplingTest;
+extern SmithPredictor *pTopHeaterPredictor;
+extern SmithPredictor *pBottomHeaterPredictor;
+extern LearningTable (*pProfileLearning)[profile_learningCount];
+extern int16_t *pLearnedProfile;
 extern bool *pStartedAuto;
 extern bool *pStartedManual;
 } // namespace lv_app_pointers
@@ -122,6 +169,7 @@ extern WidgetParameterData confirm_wpd; // Used for modal confirm
 extern lv_obj_t *header, *back, *logo, *profile_btn;
 extern lv_obj_t *box, *label, *saveBtn, *drawBtn, *dataPointTA, *startTopHeaterAtTA, *grid_box;
 extern lv_obj_t **targetSecondTA, **targetTemperatureTA;
+extern lv_obj_t *learningSwitch, *learningLabel;
 extern bool modified;
 } // namespace AppProfilesVar
 void app_profiles(uint32_t delay);
@@ -130,12 +178,26 @@ namespace AppVarSettings
 {
 extern lv_obj_t *header, *topHeater_cont, *bottomHeater_cont;
 extern lv_coord_t elem_y_offset[];
+extern lv_obj_t *scheduleTA[GAIN_SCHEDULE_MAX_BREAKPOINT][4];
+extern GainSchedule *editedSchedule;
+extern lv_obj_t *decouplerTA[2][2], *decouplerSwitch, *stepTestLabel, *stepTestBtn;
+extern lv_timer_t *stepTestTimer;
+extern StepTestPhase stepTestLastPhase;
+extern lv_obj_t *predictorTA[3], *predictorSwitch;
+extern SmithPredictor *editedPredictor;
+extern lv_obj_t *diagnosticsLabel, *diagnosticsTable;
+extern lv_timer_t *diagnosticsTimer;
 } // namespace AppVarSettings
 void app_settings(uint32_t delay);
 
 lv_obj_t *app_create_chart(lv_obj_t *_parent, bool profileGraph, uint8_t _selectedProfile, bool createLegend,
                            lv_coord_t width, lv_coord_t height);
 void app_anim_y(lv_obj_t *obj, uint32_t delay, lv_coord_t offs, bool reverse, bool out = false);
+bool app_show_run_btn(lv_obj_t *run_btn, bool started);
+void app_save_learning(uint16_t profile);
+bool app_load_profile(uint16_t index, Profile *profile);
+bool app_save_profile(uint16_t index, const Profile *profile);
+void app_select_profile(uint16_t index);
 lv_obj_t *rollpick_create(WidgetParameterData *wpd, const char *headerTitle, const char *options,
                           const lv_font_t *headerFont = &lv_font_montserrat_20, lv_coord_t width = lv_pct(70),
                           lv_coord_t height = lv_pct(70));
@@ -0,0 +1,322 @@
+#include "profile_store.h"
+#include "Log.h"
+#include <string.h>
+
+static uint8_t profile_crc8(const uint8_t *data, uint16_t len)
+{
+    uint8_t crc = 0;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint8_t *profile_putVarint(uint8_t *dest, uint16_t value)
+{
+    while (value >= 0x80)
+    {
+        *dest++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *dest++ = value;
+    return dest;
+}
+
+// Returns NULL if the varint runs past end or doesn't fit 16 bits
+static const uint8_t *profile_getVarint(const uint8_t *src, const uint8_t *end, uint16_t *value)
+{
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 21; shift += 7)
+    {
+        if (src >= end)
+            return NULL;
+        uint8_t byte = *src++;
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            if (v > 0xFFFF)
+                return NULL;
+            *value = v;
+            return src;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Encode the used data points of a profile, at most PROFILE_ENCODED_MAX bytes are written to dest
+ *
+ * @param profile
+ * @param dest
+ * @return uint8_t Encoded length, 0 if the data point count is out of range
+ */
+uint8_t profile_encode(const Profile *profile, uint8_t *dest)
+{
+    uint8_t count = profile->dataPoint;
+    if (count == 0 || count > profile_maximumDataPoint)
+        return 0;
+    bool wide = false;
+    for (uint8_t i = 0; i < count; i++)
+        if (profile->targetTemperature[i] < 0 || profile->targetTemperature[i] > 0xFF)
+            wide = true;
+
+    uint8_t *p = dest;
+    *p++ = count | (wide ? 0x80 : 0);
+    p = profile_putVarint(p, profile->startTopHeaterAt);
+    uint16_t second = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int temperature = profile->targetTemperature[i];
+        if (wide)
+        {
+            int16_t t = temperature < INT16_MIN ? INT16_MIN : (temperature > INT16_MAX ? INT16_MAX : temperature);
+            memcpy(p, &t, sizeof(t));
+            p += sizeof(t);
+        }
+        else
+            *p++ = temperature;
+        // Wraps around if the seconds go backward, decoding wraps the same way
+        p = profile_putVarint(p, (uint16_t)(profile->targetSecond[i] - second));
+        second = profile->targetSecond[i];
+    }
+    *p = profile_crc8(dest, p - dest);
+    p++;
+    return p - dest;
+}
+
+/**
+ * @brief Decode a profile encoded by profile_encode()
+ *
+ * @param profile Left untouched if the encoded profile is not valid
+ * @param src
+ * @param available Bytes readable from src
+ * @return uint8_t Encoded length, 0 if it's not valid
+ */
+uint8_t profile_decode(Profile *profile, const uint8_t *src, uint16_t available)
+{
+    const uint8_t *p = src;
+    const uint8_t *end = src + available;
+    if (p >= end)
+        return 0;
+    uint8_t count = *p & 0x7F;
+    bool wide = *p++ & 0x80;
+    if (count == 0 || count > profile_maximumDataPoint)
+        return 0;
+
+    Profile decoded;
+    decoded.dataPoint = count;
+    p = profile_getVarint(p, end, &decoded.startTopHeaterAt);
+    uint16_t second = 0;
+    for (uint8_t i = 0; i < count && p != NULL; i++)
+    {
+        if (wide)
+        {
+            int16_t t;
+            if (end - p < (int)sizeof(t))
+                return 0;
+            memcpy(&t, p, sizeof(t));
+            p += sizeof(t);
+            decoded.targetTemperature[i] = t;
+        }
+        else
+        {
+            if (p >= end)
+                return 0;
+            decoded.targetTemperature[i] = *p++;
+        }
+        uint16_t delta;
+        p = profile_getVarint(p, end, &delta);
+        second += delta;
+        decoded.targetSecond[i] = second;
+    }
+    if (p == NULL || p >= end || profile_crc8(src, p - src) != *p)
+        return 0;
+    *profile = decoded;
+    return p + 1 - src;
+}
+
+#ifdef PICO_BOARD
+static ProfileStore *profile_store = NULL; // Store the writer callbacks belong to, set by mount()
+
+/**
+ * @brief Load the directory and read each profile once for its size, entries pointing to a profile that doesn't
+ * decode are dropped
+ *
+ */
+void ProfileStore::mount()
+{
+    profile_store = this;
+    if (mutex == NULL)
+        mutex = xSemaphoreCreateMutex();
+    memset(directory, PROFILE_STORE_EMPTY, sizeof(directory));
+    memset(units, 0, sizeof(units));
+    memset(pending, PROFILE_STORE_EMPTY, sizeof(pending));
+    uint8_t loaded[profile_count];
+    if (!store->load(directoryRecord, loaded, sizeof(loaded)))
+        return;
+    for (uint16_t i = 0; i < profile_count; i++)
+    {
+        if (loaded[i] == PROFILE_STORE_EMPTY)
+            continue;
+        units[i] = readUnits(loaded[i]);
+        if (units[i])
+            directory[i] = loaded[i];
+        else
+            LOG_WARN("Profile %u is corrupted, using the default one\n", i);
+    }
+}
+
+// Heap units taken by the profile starting at a unit, 0 if it's empty, can't be read or doesn't decode
+uint8_t ProfileStore::readUnits(uint8_t unit)
+{
+    if (unit == PROFILE_STORE_EMPTY || unit >= heapUnits)
+        return 0;
+    Profile profile;
+    uint8_t encoded[PROFILE_ENCODED_MAX];
+    uint16_t available = std::min<uint16_t>((heapUnits - unit) * PROFILE_STORE_UNIT, sizeof(encoded));
+    if (!store->readRaw(heapBase + unit * PROFILE_STORE_UNIT, encoded, available))
+        return 0;
+    uint8_t len = profile_decode(&profile, encoded, available);
+    return (len + PROFILE_STORE_UNIT - 1) / PROFILE_STORE_UNIT;
+}
+
+/**
+ * @brief Read the units of a profile from the EEPROM and decode it
+ *
+ * @param index
+ * @param profile Left untouched if the profile was never saved or can't be read
+ * @return false if the profile was never saved or can't be read
+ */
+bool ProfileStore::load(uint16_t index, Profile *profile)
+{
+    if (index >= profile_count)
+        return false;
+    uint8_t encoded[(PROFILE_ENCODED_MAX + PROFILE_STORE_UNIT - 1) / PROFILE_STORE_UNIT * PROFILE_STORE_UNIT];
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint16_t len = units[index] * PROFILE_STORE_UNIT;
+    bool ok = len > 0 && store->readRaw(heapBase + directory[index] * PROFILE_STORE_UNIT, encoded, len);
+    xSemaphoreGive(mutex);
+    return ok && profile_decode(profile, encoded, len) > 0;
+}
+
+/**
+ * @brief Find a free run of units, every saved profile is kept including the old copy of the one being saved and
+ * the copies still waiting for their directory update, the mutex has to be held
+ *
+ * @param count
+ * @return uint8_t First unit of the run, PROFILE_STORE_EMPTY if there's no room left
+ */
+uint8_t ProfileStore::allocate(uint8_t count)
+{
+    uint8_t used[256 / 8] = {};
+    for (uint16_t i = 0; i < profile_count; i++)
+    {
+        for (uint8_t u = 0; u < units[i]; u++)
+            used[(directory[i] + u) / 8] |= 1 << ((directory[i] + u) % 8);
+        for (uint8_t u = 0; pending[i] != PROFILE_STORE_EMPTY && u < pendingUnits[i]; u++)
+            used[(pending[i] + u) / 8] |= 1 << ((pending[i] + u) % 8);
+    }
+
+    for (uint8_t tried = 0; tried < heapUnits; tried++)
+    {
+        uint8_t start = (nextUnit + tried) % heapUnits;
+        if (start + count > heapUnits)
+            continue;
+        uint8_t u = 0;
+        while (u < count && !(used[(start + u) / 8] & (1 << ((start + u) % 8))))
+            u++;
+        if (u == count)
+            return start;
+    }
+    return PROFILE_STORE_EMPTY;
+}
+
+/**
+ * @brief Encode a profile on free heap space, the new directory is queued once that write succeeded
+ *
+ * @param index
+ * @param profile
+ * @param callback Passed to the writer for the directory, or called with ok false if the profile itself failed
+ * @return false if there's no room left on the heap or the writer queue is full
+ */
+bool ProfileStore::save(uint16_t index, const Profile *profile, AT24C16WriterCallback callback)
+{
+    uint8_t encoded[PROFILE_ENCODED_MAX];
+    uint8_t len = profile_encode(profile, encoded);
+    if (index >= profile_count || len == 0)
+        return false;
+
+    uint8_t count = (len + PROFILE_STORE_UNIT - 1) / PROFILE_STORE_UNIT;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint8_t unit = allocate(count);
+    // A save of the same profile still pending is dropped, its callback never matches anymore
+    bool queued = unit != PROFILE_STORE_EMPTY;
+    if (queued)
+    {
+        pending[index] = unit;
+        pendingUnits[index] = count;
+        pendingCallback[index] = callback;
+        queued = store->writeRaw(heapBase + unit * PROFILE_STORE_UNIT, encoded, len, heapWritten);
+        if (queued)
+            nextUnit = (unit + count) % heapUnits;
+        else
+            pending[index] = PROFILE_STORE_EMPTY;
+    }
+    xSemaphoreGive(mutex);
+    return queued;
+}
+
+/**
+ * @brief Writer callback of a profile on the heap, commits the directory pointing to it if it was written
+ *
+ */
+void ProfileStore::heapWritten(uint16_t address, uint16_t pagesWritten, bool ok)
+{
+    ProfileStore *self = profile_store;
+    uint8_t unit = (address - self->heapBase) / PROFILE_STORE_UNIT;
+    uint16_t index = 0;
+    AT24C16WriterCallback callback = NULL;
+    xSemaphoreTake(self->mutex, portMAX_DELAY);
+    while (index < profile_count && self->pending[index] != unit)
+        index++;
+    if (index == profile_count)
+    {
+        xSemaphoreGive(self->mutex);
+        return;
+    }
+    self->pending[index] = PROFILE_STORE_EMPTY;
+    callback = self->pendingCallback[index];
+    if (ok)
+    {
+        uint8_t updated[profile_count];
+        memcpy(updated, self->directory, sizeof(updated));
+        updated[index] = unit;
+        ok = self->store->save(self->directoryRecord, updated, sizeof(updated), callback);
+        if (ok)
+        {
+            self->directory[index] = unit;
+            self->units[index] = self->pendingUnits[index];
+        }
+    }
+    xSemaphoreGive(self->mutex);
+    if (!ok)
+    {
+        LOG_ERROR("Profile %u not saved, the previous one is kept\n", index);
+        if (callback)
+            callback(address, pagesWritten, false);
+    }
+}
+
+uint16_t ProfileStore::getFree()
+{
+    uint16_t used = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (uint16_t i = 0; i < profile_count; i++)
+        used += units[i];
+    xSemaphoreGive(mutex);
+    return (heapUnits - used) * PROFILE_STORE_UNIT;
+}
+#endif
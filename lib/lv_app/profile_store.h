@@ -0,0 +1,84 @@
+#ifndef _PROFILE_STORE_H
+#define _PROFILE_STORE_H
+#include <stdint.h>
+#include <algorithm>
+
+static constexpr uint8_t profile_maximumDataPoint = 20;
+static constexpr uint16_t profile_count = 40;         // Profiles in the directory
+static constexpr uint16_t profile_learningCount = 10; // The first profiles also get an iterative learning table
+struct Profile
+{
+    uint8_t dataPoint = 1;
+    int targetTemperature[profile_maximumDataPoint];
+    uint16_t targetSecond[profile_maximumDataPoint];
+    uint16_t startTopHeaterAt = 0;
+    Profile()
+    {
+        std::fill(targetTemperature, &targetTemperature[0] + profile_maximumDataPoint, 0);
+        std::fill(targetSecond, &targetSecond[0] + profile_maximumDataPoint, 0);
+        targetTemperature[0] = 30;
+        targetSecond[0] = 0;
+    }
+};
+
+/*
+ * Encoded profile, only the used data points are stored:
+ *   data point count, bit 7 set when the temperatures need 16 bits
+ *   startTopHeaterAt as a varint
+ *   per data point the temperature (8 or 16 bits) and the delta from the previous second as a varint
+ *   CRC8 of everything above
+ * A usual profile with temperatures up to 255 and steps shorter than 128 seconds takes 2 bytes per data point.
+ */
+static constexpr uint8_t PROFILE_ENCODED_MAX = 1 + 3 + profile_maximumDataPoint * (2 + 3) + 1;
+
+uint8_t profile_encode(const Profile *profile, uint8_t *dest);
+uint8_t profile_decode(Profile *profile, const uint8_t *src, uint16_t available);
+
+#ifdef PICO_BOARD
+#include <AT24C16Store.h>
+
+// Heap offsets of the directory are counted in units, 0xFF marks an empty profile
+static constexpr uint8_t PROFILE_STORE_UNIT = 4;
+static constexpr uint8_t PROFILE_STORE_EMPTY = 0xFF;
+
+/**
+ * @brief Profiles are encoded back to back on a heap area of the EEPROM, the directory record of the store holds the
+ * heap offset of each profile. A saved profile is written to free heap space first and the directory is only saved
+ * from the completion callback of that write once it succeeded, so the old copy stays valid until the new directory
+ * is committed. Only the heap units taken by each profile are kept in RAM, a profile is read from the EEPROM and
+ * decoded on load(). The directory and the pending saves are guarded by a mutex, save() and the writer callback
+ * change them from different tasks.
+ */
+class ProfileStore
+{
+public:
+    ProfileStore(AT24C16Store *_store, uint8_t _directoryRecord, uint16_t _heapBase, uint16_t _heapSize)
+        : store(_store), directoryRecord(_directoryRecord), heapBase(_heapBase), heapUnits(_heapSize / PROFILE_STORE_UNIT)
+    {
+    }
+    void mount();
+    bool load(uint16_t index, Profile *profile);
+    bool save(uint16_t index, const Profile *profile, AT24C16WriterCallback callback = NULL);
+    // Free heap space in bytes, a profile may still not fit if the space is fragmented
+    uint16_t getFree();
+
+protected:
+    static void heapWritten(uint16_t address, uint16_t pagesWritten, bool ok);
+    uint8_t readUnits(uint8_t unit);
+    uint8_t allocate(uint8_t units);
+
+    AT24C16Store *store;
+    uint8_t directoryRecord;
+    uint16_t heapBase;
+    uint8_t heapUnits;
+    SemaphoreHandle_t mutex = NULL; // Created by mount()
+    uint8_t directory[profile_count];
+    uint8_t units[profile_count]; // Heap units taken by each directory entry, 0 if it's empty
+    // Heap unit of each profile written but not committed to the directory yet, taken by the writer callback
+    uint8_t pending[profile_count];
+    uint8_t pendingUnits[profile_count];
+    AT24C16WriterCallback pendingCallback[profile_count];
+    uint8_t nextUnit = 0; // Where the search for free space starts, so the writes go around the whole heap
+};
+#endif
+#endif
@@ -1,4 +1,6 @@
 #include "lv_drivers.h"
+#include "Health.h"
+#include "lv_app.h"
 
 static constexpr size_t displayBufferSize = 480 * 80;
 
@@ -25,6 +27,7 @@ void init_display()
     tft->setRotation(INVERTED_LANDSCAPE);
     // Initialize DMA for display and it's transfer complete callback
     tft->dmaInit([]() {
+        HealthIsr timed;
         // DMA transfer is complete, send ready flag to lv_disp
         lv_disp_flush_ready(&lv_display_device);
         // Clear the IRQ flag, must be called so that the IRQ can be called next time
@@ -54,6 +57,7 @@ void init_display()
     add_repeating_timer_ms(
         5,
         [](struct repeating_timer *t) -> bool {
+            HealthIsr timed;
             lv_tick_inc(5);
             return true;
         },
@@ -74,8 +78,13 @@ void lv_display_flush_cb(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t
 
 void lv_input_touch_cb(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
 {
-    TouchCoordinate tc;
-    tft->sampleTouch(tc);
+    // Two touch pins are shared with the SD card, the last reading is kept while the card is accessed
+    static TouchCoordinate tc;
+    if (sdCard.takePins(0))
+    {
+        tft->sampleTouch(tc);
+        sdCard.givePins();
+    }
     data->state = tc.touched ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
     data->point.x = tc.x;
     data->point.y = tc.y;
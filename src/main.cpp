@@ -6,13 +6,25 @@
  * @date 2022-07-26
  *
  * @copyright Copyright (c) 2022
- * @todo Auto operation is not yet implemented because the profile graph
- * somehow bugged and not drawn when the profile total second is >= 373
+ * @todo The profile graph of auto operation is somehow bugged and not drawn
+ * when the profile total second is >= 373
  */
 
 #include "FreeRTOS.h"
+#include "Filters.h"
+#include "FlashRecorder.h"
 #include "HC595.h"
+#include "Health.h"
+#include "HostLink.h"
+#include "Log.h"
 #include "MAX6675.h"
+#include "MAX31855.h"
+#include "MAX31856.h"
+#include "MAX6675Pio.h"
+#include "ModbusLink.h"
+#include "RunClock.h"
+#include "SpscRing.h"
+#include "decoupler.h"
 #include "globals.h"
 #include "hardware/adc.h"
 #include "hardware/clocks.h"
@@ -20,52 +32,146 @@
 #include "hardware/structs/clocks.h"
 #include "hardware/structs/pll.h"
 #include "hardware/structs/rosc.h"
+#include "iterative_learning.h"
 #include "lv_app.h"
 #include "lv_drivers.h"
 #include "lvgl.h"
-#include "movingAvg.h"
+#include "gain_schedule.h"
 #include "pid.h"
+#include "pico/unique_id.h"
 #include "semphr.h"
+#include "smith_predictor.h"
 #include "task.h"
+#include "thermal_kalman.h"
 #include <tusb.h>
+#include <type_traits>
 
 void blinkStatusLED();
+static void applyGainSchedule(PIDController *pid, const GainSchedule *schedule, float pv);
+static uint32_t profileDuration(const Profile *profile);
+static void profileSetpoint(const Profile *profile, float second, float *bottomSV, float *topSV);
+static void remoteCommands(const HostLinkStatus *status);
+static uint8_t runHeader(uint8_t *dest, bool automatic, uint16_t profileIndex, const Profile *profile);
 static void lv_app_task(void *pvParameter);
 static void sensor_task(void *pvParameter);
 static void pid_task(void *pvParameter);
 
 HC595 sft(SFT_DATA, SFT_LATCH, SFT_CLOCK);
-MAX6675 top_max6675(THERM_DATA, THERM_SCK, THERM_CS);
-MAX6675 bottom_max6675(THERM_DATA, THERM_SCK, UART0_RX);
-movingAvg adc_topHeater(10);
-movingAvg adc_bottomHeater(10);
+// Thermocouple converter of each zone: MAX6675, MAX31855 or MAX31856 (the MAX31856 needs THERM_SDI wired)
+typedef MAX6675 BottomThermocouple;
+typedef MAX6675 TopThermocouple;
+BottomThermocouple bottomThermocouple(THERM_DATA, THERM_SCK, THERM_CS_BOTTOM, THERM_SDI);
+TopThermocouple topThermocouple(THERM_DATA, THERM_SCK, THERM_CS, THERM_SDI);
+// Two MAX6675 are read in background by PIO and DMA instead, the other converters are polled by sensor_task
+static constexpr bool thermocouple_usePio =
+    std::is_same<BottomThermocouple, MAX6675>::value && std::is_same<TopThermocouple, MAX6675>::value;
+MAX6675Pio max6675(THERM_DATA, THERM_SCK, THERM_CS_BOTTOM, THERM_CS);
+// Samples handed from sensor_task to pid_task without a mutex, the two tasks may run on different cores
+static SpscRing<ThermocoupleSample, 32> thermocouple_ring;
+// Thermocouple filter used by the control loop, any filter of Filters.h can be picked here. Only pid_task touches
+// the filters and the Kalman estimates below
+typedef Filters::SMA<10> ThermocoupleFilter;
+ThermocoupleFilter filter_topHeater;
+ThermocoupleFilter filter_bottomHeater;
+// Kalman estimate of each zone fusing the thermocouple with the SSR duty, used as PV instead of the filter above once
+// it's enabled here. Off until its noise settings are tuned on the hardware, the estimates are kept up to date anyway
+static constexpr bool thermocouple_useKalman = false;
+static constexpr float kalman_measurementNoise = 0.35f; // in celcius^2, MAX6675 noise and 0.25 celcius steps
+static constexpr float kalman_temperatureNoise = 0.01f; // in celcius^2/s
+static constexpr float kalman_rateNoise = 0.02f;        // in (celcius/s)^2/s
+static constexpr float kalman_ambient = 25.0f;          // in celcius
+ThermalKalman kalman_topHeater;
+ThermalKalman kalman_bottomHeater;
 PIDController PID_bottomHeater, PID_topHeater;
+RunClock runClock;
 
 static uint32_t bottomHeaterPV = 0;
 static uint32_t topHeaterPV = 0;
 static uint32_t bottomHeaterSV = 300;
 static uint32_t topHeaterSV = 0;
 
-static uint32_t secondsRunning = 0;
+static uint32_t secondsRunning = 0; // Whole seconds of runClock, mirrored for lv_app
 static bool startedAuto;
 static bool startedManual;
 static uint16_t selectedProfile = 0;
-static Profile profileLists[10];
+static Profile activeProfile; // Selected profile, decoded by lv_app from the EEPROM on selection
 
 // Variable to store PID constants, P I D and tau consecutively
 static double topHeaterPID[4];
 static double bottomHeaterPID[4];
 
+// Temperature scheduled PID gains, used instead of the fixed PID constants above when enabled
+static GainSchedule topHeaterSchedule;
+static GainSchedule bottomHeaterSchedule;
+
+// Optional 2x2 decoupler in front of both PIDs and the step test used to identify it
+static Decoupler decoupler;
+static CouplingStepTest couplingTest;
+static constexpr float couplingTest_stepDuty = 0.5f;
+static constexpr uint32_t couplingTest_stepDuration = 180; // in seconds
+
+// Dead time compensation, the PIDs act on the predicted temperature instead of the lagging thermocouple reading
+static SmithPredictor topHeaterPredictor;
+static SmithPredictor bottomHeaterPredictor;
+
+// Run-to-run learning of a feed-forward duty for each profile slot, used on auto operation
+static LearningTable profileLearning[profile_learningCount];
+static IterativeLearning learning;
+static int16_t learnedProfile = -1; // Profile whose learning table was updated and has to be saved by lv_app
+static constexpr float learning_gain = 0.004f; // in duty per celcius
+static constexpr uint16_t learning_lead = 10;  // in seconds
+
+// Every run is recorded to a circular log on the flash, just below the settings. A run starts with a header page
+// (board id, operation and profile), then a 16 bytes sample per control period:
+//   [0..1] second, [2..5] SV bottom and top in celcius, [6..9] PV bottom and top in 0.1 celcius,
+//   [10..13] duty bottom and top in pwm_resolution, [14] thermocouple status bottom (bits 0-2) and top (bits 3-5),
+//   auto operation (bit 6), learned feed-forward applied (bit 7), [15] reserved
+static constexpr uint32_t recorder_size = 1024 * 1024; // ~17 hours of runs
+static constexpr uint32_t recorder_offset = FLASH_SettingsOffset - recorder_size;
+static constexpr uint8_t recorder_sampleSize = 16;
+static_assert(recorder_sampleSize == HOSTLINK_RUN_RECORD_SIZE, "The host tools read the samples of the run log");
+FlashRecorder runRecorder(&flashLockout, recorder_offset, recorder_size);
+
+// Every run is also streamed to a numbered file of the SD card, either one CSV line per control period or the same
+// samples as the recorder for a smaller file
+static constexpr bool sdLog_binary = false;
+
+// Modbus slave for the line PLCs on the third USB CDC interface. TCP framing is for a TCP to serial bridge on the
+// host, like socat TCP-LISTEN:502,fork,reuseaddr /dev/ttyACM2,raw
+static constexpr ModbusFraming modbus_framing = MODBUS_RTU;
+static constexpr uint8_t modbus_address = 1;
+ModbusLink modbusLink(&hostLink, modbus_framing, modbus_address);
+
 static constexpr UBaseType_t lv_app_task_priority = (tskIDLE_PRIORITY + 1);
 static constexpr UBaseType_t sensor_task_priority = (tskIDLE_PRIORITY + 2);
 static constexpr UBaseType_t pid_task_priority = (tskIDLE_PRIORITY + 3);
+static constexpr UBaseType_t eeprom_task_priority = (tskIDLE_PRIORITY + 1); // Mostly waits on I2C
+static constexpr uint32_t eeprom_task_stack_size = 512UL;
+static constexpr UBaseType_t recorder_task_priority = (tskIDLE_PRIORITY + 1); // Mostly waits on the flash
+static constexpr uint32_t recorder_task_stack_size = 512UL;
+static constexpr UBaseType_t flash_task_priority = (tskIDLE_PRIORITY + 1); // Mostly waits on the flash
+static constexpr uint32_t flash_task_stack_size = 512UL;
+static constexpr UBaseType_t sd_task_priority = (tskIDLE_PRIORITY + 1); // Mostly waits on the SPI
+static constexpr uint32_t sd_task_stack_size = 512UL;
+static constexpr UBaseType_t usb_task_priority = (tskIDLE_PRIORITY + 2);
+static constexpr UBaseType_t sampler_task_priority = (tskIDLE_PRIORITY + 2); // Keeps the telemetry rate
+static constexpr UBaseType_t link_task_priority = (tskIDLE_PRIORITY + 1);    // Mostly waits on the USB FIFO
+static constexpr uint32_t host_link_task_stack_size = 512UL;
+static constexpr UBaseType_t log_task_priority = (tskIDLE_PRIORITY + 1); // Console output is never urgent
+static constexpr uint32_t log_task_stack_size = 1024UL;
+static constexpr UBaseType_t modbus_task_priority = (tskIDLE_PRIORITY + 1);
+static constexpr uint32_t modbus_task_stack_size = 512UL;
+static constexpr UBaseType_t health_task_priority = (tskIDLE_PRIORITY + 1);
+static constexpr uint32_t health_task_stack_size = 512UL;
 static constexpr uint32_t lv_app_task_stack_size = 8192UL;
 static constexpr uint32_t sensor_task_stack_size = configMINIMAL_STACK_SIZE;
 static constexpr uint32_t pid_task_stack_size = 1024UL;
 static TaskHandle_t lv_app_task_handle;
 static TaskHandle_t sensor_task_handle;
 static TaskHandle_t pid_task_handle;
-static SemaphoreHandle_t sensor_mutex;
+static constexpr uint32_t max6675_period = 220; // in ms, MAX6675 max conversion time is 220ms
+
+static constexpr uint32_t thermocouple_maxAge = 1000; // in ms, the held value turns stale after this
 
 bool pwm_timer_cb(repeating_timer_t *rt);
 static constexpr uint16_t pwm_resolution = 1000;
@@ -90,6 +196,22 @@ int main()
     // Initialize shift register (only used for SSR PWM)
     sft.init();
 
+    // Initialize the run clock used by the control loop, profile runner and chart
+    runClock.init();
+
+    // Gain schedules are disabled until loaded from EEPROM by lv_app
+    GainSchedule_Init(&topHeaterSchedule);
+    GainSchedule_Init(&bottomHeaterSchedule);
+    Decoupler_Init(&decoupler);
+    CouplingStepTest_Init(&couplingTest, couplingTest_stepDuty, couplingTest_stepDuration);
+    SmithPredictor_Init(&topHeaterPredictor);
+    SmithPredictor_Init(&bottomHeaterPredictor);
+    ThermalKalman_Init(&kalman_topHeater, kalman_measurementNoise, kalman_temperatureNoise, kalman_rateNoise);
+    ThermalKalman_Init(&kalman_bottomHeater, kalman_measurementNoise, kalman_temperatureNoise, kalman_rateNoise);
+    for (int i = 0; i < profile_learningCount; i++)
+        LearningTable_Init(&profileLearning[i]);
+    IterativeLearning_Init(&learning, learning_gain, learning_lead);
+
     // Initializer pointers used for lv_app
     {
         using namespace lv_app_pointers;
@@ -104,22 +226,58 @@ int main()
         pStartedManual = &startedManual;
         pTopHeaterPID = &topHeaterPID;
         pBottomHeaterPID = &bottomHeaterPID;
+        pTopHeaterSchedule = &topHeaterSchedule;
+        pBottomHeaterSchedule = &bottomHeaterSchedule;
+        pDecoupler = &decoupler;
+        pCouplingTest = &couplingTest;
+        pTopHeaterPredictor = &topHeaterPredictor;
+        pBottomHeaterPredictor = &bottomHeaterPredictor;
+        pProfileLearning = &profileLearning;
+        pLearnedProfile = &learnedProfile;
         pSelectedProfile = &selectedProfile;
-        pProfileLists = &profileLists;
+        pActiveProfile = &activeProfile;
     }
 
     // Initialize mutex and queues used later for RTOS tasks
     lv_app_mutex = xSemaphoreCreateMutex();
-    sensor_mutex = xSemaphoreCreateMutex();
     pwm_ssr0_queue = xQueueCreate(1, sizeof(uint32_t));
     pwm_ssr1_queue = xQueueCreate(1, sizeof(uint32_t));
 
     add_repeating_timer_us(pwm_period, pwm_timer_cb, NULL, &pwm_timer);
 
+    // Console output of the tasks is formatted and written by the log task, they only queue the records
+    if (!logger.init(log_task_priority, log_task_stack_size))
+        printf("Log init failed!\n");
+    // Loads, stack and heap margins for the diagnostics screen and the host link
+    if (!health.init(health_task_priority, health_task_stack_size))
+        printf("Health init failed!\n");
+
     // Create RTOS tasks
     xTaskCreate(lv_app_task, "lv_app_task", lv_app_task_stack_size, NULL, lv_app_task_priority, &lv_app_task_handle);
     xTaskCreate(sensor_task, "sensor_task", sensor_task_stack_size, NULL, sensor_task_priority, &sensor_task_handle);
     xTaskCreate(pid_task, "pid_task", pid_task_stack_size, NULL, pid_task_priority, &pid_task_handle);
+    // EEPROM writes requested by lv_app run on their own task, so the UI never waits for them
+    if (!EEPROMWriter.init(eeprom_task_priority, eeprom_task_stack_size))
+        printf("EEPROM writer init failed!\n");
+    // Flash writes park the other core on a task of its own, so nothing runs from flash while it's programmed
+    if (!flashLockout.init())
+        printf("Flash lockout init failed!\n");
+    // Settings put by lv_app are written to the flash by their own task, like the EEPROM ones
+    if (!FlashSettings.init(flash_task_priority, flash_task_stack_size))
+        printf("Flash settings init failed!\n");
+    // Run samples are batched by pid_task and written a page at a time by the recorder task
+    if (!runRecorder.mount())
+        printf("Run recorder region is not usable, runs are not recorded!\n");
+    else if (!runRecorder.init(recorder_task_priority, recorder_task_stack_size))
+        printf("Run recorder init failed!\n");
+    // The card is only detected when a run starts, so it may be inserted at any time
+    if (!sdCard.init() || !sdLogger.init(sd_task_priority, sd_task_stack_size))
+        printf("SD card logger init failed!\n");
+    // The console moves from the UART to the first USB CDC interface once the scheduler runs
+    if (!hostLink.init(usb_task_priority, sampler_task_priority, link_task_priority, host_link_task_stack_size))
+        printf("Host link init failed!\n");
+    else if (!modbusLink.init(modbus_task_priority, modbus_task_stack_size))
+        printf("Modbus init failed!\n");
 
     // Start the RTOS scheduler, the created tasks will run after this point
     vTaskStartScheduler();
@@ -133,6 +291,7 @@ bool pwm_timer_cb(repeating_timer_t *rt)
 {
     static uint16_t c_pwm_ssr0 = 0;
     static uint16_t c_pwm_ssr1 = 0;
+    HealthIsr timed;
 
     // Check queue for any data, if there is some data, put it on corresponding c_pwm_ssrx
     xQueueReceiveFromISR(pwm_ssr0_queue, &c_pwm_ssr0, NULL);
@@ -177,25 +336,58 @@ static void lv_app_task(void *pvParameter)
     }
 }
 
-// Task to sample MAX6675 thermocouple every 200ms (MAX6675 conversion time is 170ms)
+// Task to collect the thermocouple readouts, either from the MAX6675 PIO reader or by polling both converters
 static void sensor_task(void *pvParameter)
 {
-    top_max6675.init();
-    bottom_max6675.init();
-    adc_topHeater.begin();
-    adc_bottomHeater.begin();
+    if (thermocouple_usePio)
+    {
+        if (!max6675.init(max6675_period))
+            LOG_ERROR("MAX6675 PIO init failed!\n");
+    }
+    else
+    {
+        bottomThermocouple.init();
+        topThermocouple.init();
+    }
     for (;;)
     {
-        uint16_t top_adc = top_max6675.sample();
-        uint16_t bottom_adc = bottom_max6675.sample();
-
-        xSemaphoreTake(sensor_mutex, portMAX_DELAY);
-        // Add the new adc readout to the moving average
-        adc_topHeater.reading(top_adc);
-        adc_bottomHeater.reading(bottom_adc);
-        xSemaphoreGive(sensor_mutex);
+        // Hand the samples over to pid_task, a full ring drops the newest samples and counts them
+        ThermocoupleSample sample;
+        if (thermocouple_usePio)
+        {
+            MAX6675Frame frame;
+            while (max6675.read(&frame))
+            {
+                sample.celcius = MAX6675::toCelcius(MAX6675Pio::toAdc(frame.raw));
+                sample.status = frame.status;
+                sample.zone = frame.cs == THERM_CS ? DECOUPLER_TOP : DECOUPLER_BOTTOM;
+                sample.timestamp = frame.timestamp;
+                if (sample.status == THERMOCOUPLE_VALID)
+                    hostLink.setRaw(sample.zone, sample.celcius);
+                thermocouple_ring.push(sample);
+            }
+        }
+        else
+        {
+            if (bottomThermocouple.poll(&sample))
+            {
+                sample.zone = DECOUPLER_BOTTOM;
+                if (sample.status == THERMOCOUPLE_VALID)
+                    hostLink.setRaw(sample.zone, sample.celcius);
+                thermocouple_ring.push(sample);
+            }
+            if (topThermocouple.poll(&sample))
+            {
+                sample.zone = DECOUPLER_TOP;
+                if (sample.status == THERMOCOUPLE_VALID)
+                    hostLink.setRaw(sample.zone, sample.celcius);
+                thermocouple_ring.push(sample);
+            }
+        }
 
-        vTaskDelay(200 / portTICK_PERIOD_MS);
+        // Nothing is timing critical with the PIO reader, the polled converters are read within 10ms of their
+        // conversion
+        vTaskDelay((thermocouple_usePio ? 50 : 10) / portTICK_PERIOD_MS);
     }
 }
 
@@ -206,20 +398,83 @@ static void pid_task(void *pvParameter)
     // Kd = P / w2
     static constexpr float PID_sampleTime = 1.0f;
     static constexpr float PID_derivativeTau = 2.161931848f;
-    bool lastStartedManual;
+    bool lastStartedManual = false;
+    bool lastStartedAuto = false;
+    uint16_t runProfile = 0;
+    Profile runProfileData; // Copy of the selected profile taken when the auto operation starts
+    ThermocoupleStatus lastStatus[2] = {THERMOCOUPLE_VALID, THERMOCOUPLE_VALID};
+    // Status of the last sample of each zone and when it and the last valid one were read, bottom then top
+    ThermocoupleStatus sampleStatus[2] = {THERMOCOUPLE_NOT_READY, THERMOCOUPLE_NOT_READY};
+    uint64_t lastTimestamp[2] = {0, 0};
+    uint64_t lastValid[2] = {0, 0};
+    filter_topHeater.reset();
+    filter_bottomHeater.reset();
     PIDController_Init(&PID_bottomHeater);
     PIDController_SetIntegralLimit(&PID_bottomHeater, 0.f, 1.0f);
     PIDController_SetOutputLimit(&PID_bottomHeater, 0.0f, 1.0f);
     PIDController_Init(&PID_topHeater);
     PIDController_SetIntegralLimit(&PID_topHeater, 0.f, 1.0f);
     PIDController_SetOutputLimit(&PID_topHeater, 0.0f, 1.0f);
+    uint64_t lastLoopStart = 0;
+    float reportedSV[2] = {0.0f, 0.0f}; // Applied on the previous iteration, for the status of the host link
+    float reportedDuty[2] = {0.0f, 0.0f};
+    TickType_t lastWakeTime = xTaskGetTickCount();
     for (;;)
     {
-        xSemaphoreTake(sensor_mutex, portMAX_DELAY);
-        // Calculate the adc readout to temperature in celcius
-        float topHeaterPV_f = MAX6675::toCelcius(adc_topHeater.getAvg());
-        float bottomHeaterPV_f = MAX6675::toCelcius(adc_bottomHeater.getAvg());
-        xSemaphoreGive(sensor_mutex);
+        uint64_t loopStart = time_us_64();
+        // Run the samples read since the last cycle through the filters
+        ThermocoupleSample sample;
+        while (thermocouple_ring.pop(&sample))
+        {
+            bool top = sample.zone == DECOUPLER_TOP;
+            uint8_t zone = sample.zone;
+            sampleStatus[zone] = sample.status;
+
+            // The Kalman filter of the zone is predicted with the duty this task applied since its previous sample
+            ThermalKalman *kf = top ? &kalman_topHeater : &kalman_bottomHeater;
+            float duty = (float)(top ? pwm_ssr1 : pwm_ssr0) / pwm_resolution;
+            if (lastTimestamp[zone])
+                ThermalKalman_Predict(kf, duty, (sample.timestamp - lastTimestamp[zone]) / 1e6f);
+            lastTimestamp[zone] = sample.timestamp;
+
+            // Invalid samples are kept out of the filters, so they hold the last good value
+            if (sample.status == THERMOCOUPLE_VALID)
+            {
+                if (top)
+                    filter_topHeater.update(Filters::toFixed(sample.celcius));
+                else
+                    filter_bottomHeater.update(Filters::toFixed(sample.celcius));
+                ThermalKalman_Correct(kf, sample.celcius);
+                lastValid[zone] = sample.timestamp;
+            }
+        }
+
+        // Filtered temperatures in celcius
+        float topHeaterPV_f = Filters::toFloat(filter_topHeater.value());
+        float bottomHeaterPV_f = Filters::toFloat(filter_bottomHeater.value());
+        if (thermocouple_useKalman && kalman_topHeater.initialized && kalman_bottomHeater.initialized)
+        {
+            topHeaterPV_f = ThermalKalman_Temperature(&kalman_topHeater);
+            bottomHeaterPV_f = ThermalKalman_Temperature(&kalman_bottomHeater);
+        }
+        // A zone without a valid sample for thermocouple_maxAge is stale, otherwise it reports its last sample status
+        ThermocoupleStatus status[2];
+        uint64_t now = time_us_64();
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            if (now - lastValid[zone] > thermocouple_maxAge * 1000ULL)
+                status[zone] = THERMOCOUPLE_STALE;
+            else
+                status[zone] = sampleStatus[zone];
+        }
+
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            if (status[zone] != lastStatus[zone])
+                LOG_WARN("%s thermocouple status %d\n", zone == DECOUPLER_TOP ? "top" : "bottom", status[zone]);
+            lastStatus[zone] = status[zone];
+        }
+        bool stale[2] = {status[DECOUPLER_BOTTOM] == THERMOCOUPLE_STALE, status[DECOUPLER_TOP] == THERMOCOUPLE_STALE};
 
         xSemaphoreTake(lv_app_mutex, portMAX_DELAY);
 
@@ -227,12 +482,38 @@ static void pid_task(void *pvParameter)
         topHeaterPV = topHeaterPV_f;
         bottomHeaterPV = bottomHeaterPV_f;
 
-        // If either started flag is true, we increment the secondsRunning
-        if (startedAuto || startedManual)
-            secondsRunning++;
+        // Requests of the host act like the touchscreen would, before the started flags are looked at below
+        {
+            HostLinkStatus remoteStatus = {};
+            remoteStatus.flags = (startedManual ? HOSTLINK_FLAG_MANUAL : 0) | (startedAuto ? HOSTLINK_FLAG_AUTO : 0);
+            remoteStatus.selectedProfile = selectedProfile;
+            remoteStatus.runSecond = secondsRunning;
+            remoteStatus.manualSV[DECOUPLER_BOTTOM] = bottomHeaterSV;
+            remoteStatus.manualSV[DECOUPLER_TOP] = topHeaterSV;
+            float pv[2] = {bottomHeaterPV_f, topHeaterPV_f};
+            for (uint8_t zone = 0; zone < 2; zone++)
+            {
+                remoteStatus.status[zone] = status[zone];
+                remoteStatus.pv[zone] = pv[zone];
+                remoteStatus.sv[zone] = reportedSV[zone];
+                remoteStatus.duty[zone] = reportedDuty[zone];
+            }
+            remoteCommands(&remoteStatus);
+        }
 
-        // Initialize PID on the rising edge of startedManual flag
-        if (lastStartedManual != startedManual && startedManual == 1)
+        // Run the clock while either started flag is true, the run time is kept after stopping for lv_app
+        bool started = startedAuto || startedManual;
+        if (started && !runClock.isRunning())
+            runClock.start();
+        else if (!started && runClock.isRunning())
+            runClock.stop();
+        float runTime = runClock.secondsf();
+        if (started)
+            secondsRunning = runTime;
+
+        // Initialize PID on the rising edge of either started flag
+        if ((lastStartedManual != startedManual && startedManual == 1) ||
+            (lastStartedAuto != startedAuto && startedAuto == 1))
         {
             PIDController_Init(&PID_bottomHeater);
             pwm_ssr0 = 0;
@@ -246,37 +527,362 @@ static void pid_task(void *pvParameter)
                                     PID_derivativeTau);
             PID_topHeater.prevMeasurement = topHeaterPV_f;
 
-            printf("topHeater P %f I %f D %f sampleTime %.1f tau %f\n", PID_topHeater.Kp, PID_topHeater.Ki,
-                   PID_topHeater.Kd, PID_sampleTime, PID_derivativeTau);
-            printf("bottomHeater P %f I %f D %f sampleTime %.1f tau %f\n", PID_bottomHeater.Kp, PID_bottomHeater.Ki,
-                   PID_bottomHeater.Kd, PID_sampleTime, PID_derivativeTau);
+            // Freshly initialized controllers have no error history, so this simply loads the scheduled gains
+            applyGainSchedule(&PID_bottomHeater, &bottomHeaterSchedule, bottomHeaterPV_f);
+            applyGainSchedule(&PID_topHeater, &topHeaterSchedule, topHeaterPV_f);
+
+            // Model parameters edited since the last run are picked up here
+            SmithPredictor_Reset(&bottomHeaterPredictor, PID_sampleTime);
+            SmithPredictor_Reset(&topHeaterPredictor, PID_sampleTime);
+            ThermalKalman_SetModel(&kalman_bottomHeater, bottomHeaterPredictor.K, bottomHeaterPredictor.tau,
+                                   bottomHeaterPredictor.deadTime, kalman_ambient);
+            ThermalKalman_SetModel(&kalman_topHeater, topHeaterPredictor.K, topHeaterPredictor.tau,
+                                   topHeaterPredictor.deadTime, kalman_ambient);
+
+            // Auto operation follows the profile selected when it was started
+            if (startedAuto)
+            {
+                runProfile = selectedProfile;
+                runProfileData = activeProfile;
+                IterativeLearning_Start(&learning, profileDuration(&runProfileData));
+            }
+
+            uint8_t header[FLASHRECORDER_PAYLOAD_SIZE];
+            runRecorder.begin(header, runHeader(header, startedAuto, runProfile, &runProfileData));
+            sdLogger.begin(sdLog_binary ? "RUN.BIN" : "RUN.CSV");
+            if (!sdLog_binary)
+            {
+                char line[128];
+                int len = startedAuto ? sprintf(line, "# Auto operation, profile %u\n", runProfile)
+                                      : sprintf(line, "# Manual operation\n");
+                len += sprintf(&line[len], "second,bottomSV,topSV,bottomPV,topPV,bottomDuty,topDuty,bottomStatus,"
+                                           "topStatus,learning\n");
+                sdLogger.write(line, len);
+            }
+
+            LOG_INFO("topHeater P %f I %f D %f sampleTime %.1f tau %f\n", PID_topHeater.Kp, PID_topHeater.Ki,
+                     PID_topHeater.Kd, PID_sampleTime, PID_derivativeTau);
+            LOG_INFO("bottomHeater P %f I %f D %f sampleTime %.1f tau %f\n", PID_bottomHeater.Kp, PID_bottomHeater.Ki,
+                     PID_bottomHeater.Kd, PID_sampleTime, PID_derivativeTau);
         }
 
+        // Setpoints are set on the manual operation screen or follow the profile on auto operation
+        float bottomSV = bottomHeaterSV;
+        float topSV = topHeaterSV;
+        if (startedAuto)
+            profileSetpoint(&runProfileData, runTime, &bottomSV, &topSV);
+
         // Compute the PIDs
-        if (startedManual)
+        if (started)
         {
-            PIDController_Compute(&PID_bottomHeater, (pid_variable_t)bottomHeaterSV, (pid_variable_t)bottomHeaterPV_f);
-            PIDController_Compute(&PID_topHeater, (pid_variable_t)topHeaterSV, (pid_variable_t)topHeaterPV_f);
+            applyGainSchedule(&PID_bottomHeater, &bottomHeaterSchedule, bottomHeaterPV_f);
+            applyGainSchedule(&PID_topHeater, &topHeaterSchedule, topHeaterPV_f);
+            // Predicted PV is the measurement itself when the predictor is disabled
+            float bottomHeaterPredicted = SmithPredictor_Predict(&bottomHeaterPredictor, bottomHeaterPV_f);
+            float topHeaterPredicted = SmithPredictor_Predict(&topHeaterPredictor, topHeaterPV_f);
+            // A stale zone is not computed, its integrator would only wind up on the held value
+            if (!stale[DECOUPLER_BOTTOM])
+                PIDController_Compute(&PID_bottomHeater, (pid_variable_t)bottomSV,
+                                      (pid_variable_t)bottomHeaterPredicted);
+            if (!stale[DECOUPLER_TOP])
+                PIDController_Compute(&PID_topHeater, (pid_variable_t)topSV, (pid_variable_t)topHeaterPredicted);
         }
 
-        // Apply PID output to PWM if the startedManual flag is true
-        if (startedManual)
-            pwm_ssr0 = (uint16_t)(PID_bottomHeater.out * 1000.);
-        else // Set the PWM value to 0 if startedManual is false
-            pwm_ssr0 = 0;
+        // Starting an operation takes the SSRs back from a running step test
+        if (started)
+            CouplingStepTest_Abort(&couplingTest);
 
-        if (startedManual)
-            pwm_ssr1 = (uint16_t)(PID_topHeater.out * 1000.);
-        else
-            pwm_ssr1 = 0;
+        float duty[2] = {0.0f, 0.0f};
+        bool learningApplied = started && startedAuto && runProfile < profile_learningCount;
+        if (started)
+        {
+            float pidOut[2] = {(float)PID_bottomHeater.out, (float)PID_topHeater.out}; // Same order as the SSRs
+            if (learningApplied)
+            {
+                // Record the tracking error of the heating zones and add the feed-forward learned on previous runs
+                const LearningTable *table = &profileLearning[runProfile];
+                float sv[2] = {bottomSV, topSV};
+                float pv[2] = {bottomHeaterPV_f, topHeaterPV_f};
+                for (uint8_t zone = 0; zone < 2; zone++)
+                {
+                    if (sv[zone] <= 0 || status[zone] != THERMOCOUPLE_VALID)
+                        continue;
+                    IterativeLearning_Record(&learning, zone, secondsRunning, sv[zone] - pv[zone]);
+                    float out = pidOut[zone] + IterativeLearning_FeedForward(&learning, table, zone, secondsRunning);
+                    pidOut[zone] = out < 0.0f ? 0.0f : (out > 1.0f ? 1.0f : out);
+                }
+                // Learn once the profile is over, lv_app saves the updated table
+                if (secondsRunning > learning.duration &&
+                    IterativeLearning_Finish(&learning, &profileLearning[runProfile]))
+                    learnedProfile = runProfile;
+            }
+            // The decoupler makes each zone see its direct gain only, so the models run on the PID outputs
+            SmithPredictor_Update(&bottomHeaterPredictor, pidOut[DECOUPLER_BOTTOM]);
+            SmithPredictor_Update(&topHeaterPredictor, pidOut[DECOUPLER_TOP]);
+            // Only decouple while both zones are heating, an idle zone can't compensate for the other one
+            if (bottomSV > 0 && topSV > 0)
+                Decoupler_Apply(&decoupler, pidOut, duty);
+            else
+            {
+                duty[DECOUPLER_BOTTOM] = pidOut[DECOUPLER_BOTTOM];
+                duty[DECOUPLER_TOP] = pidOut[DECOUPLER_TOP];
+            }
+        }
+        else // Both SSRs are off unless a coupling step test is running
+        {
+            float pv[2] = {bottomHeaterPV_f, topHeaterPV_f};
+            if (stale[DECOUPLER_BOTTOM] || stale[DECOUPLER_TOP])
+                CouplingStepTest_Abort(&couplingTest);
+            CouplingStepTest_Update(&couplingTest, pv, duty);
+        }
+
+        // Safe output policy: a zone running on a held value may not raise its duty, a stale zone is turned off
+        float lastDuty[2] = {(float)pwm_ssr0 / pwm_resolution, (float)pwm_ssr1 / pwm_resolution};
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            if (stale[zone])
+                duty[zone] = 0.0f;
+            else if (status[zone] != THERMOCOUPLE_VALID && duty[zone] > lastDuty[zone])
+                duty[zone] = lastDuty[zone];
+        }
+
+        // Apply the duty of each zone to PWM
+        pwm_ssr0 = (uint16_t)(duty[DECOUPLER_BOTTOM] * 1000.);
+        pwm_ssr1 = (uint16_t)(duty[DECOUPLER_TOP] * 1000.);
 
         // Send the current computed PWM value to the queue
         xQueueSend(pwm_ssr0_queue, &pwm_ssr0, portMAX_DELAY);
         xQueueSend(pwm_ssr1_queue, &pwm_ssr1, portMAX_DELAY);
 
+        // Only the copy to the batch happens here, the recorder task writes the page once it's full
+        if (started)
+        {
+            uint8_t record[recorder_sampleSize];
+            uint16_t values[7] = {(uint16_t)secondsRunning,
+                                  (uint16_t)bottomSV,
+                                  (uint16_t)topSV,
+                                  (uint16_t)(int16_t)(bottomHeaterPV_f * 10.0f),
+                                  (uint16_t)(int16_t)(topHeaterPV_f * 10.0f),
+                                  pwm_ssr0,
+                                  pwm_ssr1};
+            for (uint8_t i = 0; i < 7; i++)
+            {
+                record[2 * i] = values[i] & 0xFF;
+                record[2 * i + 1] = values[i] >> 8;
+            }
+            record[14] = (status[DECOUPLER_BOTTOM] & 0x07) | (status[DECOUPLER_TOP] & 0x07) << 3 |
+                         (startedAuto ? 0x40 : 0) | (learningApplied ? 0x80 : 0);
+            record[15] = 0;
+            runRecorder.append(record, sizeof(record));
+
+            if (sdLog_binary)
+                sdLogger.write(record, sizeof(record));
+            else
+            {
+                // Integer formatting only, PV in 0.1 celcius and duty in pwm_resolution like the record above
+                char line[64];
+                int16_t pv[2] = {(int16_t)values[3], (int16_t)values[4]};
+                int len = sprintf(line, "%u,%u,%u,%s%d.%d,%s%d.%d,%u,%u,%u,%u,%u\n", values[0], values[1], values[2],
+                                  pv[0] < 0 ? "-" : "", abs(pv[0]) / 10, abs(pv[0]) % 10, pv[1] < 0 ? "-" : "",
+                                  abs(pv[1]) / 10, abs(pv[1]) % 10, pwm_ssr0, pwm_ssr1,
+                                  (unsigned)status[DECOUPLER_BOTTOM], (unsigned)status[DECOUPLER_TOP], learningApplied);
+                sdLogger.write(line, len);
+            }
+        }
+        else if (lastStartedManual || lastStartedAuto)
+        {
+            runRecorder.end();
+            sdLogger.end();
+        }
+
+        // State of this iteration for the host link, the sampler fills in the rest
+        HostLinkTelemetry telemetry = {};
+        telemetry.loopPeriod = lastLoopStart ? loopStart - lastLoopStart : 0;
+        telemetry.runSecond = secondsRunning;
+        telemetry.flags = (startedManual ? HOSTLINK_FLAG_MANUAL : 0) | (startedAuto ? HOSTLINK_FLAG_AUTO : 0) |
+                          (learningApplied ? HOSTLINK_FLAG_LEARNING : 0);
+        const PIDController *pids[2] = {&PID_bottomHeater, &PID_topHeater};
+        float svs[2] = {bottomSV, topSV};
+        float pvs[2] = {bottomHeaterPV_f, topHeaterPV_f};
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            telemetry.status[zone] = status[zone];
+            telemetry.pv[zone] = pvs[zone];
+            telemetry.sv[zone] = svs[zone];
+            telemetry.proportional[zone] = pids[zone]->proportional;
+            telemetry.integral[zone] = pids[zone]->integrator;
+            telemetry.derivative[zone] = pids[zone]->differentiator;
+            telemetry.duty[zone] = duty[zone];
+        }
+        lastLoopStart = loopStart;
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            reportedSV[zone] = started ? svs[zone] : 0.0f;
+            reportedDuty[zone] = duty[zone];
+        }
+
+        // Register map of the Modbus interface, published along with the telemetry
+        uint16_t registers[MODBUS_REG_COUNT] = {};
+        registers[MODBUS_REG_STATE] =
+            startedAuto ? MODBUS_STATE_AUTO : (startedManual ? MODBUS_STATE_MANUAL : MODBUS_STATE_IDLE);
+        registers[MODBUS_REG_RUN_SECOND] = secondsRunning;
+        registers[MODBUS_REG_SELECTED_PROFILE] = selectedProfile;
+        uint32_t manualSVs[2] = {bottomHeaterSV, topHeaterSV};
+        uint16_t pwms[2] = {pwm_ssr0, pwm_ssr1};
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            if (status[zone] != THERMOCOUPLE_VALID)
+                registers[MODBUS_REG_ALARMS] |= MODBUS_ALARM_BOTTOM_SENSOR << zone;
+            if (stale[zone])
+                registers[MODBUS_REG_ALARMS] |= MODBUS_ALARM_BOTTOM_STALE << zone;
+            registers[MODBUS_REG_STATUS + zone] = status[zone];
+            registers[MODBUS_REG_PV + zone] = (int16_t)(pvs[zone] * 10.0f);
+            registers[MODBUS_REG_SV + zone] = (uint16_t)(reportedSV[zone] * 10.0f);
+            registers[MODBUS_REG_MANUAL_SV + zone] = manualSVs[zone];
+            registers[MODBUS_REG_DUTY + zone] = pwms[zone];
+            modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone], pids[zone]->Kp);
+            modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone + 2], pids[zone]->Ki);
+            modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone + 4], pids[zone]->Kd);
+        }
+
         lastStartedManual = startedManual;
+        lastStartedAuto = startedAuto;
         xSemaphoreGive(lv_app_mutex);
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        uint64_t loopTime = time_us_64() - loopStart;
+        telemetry.loopTime = loopTime > UINT16_MAX ? UINT16_MAX : loopTime;
+        hostLink.publish(&telemetry);
+        modbusLink.publish(registers);
+
+        // Keep a fixed control period regardless of how long this iteration took
+        vTaskDelayUntil(&lastWakeTime, (TickType_t)(PID_sampleTime * 1000) / portTICK_PERIOD_MS);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Apply the run control requests of the host link, called by pid_task while it holds lv_app_mutex. Only
+ * queues are touched here, the answers are sent by the link task.
+ *
+ * @param status State before the requests are applied, answers HOSTLINK_GET_STATUS
+ */
+static void remoteCommands(const HostLinkStatus *status)
+{
+    HostLinkRequest command;
+    while (hostLink.takeCommand(&command))
+    {
+        const uint8_t *payload = command.payload;
+        switch (command.type)
+        {
+        case HOSTLINK_START:
+        {
+            bool automatic = payload[0] == HOSTLINK_MODE_AUTO;
+            if (command.len != 1 || payload[0] > HOSTLINK_MODE_AUTO)
+                hostLink.ack(&command, HOSTLINK_INVALID);
+            else if (automatic ? startedManual : startedAuto)
+                hostLink.ack(&command, HOSTLINK_REFUSED);
+            else
+            {
+                // Same as the run button, the run clock restarts on the rising edge seen below
+                if (!startedAuto && !startedManual)
+                    secondsRunning = 0;
+                if (automatic)
+                    startedAuto = true;
+                else
+                    startedManual = true;
+                hostLink.ack(&command, HOSTLINK_OK);
+            }
+            break;
+        }
+        case HOSTLINK_STOP:
+            if (command.len != 0)
+                hostLink.ack(&command, HOSTLINK_INVALID);
+            else
+            {
+                startedAuto = false;
+                startedManual = false;
+                hostLink.ack(&command, HOSTLINK_OK);
+            }
+            break;
+        case HOSTLINK_SET_SV:
+        {
+            uint16_t sv[2] = {(uint16_t)(payload[0] | payload[1] << 8), (uint16_t)(payload[2] | payload[3] << 8)};
+            if (command.len != 4 || sv[DECOUPLER_BOTTOM] > HOSTLINK_MAXIMUM_SV || sv[DECOUPLER_TOP] > HOSTLINK_MAXIMUM_SV)
+                hostLink.ack(&command, HOSTLINK_INVALID);
+            else
+            {
+                bottomHeaterSV = sv[DECOUPLER_BOTTOM];
+                topHeaterSV = sv[DECOUPLER_TOP];
+                hostLink.ack(&command, HOSTLINK_OK);
+            }
+            break;
+        }
+        case HOSTLINK_GET_STATUS:
+            hostLink.reply(&command, HOSTLINK_STATUS, status, sizeof(*status));
+            break;
+        default:
+            hostLink.ack(&command, HOSTLINK_INVALID);
+            break;
+        }
+    }
+}
+
+// Interpolate the gains for the current process value and hand them to the controller without an output bump
+static void applyGainSchedule(PIDController *pid, const GainSchedule *schedule, float pv)
+{
+    if (!GainSchedule_IsEnabled(schedule))
+        return;
+    float kp, ki, kd;
+    GainSchedule_Lookup(schedule, pv, &kp, &ki, &kd);
+    PIDController_SetGainsBumpless(pid, kp, ki, kd);
+}
+
+// Last target second of the profile, the profile is over after it
+static uint32_t profileDuration(const Profile *profile)
+{
+    if (profile->dataPoint == 0 || profile->dataPoint > profile_maximumDataPoint)
+        return 0;
+    return profile->targetSecond[profile->dataPoint - 1];
+}
+
+// Linearly interpolate the profile temperature, the top heater only follows it from startTopHeaterAt data point
+static void profileSetpoint(const Profile *profile, float second, float *bottomSV, float *topSV)
+{
+    *bottomSV = 0.0f;
+    *topSV = 0.0f;
+    if (second > profileDuration(profile))
+        return;
+
+    uint8_t i = 0;
+    while (i < profile->dataPoint - 2 && second >= profile->targetSecond[i + 1])
+        i++;
+    float temperature = profile->targetTemperature[i];
+    if (profile->dataPoint > 1)
+    {
+        float span = profile->targetSecond[i + 1] - profile->targetSecond[i];
+        float frac = span > 0 ? (second - profile->targetSecond[i]) / span : 1.0f;
+        temperature += frac * (profile->targetTemperature[i + 1] - profile->targetTemperature[i]);
+    }
+
+    *bottomSV = temperature;
+    if (profile->startTopHeaterAt < profile->dataPoint && second >= profile->targetSecond[profile->startTopHeaterAt])
+        *topSV = temperature;
+}
+
+// Header page of a recorded run: [0..7] board id, [8] 1 on auto operation, [9..10] profile index, then the encoded
+// profile on auto operation
+static uint8_t runHeader(uint8_t *dest, bool automatic, uint16_t profileIndex, const Profile *profile)
+{
+    pico_unique_board_id_t id;
+    pico_get_unique_board_id(&id);
+    memcpy(dest, id.id, PICO_UNIQUE_BOARD_ID_SIZE_BYTES);
+    uint8_t len = PICO_UNIQUE_BOARD_ID_SIZE_BYTES;
+    dest[len++] = automatic;
+    dest[len++] = profileIndex & 0xFF;
+    dest[len++] = profileIndex >> 8;
+    static_assert(PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 3 + PROFILE_ENCODED_MAX <= FLASHRECORDER_PAYLOAD_SIZE,
+                  "Run header doesn't fit a page");
+    static_assert(PICO_UNIQUE_BOARD_ID_SIZE_BYTES == HOSTLINK_RUN_BOARD_ID_SIZE, "The host tools read the run header");
+    if (automatic)
+        len += profile_encode(profile, &dest[len]);
+    return len;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file Formats.cpp
+ * @brief Text files of the host tool, profiles use the PROFILES.CSV lines of the SD card import and export
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Formats.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const format_zones[2] = {"bottom", "top"};
+
+// Returns the length written without the newline, dest needs FORMATS_LINE_SIZE bytes
+int format_profile(char *dest, uint16_t index, const Profile *profile)
+{
+    int len = sprintf(dest, "%u,%u", index, profile->startTopHeaterAt);
+    for (uint8_t d = 0; d < profile->dataPoint; d++)
+        len += sprintf(&dest[len], ",%u:%d", profile->targetSecond[d], profile->targetTemperature[d]);
+    return len;
+}
+
+// Same checks as the SD card import, false if anything is out of range
+bool parse_profile(const char *line, uint16_t *index, Profile *profile)
+{
+    char *end;
+    long value = strtol(line, &end, 10);
+    if (end == line || *end != ',' || value < 0 || value >= profile_count)
+        return false;
+    *index = value;
+    line = end + 1;
+    value = strtol(line, &end, 10);
+    if (end == line || value < 0 || value > UINT16_MAX)
+        return false;
+    profile->startTopHeaterAt = value;
+    profile->dataPoint = 0;
+    while (*end == ',')
+    {
+        if (profile->dataPoint == profile_maximumDataPoint)
+            return false;
+        line = end + 1;
+        value = strtol(line, &end, 10);
+        if (end == line || *end != ':' || value < 0 || value > UINT16_MAX)
+            return false;
+        profile->targetSecond[profile->dataPoint] = value;
+        line = end + 1;
+        value = strtol(line, &end, 10);
+        if (end == line || value < INT16_MIN || value > INT16_MAX)
+            return false;
+        profile->targetTemperature[profile->dataPoint++] = value;
+    }
+    return *end == '\0' && profile->dataPoint > 0;
+}
+
+// Shortest text that reads back as the same float, so a downloaded file uploads back to the same values
+static int format_float(char *dest, float value)
+{
+    int len = 0;
+    for (int digits = 6; digits <= 9; digits++)
+    {
+        len = sprintf(dest, "%.*g", digits, value);
+        if (strtof(dest, NULL) == value)
+            break;
+    }
+    return len;
+}
+
+int format_tuning(char *dest, const HostLinkTuning *tuning)
+{
+    int len = sprintf(dest, "%s", format_zones[tuning->zone ? 1 : 0]);
+    float constants[4] = {tuning->kp, tuning->ki, tuning->kd, tuning->tau};
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        dest[len++] = ',';
+        len += format_float(&dest[len], constants[i]);
+    }
+    for (uint8_t i = 0; i < tuning->breakpointCount && i < HOSTLINK_TUNING_MAX_BREAKPOINT; i++)
+    {
+        float gains[3] = {tuning->breakpoints[i].kp, tuning->breakpoints[i].ki, tuning->breakpoints[i].kd};
+        len += sprintf(&dest[len], ",%u", tuning->breakpoints[i].temperature);
+        for (uint8_t g = 0; g < 3; g++)
+        {
+            dest[len++] = ':';
+            len += format_float(&dest[len], gains[g]);
+        }
+    }
+    return len;
+}
+
+// Returns what follows the number, NULL if there's no finite number
+static const char *parse_float(const char *src, float *value)
+{
+    char *end;
+    *value = strtof(src, &end);
+    return end == src || !isfinite(*value) ? NULL : end;
+}
+
+bool parse_tuning(const char *line, HostLinkTuning *tuning)
+{
+    memset(tuning, 0, sizeof(*tuning));
+    const char *p = strchr(line, ',');
+    if (p == NULL)
+        return false;
+    size_t zoneLen = p - line;
+    if (zoneLen == strlen(format_zones[0]) && !strncmp(line, format_zones[0], zoneLen))
+        tuning->zone = 0;
+    else if (zoneLen == strlen(format_zones[1]) && !strncmp(line, format_zones[1], zoneLen))
+        tuning->zone = 1;
+    else
+        return false;
+
+    float constants[4];
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (*p != ',' || !(p = parse_float(p + 1, &constants[i])))
+            return false;
+    }
+    tuning->kp = constants[0];
+    tuning->ki = constants[1];
+    tuning->kd = constants[2];
+    tuning->tau = constants[3];
+    while (*p == ',')
+    {
+        if (tuning->breakpointCount == HOSTLINK_TUNING_MAX_BREAKPOINT)
+            return false;
+        char *end;
+        long temperature = strtol(p + 1, &end, 10);
+        if (end == p + 1 || *end != ':' || temperature < 0 || temperature > UINT16_MAX)
+            return false;
+        float kp, ki, kd;
+        if (!(p = parse_float(end + 1, &kp)) || *p != ':' || !(p = parse_float(p + 1, &ki)) || *p != ':' ||
+            !(p = parse_float(p + 1, &kd)))
+            return false;
+        auto &breakpoint = tuning->breakpoints[tuning->breakpointCount++];
+        breakpoint.temperature = temperature;
+        breakpoint.kp = kp;
+        breakpoint.ki = ki;
+        breakpoint.kd = kd;
+    }
+    // Each temperature only once, the station sorts them
+    for (uint8_t i = 0; i < tuning->breakpointCount; i++)
+        for (uint8_t j = i + 1; j < tuning->breakpointCount; j++)
+            if (tuning->breakpoints[i].temperature == tuning->breakpoints[j].temperature)
+                return false;
+    return *p == '\0';
+}
+
+/**
+ * @brief Read the next line without its line ending
+ *
+ * @param file
+ * @param line
+ * @param size
+ * @param skip Set for empty and comment lines, they are returned too so the caller can count the lines
+ * @return false at the end of the file, or if the line doesn't fit
+ */
+bool read_line(FILE *file, char *line, size_t size, bool *skip)
+{
+    if (!fgets(line, size, file))
+        return false;
+    size_t len = strlen(line);
+    if (len == size - 1 && line[len - 1] != '\n' && !feof(file))
+        return false;
+    while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+    *skip = len == 0 || line[0] == '#';
+    return true;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file Formats.h
+ * @brief Text files of the host tool, profiles use the PROFILES.CSV lines of the SD card import and export
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Profile line:  profile,startTopHeaterAt,second:celcius,second:celcius,...
+ * Tuning line:   zone,kp,ki,kd,tau,celcius:kp:ki:kd,...   zone is bottom or top, the breakpoints are optional
+ * Empty lines and lines starting with # are skipped.
+ */
+#ifndef _FORMATS_H_
+#include "HostLinkProtocol.h"
+#include "profile_store.h"
+#include <stdio.h>
+#define _FORMATS_H_
+
+#define FORMATS_LINE_SIZE 512
+
+int format_profile(char *dest, uint16_t index, const Profile *profile);
+bool parse_profile(const char *line, uint16_t *index, Profile *profile);
+int format_tuning(char *dest, const HostLinkTuning *tuning);
+bool parse_tuning(const char *line, HostLinkTuning *tuning);
+bool read_line(FILE *file, char *line, size_t size, bool *skip);
+#endif
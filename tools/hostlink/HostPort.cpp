@@ -0,0 +1,218 @@
+/**
+ * @file HostPort.cpp
+ * @brief Host side of the link, frames to and from the link interface of the station or of the simulator's pty
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "HostPort.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static int64_t nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Open the link interface, a tty is switched to raw mode. The baud rate means nothing to a USB CDC interface.
+ *
+ * @param path /dev/ttyACM1 for the station, the pty printed by the simulator
+ * @return false if it can't be opened, errno tells why
+ */
+bool HostPort::open(const char *path)
+{
+    int f = ::open(path, O_RDWR | O_NOCTTY);
+    if (f < 0)
+        return false;
+    if (isatty(f))
+    {
+        struct termios tio;
+        if (tcgetattr(f, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            tio.c_cflag |= CLOCAL | CREAD;
+            tcsetattr(f, TCSANOW, &tio);
+        }
+        // Whatever was left from an earlier session would only look like lost frames
+        tcflush(f, TCIFLUSH);
+    }
+    return attach(f);
+}
+
+// Use a descriptor that is already open, the port closes it
+bool HostPort::attach(int _fd)
+{
+    close();
+    fd = _fd;
+    inputPos = inputLen = 0;
+    rxLen = 0;
+    rxOverflow = false;
+    return fd >= 0;
+}
+
+void HostPort::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool HostPort::send(uint8_t type, const void *payload, size_t len)
+{
+    return sendSequenced(type, txSequence++, payload, len);
+}
+
+bool HostPort::sendSequenced(uint8_t type, uint8_t sequence, const void *payload, size_t len)
+{
+    uint8_t encoded[HOSTLINK_MAX_ENCODED];
+    size_t encodedLen = hostlink_encodeFrame(type, sequence, payload, len, encoded);
+    if (encodedLen == 0)
+        return false;
+    size_t written = 0;
+    while (written < encodedLen)
+    {
+        ssize_t n = write(fd, &encoded[written], encodedLen - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Wait for the next valid frame, the frames that don't decode are counted and skipped
+ *
+ * @param frame
+ * @param timeoutMs Negative waits forever
+ * @return int 1 on a frame, 0 on timeout, -1 if the port failed or was closed by the other end
+ */
+int HostPort::receive(HostFrame *frame, int timeoutMs)
+{
+    int64_t deadline = nowMs() + timeoutMs;
+    for (;;)
+    {
+        if (inputPos == inputLen)
+        {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int wait = timeoutMs < 0 ? -1 : (int)(deadline - nowMs());
+            if (timeoutMs >= 0 && wait < 0)
+                wait = 0;
+            int ready = poll(&pfd, 1, wait);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready < 0)
+                return -1;
+            if (ready == 0)
+                return 0;
+            ssize_t n = read(fd, input, sizeof(input));
+            if (n < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            if (n <= 0) // A pty reads EIO once the simulator is gone
+                return -1;
+            inputPos = 0;
+            inputLen = n;
+        }
+        uint8_t byte = input[inputPos++];
+        if (byte != 0)
+        {
+            if (rxLen < sizeof(rx))
+                rx[rxLen++] = byte;
+            else
+                rxOverflow = true;
+            continue;
+        }
+
+        uint8_t decoded[HOSTLINK_MAX_FRAME];
+        size_t len = rxOverflow ? 0 : hostlink_decodeFrame(rx, rxLen, decoded);
+        bool empty = rxLen == 0 && !rxOverflow;
+        rxLen = 0;
+        rxOverflow = false;
+        if (empty) // Back to back delimiters
+            continue;
+        if (len == 0)
+        {
+            badFrames++;
+            continue;
+        }
+        frame->type = decoded[0];
+        frame->sequence = decoded[1];
+        frame->len = len - 2;
+        memcpy(frame->payload, &decoded[2], frame->len);
+        return 1;
+    }
+}
+
+// Pass a telemetry frame to the callback, the gap in the sequence counts the frames lost on the way
+bool HostPort::handleTelemetry(const HostFrame *frame)
+{
+    if (frame->type != HOSTLINK_TELEMETRY || frame->len != sizeof(HostLinkTelemetry))
+        return false;
+    uint32_t lost = telemetrySeen ? (uint8_t)(frame->sequence - telemetrySequence - 1) : 0;
+    telemetrySeen = true;
+    telemetrySequence = frame->sequence;
+    if (telemetryCallback)
+    {
+        HostLinkTelemetry telemetry;
+        memcpy(&telemetry, frame->payload, sizeof(telemetry));
+        telemetryCallback(&telemetry, lost, telemetryContext);
+    }
+    return true;
+}
+
+/**
+ * @brief Send a request and wait for its answer, retried when it times out or the station is busy
+ *
+ * @param type
+ * @param payload
+ * @param len
+ * @param replyType Type of the answer, HOSTLINK_ACK is accepted too
+ * @param reply Payload of the answer without the request sequence in front
+ * @return int 1 on an answer, 0 if the station never answered, -1 if the port failed
+ */
+int HostPort::request(uint8_t type, const void *payload, size_t len, uint8_t replyType, HostFrame *reply)
+{
+    for (uint8_t attempt = 0; attempt < HOSTPORT_RETRIES; attempt++)
+    {
+        uint8_t sequence = txSequence++;
+        if (!sendSequenced(type, sequence, payload, len))
+            return -1;
+        int64_t deadline = nowMs() + HOSTPORT_REPLY_TIMEOUT;
+        bool busy = false;
+        while (!busy)
+        {
+            int left = deadline - nowMs();
+            if (left <= 0)
+                break;
+            int got = receive(reply, left);
+            if (got < 0)
+                return -1;
+            if (got == 0)
+                break;
+            if (handleTelemetry(reply))
+                continue;
+            // Late answers to an earlier attempt carry another sequence
+            if (reply->len == 0 || reply->payload[0] != sequence ||
+                (reply->type != replyType && reply->type != HOSTLINK_ACK))
+                continue;
+            reply->len--;
+            memmove(reply->payload, &reply->payload[1], reply->len);
+            busy = reply->type == HOSTLINK_ACK && reply->len == 2 && reply->payload[1] == HOSTLINK_BUSY;
+            if (!busy)
+                return 1;
+            usleep(200 * 1000);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file HostPort.h
+ * @brief Host side of the link, frames to and from the link interface of the station or of the simulator's pty
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOSTPORT_H_
+#include "HostLinkProtocol.h"
+#include <stdint.h>
+#include <stdio.h>
+#define _HOSTPORT_H_
+
+#define HOSTPORT_REPLY_TIMEOUT 2000 // in ms, the station answers within a control period or a few lv_app timer periods
+#define HOSTPORT_RETRIES 3
+
+// Frame received from the other end, payload excludes the type and the sequence
+struct HostFrame
+{
+    uint8_t type;
+    uint8_t sequence;
+    uint16_t len;
+    uint8_t payload[HOSTLINK_MAX_PAYLOAD];
+};
+
+typedef void (*HostTelemetryCallback)(const HostLinkTelemetry *telemetry, uint32_t lost, void *context);
+
+class HostPort
+{
+public:
+    ~HostPort() { close(); }
+    bool open(const char *path);
+    bool attach(int _fd);
+    void close();
+    bool send(uint8_t type, const void *payload, size_t len);
+    bool sendSequenced(uint8_t type, uint8_t sequence, const void *payload, size_t len);
+    int receive(HostFrame *frame, int timeoutMs);
+    int request(uint8_t type, const void *payload, size_t len, uint8_t replyType, HostFrame *reply);
+    // Telemetry received while waiting for a reply goes here instead of being dropped
+    void onTelemetry(HostTelemetryCallback callback, void *context)
+    {
+        telemetryCallback = callback;
+        telemetryContext = context;
+    }
+    bool handleTelemetry(const HostFrame *frame);
+    // Frames that failed the COBS decoding or the CRC
+    uint32_t getBadFrames() { return badFrames; }
+
+protected:
+    int fd = -1;
+    uint8_t txSequence = 0;
+    bool telemetrySeen = false;
+    uint8_t telemetrySequence = 0;
+    uint8_t input[256]; // Read from the port and not decoded yet
+    uint16_t inputPos = 0;
+    uint16_t inputLen = 0;
+    uint8_t rx[HOSTLINK_MAX_ENCODED];
+    uint16_t rxLen = 0;
+    bool rxOverflow = false;
+    uint32_t badFrames = 0;
+    HostTelemetryCallback telemetryCallback = NULL;
+    void *telemetryContext = NULL;
+};
+#endif
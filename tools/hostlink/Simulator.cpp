@@ -0,0 +1,529 @@
+/**
+ * @file Simulator.cpp
+ * @brief Stand-in for the station on a pseudo terminal, so the host tool can be tried without the hardware
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Simulator.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static constexpr float simulator_gain = 300.0f; // in celcius above ambient at full duty
+static constexpr float simulator_tau = 60.0f;   // in seconds
+static constexpr float simulator_ambient = 25.0f;
+static constexpr uint64_t simulator_modbusIdle = 20000; // in us, like MODBUSLINK_IDLE of the station
+
+static uint64_t nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Create a non blocking pty, the slave side is put in raw mode right away so nothing is echoed back before the
+// other end opens it. Returns the master, -1 if the pty can't be created.
+int Simulator::openPty(char *ptyPath, size_t size, int *slaveFd)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) || unlockpt(master) || !ptsname(master))
+        return -1;
+    strncpy(ptyPath, ptsname(master), size - 1);
+    *slaveFd = ::open(ptyPath, O_RDWR | O_NOCTTY);
+    if (*slaveFd < 0)
+        return -1;
+    struct termios tio;
+    tcgetattr(*slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(*slaveFd, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    return master;
+}
+
+/**
+ * @brief Create the ptys of the link and Modbus interfaces
+ *
+ * @param framing Of the Modbus interface
+ * @return false if a pty can't be created
+ */
+bool Simulator::open(ModbusFraming framing)
+{
+    int master = openPty(path, sizeof(path), &slave);
+    if (master < 0)
+        return false;
+    port.attach(master);
+    modbusMaster = openPty(modbusPath, sizeof(modbusPath), &modbusSlave);
+    if (modbusMaster < 0)
+        return false;
+    modbus = ModbusSlave(framing, 1, MODBUS_REG_COUNT, readRegisters, this);
+    started = nowUs();
+
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        tuning[zone].zone = zone;
+        tuning[zone].kp = 0.05f;
+        tuning[zone].ki = 0.001f;
+        tuning[zone].tau = 2.161931848f;
+    }
+    return true;
+}
+
+// SV of a zone along a profile, linear between the data points, the top zone waits for startTopHeaterAt
+static float profileSV(const Profile *profile, float second, uint8_t zone)
+{
+    if (zone == 1 && second < profile->startTopHeaterAt)
+        return 0;
+    for (uint8_t i = 1; i < profile->dataPoint; i++)
+        if (second < profile->targetSecond[i])
+        {
+            float span = profile->targetSecond[i] - profile->targetSecond[i - 1];
+            float t = span > 0 ? (second - profile->targetSecond[i - 1]) / span : 1;
+            return profile->targetTemperature[i - 1] +
+                   (profile->targetTemperature[i] - profile->targetTemperature[i - 1]) * t;
+        }
+    return profile->targetTemperature[profile->dataPoint - 1];
+}
+
+// Both operations on both zones, the PI terms use the tuning uploaded by the host, the heaters are off when idle
+void Simulator::step(float dt)
+{
+    if (flags)
+        seconds += dt;
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        if (flags & HOSTLINK_FLAG_AUTO)
+            sv[zone] = profileSV(&profiles[selectedProfile], seconds, zone);
+        else if (flags & HOSTLINK_FLAG_MANUAL)
+            sv[zone] = manualSV[zone];
+        else
+            sv[zone] = 0;
+        if (sv[zone] == 0)
+        {
+            integral[zone] = 0;
+            duty[zone] = 0;
+            lastError[zone] = 0;
+            pv[zone] += (simulator_ambient - pv[zone]) * dt / simulator_tau;
+            continue;
+        }
+        float error = sv[zone] - pv[zone];
+        integral[zone] += tuning[zone].ki * error * dt;
+        integral[zone] = integral[zone] < 0 ? 0 : (integral[zone] > 1 ? 1 : integral[zone]);
+        float out = tuning[zone].kp * error + integral[zone];
+        duty[zone] = out < 0 ? 0 : (out > 1 ? 1 : out);
+        lastError[zone] = error;
+        float target = simulator_ambient + simulator_gain * duty[zone];
+        pv[zone] += (target - pv[zone]) * dt / simulator_tau;
+    }
+    while (flags && seconds >= recordedSecond)
+        record();
+}
+
+// One sample per run second, laid out like the ones the station records
+void Simulator::record()
+{
+    if (runLog.empty() || runLog.back().type != HOSTLINK_RUN_RECORDS ||
+        runLog.back().payload.size() + HOSTLINK_RUN_RECORD_SIZE > HOSTLINK_RUN_PAGE_SIZE)
+        runLog.push_back({HOSTLINK_RUN_RECORDS, {}});
+    uint16_t values[7] = {(uint16_t)recordedSecond,
+                          (uint16_t)sv[0],
+                          (uint16_t)sv[1],
+                          (uint16_t)(int16_t)(pv[0] * 10.0f),
+                          (uint16_t)(int16_t)(pv[1] * 10.0f),
+                          (uint16_t)(duty[0] * 1000),
+                          (uint16_t)(duty[1] * 1000)};
+    std::vector<uint8_t> &payload = runLog.back().payload;
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        payload.push_back(values[i] & 0xFF);
+        payload.push_back(values[i] >> 8);
+    }
+    payload.push_back(flags & HOSTLINK_FLAG_AUTO ? 0x40 : 0);
+    payload.push_back(0);
+    recordedSecond++;
+}
+
+void Simulator::sample()
+{
+    HostLinkTelemetry telemetry = {};
+    telemetry.timestamp = nowUs();
+    telemetry.dropped = dropped;
+    telemetry.loopPeriod = 1000000;
+    telemetry.loopTime = 350;
+    telemetry.runSecond = seconds;
+    telemetry.flags = flags;
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        // Quarter degree steps and a bit of noise, like the MAX6675
+        telemetry.raw[zone] = (int)((pv[zone] + (rand() % 100 - 50) / 100.0f) * 4) / 4.0f;
+        telemetry.pv[zone] = pv[zone];
+        telemetry.sv[zone] = sv[zone];
+        telemetry.proportional[zone] = tuning[zone].kp * lastError[zone];
+        telemetry.integral[zone] = integral[zone];
+        telemetry.duty[zone] = duty[zone];
+    }
+    if (!port.send(HOSTLINK_TELEMETRY, &telemetry, sizeof(telemetry)))
+        dropped++;
+}
+
+// Same register map as pid_task publishes, from the state of the model
+bool Simulator::readRegisters(uint16_t address, uint16_t count, uint16_t *dest, void *context)
+{
+    Simulator *sim = (Simulator *)context;
+    uint16_t registers[MODBUS_REG_COUNT] = {};
+    registers[MODBUS_REG_STATE] = sim->flags & HOSTLINK_FLAG_AUTO
+                                      ? MODBUS_STATE_AUTO
+                                      : (sim->flags & HOSTLINK_FLAG_MANUAL ? MODBUS_STATE_MANUAL : MODBUS_STATE_IDLE);
+    registers[MODBUS_REG_RUN_SECOND] = sim->seconds;
+    registers[MODBUS_REG_SELECTED_PROFILE] = sim->selectedProfile;
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        registers[MODBUS_REG_PV + zone] = (int16_t)(sim->pv[zone] * 10.0f);
+        registers[MODBUS_REG_SV + zone] = (uint16_t)(sim->sv[zone] * 10.0f);
+        registers[MODBUS_REG_MANUAL_SV + zone] = sim->manualSV[zone];
+        registers[MODBUS_REG_DUTY + zone] = sim->duty[zone] * 1000;
+        modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone], sim->tuning[zone].kp);
+        modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone + 2], sim->tuning[zone].ki);
+        modbus_putFloat(&registers[MODBUS_REG_GAINS + 6 * zone + 4], sim->tuning[zone].kd);
+    }
+    memcpy(dest, &registers[address], count * sizeof(uint16_t));
+    return true;
+}
+
+// Same framing as the Modbus task of the station, a master that isn't there yet is not an error
+void Simulator::serveModbus()
+{
+    ssize_t n = read(modbusMaster, &modbusRx[modbusRxLen], sizeof(modbusRx) - modbusRxLen);
+    uint64_t now = nowUs();
+    if (n > 0)
+    {
+        modbusRxLen += n;
+        modbusLastReceive = now;
+    }
+    bool idle = now - modbusLastReceive >= simulator_modbusIdle;
+    size_t start = 0;
+    for (;;)
+    {
+        uint8_t tx[MODBUS_MAX_ADU];
+        size_t txLen;
+        size_t consumed = modbus.process(&modbusRx[start], modbusRxLen - start, idle, tx, &txLen);
+        if (consumed == 0)
+            break;
+        if (txLen && write(modbusMaster, tx, txLen) != (ssize_t)txLen)
+            fprintf(stderr, "Modbus answer dropped: %s\n", strerror(errno));
+        start += consumed;
+    }
+    if (start == 0 && modbusRxLen == sizeof(modbusRx))
+        start = modbusRxLen;
+    memmove(modbusRx, &modbusRx[start], modbusRxLen - start);
+    modbusRxLen -= start;
+}
+
+void Simulator::reply(const HostFrame *request, uint8_t type, const void *payload, size_t len)
+{
+    uint8_t answer[HOSTLINK_MAX_PAYLOAD];
+    answer[0] = request->sequence;
+    memcpy(&answer[1], payload, len);
+    port.send(type, answer, len + 1);
+}
+
+void Simulator::ack(const HostFrame *request, HostLinkResult result)
+{
+    uint8_t payload[2] = {request->type, result};
+    reply(request, HOSTLINK_ACK, payload, sizeof(payload));
+}
+
+// Run control, same checks as pid_task
+void Simulator::command(const HostFrame *request)
+{
+    const uint8_t *payload = request->payload;
+    switch (request->type)
+    {
+    case HOSTLINK_START:
+    {
+        uint8_t flag = payload[0] == HOSTLINK_MODE_AUTO ? HOSTLINK_FLAG_AUTO : HOSTLINK_FLAG_MANUAL;
+        if (request->len != 1 || payload[0] > HOSTLINK_MODE_AUTO)
+            ack(request, HOSTLINK_INVALID);
+        else if (flags & ~flag)
+            ack(request, HOSTLINK_REFUSED);
+        else
+        {
+            if (!flags)
+            {
+                // Same header as the station, with a made up board id
+                RunPage header = {HOSTLINK_RUN_HEADER, {'H', 'o', 't', 'B', 'e', 'r', 'r', 'y'}};
+                static_assert(HOSTLINK_RUN_BOARD_ID_SIZE == 8, "Made up board id size differs");
+                header.payload.push_back(flag == HOSTLINK_FLAG_AUTO);
+                header.payload.push_back(flag == HOSTLINK_FLAG_AUTO ? selectedProfile : 0);
+                header.payload.push_back(0);
+                if (flag == HOSTLINK_FLAG_AUTO)
+                {
+                    uint8_t encoded[PROFILE_ENCODED_MAX];
+                    uint8_t len = profile_encode(&profiles[selectedProfile], encoded);
+                    header.payload.insert(header.payload.end(), encoded, encoded + len);
+                }
+                runLog.push_back(header);
+                seconds = 0;
+                recordedSecond = 0;
+            }
+            flags = flag;
+            ack(request, HOSTLINK_OK);
+        }
+        break;
+    }
+    case HOSTLINK_STOP:
+        if (request->len != 0)
+            ack(request, HOSTLINK_INVALID);
+        else
+        {
+            flags = 0;
+            ack(request, HOSTLINK_OK);
+        }
+        break;
+    case HOSTLINK_SET_SV:
+    {
+        uint16_t received[2] = {(uint16_t)(payload[0] | payload[1] << 8), (uint16_t)(payload[2] | payload[3] << 8)};
+        if (request->len != 4 || received[0] > HOSTLINK_MAXIMUM_SV || received[1] > HOSTLINK_MAXIMUM_SV)
+            ack(request, HOSTLINK_INVALID);
+        else
+        {
+            manualSV[0] = received[0];
+            manualSV[1] = received[1];
+            ack(request, HOSTLINK_OK);
+        }
+        break;
+    }
+    case HOSTLINK_SELECT_PROFILE:
+        if (request->len != 1 || payload[0] >= profile_count)
+            ack(request, HOSTLINK_INVALID);
+        else if (flags & HOSTLINK_FLAG_AUTO)
+            ack(request, HOSTLINK_REFUSED);
+        else
+        {
+            selectedProfile = payload[0];
+            ack(request, HOSTLINK_OK);
+        }
+        break;
+    case HOSTLINK_GET_STATUS:
+    {
+        HostLinkStatus status = {};
+        status.flags = flags;
+        status.selectedProfile = selectedProfile;
+        status.runSecond = seconds;
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            status.manualSV[zone] = manualSV[zone];
+            status.pv[zone] = pv[zone];
+            status.sv[zone] = sv[zone];
+            status.duty[zone] = duty[zone];
+        }
+        reply(request, HOSTLINK_STATUS, &status, sizeof(status));
+        break;
+    }
+    }
+}
+
+// Tasks of the station with made up figures, only the pages are served like the station does
+void Simulator::health(const HostFrame *request)
+{
+    static const HostLinkTaskHealth tasks[] = {
+        {"log_task", 2, 700, 1, 2, 0x3},
+        {"health_task", 1, 380, 1, 2, 0x3},
+        {"lv_app_task", 180, 6100, 1, 2, 0x3},
+        {"sensor_task", 3, 90, 2, 2, 0x3},
+        {"pid_task", 40, 610, 3, 2, 0x3},
+        {"eeprom_task", 0, 400, 1, 2, 0x3},
+        {"flash_park0", 0, 200, 31, 3, 0x1},
+        {"flash_park1", 0, 200, 31, 3, 0x2},
+        {"recorder_task", 1, 350, 1, 2, 0x3},
+        {"sd_task", 0, 330, 1, 2, 0x3},
+        {"usb_task", 30, 380, 2, 2, 0x3},
+        {"link_task", 8, 300, 1, 2, 0x3},
+        {"sampler_task", 2, 420, 2, 2, 0x3},
+        {"modbus_task", 1, 390, 1, 2, 0x3},
+        {"IDLE0", 790, 180, 0, 1, 0x3},
+        {"IDLE1", 942, 180, 0, 1, 0x3},
+        {"Tmr Svc", 0, 900, 31, 2, 0x3},
+    };
+    static constexpr uint8_t taskCount = sizeof(tasks) / sizeof(tasks[0]);
+    if (request->len != 1)
+    {
+        ack(request, HOSTLINK_INVALID);
+        return;
+    }
+    HostLinkHealth summary = {};
+    summary.uptime = (nowUs() - started) / 1000000;
+    summary.window = 1000000;
+    summary.coreLoad[0] = 210;
+    summary.coreLoad[1] = 58;
+    summary.isrLoad[0] = 15;
+    summary.heapFree = 21000;
+    summary.heapMinimum = 19500;
+    summary.lvglSize = 65536;
+    summary.lvglFree = 30000;
+    summary.lvglBiggest = 24000;
+    summary.lvglFragmentation = 20;
+    summary.taskCount = taskCount;
+    summary.first = request->payload[0];
+    summary.count = summary.first < taskCount ? taskCount - summary.first : 0;
+    if (summary.count > HOSTLINK_HEALTH_TASKS)
+        summary.count = HOSTLINK_HEALTH_TASKS;
+    uint8_t answer[sizeof(HostLinkHealth) + HOSTLINK_HEALTH_TASKS * sizeof(HostLinkTaskHealth)];
+    memcpy(answer, &summary, sizeof(summary));
+    memcpy(&answer[sizeof(summary)], &tasks[summary.first], summary.count * sizeof(HostLinkTaskHealth));
+    reply(request, HOSTLINK_HEALTH, answer, sizeof(summary) + summary.count * sizeof(HostLinkTaskHealth));
+}
+
+// Pages of the run log in chunks, like the station serves them
+void Simulator::runPage(const HostFrame *request)
+{
+    if (request->len != sizeof(uint32_t) + 1)
+    {
+        ack(request, HOSTLINK_INVALID);
+        return;
+    }
+    HostLinkRunPage page = {};
+    memcpy(&page.sequence, request->payload, sizeof(page.sequence));
+    page.offset = request->payload[sizeof(page.sequence)];
+    page.oldest = 0;
+    page.next = runLog.size();
+    const RunPage *found = page.sequence < runLog.size() ? &runLog[page.sequence] : NULL;
+    if (found)
+    {
+        page.type = found->type;
+        page.len = found->payload.size();
+    }
+    page.count = page.offset < page.len ? std::min(page.len - page.offset, HOSTLINK_RUN_CHUNK) : 0;
+    uint8_t answer[sizeof(HostLinkRunPage) + HOSTLINK_RUN_CHUNK];
+    memcpy(answer, &page, sizeof(page));
+    if (page.count)
+        memcpy(&answer[sizeof(page)], &found->payload[page.offset], page.count);
+    reply(request, HOSTLINK_RUN_PAGE, answer, sizeof(page) + page.count);
+}
+
+// Same checks as the station, minus the storage
+void Simulator::handle(const HostFrame *request)
+{
+    const uint8_t *payload = request->payload;
+    switch (request->type)
+    {
+    case HOSTLINK_SET_TELEMETRY:
+        if (request->len == 1 && payload[0] <= HOSTLINK_TELEMETRY_MAX_RATE)
+        {
+            rate = payload[0];
+            ack(request, HOSTLINK_OK);
+        }
+        else
+            ack(request, HOSTLINK_INVALID);
+        break;
+    case HOSTLINK_GET_PROFILE:
+        if (request->len == 1 && payload[0] < profile_count)
+        {
+            uint8_t answer[1 + PROFILE_ENCODED_MAX];
+            answer[0] = payload[0];
+            reply(request, HOSTLINK_PROFILE, answer, 1 + profile_encode(&profiles[payload[0]], &answer[1]));
+        }
+        else
+            ack(request, HOSTLINK_INVALID);
+        break;
+    case HOSTLINK_SET_PROFILE:
+    {
+        Profile profile;
+        if (request->len >= 2 && payload[0] < profile_count &&
+            profile_decode(&profile, &payload[1], request->len - 1) == request->len - 1)
+        {
+            profiles[payload[0]] = profile;
+            ack(request, HOSTLINK_OK);
+        }
+        else
+            ack(request, HOSTLINK_INVALID);
+        break;
+    }
+    case HOSTLINK_GET_TUNING:
+        if (request->len == 1 && payload[0] <= 1)
+            reply(request, HOSTLINK_TUNING, &tuning[payload[0]], sizeof(HostLinkTuning));
+        else
+            ack(request, HOSTLINK_INVALID);
+        break;
+    case HOSTLINK_SET_TUNING:
+    {
+        HostLinkTuning received;
+        memcpy(&received, payload, sizeof(received));
+        if (request->len == sizeof(received) && received.zone <= 1 &&
+            received.breakpointCount <= HOSTLINK_TUNING_MAX_BREAKPOINT)
+        {
+            tuning[received.zone] = received;
+            ack(request, HOSTLINK_OK);
+        }
+        else
+            ack(request, HOSTLINK_INVALID);
+        break;
+    }
+    case HOSTLINK_START:
+    case HOSTLINK_STOP:
+    case HOSTLINK_SET_SV:
+    case HOSTLINK_SELECT_PROFILE:
+    case HOSTLINK_GET_STATUS:
+        command(request);
+        break;
+    case HOSTLINK_GET_HEALTH:
+        health(request);
+        break;
+    case HOSTLINK_GET_RUN_PAGE:
+        runPage(request);
+        break;
+    default:
+        ack(request, HOSTLINK_INVALID);
+        break;
+    }
+}
+
+/**
+ * @brief Serve the host tool until stop is set, the model runs in real time
+ *
+ * @param stop
+ * @return int 0, or 1 if the pty failed
+ */
+int Simulator::run(volatile bool *stop)
+{
+    uint64_t last = nowUs();
+    uint64_t nextSample = last;
+    while (!*stop)
+    {
+        uint64_t now = nowUs();
+        int wait = 2; // The Modbus pty is polled in between, every 2ms like the station
+        if (rate && now >= nextSample)
+            wait = 0;
+        else if (rate && nextSample - now < 2000)
+            wait = (nextSample - now + 999) / 1000;
+        HostFrame frame;
+        int got = port.receive(&frame, wait);
+        if (got < 0)
+            return 1;
+        serveModbus();
+        if (got > 0)
+        {
+            handle(&frame);
+            continue;
+        }
+
+        now = nowUs();
+        step((now - last) / 1e6f);
+        last = now;
+        if (rate && now >= nextSample)
+        {
+            sample();
+            nextSample += 1000000 / rate;
+            if (nextSample < now) // Don't catch up after a stall, like vTaskDelayUntil would
+                nextSample = now + 1000000 / rate;
+        }
+    }
+    return 0;
+}
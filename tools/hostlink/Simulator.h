@@ -0,0 +1,80 @@
+/**
+ * @file Simulator.h
+ * @brief Stand-in for the station on a pseudo terminal, so the host tool can be tried without the hardware
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Answers the same requests as the station from profiles and tuning kept in memory, and streams the telemetry of
+ * both operations on a first order model of both zones. Run control requests are answered right away instead of on
+ * the next control period. Every run is kept in an endless run log of the same pages as the station. A second pty
+ * serves the Modbus register map of the station. Like the station it never waits for the host, frames that
+ * don't fit the pty buffer are dropped and counted.
+ */
+#ifndef _SIMULATOR_H_
+#include "HostPort.h"
+#include "ModbusMap.h"
+#include "ModbusSlave.h"
+#include "profile_store.h"
+#include <vector>
+#define _SIMULATOR_H_
+
+class Simulator
+{
+public:
+    bool open(ModbusFraming framing);
+    // Path of the pty to give to the other commands
+    const char *getPath() { return path; }
+    // Path of the pty to give to a Modbus master
+    const char *getModbusPath() { return modbusPath; }
+    int run(volatile bool *stop);
+
+protected:
+    void handle(const HostFrame *request);
+    void reply(const HostFrame *request, uint8_t type, const void *payload, size_t len);
+    void ack(const HostFrame *request, HostLinkResult result);
+    void command(const HostFrame *request);
+    void health(const HostFrame *request);
+    void runPage(const HostFrame *request);
+    void record();
+    void step(float dt);
+    void sample();
+    void serveModbus();
+    static bool readRegisters(uint16_t address, uint16_t count, uint16_t *dest, void *context);
+    static int openPty(char *ptyPath, size_t size, int *slaveFd);
+
+    HostPort port;
+    int slave = -1; // Kept open so the pty survives the host tool closing it
+    char path[64] = {};
+    ModbusSlave modbus{MODBUS_RTU, 1, MODBUS_REG_COUNT, readRegisters, this};
+    int modbusMaster = -1;
+    int modbusSlave = -1;
+    char modbusPath[64] = {};
+    uint8_t modbusRx[MODBUS_MAX_ADU];
+    size_t modbusRxLen = 0;
+    uint64_t modbusLastReceive = 0;
+    uint8_t rate = HOSTLINK_DEFAULT_RATE;
+    uint32_t dropped = 0;
+    Profile profiles[profile_count];
+    HostLinkTuning tuning[2] = {};
+    // Model of each zone, bottom then top
+    float pv[2] = {25.0f, 25.0f};
+    uint8_t flags = 0; // HOSTLINK_FLAG_MANUAL or HOSTLINK_FLAG_AUTO while running
+    uint8_t selectedProfile = 0;
+    uint16_t manualSV[2] = {150, 200};
+    float sv[2] = {};
+    float integral[2] = {};
+    float lastError[2] = {};
+    float duty[2] = {};
+    float seconds = 0;
+    uint64_t started = 0; // in us, for the uptime of the health answers
+    struct RunPage
+    {
+        uint8_t type; // HostLinkRunPageType
+        std::vector<uint8_t> payload;
+    };
+    std::vector<RunPage> runLog; // Sequence of each page is its index, nothing is ever overwritten
+    uint32_t recordedSecond = 0; // Next run second a sample is recorded for
+};
+#endif
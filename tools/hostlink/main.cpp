@@ -0,0 +1,683 @@
+/**
+ * @file main.cpp
+ * @brief Host tool of the link interface: live telemetry, recording, plotting, profiles, tuning, run control,
+ * run log download and diagnostics
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The station shows up as three ACM devices, the console, the link and Modbus (usually /dev/ttyACM0, /dev/ttyACM1
+ * and /dev/ttyACM2, /dev/serial/by-id tells the stations apart by their board id). Run "hotberry-link simulate" to
+ * get a pty that behaves like the link interface of a station, and a second one like its Modbus interface.
+ */
+#include "Formats.h"
+#include "HostPort.h"
+#include "Simulator.h"
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static volatile bool stopRequested = false;
+
+static void onSignal(int) { stopRequested = true; }
+
+static double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: hotberry-link COMMAND [OPTIONS] PORT [FILE]\n"
+            "  monitor PORT                 print the telemetry\n"
+            "  record PORT FILE             record the telemetry to a CSV file\n"
+            "  plot PORT                    plot the PV and SV of both zones on the terminal\n"
+            "  get-profiles PORT [FILE]     download every profile, as PROFILES.CSV lines\n"
+            "  put-profiles PORT FILE       upload the profiles of a PROFILES.CSV file\n"
+            "  get-tuning PORT [FILE]       download the PID constants and gain schedule of both zones\n"
+            "  put-tuning PORT FILE         upload the tuning lines of a file\n"
+            "  start PORT manual|auto       start an operation, the auto one runs the selected profile\n"
+            "  stop PORT                    stop the running operation\n"
+            "  set-sv PORT BOTTOM TOP       set the SV of the manual operation in celcius\n"
+            "  select PORT INDEX            select the profile of the auto operation\n"
+            "  status PORT                  print the state of the station\n"
+            "  health PORT                  print the load of each task and core, the stack and heap margins\n"
+            "  get-runs PORT [FILE]         download the run log kept in the flash of the station, as CSV\n"
+            "  simulate                     serve a simulated station until interrupted, prints the pty of the link\n"
+            "                               then the pty of Modbus\n"
+            "Options:\n"
+            "  -r HZ       telemetry rate, 1 to %u, the station keeps it until it restarts (default %u)\n"
+            "  -t SECONDS  stop monitor, record and plot after this long\n"
+            "  -m FRAMING  Modbus framing of simulate, rtu or tcp (default rtu)\n",
+            HOSTLINK_TELEMETRY_MAX_RATE, HOSTLINK_DEFAULT_RATE);
+}
+
+static const char *resultName(uint8_t result)
+{
+    switch (result)
+    {
+    case HOSTLINK_OK:
+        return "ok";
+    case HOSTLINK_INVALID:
+        return "rejected as invalid";
+    case HOSTLINK_BUSY:
+        return "busy, the same screen is open on the station";
+    case HOSTLINK_STORAGE:
+        return "applied but not saved, the storage is full or failed";
+    case HOSTLINK_REFUSED:
+        return "refused, the other operation is running or the profile is in use";
+    default:
+        return "unknown result";
+    }
+}
+
+// Returns the result of the acknowledged request, or -1 if the station never answered
+static int requestAck(HostPort *port, uint8_t type, const void *payload, size_t len)
+{
+    HostFrame reply;
+    if (port->request(type, payload, len, HOSTLINK_ACK, &reply) <= 0 || reply.type != HOSTLINK_ACK ||
+        reply.len != 2)
+        return -1;
+    return reply.payload[1];
+}
+
+static bool setRate(HostPort *port, uint8_t rate)
+{
+    int result = requestAck(port, HOSTLINK_SET_TELEMETRY, &rate, 1);
+    if (result != HOSTLINK_OK)
+        fprintf(stderr, "Setting the telemetry rate failed: %s\n",
+                result < 0 ? "no answer, is this the link interface?" : resultName(result));
+    return result == HOSTLINK_OK;
+}
+
+struct StreamState
+{
+    FILE *csv = NULL;
+    bool print = false;
+    bool plot = false;
+    double start = 0;
+    uint32_t samples = 0;
+    uint32_t lost = 0;
+    uint32_t dropped = 0;
+    std::vector<HostLinkTelemetry> history; // Plot columns, oldest first
+    double lastDraw = 0;
+};
+
+static void drawPlot(StreamState *state)
+{
+    struct winsize ws = {};
+    int cols = 100, rows = 24;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 20 && ws.ws_row > 8)
+    {
+        cols = ws.ws_col;
+        rows = ws.ws_row;
+    }
+    int width = cols - 8, height = rows - 3;
+    while ((int)state->history.size() > width)
+        state->history.erase(state->history.begin());
+
+    float low = INFINITY, high = -INFINITY;
+    for (const HostLinkTelemetry &t : state->history)
+        for (uint8_t zone = 0; zone < 2; zone++)
+        {
+            low = fminf(low, fminf(t.pv[zone], t.sv[zone]));
+            high = fmaxf(high, fmaxf(t.pv[zone], t.sv[zone]));
+        }
+    if (state->history.empty())
+        return;
+    low = floorf(low / 10) * 10;
+    high = ceilf(high / 10) * 10;
+    if (high - low < 10)
+        high = low + 10;
+
+    std::vector<std::string> canvas(height, std::string(width, ' '));
+    auto put = [&](int x, float value, char c) {
+        int y = (int)roundf((high - value) / (high - low) * (height - 1));
+        if (y >= 0 && y < height && (canvas[y][x] == ' ' || c == 'B' || c == 'T'))
+            canvas[y][x] = c;
+    };
+    for (size_t x = 0; x < state->history.size(); x++)
+    {
+        const HostLinkTelemetry &t = state->history[x];
+        put(x, t.sv[0], '-');
+        put(x, t.sv[1], '=');
+        put(x, t.pv[0], 'B');
+        put(x, t.pv[1], 'T');
+    }
+
+    const HostLinkTelemetry &last = state->history.back();
+    printf("\033[H\033[2J");
+    for (int y = 0; y < height; y++)
+        printf("%6.0f |%s\n", high - (high - low) * y / (height - 1), canvas[y].c_str());
+    printf("B bottom PV %.1f  - SV %.0f  duty %.0f%%   T top PV %.1f  = SV %.0f  duty %.0f%%\n", last.pv[0],
+           last.sv[0], last.duty[0] * 100, last.pv[1], last.sv[1], last.duty[1] * 100);
+    printf("second %u  samples %u  lost %u  dropped %u", last.runSecond, state->samples, state->lost, last.dropped);
+    fflush(stdout);
+}
+
+static void onTelemetry(const HostLinkTelemetry *t, uint32_t lost, void *context)
+{
+    StreamState *state = (StreamState *)context;
+    state->samples++;
+    state->lost += lost;
+    state->dropped = t->dropped;
+    double elapsed = nowSeconds() - state->start;
+    if (state->csv)
+    {
+        fprintf(state->csv, "%.3f,%u,%u,%u,%u,%u,%u", elapsed, t->timestamp, t->runSecond, t->flags, t->loopTime,
+                t->loopPeriod, t->dropped);
+        for (uint8_t zone = 0; zone < 2; zone++)
+            fprintf(state->csv, ",%u,%.2f,%.3f,%.1f,%.5f,%.5f,%.5f,%.4f", t->status[zone], t->raw[zone], t->pv[zone],
+                    t->sv[zone], t->proportional[zone], t->integral[zone], t->derivative[zone], t->duty[zone]);
+        fprintf(state->csv, "\n");
+    }
+    if (state->print)
+        printf("%8.3f s  run %5u s  bottom %6.2f/%3.0f %5.1f%%  top %6.2f/%3.0f %5.1f%%  loop %5u us  dropped %u%s\n",
+               elapsed, t->runSecond, t->pv[0], t->sv[0], t->duty[0] * 100, t->pv[1], t->sv[1], t->duty[1] * 100,
+               t->loopTime, t->dropped, lost ? "  (frames lost)" : "");
+    if (state->plot)
+    {
+        state->history.push_back(*t);
+        if (elapsed - state->lastDraw >= 0.2)
+        {
+            drawPlot(state);
+            state->lastDraw = elapsed;
+        }
+    }
+}
+
+static int stream(HostPort *port, StreamState *state, int rate, double duration)
+{
+    port->onTelemetry(onTelemetry, state);
+    if (rate >= 0 && !setRate(port, rate))
+        return 1;
+    state->start = nowSeconds();
+    if (state->csv)
+        fprintf(state->csv, "host_s,timestamp_us,run_s,flags,loop_us,period_us,dropped,"
+                            "bottom_status,bottom_raw,bottom_pv,bottom_sv,bottom_p,bottom_i,bottom_d,bottom_duty,"
+                            "top_status,top_raw,top_pv,top_sv,top_p,top_i,top_d,top_duty\n");
+    while (!stopRequested && (duration <= 0 || nowSeconds() - state->start < duration))
+    {
+        HostFrame frame;
+        int got = port->receive(&frame, 100);
+        if (got < 0)
+        {
+            fprintf(stderr, "\nThe port was closed\n");
+            break;
+        }
+        if (got > 0)
+            port->handleTelemetry(&frame);
+    }
+    if (state->plot)
+        printf("\n");
+    fprintf(stderr, "%u samples, %u lost on the way, %u dropped by the station, %u bad frames\n", state->samples,
+            state->lost, state->dropped, port->getBadFrames());
+    return 0;
+}
+
+static int getProfiles(HostPort *port, FILE *out)
+{
+    fprintf(out, "# profile,startTopHeaterAt,second:celcius,...\n");
+    for (uint16_t i = 0; i < profile_count; i++)
+    {
+        uint8_t index = i;
+        HostFrame reply;
+        Profile profile;
+        if (port->request(HOSTLINK_GET_PROFILE, &index, 1, HOSTLINK_PROFILE, &reply) <= 0 ||
+            reply.type != HOSTLINK_PROFILE || reply.len < 2 || reply.payload[0] != index ||
+            !profile_decode(&profile, &reply.payload[1], reply.len - 1))
+        {
+            fprintf(stderr, "Profile %u couldn't be downloaded\n", i);
+            return 1;
+        }
+        char line[FORMATS_LINE_SIZE];
+        format_profile(line, i, &profile);
+        fprintf(out, "%s\n", line);
+    }
+    return 0;
+}
+
+static int putProfiles(HostPort *port, FILE *in)
+{
+    char line[FORMATS_LINE_SIZE];
+    bool skip;
+    uint32_t number = 0, uploaded = 0, failed = 0;
+    while (read_line(in, line, sizeof(line), &skip))
+    {
+        number++;
+        if (skip)
+            continue;
+        uint16_t index;
+        Profile profile;
+        uint8_t payload[1 + PROFILE_ENCODED_MAX];
+        uint8_t len = 0;
+        if (parse_profile(line, &index, &profile))
+            len = profile_encode(&profile, &payload[1]);
+        if (len == 0)
+        {
+            fprintf(stderr, "Line %u is not a valid profile\n", number);
+            failed++;
+            continue;
+        }
+        payload[0] = index;
+        int result = requestAck(port, HOSTLINK_SET_PROFILE, payload, 1 + len);
+        if (result == HOSTLINK_OK)
+            uploaded++;
+        else
+        {
+            fprintf(stderr, "Profile %u: %s\n", index, result < 0 ? "no answer" : resultName(result));
+            failed++;
+        }
+    }
+    fprintf(stderr, "%u profiles uploaded, %u failed\n", uploaded, failed);
+    return failed ? 1 : 0;
+}
+
+static int getTuning(HostPort *port, FILE *out)
+{
+    fprintf(out, "# zone,kp,ki,kd,tau,celcius:kp:ki:kd,...\n");
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        HostFrame reply;
+        if (port->request(HOSTLINK_GET_TUNING, &zone, 1, HOSTLINK_TUNING, &reply) <= 0 ||
+            reply.type != HOSTLINK_TUNING || reply.len != sizeof(HostLinkTuning))
+        {
+            fprintf(stderr, "The tuning of zone %u couldn't be downloaded\n", zone);
+            return 1;
+        }
+        HostLinkTuning tuning;
+        memcpy(&tuning, reply.payload, sizeof(tuning));
+        char line[FORMATS_LINE_SIZE];
+        format_tuning(line, &tuning);
+        fprintf(out, "%s\n", line);
+    }
+    return 0;
+}
+
+static int putTuning(HostPort *port, FILE *in)
+{
+    char line[FORMATS_LINE_SIZE];
+    bool skip;
+    uint32_t number = 0, failed = 0;
+    while (read_line(in, line, sizeof(line), &skip))
+    {
+        number++;
+        if (skip)
+            continue;
+        HostLinkTuning tuning;
+        if (!parse_tuning(line, &tuning))
+        {
+            fprintf(stderr, "Line %u is not a valid tuning\n", number);
+            failed++;
+            continue;
+        }
+        int result = requestAck(port, HOSTLINK_SET_TUNING, &tuning, sizeof(tuning));
+        if (result != HOSTLINK_OK)
+        {
+            fprintf(stderr, "Line %u: %s\n", number, result < 0 ? "no answer" : resultName(result));
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+// Run control requests, the arguments follow the port
+static int control(HostPort *port, const char *command, int argc, char **argv)
+{
+    uint8_t type, payload[4];
+    size_t len = 0;
+    char *end;
+    if (!strcmp(command, "start") && argc == 1 && (!strcmp(argv[0], "manual") || !strcmp(argv[0], "auto")))
+    {
+        type = HOSTLINK_START;
+        payload[len++] = !strcmp(argv[0], "auto") ? HOSTLINK_MODE_AUTO : HOSTLINK_MODE_MANUAL;
+    }
+    else if (!strcmp(command, "stop") && argc == 0)
+        type = HOSTLINK_STOP;
+    else if (!strcmp(command, "set-sv") && argc == 2)
+    {
+        type = HOSTLINK_SET_SV;
+        for (int i = 0; i < 2; i++)
+        {
+            long sv = strtol(argv[i], &end, 10);
+            if (*end || end == argv[i] || sv < 0 || sv > HOSTLINK_MAXIMUM_SV)
+            {
+                fprintf(stderr, "The SV goes from 0 to %u celcius\n", HOSTLINK_MAXIMUM_SV);
+                return 2;
+            }
+            payload[len++] = sv & 0xFF;
+            payload[len++] = sv >> 8;
+        }
+    }
+    else if (!strcmp(command, "select") && argc == 1)
+    {
+        type = HOSTLINK_SELECT_PROFILE;
+        long index = strtol(argv[0], &end, 10);
+        if (*end || end == argv[0] || index < 0 || index >= profile_count)
+        {
+            fprintf(stderr, "The profile goes from 0 to %u\n", profile_count - 1);
+            return 2;
+        }
+        payload[len++] = index;
+    }
+    else
+    {
+        usage();
+        return 2;
+    }
+    int result = requestAck(port, type, payload, len);
+    if (result != HOSTLINK_OK)
+    {
+        fprintf(stderr, "%s: %s\n", command, result < 0 ? "no answer" : resultName(result));
+        return 1;
+    }
+    return 0;
+}
+
+static int printStatus(HostPort *port)
+{
+    HostFrame reply;
+    if (port->request(HOSTLINK_GET_STATUS, NULL, 0, HOSTLINK_STATUS, &reply) <= 0 || reply.type != HOSTLINK_STATUS ||
+        reply.len != sizeof(HostLinkStatus))
+    {
+        fprintf(stderr, "The status couldn't be read\n");
+        return 1;
+    }
+    HostLinkStatus s;
+    memcpy(&s, reply.payload, sizeof(s));
+    const char *operation = s.flags & HOSTLINK_FLAG_AUTO ? "auto" : (s.flags & HOSTLINK_FLAG_MANUAL ? "manual" : "idle");
+    printf("operation %s  run %u s  profile %u  manual SV %u/%u\n", operation, s.runSecond, s.selectedProfile,
+           s.manualSV[0], s.manualSV[1]);
+    const char *zoneName[2] = {"bottom", "top"};
+    for (uint8_t zone = 0; zone < 2; zone++)
+        printf("%-6s  PV %6.2f  SV %3.0f  duty %5.1f%%  thermocouple status %u\n", zoneName[zone], s.pv[zone], s.sv[zone],
+               s.duty[zone] * 100, s.status[zone]);
+    return 0;
+}
+
+// Loads are in permille, printed as percent
+static int printHealth(HostPort *port)
+{
+    static const char *stateName[] = {"running", "ready", "blocked", "suspended", "deleted"};
+    uint8_t first = 0;
+    uint8_t taskCount = 0;
+    do
+    {
+        HostFrame reply;
+        HostLinkHealth h;
+        bool valid = port->request(HOSTLINK_GET_HEALTH, &first, 1, HOSTLINK_HEALTH, &reply) > 0 &&
+                     reply.type == HOSTLINK_HEALTH && reply.len >= sizeof(h);
+        if (valid)
+        {
+            memcpy(&h, reply.payload, sizeof(h));
+            valid = reply.len == sizeof(h) + h.count * sizeof(HostLinkTaskHealth);
+        }
+        if (!valid)
+        {
+            fprintf(stderr, "The health couldn't be read\n");
+            return 1;
+        }
+        if (first == 0)
+        {
+            if (h.window == 0)
+            {
+                printf("Up %u s, the first window isn't over yet\n", h.uptime);
+                return 0;
+            }
+            printf("up %u s  window %.3f s\n", h.uptime, h.window / 1e6);
+            for (uint8_t core = 0; core < 2; core++)
+                printf("core %u  load %5.1f%%  ISR %5.1f%%\n", core, h.coreLoad[core] / 10.0, h.isrLoad[core] / 10.0);
+            printf("heap  %u B free, %u B lowest\n", h.heapFree, h.heapMinimum);
+            printf("LVGL  %u of %u B free, biggest block %u B, %u%% fragmented\n", h.lvglFree, h.lvglSize,
+                   h.lvglBiggest, h.lvglFragmentation);
+            printf("%-16s %-5s %4s %-9s %6s %10s\n", "task", "core", "prio", "state", "CPU", "stack free");
+        }
+        for (uint8_t i = 0; i < h.count; i++)
+        {
+            HostLinkTaskHealth t;
+            memcpy(&t, &reply.payload[sizeof(h) + i * sizeof(t)], sizeof(t));
+            const char *core = t.affinity == 0x1 ? "0" : (t.affinity == 0x2 ? "1" : "any");
+            printf("%-16.*s %-5s %4u %-9s %5.1f%% %10u\n", HOSTLINK_TASK_NAME_LENGTH, t.name, core, t.priority,
+                   t.state < sizeof(stateName) / sizeof(stateName[0]) ? stateName[t.state] : "?", t.load / 10.0,
+                   t.stackFree);
+        }
+        taskCount = h.taskCount;
+        first += h.count;
+        if (h.count == 0)
+            break;
+    } while (first < taskCount);
+    return 0;
+}
+
+// Whole page of the run log, chunk after chunk. False if the station never answered or the page changed meanwhile.
+static bool getRunPage(HostPort *port, uint32_t sequence, HostLinkRunPage *page, uint8_t *data)
+{
+    uint8_t offset = 0;
+    do
+    {
+        uint8_t payload[sizeof(uint32_t) + 1];
+        memcpy(payload, &sequence, sizeof(sequence));
+        payload[sizeof(sequence)] = offset;
+        HostFrame reply;
+        HostLinkRunPage chunk;
+        if (port->request(HOSTLINK_GET_RUN_PAGE, payload, sizeof(payload), HOSTLINK_RUN_PAGE, &reply) <= 0 ||
+            reply.type != HOSTLINK_RUN_PAGE || reply.len < sizeof(chunk))
+            return false;
+        memcpy(&chunk, reply.payload, sizeof(chunk));
+        if (reply.len != sizeof(chunk) + chunk.count || chunk.sequence != sequence || chunk.offset != offset ||
+            chunk.len > HOSTLINK_RUN_PAGE_SIZE || chunk.offset + chunk.count > chunk.len ||
+            (offset && (chunk.type != page->type || chunk.len != page->len)))
+            return false;
+        memcpy(&data[offset], &reply.payload[sizeof(chunk)], chunk.count);
+        *page = chunk;
+        offset += chunk.count;
+        if (chunk.count == 0)
+            break;
+    } while (offset < page->len);
+    return true;
+}
+
+// Same columns as the RUN.CSV log of the SD card, plus the run they belong to. Runs are numbered from the oldest
+// one still in the log, samples whose run header was already overwritten belong to run 0.
+static int getRuns(HostPort *port, FILE *out)
+{
+    HostLinkRunPage page;
+    uint8_t data[HOSTLINK_RUN_PAGE_SIZE];
+    if (!getRunPage(port, 0, &page, data))
+    {
+        fprintf(stderr, "The run log couldn't be read\n");
+        return 1;
+    }
+    // The station goes on recording while this downloads, the pages written meanwhile are left for the next time
+    uint32_t end = page.next;
+    uint32_t runs = 0, samples = 0, lost = 0;
+    fprintf(out, "run,second,bottomSV,topSV,bottomPV,topPV,bottomDuty,topDuty,bottomStatus,topStatus,learning\n");
+    for (uint32_t sequence = page.oldest; sequence != end; sequence++)
+    {
+        if (!getRunPage(port, sequence, &page, data))
+        {
+            fprintf(stderr, "Page %u of the run log couldn't be read\n", sequence);
+            return 1;
+        }
+        if (page.type == HOSTLINK_RUN_HEADER && page.len >= HOSTLINK_RUN_BOARD_ID_SIZE + 3)
+        {
+            runs++;
+            const uint8_t *h = &data[HOSTLINK_RUN_BOARD_ID_SIZE];
+            if (h[0])
+                fprintf(out, "# Run %u, auto operation, profile %u\n", runs, h[1] | h[2] << 8);
+            else
+                fprintf(out, "# Run %u, manual operation\n", runs);
+        }
+        else if (page.type == HOSTLINK_RUN_RECORDS)
+            for (uint8_t i = 0; i + HOSTLINK_RUN_RECORD_SIZE <= page.len; i += HOSTLINK_RUN_RECORD_SIZE)
+            {
+                const uint8_t *r = &data[i];
+                uint16_t values[7];
+                for (uint8_t v = 0; v < 7; v++)
+                    values[v] = r[2 * v] | r[2 * v + 1] << 8;
+                fprintf(out, "%u,%u,%u,%u,%.1f,%.1f,%u,%u,%u,%u,%u\n", runs, values[0], values[1], values[2],
+                        (int16_t)values[3] / 10.0, (int16_t)values[4] / 10.0, values[5], values[6], r[14] & 0x07,
+                        r[14] >> 3 & 0x07, r[14] >> 7);
+                samples++;
+            }
+        else
+            lost++;
+    }
+    fprintf(stderr, "%u runs, %u samples, %u pages overwritten or corrupted\n", runs, samples, lost);
+    return 0;
+}
+
+static int simulate(ModbusFraming framing)
+{
+    static Simulator simulator;
+    if (!simulator.open(framing))
+    {
+        fprintf(stderr, "Creating the pty failed: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("%s\n%s\n", simulator.getPath(), simulator.getModbusPath());
+    fflush(stdout);
+    return simulator.run(&stopRequested);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 2;
+    }
+    const char *command = argv[1];
+    int rate = -1;
+    double duration = 0;
+    ModbusFraming framing = MODBUS_RTU;
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "r:t:m:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            rate = atoi(optarg);
+            if (rate < 1 || rate > HOSTLINK_TELEMETRY_MAX_RATE)
+            {
+                fprintf(stderr, "The rate goes from 1 to %u Hz\n", HOSTLINK_TELEMETRY_MAX_RATE);
+                return 2;
+            }
+            break;
+        case 't':
+            duration = atof(optarg);
+            break;
+        case 'm':
+            if (strcmp(optarg, "rtu") && strcmp(optarg, "tcp"))
+            {
+                usage();
+                return 2;
+            }
+            framing = !strcmp(optarg, "tcp") ? MODBUS_TCP : MODBUS_RTU;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (!strcmp(command, "simulate"))
+        return simulate(framing);
+
+    if (optind >= argc)
+    {
+        usage();
+        return 2;
+    }
+    const char *path = argv[optind++];
+    const char *file = optind < argc ? argv[optind] : NULL;
+    HostPort port;
+    if (!port.open(path))
+    {
+        fprintf(stderr, "Opening %s failed: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (!strcmp(command, "start") || !strcmp(command, "stop") || !strcmp(command, "set-sv") ||
+        !strcmp(command, "select"))
+        return control(&port, command, argc - optind, &argv[optind]);
+    if (!strcmp(command, "status"))
+        return printStatus(&port);
+    if (!strcmp(command, "health"))
+        return printHealth(&port);
+
+    bool writes = !strcmp(command, "record") || !strcmp(command, "get-profiles") || !strcmp(command, "get-tuning") ||
+                  !strcmp(command, "get-runs");
+    bool reads = !strcmp(command, "put-profiles") || !strcmp(command, "put-tuning");
+    FILE *f = NULL;
+    if ((reads || !strcmp(command, "record")) && file == NULL)
+    {
+        usage();
+        return 2;
+    }
+    if (file)
+    {
+        f = fopen(file, writes ? "w" : "r");
+        if (f == NULL)
+        {
+            fprintf(stderr, "Opening %s failed: %s\n", file, strerror(errno));
+            return 1;
+        }
+    }
+
+    int status;
+    StreamState state;
+    if (!strcmp(command, "monitor"))
+    {
+        state.print = true;
+        status = stream(&port, &state, rate, duration);
+    }
+    else if (!strcmp(command, "record"))
+    {
+        state.csv = f;
+        status = stream(&port, &state, rate, duration);
+    }
+    else if (!strcmp(command, "plot"))
+    {
+        state.plot = true;
+        status = stream(&port, &state, rate, duration);
+    }
+    else if (!strcmp(command, "get-profiles"))
+        status = getProfiles(&port, f ? f : stdout);
+    else if (!strcmp(command, "put-profiles"))
+        status = putProfiles(&port, f);
+    else if (!strcmp(command, "get-tuning"))
+        status = getTuning(&port, f ? f : stdout);
+    else if (!strcmp(command, "put-tuning"))
+        status = putTuning(&port, f);
+    else if (!strcmp(command, "get-runs"))
+        status = getRuns(&port, f ? f : stdout);
+    else
+    {
+        usage();
+        status = 2;
+    }
+    if (f && fclose(f) != 0)
+    {
+        fprintf(stderr, "Writing %s failed: %s\n", file, strerror(errno));
+        status = 1;
+    }
+    return status;
+}
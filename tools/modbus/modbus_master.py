@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Reference Modbus master of the station, standard library only.
+
+Reads the register map of lib/Modbus/ModbusMap.h from the Modbus interface of a station (the third ACM device,
+usually /dev/ttyACM2) or from the pty given by "hotberry-link simulate", and prints it decoded. With --check it also
+sends the requests the slave has to refuse or ignore and checks its answers, e.g.
+
+    modbus_master.py /dev/ttyACM2
+    modbus_master.py --framing tcp --check /dev/pts/5
+
+The framing has to match the one the firmware or the simulator was built or started with.
+"""
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+READ_HOLDING = 0x03
+READ_INPUT = 0x04
+ILLEGAL_FUNCTION = 0x01
+ILLEGAL_ADDRESS = 0x02
+ILLEGAL_VALUE = 0x03
+
+REG_COUNT = 28
+STATES = {0: "idle", 1: "manual", 2: "auto"}
+ALARMS = ["bottom sensor", "top sensor", "bottom stale", "top stale"]
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+class Master:
+    def __init__(self, path, framing, unit, timeout):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.framing = framing
+        self.unit = unit
+        self.timeout = timeout
+        self.transaction = 0
+
+    def frame(self, pdu, unit=None):
+        unit = self.unit if unit is None else unit
+        if self.framing == "rtu":
+            adu = bytes([unit]) + pdu
+            return adu + struct.pack("<H", crc16(adu))
+        self.transaction = (self.transaction + 1) & 0xFFFF
+        return struct.pack(">HHHB", self.transaction, 0, len(pdu) + 1, unit) + pdu
+
+    # Everything that comes back within the timeout, the slave never sends anything unasked
+    def transfer(self, raw):
+        os.write(self.fd, raw)
+        answer = b""
+        end = time.monotonic() + self.timeout
+        while time.monotonic() < end:
+            ready, _, _ = select.select([self.fd], [], [], 0.02)
+            if ready:
+                answer += os.read(self.fd, 512)
+        return answer
+
+    # PDU of the answer, None if nothing came back
+    def request(self, pdu, unit=None):
+        answer = self.transfer(self.frame(pdu, unit))
+        if not answer:
+            return None
+        if self.framing == "rtu":
+            if len(answer) < 4 or crc16(answer) != 0:
+                raise ValueError("bad CRC: " + answer.hex())
+            return answer[1:-2]
+        if len(answer) < 8 or struct.unpack(">H", answer[:2])[0] != self.transaction:
+            raise ValueError("bad MBAP header: " + answer.hex())
+        return answer[7:]
+
+    def read(self, function, address, count):
+        pdu = self.request(struct.pack(">BHH", function, address, count))
+        if pdu is None:
+            raise TimeoutError("no answer")
+        if pdu[0] & 0x80:
+            raise ValueError("exception 0x%02x" % pdu[1])
+        return struct.unpack(">%dH" % count, pdu[2:])
+
+
+def signed(value):
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def show(registers):
+    alarms = [name for i, name in enumerate(ALARMS) if registers[3] >> i & 1]
+    print("State      %s, second %u, profile %u" % (STATES.get(registers[0], registers[0]), registers[1], registers[2]))
+    print("Alarms     %s" % (", ".join(alarms) or "none"))
+    print("Status     bottom %u, top %u" % (registers[4], registers[5]))
+    print("PV         bottom %.1f, top %.1f" % (signed(registers[6]) / 10, signed(registers[7]) / 10))
+    print("SV         bottom %.1f, top %.1f" % (signed(registers[8]) / 10, signed(registers[9]) / 10))
+    print("Manual SV  bottom %d, top %d" % (signed(registers[10]), signed(registers[11])))
+    print("Duty       bottom %u, top %u" % (registers[12], registers[13]))
+    gains = [struct.unpack(">f", struct.pack(">HH", registers[16 + 2 * i], registers[17 + 2 * i]))[0] for i in range(6)]
+    print("Gains      bottom %g %g %g, top %g %g %g" % tuple(gains))
+
+
+# Answers the slave has to give to requests it can't serve, and the ones it has to stay silent on
+def check(master):
+    failures = 0
+
+    def expect(name, pdu, wanted, unit=None):
+        nonlocal failures
+        answer = master.request(pdu, unit)
+        ok = answer == wanted
+        failures += not ok
+        print("%-28s %s" % (name, "ok" if ok else "got %s" % (answer.hex() if answer else "no answer")))
+
+    def exception(function, code):
+        return bytes([function | 0x80, code])
+
+    # Same map as the holding registers, its values may have moved on since the read above
+    answer = master.request(struct.pack(">BHH", READ_INPUT, 6, 2))
+    ok = answer is not None and answer[:2] == bytes([READ_INPUT, 4]) and len(answer) == 6
+    failures += not ok
+    print("%-28s %s" % ("Input registers", "ok" if ok else "got " + (answer.hex() if answer else "no answer")))
+    expect("Past the end", struct.pack(">BHH", READ_HOLDING, REG_COUNT - 1, 2),
+           exception(READ_HOLDING, ILLEGAL_ADDRESS))
+    expect("Zero registers", struct.pack(">BHH", READ_HOLDING, 0, 0), exception(READ_HOLDING, ILLEGAL_VALUE))
+    expect("Write single register", struct.pack(">BHH", 0x06, 0, 1), exception(0x06, ILLEGAL_FUNCTION))
+    if master.framing == "rtu":
+        expect("Other slave", struct.pack(">BHH", READ_HOLDING, 0, 1), None, unit=(master.unit % 247) + 1)
+        expect("Broadcast", struct.pack(">BHH", READ_HOLDING, 0, 1), None, unit=0)
+        # A bad CRC drops one byte at a time, the good frame right behind it is still answered
+        bad = bytearray(master.frame(struct.pack(">BHH", READ_HOLDING, 0, 1)))
+        bad[-1] ^= 1
+        good = master.frame(struct.pack(">BHH", READ_HOLDING, 1, 1))
+        answer = master.transfer(bytes(bad) + good)
+        ok = len(answer) == 7 and crc16(answer) == 0 and answer[1:3] == bytes([READ_HOLDING, 2])
+        failures += not ok
+        print("%-28s %s" % ("Bad CRC then a good frame", "ok" if ok else "got " + (answer.hex() or "no answer")))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("path", help="Modbus interface of the station or pty of the simulator")
+    parser.add_argument("--framing", choices=["rtu", "tcp"], default="rtu")
+    parser.add_argument("--unit", type=int, default=1, help="slave address (default 1)")
+    parser.add_argument("--timeout", type=float, default=0.3, help="in s, wait for each answer (default 0.3)")
+    parser.add_argument("--check", action="store_true", help="also check the answers to bad requests")
+    args = parser.parse_args()
+
+    master = Master(args.path, args.framing, args.unit, args.timeout)
+    try:
+        show(master.read(READ_HOLDING, 0, REG_COUNT))
+        failures = check(master) if args.check else 0
+    except (TimeoutError, ValueError) as e:
+        print("Read failed: %s" % e)
+        return 1
+    if failures:
+        print("%d checks failed" % failures)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())